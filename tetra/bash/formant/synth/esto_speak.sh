@@ -67,13 +67,14 @@ parse_and_speak_esto() {
             local duration="${BASH_REMATCH[2]}"
             local pitch="${BASH_REMATCH[3]}"
 
-            # Apply rate multiplier to duration
-            duration=$(bc -l <<< "scale=0; $duration / $CURRENT_RATE")
+            # Durations are sent as written; the engine applies @RATE
+            # and sequences phonemes on its own timeline, so the script
+            # is streamed without waiting
 
-            # Skip rest/silence phonemes (pitch 0)
+            # Rest/silence phonemes (pitch 0) hold the timeline silently
             if [[ "$pitch" == "0" ]]; then
                 print_debug "Rest: ${duration}ms"
-                sleep $(bc -l <<< "scale=3; $duration / 1000")
+                formant_phoneme rest "$duration" "$CURRENT_PITCH" 0.0 0.3
                 continue
             fi
 
@@ -81,10 +82,6 @@ parse_and_speak_esto() {
 
             # Send to formant
             formant_phoneme "$phoneme" "$duration" "$pitch" 0.7 0.3
-
-            # Wait for duration (accounting for rate)
-            local wait_time=$(bc -l <<< "scale=3; $duration / 1000")
-            sleep "$wait_time"
         else
             # Invalid line format
             print_error "Invalid format at line $line_num: $line"
@@ -258,8 +255,7 @@ main() {
     # Parse and speak
     parse_and_speak_esto "$esto_file"
 
-    # Cleanup
-    sleep 0.5
+    # Cleanup (formant_stop waits for queued speech to finish)
     print_info "Stopping formant engine..."
     formant_stop
 
@@ -57,11 +57,17 @@ formant_start() {
 
 formant_stop() {
     if [[ -n "$FORMANT_PID" ]]; then
-        # Send STOP command
+        # Send STOP command; the engine exits once queued speech has played
         formant_send "STOP"
-        sleep 0.2
 
-        # Kill process if still running
+        # Wait for exit, killing the process only if it hangs
+        local timeout=${FORMANT_STOP_TIMEOUT:-30}
+        local waited=0
+        while kill -0 "$FORMANT_PID" 2>/dev/null && (( waited < timeout * 10 )); do
+            sleep 0.1
+            ((waited++)) || true
+        done
+
         if kill -0 "$FORMANT_PID" 2>/dev/null; then
             kill "$FORMANT_PID"
         fi
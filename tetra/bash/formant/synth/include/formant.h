@@ -15,6 +15,8 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
 #include <portaudio.h>
 
 #ifdef __cplusplus
@@ -32,10 +34,26 @@ extern "C" {
 #define FORMANT_SAMPLE_RATE_DEFAULT 48000.0f
 #define FORMANT_BUFFER_SIZE_DEFAULT 512
 #define FORMANT_MAX_FORMANTS 5
+#define FORMANT_LPC_ORDER 10         /* Two poles per formant */
+#define FORMANT_BANK_LANES 8        /* FORMANT_MAX_FORMANTS padded to a vector multiple */
+#define FORMANT_BANK_BLOCK 256      /* Largest engine sub-block (max control rate) */
+#define FORMANT_CONTROL_RATE_DEFAULT 32  /* Samples per formant/coefficient update */
+#define FORMANT_GLOTTAL_TABLE_SIZE 1024  /* Samples per glottal wavetable cycle */
+#define FORMANT_GLOTTAL_MIPS 6      /* Band-limited levels per glottal shape */
+#define FORMANT_NOISE_SEED_DEFAULT 1
 #define FORMANT_MAX_GRAINS 64
-#define FORMANT_MAX_COMMANDS 256
+#define FORMANT_MAX_VOICES 64       /* Voices in a choir */
+#define FORMANT_MAX_WORKERS 32      /* Choir render threads, including the caller */
+#define FORMANT_CHOIR_BLOCK 4096    /* Largest block rendered per voice in one pass */
+#define FORMANT_VOICE_ALL (-1)      /* Command target: every voice in the choir */
+#define FORMANT_MAX_SESSIONS 64     /* Concurrent server connections */
+#define FORMANT_SESSION_RING 16384  /* Per-session output ring (samples, power of 2) */
+#define FORMANT_SESSION_LINE 1024   /* Longest ECL line accepted from a client */
+#define FORMANT_MAX_COMMANDS 256    /* Command ring capacity (power of 2) */
+#define FORMANT_CACHE_LINE 64
 
 #define FORMANT_IPA_MAX_LEN 4
+#define FORMANT_MAX_PHONEMES 64     /* Phoneme IDs are 0..FORMANT_MAX_PHONEMES-1 */
 #define FORMANT_PARAM_MAX_LEN 16
 #define FORMANT_EMOTION_MAX_LEN 16
 
@@ -131,18 +149,75 @@ typedef struct {
     float gain;        /* Gain multiplier */
 } formant_filter_t;
 
-/* LPC filter for CELP synthesis */
+/* LPC lattice filter for CELP synthesis (reflection coefficient form) */
 typedef struct {
-    float a[10];       /* LPC coefficients (10th order) */
-    float gain;        /* Overall gain */
-    float mem[10];     /* Filter memory (state) */
+    float k[FORMANT_LPC_ORDER];         /* Reflection coefficients in use */
+    float k_target[FORMANT_LPC_ORDER];  /* Shape being glided towards */
+    float gain;                         /* Input gain in use */
+    float gain_target;
+    float b[FORMANT_LPC_ORDER];         /* Backward prediction state */
+    float glide;                        /* One-pole glide coefficient per sample */
+    int glide_length;                   /* Samples per glide before snapping */
+    int glide_remaining;                /* Samples left in the current glide */
 } formant_lpc_filter_t;
 
+/* Formant bank block kernels (selectable at runtime) */
+typedef enum {
+    FORMANT_BANK_KERNEL_SCALAR,   /* Portable per-lane loop */
+    FORMANT_BANK_KERNEL_SIMD      /* SSE/AVX/NEON lanes (falls back to scalar) */
+} formant_bank_kernel_t;
+
+/**
+ * Parallel resonator bank in structure-of-arrays layout
+ *
+ * Lane f holds formant f. All resonators are constant-skirt bandpass
+ * biquads (b1 = 0, b2 = -b0) fed by the same input, so the input history
+ * is shared and each lane only carries its own output history. Lanes past
+ * num_formants have zero coefficients so kernels can always run full width.
+ */
 typedef struct {
-    formant_filter_t filters[FORMANT_MAX_FORMANTS];
-    int num_formants;  /* Typically 3-5 */
+    _Alignas(32) float b0[FORMANT_BANK_LANES];
+    _Alignas(32) float a1[FORMANT_BANK_LANES];
+    _Alignas(32) float a2[FORMANT_BANK_LANES];
+    _Alignas(32) float gain[FORMANT_BANK_LANES];
+    _Alignas(32) float b0_target[FORMANT_BANK_LANES];    /* Reached at the end of the next block */
+    _Alignas(32) float a1_target[FORMANT_BANK_LANES];
+    _Alignas(32) float a2_target[FORMANT_BANK_LANES];
+    _Alignas(32) float gain_target[FORMANT_BANK_LANES];
+    _Alignas(32) float y1[FORMANT_BANK_LANES];
+    _Alignas(32) float y2[FORMANT_BANK_LANES];
+    float x1, x2;                          /* Shared input history */
+
+    float freq[FORMANT_BANK_LANES];        /* Center frequency of target coefficients (Hz) */
+    float bw[FORMANT_BANK_LANES];          /* Bandwidth of target coefficients (Hz) */
+    bool ramp_pending;                     /* Targets differ from current coefficients */
+    float sample_rate;
+    int num_formants;                      /* Active lanes (1-5) */
+    formant_bank_kernel_t kernel;
 } formant_bank_t;
 
+/* ============================================================================
+ * Data Structures - Noise
+ * ========================================================================= */
+
+#define FORMANT_NOISE_LANES 8       /* Independent xorshift32 generators */
+#define FORMANT_NOISE_BLOCK 64      /* White noise samples generated per refill */
+
+/**
+ * Per-voice noise source: PRNG lanes plus the memories of the noise filters
+ * Seeded deterministically, so offline renders are bit-reproducible.
+ */
+typedef struct {
+    _Alignas(32) uint32_t state[FORMANT_NOISE_LANES];
+    _Alignas(32) float block[FORMANT_NOISE_BLOCK];   /* Pre-generated white noise */
+    int pos;                        /* Next unread sample in block */
+
+    /* Filter memories */
+    float aspiration_lp;
+    float frication_hp, frication_lp;
+    float burst_hp;
+} formant_noise_t;
+
 /* ============================================================================
  * Data Structures - Grain
  * ========================================================================= */
@@ -184,6 +259,7 @@ typedef struct {
     uint16_t gain_map_chunks;             /* Number of chunks in gain map */
     float selection_gain;                 /* Overall gain adjustment (dB) */
     float* audio_data;                    /* Loaded audio samples (dynamic) */
+    const int16_t* audio_pcm16;           /* Mapped int16 bank: samples / 32768 (audio_data NULL) */
     uint32_t audio_length;                /* Length of audio data in samples */
     float sample_rate;                    /* Sample rate of grain */
 } sound_grain_t;
@@ -200,8 +276,68 @@ typedef struct phoneme_bst_node {
     uint8_t feature_vector;                   /* Phonetic feature bits for ordering */
 } phoneme_bst_node_t;
 
+/**
+ * Compiled bank file (.fbank), little endian
+ *
+ *   header   64 bytes
+ *   index    num_grains entries, sorted by phoneme then F0
+ *   samples  one run per grain, each SOUND_BANK_ALIGN aligned
+ *
+ * sound_bank_map() maps the file read-only: loading touches only the
+ * header, and processes mapping the same bank share its pages.
+ */
+#define SOUND_BANK_MAGIC "FBANK\r\n\x1a"  /* 8 bytes; catches text-mode mangling */
+#define SOUND_BANK_VERSION 1
+#define SOUND_BANK_ALIGN 64
+#define SOUND_BANK_GAIN_CHUNKS 16
+#define SOUND_BANK_IPA_LEN 8
+
+typedef enum {
+    SOUND_BANK_FLOAT32 = 0,
+    SOUND_BANK_INT16 = 1
+} sound_bank_format_t;
+
+/* Per-grain feature vector, for selection by similarity */
+typedef enum {
+    SOUND_GRAIN_FEATURE_PHONETIC,        /* sound_bank_calc_feature_vector() byte */
+    SOUND_GRAIN_FEATURE_F0,              /* Hz, from the loop period */
+    SOUND_GRAIN_FEATURE_LEVEL,           /* RMS, dBFS */
+    SOUND_GRAIN_FEATURE_ZCR,             /* Zero crossings per sample (brightness) */
+    SOUND_GRAIN_FEATURES
+} sound_grain_feature_t;
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t sample_format;              /* sound_bank_format_t */
+    uint32_t num_grains;
+    uint32_t entry_size;                 /* sizeof(sound_bank_entry_t) */
+    uint64_t index_offset;
+    uint64_t file_size;
+    uint8_t reserved[24];
+} sound_bank_header_t;
+
+typedef struct {
+    char phoneme[SOUND_BANK_IPA_LEN];    /* NUL padded */
+    uint64_t sample_offset;              /* From file start */
+    uint32_t audio_length;
+    float sample_rate;
+    uint32_t midpoint_sample;
+    uint32_t loop_start;
+    uint32_t loop_end;
+    uint32_t duration_samples;
+    float selection_gain;
+    uint16_t gain_map_chunks;
+    uint8_t feature_vector;
+    uint8_t reserved;
+    float gain_map[SOUND_BANK_GAIN_CHUNKS];
+    float features[SOUND_GRAIN_FEATURES];
+} sound_bank_entry_t;
+
 /**
  * Sound bank - collection of grains organized by BST
+ * A mapped bank (sound_bank_map) leaves grains empty and reads the file's
+ * index instead.
  */
 typedef struct {
     phoneme_bst_node_t* root;            /* Root of phoneme BST */
@@ -209,8 +345,88 @@ typedef struct {
     int num_grains;                      /* Number of grains loaded */
     int capacity;                        /* Array capacity */
     char bank_path[256];                 /* Path to sound bank directory */
+
+    /* Compiled bank */
+    const uint8_t* map;                  /* Whole file, PROT_READ */
+    size_t map_size;
+    sound_bank_format_t sample_format;
+    const sound_bank_entry_t* entries;
+    int num_entries;
 } sound_bank_t;
 
+/**
+ * Grain analyzer - FFT plan and scratch reused across grains
+ * One per thread. The transform size follows the longest pitch period, so
+ * every grain at one sample rate shares the plan.
+ */
+typedef struct {
+    struct formant_fft* fft;             /* Autocorrelation plan */
+    int fft_size;
+    int capacity;                        /* Scratch length; only grows */
+    float* frame;                        /* fft_size: one zero-padded block, then the ACF */
+    float* block_re;                     /* fft_size / 2 + 1 each */
+    float* block_im;
+    float* lagged_re;
+    float* lagged_im;
+    float* acf_re;                       /* Cross-spectra summed over blocks */
+    float* acf_im;
+    bool refine;                         /* Refine the ACF peak by normalized cross-correlation */
+} sound_grain_analyzer_t;
+
+/**
+ * Grain feature index - nearest grain for a phoneme, pitch and emotion
+ * Rows are grains, stored as one aligned column per dimension, grouped by
+ * phoneme and sorted by pitch (level if unvoiced) within each group.
+ * Banks up to SOUND_GRAIN_INDEX_FLAT_MAX grains are scanned whole with
+ * vector loops. Larger ones visit phoneme groups closest first and walk
+ * outward from the target, examining at most SOUND_GRAIN_INDEX_VISIT_MAX
+ * rows: a query costs O(phonemes * log(grains per phoneme) + VISIT_MAX)
+ * whatever the bank size. Queries never allocate, so the audio thread may
+ * call them.
+ */
+#define SOUND_GRAIN_MATCHES_MAX 4            /* Neighbours one query can return */
+#define SOUND_GRAIN_INDEX_FLAT_MAX 256       /* Largest bank scanned row by row */
+#define SOUND_GRAIN_INDEX_VISIT_MAX 256      /* Rows one grouped query may examine */
+
+typedef enum {
+    SOUND_GRAIN_DIM_F1,                  /* Phoneme F1 target, Bark */
+    SOUND_GRAIN_DIM_F2,                  /* Phoneme F2 target, Bark */
+    SOUND_GRAIN_DIM_VOICING,             /* 0 vowel, 1 voiced consonant, 2 unvoiced */
+    SOUND_GRAIN_DIM_PITCH,               /* Semitones above 100 Hz */
+    SOUND_GRAIN_DIM_LEVEL,               /* RMS, dBFS */
+    SOUND_GRAIN_DIM_BRIGHTNESS,          /* Zero crossings per 100 samples */
+    SOUND_GRAIN_DIMS
+} sound_grain_dim_t;
+
+/* Rows [start, end) share one phoneme, so its F1, F2 and voicing */
+typedef struct {
+    int start, end;
+    float f1, f2, voicing;
+    sound_grain_dim_t key;               /* Rows ascend on this: PITCH, or LEVEL if unvoiced */
+} sound_grain_group_t;
+
+typedef struct {
+    int count;                           /* Grains indexed */
+    int stride;                          /* count rounded up to whole vectors */
+    float* dims[SOUND_GRAIN_DIMS];       /* stride each, FORMANT_CACHE_LINE aligned */
+    int32_t* grain;                      /* Bank grain (or mapped entry) per row */
+    float neutral_level;                 /* Bank means: the NEUTRAL emotion targets */
+    float neutral_brightness;
+    int num_groups;
+    sound_grain_group_t groups[FORMANT_MAX_PHONEMES];
+} sound_grain_index_t;
+
+typedef struct {
+    float target[SOUND_GRAIN_DIMS];
+    float weight[SOUND_GRAIN_DIMS];      /* Per squared unit; 0 ignores the dimension */
+} sound_grain_query_t;
+
+typedef struct {
+    int grain;                           /* Bank grain (or mapped entry) index */
+    float distance;                      /* Weighted squared distance */
+    float mix;                           /* Interpolation weight; a query's mixes sum to 1 */
+} sound_grain_match_t;
+
 /* ============================================================================
  * Data Structures - VU Meter & Metering
  * ========================================================================= */
@@ -218,15 +434,39 @@ typedef struct {
 /* Forward declaration for VAD */
 typedef struct formant_vad formant_vad_t;
 
+#define FORMANT_FIR_FFT_MIN_TAPS 256 /* Longer filters use partitioned FFT convolution */
+#define FORMANT_FIR_PARTITION 256     /* FFT partition (block) size in samples */
+
 /**
  * FIR filter for frequency weighting (A-weight, bass, treble, etc.)
+ * Short filters run in direct form. From FORMANT_FIR_FFT_MIN_TAPS taps the
+ * response is split into FORMANT_FIR_PARTITION-sample partitions and
+ * applied by uniformly partitioned overlap-save convolution, which adds
+ * one partition of latency.
  */
 typedef struct {
     float* coeffs;                       /* Filter coefficients (dynamic array) */
+    float* reversed;                     /* coeffs back to front, for the direct form */
     int num_taps;                        /* Number of filter taps */
-    float* history;                      /* Input sample history (circular) */
+    float* history;                      /* Input history, mirrored (2 x num_taps) */
     int history_pos;                     /* Current position in history buffer */
     char name[32];                       /* Filter name (e.g., "A-weight") */
+
+    /* Partitioned convolution (NULL fft: direct form) */
+    struct formant_fft* fft;             /* Real FFT, 2 x FORMANT_FIR_PARTITION */
+    int num_partitions;
+    int bins;                            /* FORMANT_FIR_PARTITION + 1 */
+    float* partition_re;                 /* Partition spectra, num_partitions x bins */
+    float* partition_im;
+    float* fdl_re;                       /* Input spectra delay line, num_partitions x bins */
+    float* fdl_im;
+    int fdl_pos;                         /* Slot holding the newest input spectrum */
+    float* frame;                        /* Previous + current input partition */
+    float* output;                       /* Last filtered partition */
+    float* work;                         /* Time-domain scratch, 2 x FORMANT_FIR_PARTITION */
+    float* acc_re;                       /* Spectrum accumulator, bins */
+    float* acc_im;
+    int fill;                            /* Samples into the current partition */
 } formant_fir_filter_t;
 
 /**
@@ -252,17 +492,23 @@ typedef struct {
     float rms_current;                   /* Current RMS value */
     float peak_current;                  /* Current peak value */
     float peak_hold;                     /* Peak hold value */
-    float true_peak;                     /* True peak (oversampled) */
-    uint64_t peak_hold_start_us;         /* When peak hold started */
+    float true_peak;                     /* True peak, 4x oversampled (BS.1770) */
+    int peak_hold_samples;               /* Samples since the held peak */
+    int peak_hold_length;                /* Hold time in samples */
 
     /* RMS integration buffer */
-    float* rms_buffer;                   /* Circular buffer for RMS calculation */
+    float* rms_buffer;                   /* Circular buffer of squared samples */
     int rms_buffer_size;                 /* Buffer size in samples */
     int rms_buffer_pos;                  /* Current position */
+    double rms_sum;                      /* Running sum of rms_buffer */
+
+    float* block;                        /* Weighted samples for one block */
+    float* tp_buffer;                    /* Oversampler history + unweighted block */
 
     /* Statistics */
     float min_level;                     /* Minimum level seen */
     float max_level;                     /* Maximum level seen */
+    float max_true_peak;                 /* Highest true peak since reset */
     uint64_t clip_count;                 /* Number of clipping samples */
 
     /* VAD integration */
@@ -270,6 +516,87 @@ typedef struct {
     bool vad_enabled;                    /* Use VAD thresholds */
 } formant_meter_t;
 
+#define FORMANT_LOUDNESS_SUBBLOCKS 30       /* 100 ms sub-blocks in the 3 s window */
+#define FORMANT_LOUDNESS_MIN_LUFS -70.0f    /* Absolute gate and histogram floor */
+#define FORMANT_LOUDNESS_MAX_LUFS 10.0f     /* Histogram ceiling */
+#define FORMANT_LOUDNESS_BINS 800           /* 0.1 LU per histogram bin */
+#define FORMANT_LOUDNESS_NONE -200.0f       /* Reading not available (LUFS) */
+
+/**
+ * Loudness meter - ITU-R BS.1770 / EBU R128 (mono)
+ * K-weighted power is summed over 100 ms sub-blocks. Momentary (400 ms)
+ * and short-term (3 s) loudness are sums of the latest sub-blocks; every
+ * sub-block boundary adds one gating block and one short-term value to
+ * energy histograms, from which integrated loudness and loudness range
+ * are gated on demand. Memory and per-sample cost are constant.
+ */
+typedef struct {
+    float sample_rate;
+
+    /* K-weighting: high shelf, then RLB high-pass (transposed direct form II) */
+    double k_b[2][3];
+    double k_a[2][2];
+    double k_z[2][2];
+
+    /* 100 ms sub-blocks */
+    int subblock_length;                 /* Samples per sub-block */
+    int subblock_fill;                   /* Samples in the current sub-block */
+    double subblock_sum;                 /* Weighted power of the current sub-block */
+    double subblocks[FORMANT_LOUDNESS_SUBBLOCKS];   /* Completed sub-block powers (ring) */
+    int subblock_pos;                    /* Next slot in subblocks */
+    int subblock_count;                  /* Completed sub-blocks (saturates at the ring size) */
+
+    /* Live readings (LUFS, FORMANT_LOUDNESS_NONE until a window has filled) */
+    float momentary;
+    float short_term;
+    float max_momentary;
+    float max_short_term;
+
+    /* Gating histograms: 400 ms blocks for integrated, 3 s values for LRA */
+    uint32_t block_count[FORMANT_LOUDNESS_BINS];
+    double block_energy[FORMANT_LOUDNESS_BINS];
+    uint32_t short_term_count[FORMANT_LOUDNESS_BINS];
+    double short_term_energy[FORMANT_LOUDNESS_BINS];
+
+    uint64_t samples;                    /* Samples measured since reset */
+} formant_loudness_t;
+
+/**
+ * Meter readings taken on the audio thread after one block
+ */
+typedef struct {
+    float rms_db;
+    float peak_db;
+    float peak_hold_db;
+    float true_peak_db;                  /* dBTP */
+    float momentary_lufs;                /* FORMANT_LOUDNESS_NONE until 400 ms */
+    float short_term_lufs;               /* FORMANT_LOUDNESS_NONE until 3 s */
+    float load;                          /* Render time / block duration, last block */
+    float load_max;                      /* Highest load since creation */
+    uint64_t clip_count;
+    uint64_t samples;                    /* Samples metered */
+} formant_meter_snapshot_t;
+
+#define FORMANT_SNAPSHOT_WORDS (sizeof(formant_meter_snapshot_t) / sizeof(uint32_t))
+
+/**
+ * Output monitor - meter and loudness run per block, published by seqlock
+ * The audio thread is the only writer and never waits: it makes sequence
+ * odd, stores the snapshot words, then makes it even again. Readers on
+ * any other thread copy the words and retry if sequence moved or was odd.
+ * Words are atomics so the racing copy is well defined.
+ */
+typedef struct {
+    formant_meter_t* meter;
+    formant_loudness_t* loudness;
+    float sample_rate;
+    float load_max;
+    uint64_t samples;
+
+    _Alignas(FORMANT_CACHE_LINE) atomic_uint sequence;   /* Odd while publishing */
+    atomic_uint words[FORMANT_SNAPSHOT_WORDS];            /* formant_meter_snapshot_t */
+} formant_monitor_t;
+
 /* ============================================================================
  * Data Structures - Emotional Modulation
  * ========================================================================= */
@@ -308,6 +635,7 @@ typedef struct {
         /* PHONEME */
         struct {
             char ipa[FORMANT_IPA_MAX_LEN];
+            int id;               /* Interned at parse time, -1 if unknown */
             float duration_ms;
             float pitch_hz;
             float intensity;
@@ -356,6 +684,23 @@ typedef struct {
     } params;
 } formant_command_t;
 
+/* ============================================================================
+ * Data Structures - Command Ring
+ * ========================================================================= */
+
+/**
+ * Lock-free single-producer/single-consumer command ring.
+ * The input thread is the only writer of tail, the audio thread the only
+ * writer of head. Indices run freely and are masked on access.
+ */
+typedef struct {
+    formant_command_t slots[FORMANT_MAX_COMMANDS];
+    _Alignas(FORMANT_CACHE_LINE) atomic_uint head;        /* Consumer position */
+    _Alignas(FORMANT_CACHE_LINE) atomic_uint tail;        /* Producer position */
+    atomic_uint_fast64_t overflow_count;                  /* Commands dropped (ring full) */
+    atomic_uint high_water;                               /* Max depth seen by producer */
+} formant_command_ring_t;
+
 /* ============================================================================
  * Data Structures - Ring Buffer
  * ========================================================================= */
@@ -371,24 +716,119 @@ typedef struct {
  * Data Structures - Audio Engine
  * ========================================================================= */
 
+#define FORMANT_LATENCY_PINGS 5
+
+typedef enum {
+    FORMANT_LATENCY_IDLE,
+    FORMANT_LATENCY_ARMED,     /* Requested, audio thread has not picked it up */
+    FORMANT_LATENCY_RUNNING,
+    FORMANT_LATENCY_DONE
+} formant_latency_state_t;
+
+/**
+ * Loopback latency probe for full-duplex streams
+ * The audio thread mutes the output, takes the input noise floor, plays a
+ * one-sample click and counts samples until the input rises above that
+ * floor. The median of FORMANT_LATENCY_PINGS round trips is published:
+ * output buffering, DAC, the acoustic or cable path, ADC and input
+ * buffering together.
+ */
+typedef struct {
+    atomic_int state;          /* formant_latency_state_t */
+    atomic_int result;         /* Round trip in samples, -1 if no click came back */
+
+    /* Audio thread only */
+    bool listening;            /* Click sent, waiting for it */
+    int countdown;             /* Samples left in the current phase */
+    int settle_samples;        /* Silence before each click */
+    int timeout_samples;       /* Give up on a click after this long */
+    int elapsed;               /* Samples since the click */
+    float noise_peak;          /* Input peak while settling */
+    int pings;                 /* Clicks sent */
+    int num_results;
+    int results[FORMANT_LATENCY_PINGS];
+} formant_latency_probe_t;
+
 typedef struct {
     PaStream* stream;
     float sample_rate;
     int buffer_size;
     formant_ring_buffer_t ring;
     bool running;
+    bool pa_initialized;       /* Pa_Initialize() called (realtime only) */
+    bool duplex;               /* One stream for input and output (set before start) */
+    formant_latency_probe_t probe;
 } formant_audio_engine_t;
 
+/* ============================================================================
+ * Data Structures - Offline Render Sink
+ * ========================================================================= */
+
+#define FORMANT_SINK_CHUNK 1024
+
+typedef enum {
+    FORMANT_SINK_WAV,          /* 16-bit PCM mono WAV file */
+    FORMANT_SINK_RAW           /* Headerless 16-bit signed PCM (native endian) */
+} formant_sink_format_t;
+
+typedef struct {
+    FILE* file;
+    formant_sink_format_t format;
+    int sample_rate;
+    uint64_t samples_written;
+    bool owns_file;                     /* False for stdout */
+    formant_loudness_t* loudness;       /* Measures everything written, or NULL */
+    int16_t pcm[FORMANT_SINK_CHUNK];    /* Conversion scratch */
+} formant_sink_t;
+
+/* ============================================================================
+ * Data Structures - WAV Reader
+ * ========================================================================= */
+
+#define FORMANT_WAV_CHUNK 1024         /* Frames converted per read() */
+
+typedef struct {
+    FILE* file;
+    int sample_rate;
+    int channels;
+    int bits_per_sample;
+    bool is_float;                      /* IEEE float data, else integer PCM */
+    int block_align;                    /* Bytes per frame */
+    uint64_t num_frames;                /* From the data chunk size */
+    uint64_t frames_read;
+    uint8_t* raw;                       /* FORMANT_WAV_CHUNK frames of file data */
+} formant_wav_reader_t;
+
 /* ============================================================================
  * Data Structures - CELP Engine
  * ========================================================================= */
 
+/**
+ * Excitation codebook and vocal tract filters for one engine sample rate
+ * Built once per rate and shared by every engine running at it.
+ * Rows are cache-line aligned; fade is the loop crossfade ramp.
+ */
+typedef struct {
+    float sample_rate;
+    int num_vectors;
+    int length;                         /* Samples per vector at sample_rate */
+    int stride;                         /* Floats between rows (cache-line multiple) */
+    float* samples;                     /* num_vectors x stride */
+    int fade_length;                    /* Loop crossfade length (samples) */
+    float* fade;                        /* fade[i] = i / fade_length */
+    /* Vocal tract per phoneme ID from its formant table; the last row is neutral */
+    float reflection[FORMANT_MAX_PHONEMES + 1][FORMANT_LPC_ORDER];
+    float lpc_gain[FORMANT_MAX_PHONEMES + 1];
+} formant_celp_codebook_t;
+
 typedef struct {
     formant_lpc_filter_t lpc;           /* LPC all-pole filter */
-    const void* current_excitation;     /* Current excitation vector */
+    const formant_celp_codebook_t* codebook;  /* Rate-matched excitation vectors */
+    const float* current_excitation;    /* Current row of codebook->samples */
     int excitation_position;            /* Position in excitation vector */
     int excitation_length;              /* Length of excitation vector */
     bool excitation_loop;               /* Loop excitation for sustained phonemes */
+    float lpf_state;                    /* Output warming low-pass state */
 } formant_celp_engine_t;
 
 /* ============================================================================
@@ -407,6 +847,20 @@ typedef enum {
     FORMANT_VAD_RESULT_SPEECH = 1
 } formant_vad_result_t;
 
+#define FORMANT_VAD_BANDS 3          /* Below 300 Hz, 300-4000 Hz (voice), above */
+#define FORMANT_VAD_VOICE_BAND 1     /* band_share index of 300-4000 Hz */
+
+/**
+ * Features of one VAD frame from the real-FFT front end
+ */
+typedef struct {
+    float energy;                    /* RMS */
+    float zcr;                       /* Zero crossings per sample pair (0-1) */
+    float flatness;                  /* Spectral flatness of the voice band (0-1) */
+    float flux;                      /* Mean rise in log power per bin since the last frame */
+    float band_share[FORMANT_VAD_BANDS];  /* Fraction of frame power in each band */
+} formant_vad_features_t;
+
 struct formant_vad {
     /* Configuration */
     float sample_rate;
@@ -434,6 +888,21 @@ struct formant_vad {
     int silence_frames;              /* Consecutive silence frames detected */
     int min_speech_frames;           /* Min frames to confirm speech */
 
+    /* Spectral front end: Hann-windowed frame, zero-padded real FFT */
+    struct formant_fft* fft;
+    int fft_size;                    /* Power of two >= frame_size */
+    int bins;                        /* fft_size / 2 + 1 */
+    float* window;                   /* frame_size */
+    float* fft_input;                /* fft_size, zero tail */
+    float* spectrum_re;              /* bins */
+    float* spectrum_im;
+    float* power;                    /* |X|^2 per bin */
+    float* log_power;                /* Current frame, then kept for the next flux */
+    float* prev_log_power;
+    int band_start[FORMANT_VAD_BANDS + 1];  /* First bin of each band; last entry = bins */
+    float band_threshold;            /* Min voice-band share for speech */
+    formant_vad_features_t features; /* Last frame */
+
     /* Pre-trigger circular buffer */
     float* pretrigger_buffer;
     int pretrigger_size;             /* Size in samples */
@@ -457,21 +926,65 @@ typedef enum {
     FORMANT_RECORDER_STOPPING
 } formant_recorder_state_t;
 
+#define FORMANT_RECORDER_RING_MS 2000     /* Capture ring (rounded up to a power of two) */
+#define FORMANT_RECORDER_CHUNK_BYTES 8192 /* Writer block, aligned to file offsets */
+
+/**
+ * Input recorder
+ * The input callback only copies samples into an SPSC ring; a writer
+ * thread converts them to PCM in file-aligned chunks, patches the WAV
+ * header and closes the file when the capture ends. If the disk stalls
+ * longer than the ring holds, samples are dropped and counted.
+ */
 typedef struct {
     PaStream* stream;                   /* PortAudio input stream */
-    FILE* wav_file;                     /* Output WAV file */
-    float* buffer;                      /* Recording buffer */
-    int buffer_size;                    /* Buffer size in samples */
-    int buffer_pos;                     /* Current position in buffer */
-    int samples_recorded;               /* Total samples recorded */
+    int fd;                             /* Output WAV file (-1 when closed) */
+    int buffer_size;                    /* Callback size in samples */
+    int samples_captured;               /* Samples pushed by the callback */
     int samples_target;                 /* Target number of samples (or max for VAD) */
     float sample_rate;                  /* Recording sample rate */
-    formant_recorder_state_t state;     /* Current state */
+    _Atomic formant_recorder_state_t state;   /* Armed and ended by the control thread, advanced by the callback */
     char filename[256];                 /* Output filename */
 
+    /* Capture ring (SPSC: input callback -> writer thread) */
+    float* ring;
+    unsigned ring_mask;                 /* Ring size - 1 */
+    _Alignas(FORMANT_CACHE_LINE) atomic_uint ring_head;  /* Writer position */
+    _Alignas(FORMANT_CACHE_LINE) atomic_uint ring_tail;  /* Callback position */
+    atomic_uint_fast64_t overruns;      /* Samples dropped (ring full) */
+
+    /* Input source */
+    bool shared_input;                  /* Fed by formant_recorder_capture(), no stream of its own */
+    atomic_bool in_capture;             /* Audio thread is inside formant_recorder_capture() */
+
+    /* Writer thread */
+    pthread_t writer;
+    bool writer_started;                /* Joined by the next start/stop */
+    atomic_bool writer_stop;            /* Drain what is queued and close */
+    int16_t* chunk;                     /* Aligned PCM conversion buffer */
+    atomic_int samples_recorded;        /* Samples written to the file */
+
+    /* Control thread: services capture requests made on the audio thread */
+    pthread_t control;
+    bool control_started;
+    pthread_mutex_t control_lock;       /* Wakes the thread early to stop it */
+    pthread_cond_t control_cond;
+    bool control_stop;                  /* Under control_lock */
+    atomic_bool request_pending;        /* request is filled in, not yet taken */
+    atomic_uint requests_dropped;       /* Made while another was pending */
+    struct {
+        char filename[256];
+        float duration_ms;              /* Duration, or the maximum with VAD */
+        bool use_vad;
+        int vad_mode;
+    } request;
+
     /* VAD support */
     formant_vad_t* vad;                 /* Voice activity detector (optional) */
     bool use_vad;                       /* Use VAD for automatic recording */
+    float* pretrigger;                  /* Scratch for the VAD pre-trigger audio */
+    float* vad_frame;                   /* Input collected up to one VAD frame */
+    int vad_fill;                       /* Samples in vad_frame */
     uint64_t start_time_us;             /* Time when recording started */
     uint64_t max_duration_us;           /* Maximum recording duration */
 } formant_recorder_t;
@@ -497,14 +1010,17 @@ typedef struct {
     /* Recording */
     formant_recorder_t* recorder;        /* Audio input recorder */
 
-    /* Metering */
-    formant_meter_t* meter;              /* VU meter for monitoring */
+    /* Metering (NULL unless formant_engine_enable_monitor() was called) */
+    formant_monitor_t* monitor;
 
     /* Sound Bank */
     sound_bank_t* sound_bank;            /* Pre-recorded sound grains */
+    sound_grain_index_t* grain_index;    /* Nearest-grain lookup over sound_bank */
 
     /* Source */
     float phase;               /* Glottal phase (0.0-1.0) */
+    const float* glottal_table;  /* Wavetable for current f0 (per sub-block) */
+    formant_noise_t noise;     /* Aspiration/frication/burst noise */
     float f0_hz;              /* Fundamental frequency */
     float intensity;          /* Amplitude (0.0-1.0) */
 
@@ -514,7 +1030,10 @@ typedef struct {
     float f3_current, f3_target;
     float f4_current, f4_target;
     float f5_current, f5_target;
-    float lerp_rate;          /* Interpolation rate (0-1) */
+    float lerp_rate;          /* Interpolation rate per sample (0-1) */
+    int control_rate;         /* Samples per formant update (1-FORMANT_BANK_BLOCK) */
+    float formant_bw[FORMANT_MAX_FORMANTS];    /* Resonator bandwidths (Hz) */
+    float formant_gain[FORMANT_MAX_FORMANTS];  /* Resonator gains (phoneme amp1-amp5) */
 
     /* Prosody */
     float pitch_base;         /* Base pitch (Hz) */
@@ -528,11 +1047,19 @@ typedef struct {
     uint64_t time_us;         /* Current synthesis time (microseconds) */
     uint64_t samples_processed;
 
-    /* Command queue (circular buffer) */
-    formant_command_t cmd_queue[FORMANT_MAX_COMMANDS];
-    int cmd_queue_head;
-    int cmd_queue_tail;
-    int cmd_queue_size;
+    /* Command queue (SPSC ring: input thread -> audio thread) */
+    formant_command_ring_t cmd_ring;
+
+    /* Timeline scheduler (sample time) */
+    uint64_t timeline_cursor;         /* Sample where the next queued command starts */
+    bool sync_locked;                 /* External clock origin established by SYNC */
+    uint64_t sync_origin_sample;      /* Engine sample matching sync_origin_ms */
+    uint64_t sync_origin_ms;          /* External timestamp of first SYNC */
+
+    /* Timeline progress published by the audio thread after each block */
+    atomic_uint_fast64_t published_cursor;
+    atomic_uint_fast64_t published_samples;
+    atomic_uint published_head;
 
     /* Current phoneme */
     const formant_phoneme_config_t* current_phoneme;
@@ -547,12 +1074,116 @@ typedef struct {
     /* State */
     bool paused;
 
-    /* Diagnostics */
-    bool enable_diagnostics;
-    int diagnostic_sample_count;
-
 } formant_engine_t;
 
+/* ============================================================================
+ * Data Structures - Choir
+ * ========================================================================= */
+
+/**
+ * N independent engines mixed to one output
+ * Voices are rendered block by block on a fixed worker pool. The caller
+ * (audio callback or offline loop) releases a block by bumping the
+ * generation in work, renders voices itself alongside the workers, then
+ * spins until pending (unrendered voices) drops to zero before mixing.
+ * No locks are taken on the audio path.
+ */
+typedef struct formant_choir {
+    formant_engine_t* voices[FORMANT_MAX_VOICES];
+    int num_voices;
+    float sample_rate;
+    float voice_gain;                   /* Mix gain, 1/sqrt(num_voices) */
+    float* voice_buffers;               /* num_voices x FORMANT_CHOIR_BLOCK samples */
+
+    /* Worker pool (the calling thread is worker 0) */
+    pthread_t workers[FORMANT_MAX_WORKERS];
+    int num_threads;
+    int block_samples;                  /* Current block, written before release */
+    _Alignas(FORMANT_CACHE_LINE) atomic_uint_fast64_t work;  /* Generation << 32 | next voice to claim */
+    _Alignas(FORMANT_CACHE_LINE) atomic_int pending;         /* Voices not yet rendered */
+    atomic_bool shutdown;
+
+    /* Audio */
+    formant_audio_engine_t audio;
+
+    /* Metering on the mix (NULL unless formant_choir_enable_monitor() was called) */
+    formant_monitor_t* monitor;
+} formant_choir_t;
+
+/* ============================================================================
+ * Data Structures - Synthesis Server
+ * ========================================================================= */
+
+typedef enum {
+    FORMANT_SESSION_FREE,      /* Slot unused */
+    FORMANT_SESSION_SETUP,     /* Connected, waiting for its first command (not rendered) */
+    FORMANT_SESSION_ACTIVE,    /* Rendered every block */
+    FORMANT_SESSION_CLOSING,   /* Input ended; rendered until its timeline is done */
+    FORMANT_SESSION_DRAINED    /* Render thread is finished with it */
+} formant_session_state_t;
+
+typedef enum {
+    FORMANT_SESSION_OUTPUT_MIX,   /* Summed onto the shared mix bus (default) */
+    FORMANT_SESSION_OUTPUT_WAV,   /* Own WAV file */
+    FORMANT_SESSION_OUTPUT_RAW    /* 16-bit PCM streamed back over the connection */
+} formant_session_output_t;
+
+/**
+ * One client connection: its own engine, ECL stream and output
+ * Ownership follows state: the server thread owns FREE/SETUP/DRAINED
+ * slots, the render thread reads ACTIVE/CLOSING ones. Rendered audio for
+ * WAV/RAW outputs crosses back through an SPSC ring so file and socket
+ * I/O never run on the render thread.
+ */
+typedef struct {
+    _Atomic int state;                  /* formant_session_state_t */
+    int id;
+    int fd;                             /* Client socket, -1 once closed */
+    bool input_closed;                  /* EOF or STOP seen */
+    formant_session_output_t output;
+    formant_engine_t* engine;
+    formant_sink_t* sink;               /* WAV output */
+
+    /* Input line assembly */
+    char line[FORMANT_SESSION_LINE];
+    int line_len;
+
+    /* Rendered audio (render thread -> server thread) */
+    float* ring;                        /* FORMANT_SESSION_RING samples */
+    atomic_uint ring_write;
+    atomic_uint ring_read;
+    atomic_uint_fast64_t ring_dropped;
+
+    /* RAW output in flight */
+    int16_t pcm[FORMANT_SINK_CHUNK];
+    int pcm_len;                        /* Bytes converted */
+    int pcm_sent;                       /* Bytes already sent */
+} formant_session_t;
+
+typedef struct {
+    int listen_fd;
+    char socket_path[108];
+    float sample_rate;
+    int buffer_size;
+
+    /* Settings applied to every new session */
+    formant_bank_kernel_t kernel;
+    int control_rate;
+    uint64_t seed;
+    bool measure_loudness;              /* Report loudness of WAV sessions and the mix */
+
+    formant_session_t sessions[FORMANT_MAX_SESSIONS];
+    int next_id;
+
+    /* Mix bus: PortAudio device, or a sink paced by a clock thread */
+    formant_audio_engine_t audio;
+    formant_sink_t* mix_sink;
+    pthread_t clock_thread;
+    bool clock_running;
+    atomic_bool clock_stop;
+    float* scratch;                     /* Per-session render block */
+} formant_server_t;
+
 /* ============================================================================
  * Core Engine Functions
  * ========================================================================= */
@@ -572,6 +1203,31 @@ void formant_engine_destroy(formant_engine_t* engine);
  */
 void formant_engine_reset(formant_engine_t* engine);
 
+/**
+ * Reseed the engine's noise source (default seed: FORMANT_NOISE_SEED_DEFAULT)
+ */
+void formant_engine_set_seed(formant_engine_t* engine, uint64_t seed);
+
+/**
+ * Meter every rendered block (see formant_monitor_process)
+ * Call before starting audio. Returns 0, or -1 on error
+ */
+int formant_engine_enable_monitor(formant_engine_t* engine, const char* preset);
+
+/**
+ * Map a compiled sound bank (.fbank) as the engine's sound bank and index
+ * its grains for sound_grain_index_nearest(). Replaces any bank already
+ * loaded; call before starting audio.
+ * Returns 0, or -1 on error
+ */
+int formant_engine_load_bank(formant_engine_t* engine, const char* path);
+
+/**
+ * Set how many samples pass between formant/coefficient updates
+ * Clamped to 1..FORMANT_BANK_BLOCK. Call before starting audio.
+ */
+void formant_engine_set_control_rate(formant_engine_t* engine, int samples);
+
 /**
  * Start audio output
  */
@@ -583,10 +1239,210 @@ int formant_engine_start(formant_engine_t* engine);
 void formant_engine_stop(formant_engine_t* engine);
 
 /**
- * Process audio buffer (called by PortAudio callback)
+ * Open and start a mono output stream driven by callback
+ * Initializes PortAudio on first use. Returns 0 on success, -1 on error
+ */
+int formant_audio_start(formant_audio_engine_t* audio, float sample_rate,
+                        PaStreamCallback* callback, void* user_data);
+
+/**
+ * Stop and close the stream opened by formant_audio_start
+ */
+void formant_audio_stop(formant_audio_engine_t* audio);
+
+/**
+ * Input-side work for one full-duplex callback (audio thread)
+ * Runs the latency probe, which replaces the output while it is active.
+ */
+void formant_audio_process_duplex(formant_audio_engine_t* audio, const float* input,
+                                  float* output, int num_samples);
+
+/**
+ * Measure loopback latency on a running duplex stream (control thread)
+ * The output must reach the input (speakers heard by the microphone, or a
+ * cable). Blocks for about a second per click.
+ * Returns the round trip in samples, or -1 if it could not be measured
+ */
+int formant_audio_measure_latency(formant_audio_engine_t* audio);
+
+/**
+ * Open one full-duplex stream: capture for the recorder runs in the
+ * synthesis callback, on the same clock as playback. Call before starting
+ */
+void formant_engine_set_duplex(formant_engine_t* engine, bool duplex);
+
+/**
+ * Process audio buffer (called by PortAudio callback, or directly for offline rendering)
+ * Queued commands are applied at their scheduled sample offset inside the buffer.
  */
 void formant_engine_process(formant_engine_t* engine, float* output, int num_samples);
 
+/**
+ * True once every queued command has been applied and the last scheduled
+ * phoneme has played out. Safe to call from the input thread.
+ */
+bool formant_engine_timeline_done(formant_engine_t* engine);
+
+/* ============================================================================
+ * Offline Render Functions
+ * ========================================================================= */
+
+/**
+ * Open output sink for offline rendering
+ * Format is chosen from the extension: ".raw"/".pcm" -> raw PCM, otherwise WAV.
+ * A path of "-" writes raw PCM to stdout.
+ * Returns NULL on error
+ */
+formant_sink_t* formant_sink_open(const char* path, float sample_rate);
+
+/**
+ * Write float samples to sink (converted to 16-bit PCM)
+ * Returns 0 on success, -1 on write error
+ */
+int formant_sink_write(formant_sink_t* sink, const float* samples, int num_samples);
+
+/**
+ * Measure loudness of everything written to sink from now on
+ * Read it from sink->loudness before closing. Returns 0, or -1 on error
+ */
+int formant_sink_measure_loudness(formant_sink_t* sink);
+
+/**
+ * Render engine output into sink until every queued command has played out
+ * @param block Scratch buffer of block_size samples
+ * Returns 0 on success, -1 on write error
+ */
+int formant_render_pending(formant_engine_t* engine, formant_sink_t* sink, float* block, int block_size);
+
+/**
+ * Finalize WAV header, close file and free sink
+ * Returns 0 on success, -1 on error
+ */
+int formant_sink_close(formant_sink_t* sink);
+
+/**
+ * formant_render_pending for a choir: renders until every voice's timeline is done
+ */
+int formant_render_choir_pending(formant_choir_t* choir, formant_sink_t* sink, float* block, int block_size);
+
+/* ============================================================================
+ * WAV Reader Functions
+ * ========================================================================= */
+
+/**
+ * Open a WAV file for streaming reads
+ * Walks the RIFF chunks, so LIST/bext/fact chunks before or after "fmt "
+ * are skipped. Accepts 16/24/32-bit PCM and 32/64-bit float, any channel
+ * count.
+ * Returns NULL on error
+ */
+formant_wav_reader_t* formant_wav_open(const char* path);
+
+/**
+ * Read up to max_frames frames as mono float (channels averaged)
+ * Returns frames read, 0 at end of data, -1 on read error
+ */
+int formant_wav_read(formant_wav_reader_t* reader, float* output, int max_frames);
+
+/**
+ * Close file and free reader
+ */
+void formant_wav_close(formant_wav_reader_t* reader);
+
+/* ============================================================================
+ * Choir Functions
+ * ========================================================================= */
+
+/**
+ * Create a choir of num_voices engines rendered by num_threads threads
+ * (the caller counts as one). Voice i gets noise seed i + 1.
+ * Returns NULL on error
+ */
+formant_choir_t* formant_choir_create(int num_voices, int num_threads, float sample_rate);
+
+/**
+ * Stop audio, join workers and destroy every voice
+ */
+void formant_choir_destroy(formant_choir_t* choir);
+
+/**
+ * Render and mix all voices (audio callback or offline loop)
+ * Blocks longer than FORMANT_CHOIR_BLOCK are split internally.
+ */
+void formant_choir_process(formant_choir_t* choir, float* output, int num_samples);
+
+/**
+ * Meter the mix after every block (see formant_monitor_process)
+ * Call before starting audio. Returns 0, or -1 on error
+ */
+int formant_choir_enable_monitor(formant_choir_t* choir, const char* preset);
+
+/**
+ * Run the choir on one full-duplex stream; every voice's recorder takes
+ * its input from that stream (see formant_engine_set_duplex)
+ */
+void formant_choir_set_duplex(formant_choir_t* choir, bool duplex);
+
+/**
+ * Start/stop the choir's audio output stream
+ */
+int formant_choir_start(formant_choir_t* choir);
+void formant_choir_stop(formant_choir_t* choir);
+
+/**
+ * Strip an optional "@<n>" or "@*" voice prefix from an ECL line
+ * Lines without a prefix address every voice.
+ * @param line Advanced past the prefix and following whitespace
+ * @return Voice index, FORMANT_VOICE_ALL, or -2 on a malformed prefix
+ */
+int formant_choir_parse_target(formant_choir_t* choir, const char** line);
+
+/**
+ * Queue command for one voice or FORMANT_VOICE_ALL
+ * A broadcast is queued only if every voice has room, so voices stay in step.
+ * Returns 0 on success, -1 if a target ring is full
+ */
+int formant_choir_queue_command(formant_choir_t* choir, int voice, const formant_command_t* cmd);
+
+/**
+ * Free slots in the fullest ring among the targeted voices
+ */
+int formant_choir_queue_space(formant_choir_t* choir, int voice);
+
+/**
+ * True once every voice's timeline has played out
+ */
+bool formant_choir_timeline_done(formant_choir_t* choir);
+
+/**
+ * Samples rendered so far, as last published by the audio thread
+ * Lets the input thread tell a busy timeline from a stalled stream.
+ */
+uint64_t formant_choir_samples_rendered(formant_choir_t* choir);
+
+/* ============================================================================
+ * Server Functions
+ * ========================================================================= */
+
+/**
+ * Listen on a Unix socket (an existing socket file at the path is replaced)
+ * Returns NULL on error
+ */
+formant_server_t* formant_server_create(const char* socket_path, float sample_rate, int buffer_size);
+
+/**
+ * Serve clients until *running is cleared
+ * The mix bus plays on the default audio device, or is written to mix_path
+ * (paced in realtime) when mix_path is non-NULL.
+ * Returns 0 on clean shutdown, -1 on error
+ */
+int formant_server_run(formant_server_t* server, const char* mix_path, volatile bool* running);
+
+/**
+ * Close every session (finalizing WAV files), remove the socket file and free
+ */
+void formant_server_destroy(formant_server_t* server);
+
 /* ============================================================================
  * Command Functions
  * ========================================================================= */
@@ -598,14 +1454,33 @@ void formant_engine_process(formant_engine_t* engine, float* output, int num_sam
 formant_command_t* formant_parse_command(const char* line);
 
 /**
- * Queue command for execution
+ * Queue command for execution (producer side, never blocks)
+ * Returns 0 on success, -1 if the ring is full (counted as overflow)
+ */
+int formant_queue_command(formant_engine_t* engine, const formant_command_t* cmd);
+
+/**
+ * Number of free slots in the command ring (producer side)
  */
-void formant_queue_command(formant_engine_t* engine, formant_command_t* cmd);
+int formant_queue_space(formant_engine_t* engine);
 
 /**
- * Process queued commands (called during audio processing)
+ * Number of commands dropped because the ring was full
  */
-void formant_process_commands(formant_engine_t* engine);
+uint64_t formant_queue_overflow_count(formant_engine_t* engine);
+
+/**
+ * Apply every queued command that is due at the current sample (audio thread)
+ *
+ * PH and FM commands are sequenced back to back on the timeline, each
+ * holding it for duration_ms scaled by PR RATE; other commands take effect
+ * at the timeline position they were queued at. SYNC re-aligns the timeline
+ * to an external millisecond clock.
+ *
+ * @param max_samples Samples left in the current block
+ * @return Samples that can be rendered before the next command is due (<= max_samples)
+ */
+int formant_process_commands(formant_engine_t* engine, int max_samples);
 
 /* ============================================================================
  * Phoneme Functions
@@ -617,6 +1492,23 @@ void formant_process_commands(formant_engine_t* engine);
  */
 const formant_phoneme_config_t* formant_get_phoneme(const char* ipa);
 
+/**
+ * Intern an IPA symbol to its phoneme ID (constant time, no string compares)
+ * Returns -1 if the symbol is unknown
+ */
+int formant_phoneme_id(const char* ipa);
+
+/**
+ * Phoneme configuration by ID (direct index; safe on the audio thread)
+ * Returns NULL if id is out of range
+ */
+const formant_phoneme_config_t* formant_phoneme_by_id(int id);
+
+/**
+ * Number of phoneme IDs in use
+ */
+int formant_phoneme_count(void);
+
 /**
  * Get all available phonemes
  */
@@ -642,7 +1534,7 @@ void formant_interpolate_phonemes(
 void formant_filter_init(formant_filter_t* filter, float freq, float bw, float sample_rate);
 
 /**
- * Update filter frequency
+ * Update filter frequency (coefficients only, filter history is kept)
  */
 void formant_filter_set_freq(formant_filter_t* filter, float freq, float sample_rate);
 
@@ -651,11 +1543,46 @@ void formant_filter_set_freq(formant_filter_t* filter, float freq, float sample_
  */
 float formant_filter_process(formant_filter_t* filter, float input);
 
+/**
+ * Initialize formant bank with num_formants active lanes (state cleared)
+ */
+void formant_bank_init(formant_bank_t* bank, int num_formants, float sample_rate);
+
+/**
+ * Set frequency, bandwidth and gain of one resonator
+ * The first call for a lane applies immediately; later calls set targets that
+ * the next formant_bank_process() ramps to sample by sample. Filter history
+ * is never reset.
+ */
+void formant_bank_set_formant(formant_bank_t* bank, int index, float freq, float bw, float gain);
+
+/**
+ * Clear filter history without touching coefficients
+ */
+void formant_bank_reset(formant_bank_t* bank);
+
 /**
  * Process buffer through formant bank
+ * Output is the gain-weighted sum of all active resonators.
  */
 void formant_bank_process(formant_bank_t* bank, const float* input, float* output, int num_samples);
 
+/**
+ * Select the block kernel used by formant_bank_process()
+ */
+void formant_bank_set_kernel(formant_bank_t* bank, formant_bank_kernel_t kernel);
+
+/**
+ * Parse a kernel name ("scalar", "simd")
+ * Returns 0 on success, -1 if the name is unknown
+ */
+int formant_bank_kernel_parse(const char* name, formant_bank_kernel_t* kernel);
+
+/**
+ * Kernel name for display, including the vector ISA for the SIMD kernel
+ */
+const char* formant_bank_kernel_name(formant_bank_kernel_t kernel);
+
 /* ============================================================================
  * Source Generator Functions
  * ========================================================================= */
@@ -666,45 +1593,105 @@ void formant_bank_process(formant_bank_t* bank, const float* input, float* outpu
 float formant_generate_glottal(float phase, float oq, float alpha);
 
 /**
- * Generate aspiration noise
+ * Build the glottal wavetable family (once per process, thread safe)
+ *
+ * One table per (open quotient, tilt) grid point: oq 0.30-0.70 in steps of
+ * 0.05, alpha 0.5-1.0 in steps of 0.1. Level 0 samples the LF model above
+ * directly; level L keeps only the first (TABLE_SIZE/2) >> L harmonics.
+ * Returns 0 on success, -1 on failure
+ */
+int formant_glottal_tables_init(void);
+
+/**
+ * Wavetable for the grid point nearest (oq, alpha), at the band-limited
+ * level whose harmonics of f0_hz all stay below Nyquist
+ * Has FORMANT_GLOTTAL_TABLE_SIZE + 1 entries (the last repeats the first).
+ * Requires formant_glottal_tables_init().
+ */
+const float* formant_glottal_table(float oq, float alpha, float f0_hz, float sample_rate);
+
+/**
+ * Read a glottal wavetable at phase (0.0-1.0) with linear interpolation
+ *
+ * Error against formant_generate_glottal(), measured by make bench over all
+ * grid shapes: level 0 stays within 6e-3 outside the table cell that
+ * straddles glottal closure (where the model itself is discontinuous), with
+ * RMS error below 0.015 over the whole cycle. Band-limited levels add Gibbs
+ * ringing around closure (peak ~0.26, RMS ~0.014 at 120 Hz / 48 kHz).
+ */
+static inline float formant_glottal_read(const float* table, float phase) {
+    float pos = phase * (float)FORMANT_GLOTTAL_TABLE_SIZE;
+    int i = (int)pos;
+    if (i < 0) i = 0;
+    if (i > FORMANT_GLOTTAL_TABLE_SIZE - 1) i = FORMANT_GLOTTAL_TABLE_SIZE - 1;
+    float frac = pos - (float)i;
+    return table[i] + frac * (table[i + 1] - table[i]);
+}
+
+/**
+ * Seed noise source (same seed, same noise)
  */
-float formant_generate_aspiration(float intensity);
+void formant_noise_init(formant_noise_t* noise, uint64_t seed);
 
 /**
- * Generate frication noise
+ * Fill buffer with white noise in [-1, 1), all lanes at once
  */
-float formant_generate_frication(float intensity, float cutoff_freq);
+void formant_noise_fill(formant_noise_t* noise, float* output, int num_samples);
 
 /**
- * Generate white noise
+ * Generate aspiration noise for num_samples from a block of white noise
  */
-float formant_generate_white_noise(void);
+void formant_generate_aspiration(formant_noise_t* noise, const float* white, float* output,
+                                 int num_samples, float intensity);
 
 /**
- * Generate plosive burst
+ * Generate frication noise for num_samples from a block of white noise
  */
-float formant_generate_plosive_burst(float time_in_burst, float intensity, float freq);
+void formant_generate_frication(formant_noise_t* noise, const float* white, float* output,
+                                int num_samples, float intensity, float cutoff_freq);
+
+/**
+ * Generate white noise (one sample from the pre-filled block)
+ * Per-sample convenience; block renderers use formant_noise_fill().
+ */
+float formant_generate_white_noise(formant_noise_t* noise);
+
+/**
+ * Generate one plosive burst sample from one white noise sample
+ */
+float formant_generate_plosive_burst(formant_noise_t* noise, float white, float time_in_burst,
+                                     float intensity, float freq);
 
 /* ============================================================================
  * CELP Functions
  * ========================================================================= */
 
 /**
- * Initialize CELP engine
+ * Initialize CELP engine for sample_rate
+ * The first engine at a given rate resamples the 16 kHz excitation codebook
+ * (polyphase windowed sinc); later engines share that copy.
+ * Returns 0 on success, -1 on error
+ */
+int formant_celp_init(formant_celp_engine_t* celp, float sample_rate);
+
+/**
+ * Shared excitation codebook for sample_rate, built on first use
+ * Not for the audio thread. Returns NULL on error
  */
-void formant_celp_init(formant_celp_engine_t* celp);
+const formant_celp_codebook_t* formant_celp_codebook(float sample_rate);
 
 /**
- * Set LPC coefficients for phoneme
+ * Jump the LPC filter to a phoneme's vocal tract (-1: neutral), no glide
  */
-void formant_celp_set_lpc(formant_celp_engine_t* celp, const char* phoneme);
+void formant_celp_set_lpc(formant_celp_engine_t* celp, int phoneme_id);
 
 /**
- * Select excitation vector for phoneme
+ * Select excitation vector and LPC shape for a phoneme ID (-1: neutral voice)
+ * Uses the phoneme x pitch band map built at init; no string work.
  */
 void formant_celp_select_excitation(
     formant_celp_engine_t* celp,
-    const formant_phoneme_config_t* phoneme,
+    int phoneme_id,
     float pitch);
 
 /**
@@ -747,6 +1734,50 @@ static inline float formant_clamp(float value, float min, float max) {
  */
 uint64_t formant_get_time_us(void);
 
+/**
+ * Get monotonic time in microseconds, for measuring intervals
+ * Unlike formant_get_time_us() it does not step when the wall clock is set.
+ */
+uint64_t formant_get_monotonic_us(void);
+
+/**
+ * Microseconds since a formant_get_monotonic_us() reading (0 if negative)
+ */
+uint64_t formant_elapsed_us(uint64_t start_us);
+
+/* ============================================================================
+ * FFT Functions
+ * ========================================================================= */
+
+/* Real FFT plan (opaque); one plan per thread, transforms never allocate */
+typedef struct formant_fft formant_fft_t;
+
+/**
+ * Create plan for real transforms of size (power of two, >= 4)
+ */
+formant_fft_t* formant_fft_create(int size);
+
+/**
+ * Destroy FFT plan
+ */
+void formant_fft_destroy(formant_fft_t* fft);
+
+/**
+ * Transform size of plan
+ */
+int formant_fft_size(const formant_fft_t* fft);
+
+/**
+ * Forward transform of size real samples into size/2 + 1 bins (unscaled)
+ */
+void formant_fft_forward(formant_fft_t* fft, const float* input, float* re, float* im);
+
+/**
+ * Inverse of formant_fft_forward(): size/2 + 1 bins to size real samples
+ * Scaled by 1/size, so forward followed by inverse is the identity.
+ */
+void formant_fft_inverse(formant_fft_t* fft, const float* re, const float* im, float* output);
+
 /* ============================================================================
  * Diagnostic Functions
  * ========================================================================= */
@@ -771,6 +1802,11 @@ float formant_diagnostics_get_rms(void);
  */
 void formant_diagnostics_print_stats(void);
 
+/**
+ * Print command queue statistics (depth, high water mark, overflows)
+ */
+void formant_diagnostics_print_queue(formant_engine_t* engine);
+
 /* ============================================================================
  * VAD Functions
  * ========================================================================= */
@@ -817,6 +1853,13 @@ formant_vad_state_t formant_vad_get_state(formant_vad_t* vad);
  */
 int formant_vad_get_pretrigger(formant_vad_t* vad, float* output, int max_samples);
 
+/**
+ * Compute the features of one frame (frame_size samples)
+ * Advances the spectral flux reference; formant_vad_process_frame() calls
+ * this itself. Never allocates
+ */
+void formant_vad_compute_features(formant_vad_t* vad, const float* frame, formant_vad_features_t* features);
+
 /* ============================================================================
  * Recorder Functions
  * ========================================================================= */
@@ -833,23 +1876,46 @@ void formant_recorder_destroy(formant_recorder_t* recorder);
 
 /**
  * Start recording to file (fixed duration)
+ * Opens the file, the writer thread and the input stream, so never call
+ * it from the audio callback; use formant_recorder_request() there.
  * Returns 0 on success, -1 on error
  */
 int formant_recorder_start(formant_recorder_t* recorder, const char* filename, float duration_ms);
 
 /**
  * Start recording with VAD (automatic speech detection)
+ * Blocks like formant_recorder_start()
  * Returns 0 on success, -1 on error
  */
 int formant_recorder_start_vad(formant_recorder_t* recorder, const char* filename,
                                 float max_duration_ms, int vad_mode);
 
+/**
+ * Ask the recorder's control thread to start a capture (audio thread)
+ * Only copies the request and sets a flag. The control thread stops any
+ * capture in progress, starts this one and reports errors.
+ * Returns 0 if handed over, -1 if the previous request is still pending
+ */
+int formant_recorder_request(formant_recorder_t* recorder, const char* filename,
+                             float duration_ms, bool use_vad, int vad_mode);
+
 /**
  * Stop recording and finalize WAV file
+ * Joins the writer thread, so call from a control thread, never the
+ * audio callback. Captures that end by themselves (duration, silence)
+ * are finalized by the writer thread without this call.
  * Returns 0 on success, -1 on error
  */
 int formant_recorder_stop(formant_recorder_t* recorder);
 
+/**
+ * Feed input captured by a full-duplex stream (audio thread)
+ * Used when recorder->shared_input is set instead of the recorder's own
+ * stream. Input is regrouped into VAD frames as needed.
+ * Returns false once the capture has ended
+ */
+bool formant_recorder_capture(formant_recorder_t* recorder, const float* input, int num_samples);
+
 /**
  * Check if recorder is currently recording
  */
@@ -876,6 +1942,25 @@ formant_meter_t* formant_meter_create(float sample_rate, const char* preset);
  */
 void formant_meter_destroy(formant_meter_t* meter);
 
+/**
+ * Set up a FIR filter from num_taps coefficients (copied)
+ * Picks direct form or partitioned FFT convolution by tap count and
+ * replaces any filter already held. Returns 0, or -1 on error
+ */
+int formant_fir_filter_init(formant_fir_filter_t* filter, const float* coeffs, int num_taps);
+
+/**
+ * Filter num_samples (pass-through when no coefficients are loaded)
+ * Partitioned filters delay the output by FORMANT_FIR_PARTITION samples.
+ * input and output may be the same buffer.
+ */
+void formant_fir_filter_process(formant_fir_filter_t* filter, const float* input, float* output, int num_samples);
+
+/**
+ * Free a FIR filter's buffers (the struct itself is not freed)
+ */
+void formant_fir_filter_release(formant_fir_filter_t* filter);
+
 /**
  * Load FIR filter coefficients from file
  * @param filename Path to coefficient file (e.g., "meters/a_weight.coef")
@@ -885,7 +1970,9 @@ int formant_meter_load_filter(formant_meter_t* meter, const char* filename);
 
 /**
  * Process audio samples through meter
- * Updates RMS, peak, and true peak values
+ * Updates RMS, peak, and true peak values. Works on whole blocks: the
+ * RMS window is a running sum and peaks are vector reductions, so the
+ * cost per sample does not depend on the integration time.
  */
 void formant_meter_process(formant_meter_t* meter, const float* samples, int num_samples);
 
@@ -904,6 +1991,11 @@ float formant_meter_get_peak_db(formant_meter_t* meter);
  */
 float formant_meter_get_peak_hold_db(formant_meter_t* meter);
 
+/**
+ * Get current true peak in dBTP (4x oversampled, ITU-R BS.1770 Annex 2)
+ */
+float formant_meter_get_true_peak_db(formant_meter_t* meter);
+
 /**
  * Reset meter statistics
  */
@@ -917,6 +2009,92 @@ void formant_meter_reset(formant_meter_t* meter);
  */
 void formant_meter_format_display(formant_meter_t* meter, char* buffer, int buffer_size, int width);
 
+/* ============================================================================
+ * Monitor Functions
+ * ========================================================================= */
+
+/**
+ * Create an output monitor (meter preset as for formant_meter_create)
+ * Returns NULL on error
+ */
+formant_monitor_t* formant_monitor_create(float sample_rate, const char* preset);
+
+/**
+ * Destroy and free monitor
+ */
+void formant_monitor_destroy(formant_monitor_t* monitor);
+
+/**
+ * Meter one rendered block and publish a snapshot (audio thread only)
+ * render_us is the time spent producing the block, for the load reading.
+ * Wait-free, no allocation and no stdio.
+ */
+void formant_monitor_process(formant_monitor_t* monitor, const float* samples, int num_samples,
+                             uint64_t render_us);
+
+/**
+ * Copy the latest snapshot (any thread)
+ * Returns false if nothing has been published yet
+ */
+bool formant_monitor_read(formant_monitor_t* monitor, formant_meter_snapshot_t* snapshot);
+
+/**
+ * Format a snapshot as a one-line status report
+ */
+void formant_monitor_format(const formant_meter_snapshot_t* snapshot, char* buffer, int buffer_size);
+
+/* ============================================================================
+ * Loudness Functions
+ * ========================================================================= */
+
+/**
+ * Create EBU R128 loudness meter
+ * Returns NULL on error
+ */
+formant_loudness_t* formant_loudness_create(float sample_rate);
+
+/**
+ * Destroy and free loudness meter
+ */
+void formant_loudness_destroy(formant_loudness_t* loudness);
+
+/**
+ * Clear all readings and filter state
+ */
+void formant_loudness_reset(formant_loudness_t* loudness);
+
+/**
+ * Measure num_samples of mono audio (O(1) per sample, never allocates)
+ */
+void formant_loudness_process(formant_loudness_t* loudness, const float* samples, int num_samples);
+
+/**
+ * Momentary loudness (400 ms) in LUFS, FORMANT_LOUDNESS_NONE before 400 ms of audio
+ */
+float formant_loudness_momentary(const formant_loudness_t* loudness);
+
+/**
+ * Short-term loudness (3 s) in LUFS, FORMANT_LOUDNESS_NONE before 3 s of audio
+ */
+float formant_loudness_short_term(const formant_loudness_t* loudness);
+
+/**
+ * Gated integrated loudness in LUFS (-70 LUFS absolute, -10 LU relative gate)
+ * Returns FORMANT_LOUDNESS_NONE if no block passes the gates
+ */
+float formant_loudness_integrated(const formant_loudness_t* loudness);
+
+/**
+ * Loudness range in LU (EBU Tech 3342: 10th to 95th percentile of gated
+ * short-term loudness, -20 LU relative gate). 0 if nothing passes the gates
+ */
+float formant_loudness_range(const formant_loudness_t* loudness);
+
+/**
+ * Print a one-line loudness summary to stderr
+ */
+void formant_loudness_report(const formant_loudness_t* loudness, const char* label);
+
 /* ============================================================================
  * Sound Bank Functions
  * ========================================================================= */
@@ -956,6 +2134,130 @@ sound_grain_t* sound_bank_find_grain(sound_bank_t* bank, const char* phoneme);
  */
 int sound_bank_analyze_grain(const char* wav_file, sound_grain_t* grain);
 
+/**
+ * Create grain analyzer (NCC refinement on)
+ */
+sound_grain_analyzer_t* sound_grain_analyzer_create(void);
+
+/**
+ * Destroy grain analyzer
+ */
+void sound_grain_analyzer_destroy(sound_grain_analyzer_t* analyzer);
+
+/**
+ * sound_bank_analyze_grain() reusing analyzer's plan and scratch
+ */
+int sound_grain_analyze(sound_grain_analyzer_t* analyzer, const char* wav_file, sound_grain_t* grain);
+
+/**
+ * Find loop points one pitch period either side of the midpoint
+ * The period is the autocorrelation peak between 80 and 500 Hz over the
+ * middle third of audio, computed by FFT.
+ * Returns the period in samples, or -1 if audio is shorter than 1024 samples
+ */
+int sound_grain_find_loop_points(sound_grain_analyzer_t* analyzer, const float* audio, int length,
+                                 int sample_rate, uint32_t* loop_start, uint32_t* loop_end);
+
+/**
+ * Analyze wav_files[i] into grains[i] on num_threads threads
+ * (0 = online CPUs, the caller counts as one). grains is preallocated by
+ * the caller; each thread owns a sound_grain_analyzer_t and claims files
+ * from a shared counter. Slots whose file fails to load are left zeroed
+ * (audio_data NULL). Returns number of grains analyzed, or -1 on error
+ */
+int sound_grain_analyze_batch(const char* const* wav_files, int count, sound_grain_t* grains,
+                              int num_threads);
+
+/**
+ * Load count grains into bank, analyzed in parallel
+ * phonemes[i] labels wav_files[i]. Slots are reserved before any thread
+ * starts, and grains enter the BST afterwards in input order. Files that
+ * fail are skipped. Not for mapped banks.
+ * Returns number of grains added, or -1 on error
+ */
+int sound_bank_load_grains(sound_bank_t* bank, const char* const* phonemes,
+                           const char* const* wav_files, int count, int num_threads);
+
+/**
+ * Compile grains listed in a manifest into one .fbank file
+ * Manifest lines are "<ipa> <file.wav>"; # starts a comment, and relative
+ * paths are taken from the manifest's directory. Each grain is analyzed
+ * (loop points, gain map, features) once, here, on num_threads threads
+ * (0 = online CPUs).
+ * Returns number of grains written, or -1 on error
+ */
+int sound_bank_compile(const char* manifest_path, const char* output_path, sound_bank_format_t format,
+                       int num_threads);
+
+/**
+ * Map a compiled bank read-only
+ * Constant time in bank size: only the header and index bounds are
+ * checked. Free with sound_bank_destroy(). Returns NULL on error
+ */
+sound_bank_t* sound_bank_map(const char* path);
+
+/**
+ * First index entry for phoneme in a mapped bank (binary search)
+ * Entries for one phoneme are adjacent, in rising F0.
+ * Returns -1 if absent. Never allocates
+ */
+int sound_bank_find_entry(const sound_bank_t* bank, const char* phoneme);
+
+/**
+ * Fill grain with a read-only view of mapped entry index
+ * audio_data (float banks) or audio_pcm16 (int16 banks) and gain_map
+ * point into the mapping; do not free or write them.
+ * Returns 0, or -1 if index is out of range or the entry is corrupt
+ */
+int sound_bank_mapped_grain(const sound_bank_t* bank, int index, sound_grain_t* grain);
+
+/**
+ * Compute a loaded grain's SOUND_GRAIN_FEATURE_* vector
+ * Needs audio_data (not a mapped int16 grain).
+ */
+void sound_grain_calc_features(const sound_grain_t* grain, const char* ipa,
+                               float features[SOUND_GRAIN_FEATURES]);
+
+/**
+ * Build a feature index over every grain in bank (loaded or mapped)
+ * Grains whose phoneme is not in the phoneme table are left out.
+ * Returns NULL on error
+ */
+sound_grain_index_t* sound_grain_index_create(const sound_bank_t* bank);
+
+/**
+ * Free index
+ */
+void sound_grain_index_destroy(sound_grain_index_t* index);
+
+/**
+ * Start a query for phoneme at f0_hz (<= 0, or an unvoiced phoneme:
+ * pitch is ignored) with default weights. Level and brightness target the
+ * bank's means but are ignored until an emotion is applied.
+ * Returns 0, or -1 if phoneme is unknown
+ */
+int sound_grain_query_init(sound_grain_query_t* query, const sound_grain_index_t* index,
+                           const char* phoneme, float f0_hz);
+
+/**
+ * Move a query's pitch, level and brightness targets toward emotion, and
+ * weigh level and brightness. intensity 0-1 scales the shift; NEUTRAL
+ * leaves the query unchanged
+ */
+void sound_grain_query_emotion(sound_grain_query_t* query, formant_emotion_t emotion, float intensity);
+
+/**
+ * Find up to k (<= SOUND_GRAIN_MATCHES_MAX) nearest grains, closest first
+ * mix weights the matches by inverse distance for interpolation; an exact
+ * match gets all of it. Allocation-free, safe on the audio thread, and
+ * bounded as described at sound_grain_index_t. When a large bank hits
+ * the visit limit (typically an emotion query without a pitch, on a
+ * voiced phoneme) the matches are the best among the rows examined.
+ * Returns number of matches
+ */
+int sound_grain_index_nearest(const sound_grain_index_t* index, const sound_grain_query_t* query,
+                              sound_grain_match_t* matches, int k);
+
 /**
  * Export grain metadata to JSON file
  */
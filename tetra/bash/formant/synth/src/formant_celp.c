@@ -9,6 +9,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <pthread.h>
 #include "formant.h"
 #include "excitation_codebook.h"
 
@@ -17,88 +18,143 @@
 #endif
 
 /* ============================================================================
- * Simple LPC Filter (All-Pole IIR)
+ * LPC Lattice Filter (All-Pole)
  * ========================================================================= */
 
-void formant_lpc_filter_init(formant_lpc_filter_t* lpc) {
+#define LPC_GLIDE_MS 5.0f           /* Time constant of reflection coefficient glides */
+#define LPC_GLIDE_LENGTH 4          /* Glide runs this many time constants, then snaps */
+#define LPC_OUTPUT_GAIN 0.5f        /* Headroom below unit power gain */
+#define LPC_IMPULSE_LENGTH 8192     /* Impulse response used to measure power gain */
+
+static void lpc_filter_init(formant_lpc_filter_t* lpc, float sample_rate) {
     memset(lpc, 0, sizeof(formant_lpc_filter_t));
-    lpc->gain = 1.0f;
+    lpc->gain = lpc->gain_target = 1.0f;
+    lpc->glide = 1.0f - expf(-1000.0f / (LPC_GLIDE_MS * sample_rate));
+    lpc->glide_length = (int)(LPC_GLIDE_LENGTH * LPC_GLIDE_MS * sample_rate / 1000.0f);
+}
+
+/**
+ * All-pole lattice, order FORMANT_LPC_ORDER
+ * Stage m: f_{m-1} = f_m - k_m b_{m-1}[n-1], b_m[n] = b_{m-1}[n-1] + k_m f_{m-1}.
+ * b[] is updated in place from the top stage down, so nothing is shifted.
+ */
+static inline float lpc_filter_process(formant_lpc_filter_t* lpc, float excitation) {
+    float f = excitation * lpc->gain;
+
+    for (int m = FORMANT_LPC_ORDER - 1; m >= 0; m--) {
+        f -= lpc->k[m] * lpc->b[m];
+        if (m + 1 < FORMANT_LPC_ORDER) {
+            lpc->b[m + 1] = lpc->b[m] + lpc->k[m] * f;
+        }
+    }
+    lpc->b[0] = f;
+
+    return f;
 }
 
-float formant_lpc_filter_process(formant_lpc_filter_t* lpc, float excitation) {
-    // All-pole IIR filter: y[n] = x[n] * gain - sum(a[i] * y[n-i])
-    float output = excitation * lpc->gain;
+/**
+ * Step towards the target shape; interpolating reflection coefficients
+ * keeps every intermediate filter stable (|k| < 1 is convex)
+ */
+static inline void lpc_filter_glide(formant_lpc_filter_t* lpc) {
+    if (lpc->glide_remaining <= 0) return;
 
-    for (int i = 0; i < 10; i++) {
-        output -= lpc->a[i] * lpc->mem[i];
+    if (--lpc->glide_remaining == 0) {
+        memcpy(lpc->k, lpc->k_target, sizeof(lpc->k));
+        lpc->gain = lpc->gain_target;
+        return;
     }
 
-    // Shift filter memory
-    for (int i = 9; i > 0; i--) {
-        lpc->mem[i] = lpc->mem[i-1];
+    for (int m = 0; m < FORMANT_LPC_ORDER; m++) {
+        lpc->k[m] += lpc->glide * (lpc->k_target[m] - lpc->k[m]);
     }
-    lpc->mem[0] = output;
+    lpc->gain += lpc->glide * (lpc->gain_target - lpc->gain);
+}
 
-    return output;
+static void lpc_filter_set_target(formant_lpc_filter_t* lpc, const float* k, float gain, bool glide) {
+    memcpy(lpc->k_target, k, sizeof(lpc->k_target));
+    lpc->gain_target = gain;
+
+    if (glide) {
+        lpc->glide_remaining = lpc->glide_length;
+    } else {
+        memcpy(lpc->k, k, sizeof(lpc->k));
+        lpc->gain = gain;
+        lpc->glide_remaining = 0;
+    }
 }
 
 /* ============================================================================
- * Hand-Crafted LPC Coefficients (Simple Vowel Approximations)
+ * LPC From Formants
  * ========================================================================= */
 
-// LPC coefficients that approximate vowel formants
-// Very conservative to ensure stability - no feedback > 1.0 total
-
-static const float LPC_A[] = {  // Open vowel /a/
-    0.3f, -0.15f, 0.08f, -0.04f, 0.02f,
-    -0.01f, 0.005f, -0.002f, 0.001f, -0.0005f
-};
-
-static const float LPC_I[] = {  // Close front vowel /i/
-    0.4f, -0.2f, 0.1f, -0.05f, 0.025f,
-    -0.012f, 0.006f, -0.003f, 0.0015f, -0.0007f
-};
-
-static const float LPC_E[] = {  // Mid-front vowel /e/
-    0.35f, -0.18f, 0.09f, -0.045f, 0.022f,
-    -0.011f, 0.005f, -0.003f, 0.0015f, -0.0007f
-};
-
-static const float LPC_O[] = {  // Mid-back vowel /o/
-    0.32f, -0.16f, 0.08f, -0.04f, 0.02f,
-    -0.01f, 0.005f, -0.002f, 0.001f, -0.0005f
-};
-
-static const float LPC_U[] = {  // Close back vowel /u/
-    0.28f, -0.14f, 0.07f, -0.035f, 0.017f,
-    -0.008f, 0.004f, -0.002f, 0.001f, -0.0005f
-};
-
-static const float LPC_SCHWA[] = {  // Neutral vowel /ə/
-    0.3f, -0.15f, 0.075f, -0.037f, 0.018f,
-    -0.009f, 0.004f, -0.002f, 0.001f, -0.0005f
-};
-
-static const float LPC_FRICATIVE[] = {  // Fricative (noise-like)
-    0.2f, -0.1f, 0.05f, -0.025f, 0.012f,
-    -0.006f, 0.003f, -0.0015f, 0.0007f, -0.0003f
-};
-
-static const float LPC_NASAL[] = {  // Nasal (low resonance)
-    0.38f, -0.19f, 0.095f, -0.047f, 0.023f,
-    -0.011f, 0.006f, -0.003f, 0.0015f, -0.0007f
-};
-
-/* Get LPC coefficients for phoneme */
-static const float* get_lpc_for_phoneme_char(char phoneme) {
-    switch (phoneme) {
-        case 'a': return LPC_A;
-        case 'i': return LPC_I;
-        case 'e': return LPC_E;
-        case 'o': return LPC_O;
-        case 'u': return LPC_U;
-        default:  return LPC_SCHWA;
+/**
+ * Reflection coefficients and output gain for a phoneme's vocal tract
+ *
+ * Each formant below Nyquist becomes a conjugate pole pair at radius
+ * exp(-pi*bw/fs), angle 2*pi*f/fs. The pairs are multiplied out into
+ * A(z) = 1 + a1 z^-1 + ... + a10 z^-10, then stepped down (backward
+ * Levinson) to reflection coefficients. The gain normalizes the filter to
+ * unit power gain so phonemes with narrow formants are not louder.
+ */
+static void lpc_from_formants(const formant_phoneme_config_t* phoneme, float sample_rate,
+                              float* k, float* gain) {
+    const float freqs[FORMANT_MAX_FORMANTS] = {
+        phoneme->f1, phoneme->f2, phoneme->f3, phoneme->f4, phoneme->f5
+    };
+    const float bws[FORMANT_MAX_FORMANTS] = {
+        phoneme->bw1, phoneme->bw2, phoneme->bw3, phoneme->bw4, phoneme->bw5
+    };
+
+    double a[FORMANT_LPC_ORDER + 1] = {1.0};
+    int order = 0;
+
+    for (int f = 0; f < FORMANT_MAX_FORMANTS; f++) {
+        if (freqs[f] <= 0.0f || freqs[f] >= 0.45f * sample_rate || bws[f] <= 0.0f) {
+            continue;   /* Pole pair would alias; leave that section flat */
+        }
+
+        double r = exp(-M_PI * bws[f] / sample_rate);
+        double c1 = -2.0 * r * cos(2.0 * M_PI * freqs[f] / sample_rate);
+        double c2 = r * r;
+
+        for (int i = order + 2; i >= 1; i--) {
+            a[i] += c1 * a[i - 1] + (i >= 2 ? c2 * a[i - 2] : 0.0);
+        }
+        order += 2;
+    }
+
+    /* Step-down recursion: k_m = a_m^(m), then drop to order m-1 */
+    for (int m = 0; m < FORMANT_LPC_ORDER; m++) {
+        k[m] = 0.0f;
+    }
+    for (int m = order; m >= 1; m--) {
+        double km = a[m];
+        k[m - 1] = (float)km;
+
+        double scale = 1.0 / (1.0 - km * km);
+        double prev[FORMANT_LPC_ORDER + 1];
+        for (int i = 1; i < m; i++) {
+            prev[i] = (a[i] - km * a[m - i]) * scale;
+        }
+        for (int i = 1; i < m; i++) {
+            a[i] = prev[i];
+        }
+    }
+
+    /* Power gain of the unit-gain filter from its impulse response */
+    formant_lpc_filter_t probe;
+    memset(&probe, 0, sizeof(probe));
+    memcpy(probe.k, k, sizeof(probe.k));
+    probe.gain = 1.0f;
+
+    double energy = 0.0;
+    for (int n = 0; n < LPC_IMPULSE_LENGTH; n++) {
+        float y = lpc_filter_process(&probe, n == 0 ? 1.0f : 0.0f);
+        energy += (double)y * y;
     }
+
+    *gain = LPC_OUTPUT_GAIN * (float)(1.0 / sqrt(energy > 1e-12 ? energy : 1.0));
 }
 
 /* ============================================================================
@@ -172,76 +228,280 @@ static const excitation_vector_t* select_excitation_for_phoneme(
     }
 }
 
+/* ============================================================================
+ * Codebook Resampling
+ * ========================================================================= */
+
+#define RESAMPLE_TAPS 16            /* Taps per polyphase branch (at unity cutoff) */
+#define RESAMPLE_KAISER_BETA 8.0    /* ~80 dB stopband */
+#define CELP_FADE_SOURCE 20         /* Loop crossfade, in codebook (16 kHz) samples */
+#define CELP_MAX_RATES 8            /* Distinct engine rates cached per process */
+
+static formant_celp_codebook_t g_codebooks[CELP_MAX_RATES];
+static int g_num_codebooks = 0;
+static pthread_mutex_t g_codebook_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int gcd_int(int a, int b) {
+    while (b != 0) {
+        int t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+/* Zeroth-order modified Bessel function (power series) for the Kaiser window */
+static double bessel_i0(double x) {
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 32; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < sum * 1e-12) break;
+    }
+    return sum;
+}
+
+/**
+ * Resample every codebook vector from EXCITATION_SAMPLE_RATE to sample_rate
+ *
+ * Rational up/down polyphase filter: output m sits at input time
+ * m * down / up, so only its phase (m * down) mod up selects a branch of
+ * precomputed Kaiser-windowed sinc taps. Vectors are treated as periodic,
+ * which keeps looped excitations seamless at the new rate.
+ */
+static int build_codebook(formant_celp_codebook_t* cb, float sample_rate) {
+    int out_rate = (int)lroundf(sample_rate);
+    if (out_rate <= 0) {
+        return -1;
+    }
+
+    int g = gcd_int(out_rate, EXCITATION_SAMPLE_RATE);
+    int up = out_rate / g;
+    int down = EXCITATION_SAMPLE_RATE / g;
+
+    /* Cutoff at the lower of the two Nyquist rates, relative to the input */
+    double cutoff = up < down ? (double)up / down : 1.0;
+    int taps = (int)ceil(RESAMPLE_TAPS / cutoff);
+    int half = taps / 2;
+
+    cb->sample_rate = sample_rate;
+    cb->num_vectors = EXCITATION_CODEBOOK_SIZE;
+    cb->length = (int)(((long)EXCITATION_VECTOR_LENGTH * up + down - 1) / down);
+    cb->stride = (cb->length + 15) & ~15;   /* 64-byte rows */
+    cb->fade_length = (int)lround((double)CELP_FADE_SOURCE * up / down);
+    if (cb->fade_length < 1) cb->fade_length = 1;
+    if (cb->fade_length > cb->length) cb->fade_length = cb->length;
+
+    cb->samples = (float*)aligned_alloc(FORMANT_CACHE_LINE,
+                                        (size_t)cb->num_vectors * cb->stride * sizeof(float));
+    cb->fade = (float*)malloc(cb->fade_length * sizeof(float));
+    float* coeffs = (float*)malloc((size_t)up * taps * sizeof(float));
+    if (!cb->samples || !cb->fade || !coeffs) {
+        free(cb->samples);
+        free(cb->fade);
+        free(coeffs);
+        cb->samples = NULL;
+        cb->fade = NULL;
+        return -1;
+    }
+    memset(cb->samples, 0, (size_t)cb->num_vectors * cb->stride * sizeof(float));
+
+    for (int i = 0; i < cb->fade_length; i++) {
+        cb->fade[i] = (float)i / (float)cb->fade_length;
+    }
+
+    /* Branch p covers inputs floor(x) - half + 1 + k for frac(x) = p / up */
+    double i0_beta = bessel_i0(RESAMPLE_KAISER_BETA);
+    for (int p = 0; p < up; p++) {
+        double frac = (double)p / up;
+        double sum = 0.0;
+        float* branch = coeffs + (size_t)p * taps;
+
+        for (int k = 0; k < taps; k++) {
+            double d = frac + half - 1 - k;     /* x - n */
+            double t = d / half;
+            double w = fabs(t) < 1.0 ? bessel_i0(RESAMPLE_KAISER_BETA * sqrt(1.0 - t * t)) / i0_beta : 0.0;
+            double arg = M_PI * cutoff * d;
+            double sinc = fabs(arg) < 1e-9 ? 1.0 : sin(arg) / arg;
+            branch[k] = (float)(cutoff * sinc * w);
+            sum += branch[k];
+        }
+
+        /* Unity DC gain on every branch, so no phase-dependent ripple */
+        if (sum != 0.0) {
+            for (int k = 0; k < taps; k++) {
+                branch[k] = (float)(branch[k] / sum);
+            }
+        }
+    }
+
+    for (int v = 0; v < cb->num_vectors; v++) {
+        const float* in = EXCITATION_CODEBOOK[v]->samples;
+        float* out = cb->samples + (size_t)v * cb->stride;
+
+        for (int m = 0; m < cb->length; m++) {
+            long pos = (long)m * down;
+            int base = (int)(pos / up) - half + 1;
+            const float* branch = coeffs + (size_t)(pos % up) * taps;
+            float acc = 0.0f;
+
+            for (int k = 0; k < taps; k++) {
+                int n = (base + k) % EXCITATION_VECTOR_LENGTH;
+                if (n < 0) n += EXCITATION_VECTOR_LENGTH;
+                acc += branch[k] * in[n];
+            }
+            out[m] = acc;
+        }
+    }
+
+    free(coeffs);
+
+    /* Vocal tracts: unknown IDs and the neutral row use schwa */
+    const formant_phoneme_config_t* neutral = formant_get_phoneme("ə");
+    int count = formant_phoneme_count();
+    for (int id = 0; id <= FORMANT_MAX_PHONEMES; id++) {
+        const formant_phoneme_config_t* phoneme = id < count ? formant_phoneme_by_id(id) : NULL;
+        lpc_from_formants(phoneme ? phoneme : neutral, sample_rate,
+                          cb->reflection[id], &cb->lpc_gain[id]);
+    }
+
+    return 0;
+}
+
+const formant_celp_codebook_t* formant_celp_codebook(float sample_rate) {
+    const formant_celp_codebook_t* result = NULL;
+
+    pthread_mutex_lock(&g_codebook_lock);
+
+    for (int i = 0; i < g_num_codebooks; i++) {
+        if (g_codebooks[i].sample_rate == sample_rate) {
+            result = &g_codebooks[i];
+            break;
+        }
+    }
+
+    if (!result && g_num_codebooks < CELP_MAX_RATES &&
+        build_codebook(&g_codebooks[g_num_codebooks], sample_rate) == 0) {
+        result = &g_codebooks[g_num_codebooks++];
+    }
+
+    pthread_mutex_unlock(&g_codebook_lock);
+    return result;
+}
+
+/* Row of the shared codebook matching a static codebook entry */
+static int excitation_index(const excitation_vector_t* excitation) {
+    for (int i = 0; i < EXCITATION_CODEBOOK_SIZE; i++) {
+        if (EXCITATION_CODEBOOK[i] == excitation) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* ============================================================================
+ * Phoneme -> Excitation Map
+ * ========================================================================= */
+
+#define CELP_PITCH_BANDS 3          /* _low (< 110 Hz), _mid, _high (> 140 Hz) */
+
+/* Everything select needs for one phoneme, resolved once at init */
+typedef struct {
+    int16_t excitation[CELP_PITCH_BANDS];   /* Codebook row per pitch band, -1 if none */
+    bool loop;                              /* Sustained phoneme: loop the excitation */
+} celp_phoneme_map_t;
+
+/* Index FORMANT_MAX_PHONEMES is the neutral entry used for unknown IDs */
+static celp_phoneme_map_t g_phoneme_map[FORMANT_MAX_PHONEMES + 1];
+static pthread_once_t g_phoneme_map_once = PTHREAD_ONCE_INIT;
+
+static inline int pitch_band(float pitch) {
+    return (pitch < 110) ? 0 : (pitch > 140) ? 2 : 1;
+}
+
+/*
+ * Run the name-based selection for every phoneme and pitch band up front,
+ * so the audio thread only indexes g_phoneme_map
+ */
+static void build_phoneme_map(void) {
+    static const float BAND_PITCH[CELP_PITCH_BANDS] = {100.0f, 125.0f, 150.0f};
+    int count = formant_phoneme_count();
+
+    for (int id = 0; id <= FORMANT_MAX_PHONEMES; id++) {
+        const formant_phoneme_config_t* phoneme = id < count ? formant_phoneme_by_id(id) : NULL;
+        celp_phoneme_map_t* entry = &g_phoneme_map[id];
+
+        for (int band = 0; band < CELP_PITCH_BANDS; band++) {
+            entry->excitation[band] =
+                (int16_t)excitation_index(select_excitation_for_phoneme(phoneme, BAND_PITCH[band]));
+        }
+
+        entry->loop = true;
+        if (phoneme) {
+            entry->loop = (phoneme->type == FORMANT_PHONEME_VOWEL ||
+                           phoneme->type == FORMANT_PHONEME_NASAL ||
+                           phoneme->type == FORMANT_PHONEME_FRICATIVE);
+        }
+    }
+}
+
 /* ============================================================================
  * CELP Engine Public API
  * ========================================================================= */
 
-void formant_celp_init(formant_celp_engine_t* celp) {
-    if (!celp) return;
+int formant_celp_init(formant_celp_engine_t* celp, float sample_rate) {
+    if (!celp) return -1;
+
+    celp->codebook = formant_celp_codebook(sample_rate);
+    if (!celp->codebook) {
+        return -1;
+    }
+    pthread_once(&g_phoneme_map_once, build_phoneme_map);
 
-    formant_lpc_filter_init(&celp->lpc);
+    lpc_filter_init(&celp->lpc, sample_rate);
     celp->current_excitation = NULL;
     celp->excitation_position = 0;
-    celp->excitation_length = EXCITATION_VECTOR_LENGTH;
+    celp->excitation_length = celp->codebook->length;
     celp->excitation_loop = true;
+    celp->lpf_state = 0.0f;
 
-    // Set default LPC coefficients (schwa/neutral)
-    memcpy(celp->lpc.a, LPC_SCHWA, sizeof(float) * 10);
-    celp->lpc.gain = 0.5f;  // Conservative gain to prevent instability
+    // Start on the neutral (schwa) vocal tract
+    formant_celp_set_lpc(celp, -1);
+    return 0;
 }
 
-void formant_celp_set_lpc(formant_celp_engine_t* celp, const char* phoneme) {
-    if (!celp || !phoneme) return;
+void formant_celp_set_lpc(formant_celp_engine_t* celp, int phoneme_id) {
+    if (!celp || !celp->codebook) return;
 
-    // Get LPC coefficients based on first character of phoneme
-    const float* lpc_coeff = get_lpc_for_phoneme_char(phoneme[0]);
-    memcpy(celp->lpc.a, lpc_coeff, sizeof(float) * 10);
+    int row = (phoneme_id >= 0 && phoneme_id < FORMANT_MAX_PHONEMES) ? phoneme_id : FORMANT_MAX_PHONEMES;
+    lpc_filter_set_target(&celp->lpc, celp->codebook->reflection[row],
+                          celp->codebook->lpc_gain[row], false);
 }
 
 void formant_celp_select_excitation(
     formant_celp_engine_t* celp,
-    const formant_phoneme_config_t* phoneme,
+    int phoneme_id,
     float pitch)
 {
     if (!celp) return;
 
-    const excitation_vector_t* excitation = select_excitation_for_phoneme(phoneme, pitch);
-    if (excitation) {
-        celp->current_excitation = excitation;
-        celp->excitation_position = 0;
-        celp->excitation_length = EXCITATION_VECTOR_LENGTH;
+    bool known = phoneme_id >= 0 && phoneme_id < FORMANT_MAX_PHONEMES;
+    const celp_phoneme_map_t* entry = &g_phoneme_map[known ? phoneme_id : FORMANT_MAX_PHONEMES];
 
-        // Smoothly transition LPC filter to avoid pops
-        // Don't clear filter memory - let it transition naturally
+    int index = entry->excitation[pitch_band(pitch)];
+    if (index >= 0) {
+        const formant_celp_codebook_t* cb = celp->codebook;
+        celp->current_excitation = cb->samples + (size_t)index * cb->stride;
+        celp->excitation_position = 0;
+        celp->excitation_length = cb->length;
 
-        // Set appropriate LPC coefficients
-        if (phoneme) {
-            const float* lpc_coeff;
-            switch (phoneme->type) {
-                case FORMANT_PHONEME_VOWEL:
-                    lpc_coeff = get_lpc_for_phoneme_char(phoneme->ipa[0]);
-                    break;
-                case FORMANT_PHONEME_FRICATIVE:
-                    lpc_coeff = LPC_FRICATIVE;
-                    break;
-                case FORMANT_PHONEME_NASAL:
-                    lpc_coeff = LPC_NASAL;
-                    break;
-                default:
-                    lpc_coeff = LPC_SCHWA;
-                    break;
-            }
-            // Smoothly interpolate coefficients to avoid discontinuities
-            for (int i = 0; i < 10; i++) {
-                celp->lpc.a[i] = 0.8f * celp->lpc.a[i] + 0.2f * lpc_coeff[i];
-            }
-        }
+        // Glide to the new vocal tract; filter state carries over so there is no pop
+        if (known) {
+            lpc_filter_set_target(&celp->lpc, cb->reflection[phoneme_id],
+                                  cb->lpc_gain[phoneme_id], true);
 
-        // Determine if this phoneme should loop excitation
-        if (phoneme) {
-            celp->excitation_loop = (phoneme->type == FORMANT_PHONEME_VOWEL ||
-                                     phoneme->type == FORMANT_PHONEME_NASAL ||
-                                     phoneme->type == FORMANT_PHONEME_FRICATIVE);
+            // Determine if this phoneme should loop excitation
+            celp->excitation_loop = entry->loop;
         }
     }
 }
@@ -251,22 +511,17 @@ float formant_celp_process_sample(formant_celp_engine_t* celp) {
         return 0.0f;
     }
 
-    const excitation_vector_t* exc = (const excitation_vector_t*)celp->current_excitation;
-
-    // Get current excitation sample
-    float excitation = exc->samples[celp->excitation_position];
+    const float* exc = celp->current_excitation;
+    const formant_celp_codebook_t* cb = celp->codebook;
+    int pos = celp->excitation_position;
 
-    // Apply crossfade at loop boundary to prevent clicking
-    if (celp->excitation_loop) {
-        int fade_length = 20;  // Crossfade over 20 samples
+    // Get current excitation sample (already at the engine rate)
+    float excitation = exc[pos];
 
-        if (celp->excitation_position < fade_length) {
-            // Fade in from loop point
-            float fade = (float)celp->excitation_position / (float)fade_length;
-            int prev_pos = celp->excitation_length - fade_length + celp->excitation_position;
-            float prev_sample = exc->samples[prev_pos];
-            excitation = prev_sample * (1.0f - fade) + excitation * fade;
-        }
+    // Crossfade from the vector's tail at the loop boundary to prevent clicking
+    if (celp->excitation_loop && pos < cb->fade_length) {
+        float prev_sample = exc[celp->excitation_length - cb->fade_length + pos];
+        excitation = prev_sample + cb->fade[pos] * (excitation - prev_sample);
     }
 
     // Advance position
@@ -283,16 +538,16 @@ float formant_celp_process_sample(formant_celp_engine_t* celp) {
     }
 
     // Filter through LPC
-    float output = formant_lpc_filter_process(&celp->lpc, excitation);
+    lpc_filter_glide(&celp->lpc);
+    float output = lpc_filter_process(&celp->lpc, excitation);
 
     // Apply gain to match formant synthesis levels (reduced to match formant RMS)
     output *= 0.15f;
 
     // Simple one-pole low-pass to warm up the sound (reduce brightness)
-    static float lpf_state = 0.0f;
     float alpha = 0.3f;  // Low-pass coefficient (higher = more filtering)
-    lpf_state = alpha * output + (1.0f - alpha) * lpf_state;
-    output = lpf_state;
+    celp->lpf_state = alpha * output + (1.0f - alpha) * celp->lpf_state;
+    output = celp->lpf_state;
 
     // Soft clipping
     if (output > 0.9f) output = 0.9f;
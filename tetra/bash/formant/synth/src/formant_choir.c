@@ -0,0 +1,441 @@
+/**
+ * formant_choir.c
+ *
+ * Multi-voice engine: N independent formant engines, each with its own
+ * timeline, pitch and formant bank, mixed to one output.
+ * Voices are rendered in parallel on a fixed worker pool. Each audio block
+ * is one generation of a lock-free barrier: the caller publishes the block,
+ * every thread (the caller included) claims voices from a shared counter,
+ * and the caller mixes once every voice has been rendered.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <sched.h>
+#include <time.h>
+#include "formant.h"
+
+/* Idle backoff: spin, then yield, then nap between blocks */
+#define SPIN_LIMIT 2000
+#define YIELD_LIMIT 200
+#define IDLE_SLEEP_NS 50000L
+
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+static inline float* voice_buffer(formant_choir_t* choir, int voice) {
+    return choir->voice_buffers + (size_t)voice * FORMANT_CHOIR_BLOCK;
+}
+
+/* ============================================================================
+ * Worker Pool
+ * ========================================================================= */
+
+/* The work word packs the block generation above the next voice to claim */
+static inline unsigned work_generation(uint64_t work) {
+    return (unsigned)(work >> 32);
+}
+
+static inline int work_voice(uint64_t work) {
+    return (int)(work & 0xffffffffu);
+}
+
+/**
+ * Claim and render voices of generation gen until none are left
+ * Voices are claimed one at a time, so uneven voices (CELP, plosives)
+ * balance across threads without a static partition. A claim only
+ * succeeds while the word still carries gen, so a worker that wakes
+ * late cannot take a voice from the next block.
+ */
+static void render_voices(formant_choir_t* choir, unsigned gen) {
+    uint64_t work = atomic_load_explicit(&choir->work, memory_order_acquire);
+
+    while (work_generation(work) == gen && work_voice(work) < choir->num_voices) {
+        if (!atomic_compare_exchange_weak_explicit(&choir->work, &work, work + 1,
+                                                   memory_order_acquire, memory_order_acquire)) {
+            continue;
+        }
+
+        int v = work_voice(work);
+        formant_engine_process(choir->voices[v], voice_buffer(choir, v), choir->block_samples);
+        atomic_fetch_sub_explicit(&choir->pending, 1, memory_order_release);
+        work = atomic_load_explicit(&choir->work, memory_order_acquire);
+    }
+}
+
+/**
+ * Wait for the generation to move past seen
+ * Workers spin for the first few microseconds so back-to-back blocks
+ * start without a wakeup, then back off so an idle choir does not pin cores.
+ */
+static unsigned wait_for_generation(formant_choir_t* choir, unsigned seen) {
+    unsigned gen;
+    int spins = 0;
+
+    while ((gen = work_generation(atomic_load_explicit(&choir->work, memory_order_acquire))) == seen &&
+           !atomic_load_explicit(&choir->shutdown, memory_order_relaxed)) {
+        if (spins < SPIN_LIMIT) {
+            cpu_relax();
+        } else if (spins < SPIN_LIMIT + YIELD_LIMIT) {
+            sched_yield();
+        } else {
+            struct timespec ts = { 0, IDLE_SLEEP_NS };
+            nanosleep(&ts, NULL);
+            continue;   /* Stay saturated; a long idle would overflow the count */
+        }
+        spins++;
+    }
+
+    return gen;
+}
+
+static void* worker_main(void* arg) {
+    formant_choir_t* choir = (formant_choir_t*)arg;
+    unsigned seen = 0;  /* Generation 0 is never a block */
+
+    for (;;) {
+        seen = wait_for_generation(choir, seen);
+        if (atomic_load_explicit(&choir->shutdown, memory_order_relaxed)) {
+            break;
+        }
+
+        render_voices(choir, seen);
+    }
+
+    return NULL;
+}
+
+/**
+ * Render one block (<= FORMANT_CHOIR_BLOCK) of every voice into voice_buffers
+ */
+static void render_block(formant_choir_t* choir, int num_samples) {
+    /* Only the caller changes the generation, so it can read its own last one */
+    unsigned gen = work_generation(atomic_load_explicit(&choir->work, memory_order_relaxed)) + 1;
+    if (gen == 0) gen = 1;
+
+    choir->block_samples = num_samples;
+    atomic_store_explicit(&choir->pending, choir->num_voices, memory_order_relaxed);
+
+    /* Release: block_samples and pending are visible to every worker
+     * that claims a voice of the new generation */
+    atomic_store_explicit(&choir->work, (uint64_t)gen << 32, memory_order_release);
+
+    render_voices(choir, gen);
+
+    /* Barrier: every voice is claimed; wait only for the ones still being
+     * rendered, not for idle workers to wake up */
+    int spins = 0;
+    while (atomic_load_explicit(&choir->pending, memory_order_acquire) != 0) {
+        if (spins < SPIN_LIMIT) {
+            cpu_relax();
+            spins++;
+        } else {
+            sched_yield();
+        }
+    }
+}
+
+/**
+ * Render and mix every voice, FORMANT_CHOIR_BLOCK samples at a time
+ */
+static void mix_blocks(formant_choir_t* choir, float* output, int num_samples) {
+    int offset = 0;
+    while (offset < num_samples) {
+        int count = num_samples - offset;
+        if (count > FORMANT_CHOIR_BLOCK) {
+            count = FORMANT_CHOIR_BLOCK;
+        }
+
+        render_block(choir, count);
+
+        float* out = output + offset;
+        const float* src = voice_buffer(choir, 0);
+        float gain = choir->voice_gain;
+        for (int i = 0; i < count; i++) {
+            out[i] = src[i] * gain;
+        }
+        for (int v = 1; v < choir->num_voices; v++) {
+            src = voice_buffer(choir, v);
+            for (int i = 0; i < count; i++) {
+                out[i] += src[i] * gain;
+            }
+        }
+
+        offset += count;
+    }
+}
+
+/* ============================================================================
+ * PortAudio Callback
+ * ========================================================================= */
+
+static int choir_audio_callback(
+    const void* input_buffer,
+    void* output_buffer,
+    unsigned long frames_per_buffer,
+    const PaStreamCallbackTimeInfo* time_info,
+    PaStreamCallbackFlags status_flags,
+    void* user_data)
+{
+    formant_choir_t* choir = (formant_choir_t*)user_data;
+    const float* input = (const float*)input_buffer;  /* NULL unless duplex */
+    float* output = (float*)output_buffer;
+    int n = (int)frames_per_buffer;
+
+    (void)time_info;
+    (void)status_flags;
+
+    formant_choir_process(choir, output, n);
+
+    if (input) {
+        for (int v = 0; v < choir->num_voices; v++) {
+            formant_recorder_capture(choir->voices[v]->recorder, input, n);
+        }
+        formant_audio_process_duplex(&choir->audio, input, output, n);
+    }
+    return paContinue;
+}
+
+/* ============================================================================
+ * Public API
+ * ========================================================================= */
+
+formant_choir_t* formant_choir_create(int num_voices, int num_threads, float sample_rate) {
+    if (num_voices < 1 || num_voices > FORMANT_MAX_VOICES) {
+        fprintf(stderr, "ERROR: Voice count must be between 1 and %d\n", FORMANT_MAX_VOICES);
+        return NULL;
+    }
+    if (num_threads < 1) {
+        num_threads = 1;
+    }
+    if (num_threads > num_voices) {
+        num_threads = num_voices;   /* Extra threads would only spin */
+    }
+    if (num_threads > FORMANT_MAX_WORKERS) {
+        num_threads = FORMANT_MAX_WORKERS;
+    }
+
+    formant_choir_t* choir = (formant_choir_t*)aligned_alloc(FORMANT_CACHE_LINE,
+                                                             sizeof(formant_choir_t));
+    if (!choir) {
+        return NULL;
+    }
+    memset(choir, 0, sizeof(formant_choir_t));
+
+    choir->num_voices = num_voices;
+    choir->sample_rate = sample_rate;
+    choir->voice_gain = 1.0f / sqrtf((float)num_voices);
+    choir->audio.sample_rate = sample_rate;
+    choir->audio.buffer_size = FORMANT_BUFFER_SIZE_DEFAULT;
+    atomic_init(&choir->work, 0);
+    atomic_init(&choir->pending, 0);
+    atomic_init(&choir->shutdown, false);
+
+    choir->voice_buffers = (float*)aligned_alloc(FORMANT_CACHE_LINE,
+                                                 (size_t)num_voices * FORMANT_CHOIR_BLOCK * sizeof(float));
+    if (!choir->voice_buffers) {
+        free(choir);
+        return NULL;
+    }
+
+    for (int v = 0; v < num_voices; v++) {
+        choir->voices[v] = formant_engine_create(sample_rate);
+        if (!choir->voices[v]) {
+            formant_choir_destroy(choir);
+            return NULL;
+        }
+        /* Distinct seeds so unison voices do not cancel or stack noise */
+        formant_engine_set_seed(choir->voices[v], FORMANT_NOISE_SEED_DEFAULT + (uint64_t)v);
+    }
+
+    for (int t = 1; t < num_threads; t++) {
+        if (pthread_create(&choir->workers[t], NULL, worker_main, choir) != 0) {
+            fprintf(stderr, "ERROR: Failed to start choir worker %d\n", t);
+            formant_choir_destroy(choir);
+            return NULL;
+        }
+        choir->num_threads = t + 1;
+    }
+    if (choir->num_threads == 0) {
+        choir->num_threads = 1;
+    }
+
+    return choir;
+}
+
+void formant_choir_destroy(formant_choir_t* choir) {
+    if (!choir) return;
+
+    formant_choir_stop(choir);
+
+    atomic_store_explicit(&choir->shutdown, true, memory_order_relaxed);
+    /* Wake the workers with a generation that has nothing left to claim */
+    uint64_t work = atomic_load_explicit(&choir->work, memory_order_relaxed);
+    atomic_store_explicit(&choir->work, ((uint64_t)(work_generation(work) + 1) << 32) |
+                          (uint32_t)choir->num_voices, memory_order_release);
+    for (int t = 1; t < choir->num_threads; t++) {
+        pthread_join(choir->workers[t], NULL);
+    }
+
+    for (int v = 0; v < choir->num_voices; v++) {
+        formant_engine_destroy(choir->voices[v]);
+    }
+
+    if (choir->audio.pa_initialized) {
+        Pa_Terminate();
+    }
+
+    formant_monitor_destroy(choir->monitor);
+    free(choir->voice_buffers);
+    free(choir);
+}
+
+void formant_choir_process(formant_choir_t* choir, float* output, int num_samples) {
+    if (!choir || !output) return;
+
+    uint64_t start_us = choir->monitor ? formant_get_monotonic_us() : 0;
+
+    /* A single voice renders straight into the output, bit-identical to
+     * driving the engine directly */
+    if (choir->num_voices == 1) {
+        formant_engine_process(choir->voices[0], output, num_samples);
+    } else {
+        mix_blocks(choir, output, num_samples);
+    }
+
+    if (choir->monitor) {
+        formant_monitor_process(choir->monitor, output, num_samples,
+                                formant_elapsed_us(start_us));
+    }
+}
+
+int formant_choir_enable_monitor(formant_choir_t* choir, const char* preset) {
+    if (!choir) return -1;
+    if (choir->monitor) return 0;
+
+    choir->monitor = formant_monitor_create(choir->sample_rate, preset);
+    return choir->monitor ? 0 : -1;
+}
+
+void formant_choir_set_duplex(formant_choir_t* choir, bool duplex) {
+    if (!choir) return;
+
+    choir->audio.duplex = duplex;
+    for (int v = 0; v < choir->num_voices; v++) {
+        formant_engine_set_duplex(choir->voices[v], duplex);
+    }
+}
+
+int formant_choir_start(formant_choir_t* choir) {
+    if (!choir) return -1;
+    return formant_audio_start(&choir->audio, choir->sample_rate, choir_audio_callback, choir);
+}
+
+void formant_choir_stop(formant_choir_t* choir) {
+    if (!choir) return;
+    formant_audio_stop(&choir->audio);
+}
+
+int formant_choir_parse_target(formant_choir_t* choir, const char** line) {
+    if (!choir || !line || !*line) return -2;
+
+    const char* p = *line;
+    while (*p == ' ' || *p == '\t') p++;
+
+    if (*p != '@') {
+        *line = p;
+        return FORMANT_VOICE_ALL;
+    }
+    p++;
+
+    int voice;
+    if (*p == '*') {
+        voice = FORMANT_VOICE_ALL;
+        p++;
+    } else if (isdigit((unsigned char)*p)) {
+        char* end;
+        long index = strtol(p, &end, 10);
+        if (index < 0 || index >= choir->num_voices) {
+            return -2;
+        }
+        voice = (int)index;
+        p = end;
+    } else {
+        return -2;
+    }
+
+    if (*p != ' ' && *p != '\t') {
+        return -2;
+    }
+    while (*p == ' ' || *p == '\t') p++;
+
+    *line = p;
+    return voice;
+}
+
+int formant_choir_queue_space(formant_choir_t* choir, int voice) {
+    if (!choir) return 0;
+
+    if (voice != FORMANT_VOICE_ALL) {
+        return (voice >= 0 && voice < choir->num_voices) ? formant_queue_space(choir->voices[voice]) : 0;
+    }
+
+    int space = FORMANT_MAX_COMMANDS;
+    for (int v = 0; v < choir->num_voices; v++) {
+        int s = formant_queue_space(choir->voices[v]);
+        if (s < space) space = s;
+    }
+    return space;
+}
+
+int formant_choir_queue_command(formant_choir_t* choir, int voice, const formant_command_t* cmd) {
+    if (!choir || !cmd) return -1;
+
+    if (voice != FORMANT_VOICE_ALL) {
+        if (voice < 0 || voice >= choir->num_voices) return -1;
+        return formant_queue_command(choir->voices[voice], cmd);
+    }
+
+    /* Single producer: space only grows between this check and the pushes */
+    if (formant_choir_queue_space(choir, FORMANT_VOICE_ALL) == 0) {
+        for (int v = 0; v < choir->num_voices; v++) {
+            if (formant_queue_space(choir->voices[v]) == 0) {
+                formant_queue_command(choir->voices[v], cmd);   /* Counts the overflow */
+            }
+        }
+        return -1;
+    }
+
+    for (int v = 0; v < choir->num_voices; v++) {
+        formant_queue_command(choir->voices[v], cmd);
+    }
+    return 0;
+}
+
+bool formant_choir_timeline_done(formant_choir_t* choir) {
+    if (!choir) return true;
+
+    for (int v = 0; v < choir->num_voices; v++) {
+        if (!formant_engine_timeline_done(choir->voices[v])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint64_t formant_choir_samples_rendered(formant_choir_t* choir) {
+    if (!choir || choir->num_voices == 0) return 0;
+
+    /* Voices render in lockstep, so the first one speaks for all */
+    return atomic_load_explicit(&choir->voices[0]->published_samples, memory_order_relaxed);
+}
@@ -63,3 +63,16 @@ void formant_diagnostics_print_stats(void) {
     fprintf(stderr, "Max:         %.6f\n", global_rms.max);
     fprintf(stderr, "========================\n\n");
 }
+
+void formant_diagnostics_print_queue(formant_engine_t* engine) {
+    if (!engine) return;
+
+    formant_command_ring_t* ring = &engine->cmd_ring;
+    unsigned head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    unsigned tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+    fprintf(stderr, "Command queue: depth %u/%d, high water %u, overflows %llu\n",
+            tail - head, FORMANT_MAX_COMMANDS,
+            atomic_load_explicit(&ring->high_water, memory_order_relaxed),
+            (unsigned long long)formant_queue_overflow_count(engine));
+}
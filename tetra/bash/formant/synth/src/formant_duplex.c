@@ -0,0 +1,153 @@
+/**
+ * formant_duplex.c
+ *
+ * Full-duplex input path. With one stream for capture and playback both
+ * run on the device clock inside the same callback, so the offset between
+ * what is played and what is heard is fixed. The latency probe measures
+ * that offset by sending a click round the loop.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "formant.h"
+
+#define PROBE_SETTLE_MS 250         /* Silence before each click (lets echoes die) */
+#define PROBE_TIMEOUT_MS 1000       /* Longest round trip accepted */
+#define PROBE_CLICK 0.5f            /* Click amplitude */
+#define PROBE_FLOOR_RATIO 4.0f      /* Detection threshold over the noise peak */
+#define PROBE_MIN_THRESHOLD 0.01f   /* Threshold on a dead-quiet input */
+#define PROBE_POLL_MS 10
+
+/* ============================================================================
+ * Latency Probe
+ * ========================================================================= */
+
+static int compare_int(const void* a, const void* b) {
+    return *(const int*)a - *(const int*)b;
+}
+
+static void probe_begin(formant_latency_probe_t* probe, float sample_rate) {
+    probe->settle_samples = (int)(sample_rate * PROBE_SETTLE_MS / 1000.0f);
+    probe->timeout_samples = (int)(sample_rate * PROBE_TIMEOUT_MS / 1000.0f);
+    probe->listening = false;
+    probe->countdown = probe->settle_samples;
+    probe->noise_peak = 0.0f;
+    probe->pings = 0;
+    probe->num_results = 0;
+}
+
+static void probe_finish(formant_latency_probe_t* probe) {
+    int result = -1;
+    if (probe->num_results > 0) {
+        qsort(probe->results, probe->num_results, sizeof(int), compare_int);
+        result = probe->results[probe->num_results / 2];
+    }
+
+    atomic_store_explicit(&probe->result, result, memory_order_relaxed);
+    atomic_store_explicit(&probe->state, FORMANT_LATENCY_DONE, memory_order_release);
+}
+
+/**
+ * Advance the probe over one callback; output is silence plus the click
+ */
+static void probe_process(formant_latency_probe_t* probe, const float* input,
+                          float* output, int num_samples) {
+    memset(output, 0, num_samples * sizeof(float));
+
+    for (int i = 0; i < num_samples; i++) {
+        float level = fabsf(input[i]);
+
+        if (!probe->listening) {
+            if (level > probe->noise_peak) {
+                probe->noise_peak = level;
+            }
+            if (--probe->countdown > 0) {
+                continue;
+            }
+
+            /* Click leaves with output sample i, which pairs with input i */
+            output[i] = PROBE_CLICK;
+            probe->listening = true;
+            probe->elapsed = 0;
+            probe->pings++;
+            continue;
+        }
+
+        probe->elapsed++;
+        float threshold = probe->noise_peak * PROBE_FLOOR_RATIO;
+        if (threshold < PROBE_MIN_THRESHOLD) {
+            threshold = PROBE_MIN_THRESHOLD;
+        }
+
+        bool heard = level > threshold;
+        if (heard || probe->elapsed >= probe->timeout_samples) {
+            if (heard) {
+                probe->results[probe->num_results++] = probe->elapsed;
+            }
+            if (probe->pings >= FORMANT_LATENCY_PINGS) {
+                probe_finish(probe);
+                return;
+            }
+            probe->listening = false;
+            probe->countdown = probe->settle_samples;
+            probe->noise_peak = 0.0f;
+        }
+    }
+}
+
+/* ============================================================================
+ * Public API
+ * ========================================================================= */
+
+void formant_audio_process_duplex(formant_audio_engine_t* audio, const float* input,
+                                  float* output, int num_samples) {
+    if (!audio || !input || !output) return;
+
+    formant_latency_probe_t* probe = &audio->probe;
+    int state = atomic_load_explicit(&probe->state, memory_order_acquire);
+
+    if (state == FORMANT_LATENCY_ARMED) {
+        probe_begin(probe, audio->sample_rate);
+        atomic_store_explicit(&probe->state, FORMANT_LATENCY_RUNNING, memory_order_relaxed);
+        state = FORMANT_LATENCY_RUNNING;
+    }
+    if (state == FORMANT_LATENCY_RUNNING) {
+        probe_process(probe, input, output, num_samples);
+    }
+}
+
+int formant_audio_measure_latency(formant_audio_engine_t* audio) {
+    if (!audio || !audio->running || !audio->duplex) {
+        fprintf(stderr, "ERROR: Latency measurement needs a running duplex stream\n");
+        return -1;
+    }
+
+    formant_latency_probe_t* probe = &audio->probe;
+    atomic_store_explicit(&probe->result, -1, memory_order_relaxed);
+    atomic_store_explicit(&probe->state, FORMANT_LATENCY_ARMED, memory_order_release);
+
+    /* Every click takes at most settle + timeout; allow one spare */
+    int limit_ms = (FORMANT_LATENCY_PINGS + 1) * (PROBE_SETTLE_MS + PROBE_TIMEOUT_MS);
+    struct timespec ts = { 0, PROBE_POLL_MS * 1000000L };
+    for (int waited = 0; waited < limit_ms; waited += PROBE_POLL_MS) {
+        if (atomic_load_explicit(&probe->state, memory_order_acquire) == FORMANT_LATENCY_DONE) {
+            break;
+        }
+        nanosleep(&ts, NULL);
+    }
+
+    int result = -1;
+    if (atomic_load_explicit(&probe->state, memory_order_acquire) == FORMANT_LATENCY_DONE) {
+        result = atomic_load_explicit(&probe->result, memory_order_relaxed);
+    } else {
+        fprintf(stderr, "ERROR: Latency probe did not finish (is the stream running?)\n");
+    }
+    atomic_store_explicit(&probe->state, FORMANT_LATENCY_IDLE, memory_order_relaxed);
+
+    return result;
+}
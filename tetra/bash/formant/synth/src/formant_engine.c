@@ -5,6 +5,8 @@
  * Manages state, audio processing, and coordination of all subsystems.
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -23,6 +25,17 @@ uint64_t formant_get_time_us(void) {
     return (uint64_t)tv.tv_sec * 1000000ULL + (uint64_t)tv.tv_usec;
 }
 
+uint64_t formant_get_monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+uint64_t formant_elapsed_us(uint64_t start_us) {
+    uint64_t now_us = formant_get_monotonic_us();
+    return now_us > start_us ? now_us - start_us : 0;
+}
+
 /* ============================================================================
  * PortAudio Callback
  * ========================================================================= */
@@ -36,15 +49,20 @@ static int audio_callback(
     void* user_data)
 {
     formant_engine_t* engine = (formant_engine_t*)user_data;
+    const float* input = (const float*)input_buffer;  /* NULL unless duplex */
     float* output = (float*)output_buffer;
 
-    (void)input_buffer;  /* Unused */
     (void)time_info;
     (void)status_flags;
 
     /* Process audio */
     formant_engine_process(engine, output, frames_per_buffer);
 
+    if (input) {
+        formant_recorder_capture(engine->recorder, input, frames_per_buffer);
+        formant_audio_process_duplex(&engine->audio, input, output, frames_per_buffer);
+    }
+
     return paContinue;
 }
 
@@ -52,11 +70,36 @@ static int audio_callback(
  * Engine Management
  * ========================================================================= */
 
+/* Glottal pulse shape (open quotient, spectral tilt) */
+static const float GLOTTAL_OQ = 0.6f;
+static const float GLOTTAL_ALPHA = 0.8f;
+
+/* Neutral resonator shape used until the first phoneme */
+static const float DEFAULT_FORMANT_BW[FORMANT_MAX_FORMANTS] = {50.0f, 100.0f, 150.0f, 150.0f, 200.0f};
+static const float DEFAULT_FORMANT_GAIN[FORMANT_MAX_FORMANTS] = {1.0f, 1.0f, 1.0f, 0.5f, 0.3f};
+
+static void reset_formant_shape(formant_engine_t* engine) {
+    for (int f = 0; f < FORMANT_MAX_FORMANTS; f++) {
+        engine->formant_bw[f] = DEFAULT_FORMANT_BW[f];
+        engine->formant_gain[f] = DEFAULT_FORMANT_GAIN[f];
+    }
+}
+
 formant_engine_t* formant_engine_create(float sample_rate) {
-    formant_engine_t* engine = (formant_engine_t*)calloc(1, sizeof(formant_engine_t));
+    /* Cache-line aligned so the SoA bank and ring indices land on their boundaries */
+    size_t size = (sizeof(formant_engine_t) + FORMANT_CACHE_LINE - 1) & ~(size_t)(FORMANT_CACHE_LINE - 1);
+    formant_engine_t* engine = (formant_engine_t*)aligned_alloc(FORMANT_CACHE_LINE, size);
     if (!engine) {
         return NULL;
     }
+    memset(engine, 0, size);
+
+    /* Glottal wavetables are shared by all engines and built only once */
+    if (formant_glottal_tables_init() != 0) {
+        fprintf(stderr, "ERROR: Failed to build glottal wavetables\n");
+        free(engine);
+        return NULL;
+    }
 
     /* Initialize audio */
     engine->sample_rate = sample_rate;
@@ -71,6 +114,9 @@ formant_engine_t* formant_engine_create(float sample_rate) {
     engine->volume = 0.7f;
     engine->rate_multiplier = 1.0f;
     engine->lerp_rate = 0.3f;
+    engine->control_rate = FORMANT_CONTROL_RATE_DEFAULT;
+    engine->glottal_table = formant_glottal_table(GLOTTAL_OQ, GLOTTAL_ALPHA, engine->f0_hz, sample_rate);
+    formant_noise_init(&engine->noise, FORMANT_NOISE_SEED_DEFAULT);
 
     /* Initialize formant targets */
     engine->f1_current = engine->f1_target = 500.0f;
@@ -83,42 +129,40 @@ formant_engine_t* formant_engine_create(float sample_rate) {
     engine->synth_mode = FORMANT_SYNTH_MODE_FORMANT;  /* Default to formant */
     engine->hybrid_mix = 0.5f;  /* 50/50 blend for hybrid mode */
 
-    /* Initialize formant bank */
-    engine->formant_bank.num_formants = 3;  /* Start with F1-F3 */
-    for (int i = 0; i < engine->formant_bank.num_formants; i++) {
-        float freqs[] = {500.0f, 1500.0f, 2500.0f};
-        float bws[] = {50.0f, 100.0f, 150.0f};
-        formant_filter_init(&engine->formant_bank.filters[i],
-                           freqs[i], bws[i], sample_rate);
-    }
+    /* Initialize formant bank (F1-F5) */
+    formant_bank_init(&engine->formant_bank, FORMANT_MAX_FORMANTS, sample_rate);
+    reset_formant_shape(engine);
 
-    /* Initialize CELP engine */
-    formant_celp_init(&engine->celp_engine);
+    /* Initialize CELP engine (resamples the shared codebook on first use) */
+    if (formant_celp_init(&engine->celp_engine, sample_rate) != 0) {
+        fprintf(stderr, "ERROR: Failed to build CELP codebook\n");
+        free(engine);
+        return NULL;
+    }
 
     /* Initialize emotion state */
     engine->emotion.current = FORMANT_EMOTION_NEUTRAL;
     engine->emotion.intensity = 0.0f;
 
     /* Initialize command queue */
-    engine->cmd_queue_head = 0;
-    engine->cmd_queue_tail = 0;
-    engine->cmd_queue_size = 0;
+    atomic_init(&engine->cmd_ring.head, 0);
+    atomic_init(&engine->cmd_ring.tail, 0);
+    atomic_init(&engine->cmd_ring.overflow_count, 0);
+    atomic_init(&engine->cmd_ring.high_water, 0);
 
     /* Initialize timing */
     engine->time_us = formant_get_time_us();
     engine->samples_processed = 0;
 
-    /* Initialize diagnostics */
-    engine->enable_diagnostics = false;
-    engine->diagnostic_sample_count = 0;
+    /* Initialize timeline */
+    engine->timeline_cursor = 0;
+    engine->sync_locked = false;
+    atomic_init(&engine->published_cursor, 0);
+    atomic_init(&engine->published_samples, 0);
+    atomic_init(&engine->published_head, 0);
 
-    /* Initialize PortAudio */
-    PaError err = Pa_Initialize();
-    if (err != paNoError) {
-        fprintf(stderr, "PortAudio error: %s\n", Pa_GetErrorText(err));
-        free(engine);
-        return NULL;
-    }
+    /* PortAudio is initialized lazily by formant_engine_start() so that
+     * offline rendering works on machines without an audio device */
 
     /* Initialize recorder */
     engine->recorder = formant_recorder_create(sample_rate);
@@ -142,8 +186,14 @@ void formant_engine_destroy(formant_engine_t* engine) {
         formant_recorder_destroy(engine->recorder);
     }
 
+    formant_monitor_destroy(engine->monitor);
+    sound_grain_index_destroy(engine->grain_index);
+    sound_bank_destroy(engine->sound_bank);
+
     /* Terminate PortAudio */
-    Pa_Terminate();
+    if (engine->audio.pa_initialized) {
+        Pa_Terminate();
+    }
 
     free(engine);
 }
@@ -162,6 +212,9 @@ void formant_engine_reset(formant_engine_t* engine) {
     engine->f1_target = 500.0f;
     engine->f2_target = 1500.0f;
     engine->f3_target = 2500.0f;
+    engine->f4_target = 3500.0f;
+    engine->f5_target = 4500.0f;
+    reset_formant_shape(engine);
 
     /* Reset emotion */
     engine->emotion.current = FORMANT_EMOTION_NEUTRAL;
@@ -170,28 +223,80 @@ void formant_engine_reset(formant_engine_t* engine) {
     engine->emotion.breathiness.intensity = 0.0f;
     engine->emotion.tension = 0.5f;
 
-    /* Clear command queue */
-    engine->cmd_queue_size = 0;
-    engine->cmd_queue_head = 0;
-    engine->cmd_queue_tail = 0;
+    /* The command ring is left alone: reset runs on the audio thread while
+     * commands queued behind RESET are still meant to play */
+
+    /* Forget the external clock; the next SYNC establishes a new origin */
+    engine->sync_locked = false;
 
     /* Reset phoneme */
     engine->current_phoneme = NULL;
 }
 
-int formant_engine_start(formant_engine_t* engine) {
+void formant_engine_set_seed(formant_engine_t* engine, uint64_t seed) {
+    if (!engine) return;
+    formant_noise_init(&engine->noise, seed);
+}
+
+int formant_engine_enable_monitor(formant_engine_t* engine, const char* preset) {
     if (!engine) return -1;
+    if (engine->monitor) return 0;
+
+    engine->monitor = formant_monitor_create(engine->sample_rate, preset);
+    return engine->monitor ? 0 : -1;
+}
+
+int formant_engine_load_bank(formant_engine_t* engine, const char* path) {
+    if (!engine || !path) return -1;
+
+    sound_bank_t* bank = sound_bank_map(path);
+    if (!bank) return -1;
+
+    sound_grain_index_t* index = sound_grain_index_create(bank);
+    if (!index) {
+        sound_bank_destroy(bank);
+        return -1;
+    }
+
+    sound_grain_index_destroy(engine->grain_index);
+    sound_bank_destroy(engine->sound_bank);
+    engine->sound_bank = bank;
+    engine->grain_index = index;
+    return 0;
+}
+
+void formant_engine_set_control_rate(formant_engine_t* engine, int samples) {
+    if (!engine) return;
+
+    if (samples < 1) samples = 1;
+    if (samples > FORMANT_BANK_BLOCK) samples = FORMANT_BANK_BLOCK;
+    engine->control_rate = samples;
+}
+
+int formant_audio_start(formant_audio_engine_t* audio, float sample_rate,
+                        PaStreamCallback* callback, void* user_data) {
+    if (!audio || !callback) return -1;
+
+    /* Initialize PortAudio */
+    if (!audio->pa_initialized) {
+        PaError err = Pa_Initialize();
+        if (err != paNoError) {
+            fprintf(stderr, "PortAudio error: %s\n", Pa_GetErrorText(err));
+            return -1;
+        }
+        audio->pa_initialized = true;
+    }
 
     /* Open audio stream */
     PaError err = Pa_OpenDefaultStream(
-        &engine->audio.stream,
-        0,                              /* No input */
+        &audio->stream,
+        audio->duplex ? 1 : 0,          /* Mono input when duplex */
         1,                              /* Mono output */
         paFloat32,                      /* 32-bit float */
-        engine->sample_rate,
-        engine->audio.buffer_size,
-        audio_callback,
-        engine
+        sample_rate,
+        audio->buffer_size,
+        callback,
+        user_data
     );
 
     if (err != paNoError) {
@@ -200,181 +305,277 @@ int formant_engine_start(formant_engine_t* engine) {
     }
 
     /* Start stream */
-    err = Pa_StartStream(engine->audio.stream);
+    err = Pa_StartStream(audio->stream);
     if (err != paNoError) {
         fprintf(stderr, "PortAudio error: %s\n", Pa_GetErrorText(err));
-        Pa_CloseStream(engine->audio.stream);
+        Pa_CloseStream(audio->stream);
         return -1;
     }
 
-    engine->audio.running = true;
+    audio->running = true;
     return 0;
 }
 
-void formant_engine_stop(formant_engine_t* engine) {
-    if (!engine || !engine->audio.running) return;
+void formant_audio_stop(formant_audio_engine_t* audio) {
+    if (!audio || !audio->running) return;
 
     /* Stop and close stream */
-    Pa_StopStream(engine->audio.stream);
-    Pa_CloseStream(engine->audio.stream);
-    engine->audio.running = false;
+    Pa_StopStream(audio->stream);
+    Pa_CloseStream(audio->stream);
+    audio->running = false;
+}
+
+void formant_engine_set_duplex(formant_engine_t* engine, bool duplex) {
+    if (!engine) return;
+
+    engine->audio.duplex = duplex;
+    if (engine->recorder) {
+        engine->recorder->shared_input = duplex;
+    }
+}
+
+int formant_engine_start(formant_engine_t* engine) {
+    if (!engine) return -1;
+    return formant_audio_start(&engine->audio, engine->sample_rate, audio_callback, engine);
+}
+
+void formant_engine_stop(formant_engine_t* engine) {
+    if (!engine) return;
+    formant_audio_stop(&engine->audio);
 }
 
 /* ============================================================================
  * Audio Processing
  * ========================================================================= */
 
-void formant_engine_process(formant_engine_t* engine, float* output, int num_samples) {
-    if (!engine || !output) return;
+/**
+ * Glide formants towards their targets over num_samples and hand the
+ * resulting coefficients to the bank, which ramps to them across the block
+ */
+static void update_formants(formant_engine_t* engine, int num_samples) {
+    /* Closed form of num_samples per-sample lerps: 1 - (1 - r)^N */
+    float rate = 1.0f - powf(1.0f - engine->lerp_rate, (float)num_samples);
+
+    engine->f1_current = formant_lerp(engine->f1_current, engine->f1_target, rate);
+    engine->f2_current = formant_lerp(engine->f2_current, engine->f2_target, rate);
+    engine->f3_current = formant_lerp(engine->f3_current, engine->f3_target, rate);
+    engine->f4_current = formant_lerp(engine->f4_current, engine->f4_target, rate);
+    engine->f5_current = formant_lerp(engine->f5_current, engine->f5_target, rate);
+
+    const float freqs[FORMANT_MAX_FORMANTS] = {
+        engine->f1_current, engine->f2_current, engine->f3_current,
+        engine->f4_current, engine->f5_current
+    };
+    for (int f = 0; f < engine->formant_bank.num_formants; f++) {
+        formant_bank_set_formant(&engine->formant_bank, f, freqs[f],
+                                 engine->formant_bw[f], engine->formant_gain[f]);
+    }
+}
 
-    /* Check if recorder needs finalization */
-    if (engine->recorder && engine->recorder->state == FORMANT_RECORDER_STOPPING) {
-        formant_recorder_stop(engine->recorder);
+/**
+ * Generate the excitation for num_samples (at most FORMANT_BANK_BLOCK)
+ * voice receives the glottal source (to be filtered), noise the unfiltered
+ * aspiration, frication and plosive burst mix. The phoneme is fixed for the
+ * call, so each active noise generator gets its own white block up front.
+ */
+static void generate_source(formant_engine_t* engine, float* voice, float* noise, int num_samples) {
+    _Alignas(32) float white[FORMANT_BANK_BLOCK];
+    _Alignas(32) float shaped[FORMANT_BANK_BLOCK];
+    const formant_phoneme_config_t* phoneme = engine->current_phoneme;
+
+    if (!phoneme) {
+        /* No phoneme - just gentle glottal pulse */
+        float phase_increment = engine->f0_hz / engine->sample_rate;
+        for (int i = 0; i < num_samples; i++) {
+            voice[i] = formant_glottal_read(engine->glottal_table, engine->phase);
+            engine->phase += phase_increment;
+            if (engine->phase >= 1.0f) {
+                engine->phase -= 1.0f;
+            }
+            noise[i] = 0.0f;
+        }
+        return;
     }
 
-    /* Process pending commands */
-    formant_process_commands(engine);
+    /* Get phoneme characteristics */
+    float asp_level = phoneme->aspiration;
+    float fric_level = phoneme->frication;
+    bool voiced = phoneme->voiced;
+    bool plosive = phoneme->type == FORMANT_PHONEME_PLOSIVE;
+    float phase_increment = engine->f0_hz / engine->sample_rate;
+
+    if (plosive) {
+        formant_noise_fill(&engine->noise, white, num_samples);
+    }
 
-    /* Generate audio */
     for (int i = 0; i < num_samples; i++) {
-        /* Interpolate formant frequencies towards targets */
-        engine->f1_current = formant_lerp(engine->f1_current, engine->f1_target, engine->lerp_rate);
-        engine->f2_current = formant_lerp(engine->f2_current, engine->f2_target, engine->lerp_rate);
-        engine->f3_current = formant_lerp(engine->f3_current, engine->f3_target, engine->lerp_rate);
-
-        /* Update filter frequencies */
-        formant_filter_set_freq(&engine->formant_bank.filters[0],
-                               engine->f1_current, engine->sample_rate);
-        formant_filter_set_freq(&engine->formant_bank.filters[1],
-                               engine->f2_current, engine->sample_rate);
-        formant_filter_set_freq(&engine->formant_bank.filters[2],
-                               engine->f3_current, engine->sample_rate);
-
-        /* Generate source signal based on current phoneme type */
         float source = 0.0f;
-        float aspiration = 0.0f;
-        float frication = 0.0f;
         float plosive_burst = 0.0f;
 
-        if (engine->current_phoneme) {
-            /* Get phoneme characteristics */
-            float asp_level = engine->current_phoneme->aspiration;
-            float fric_level = engine->current_phoneme->frication;
-            bool voiced = engine->current_phoneme->voiced;
-            formant_phoneme_type_t type = engine->current_phoneme->type;
-
-            /* Handle plosive burst (p, b, t, d, k, g) */
-            if (type == FORMANT_PHONEME_PLOSIVE) {
-                if (!engine->in_plosive_burst) {
-                    /* Start burst */
-                    engine->in_plosive_burst = true;
-                    engine->plosive_burst_time = 0.0f;
-                    engine->plosive_burst_duration = engine->sample_rate * 0.02f;  /* 20ms burst */
-                }
-
-                if (engine->plosive_burst_time < engine->plosive_burst_duration) {
-                    /* Generate burst */
-                    float burst_progress = engine->plosive_burst_time / engine->plosive_burst_duration;
-                    float burst_freq = engine->current_phoneme->f2;  /* Use F2 for burst color */
-                    float burst_intensity = voiced ? 0.3f : 0.6f;  /* Weaker for voiced */
-                    plosive_burst = formant_generate_plosive_burst(burst_progress, burst_intensity, burst_freq);
-                    engine->plosive_burst_time += 1.0f;
-                } else {
-                    /* Burst finished, start voiced portion for voiced plosives */
-                    engine->in_plosive_burst = false;
-                }
-            } else {
-                engine->in_plosive_burst = false;
-            }
-
-            /* Generate voiced source (glottal pulse) - suppress during plosive closure */
-            if (voiced && !engine->in_plosive_burst) {
-                source = formant_generate_glottal(engine->phase, 0.6f, 0.8f);
-                source *= (1.0f - asp_level * 0.5f);  /* Reduce harmonics if breathy */
+        /* Handle plosive burst (p, b, t, d, k, g) */
+        if (plosive) {
+            if (!engine->in_plosive_burst) {
+                /* Start burst */
+                engine->in_plosive_burst = true;
+                engine->plosive_burst_time = 0.0f;
+                engine->plosive_burst_duration = engine->sample_rate * 0.02f;  /* 20ms burst */
             }
 
-            /* Generate aspiration noise (for breathiness, /h/, voiceless stops) */
-            if (asp_level > 0.01f) {
-                aspiration = formant_generate_aspiration(asp_level);
+            if (engine->plosive_burst_time < engine->plosive_burst_duration) {
+                /* Generate burst */
+                float burst_progress = engine->plosive_burst_time / engine->plosive_burst_duration;
+                float burst_freq = phoneme->f2;  /* Use F2 for burst color */
+                float burst_intensity = voiced ? 0.3f : 0.6f;  /* Weaker for voiced */
+                plosive_burst = formant_generate_plosive_burst(&engine->noise, white[i], burst_progress,
+                                                               burst_intensity, burst_freq);
+                engine->plosive_burst_time += 1.0f;
+            } else {
+                /* Burst finished, start voiced portion for voiced plosives */
+                engine->in_plosive_burst = false;
             }
+        } else {
+            engine->in_plosive_burst = false;
+        }
 
-            /* Generate frication noise (for fricatives: s, f, sh, etc.) */
-            if (fric_level > 0.01f) {
-                float fric_freq = engine->current_phoneme->f3;  /* Use F3 for frication color */
-                frication = formant_generate_frication(fric_level, fric_freq);
-            }
+        /* Generate voiced source (glottal pulse) - suppress during plosive closure */
+        if (voiced && !engine->in_plosive_burst) {
+            source = formant_glottal_read(engine->glottal_table, engine->phase);
+            source *= (1.0f - asp_level * 0.5f);  /* Reduce harmonics if breathy */
+        }
 
-            /* Advance glottal phase */
-            if (voiced) {
-                float phase_increment = engine->f0_hz / engine->sample_rate;
-                engine->phase += phase_increment;
-                if (engine->phase >= 1.0f) {
-                    engine->phase -= 1.0f;
-                }
-            }
-        } else {
-            /* No phoneme - just gentle glottal pulse */
-            source = formant_generate_glottal(engine->phase, 0.6f, 0.8f);
-            float phase_increment = engine->f0_hz / engine->sample_rate;
+        /* Advance glottal phase */
+        if (voiced) {
             engine->phase += phase_increment;
             if (engine->phase >= 1.0f) {
                 engine->phase -= 1.0f;
             }
         }
 
-        /* Generate output based on synthesis mode */
-        float sample = 0.0f;
+        voice[i] = source;
+        noise[i] = plosive_burst * 0.5f;
+    }
 
-        if (engine->synth_mode == FORMANT_SYNTH_MODE_FORMANT) {
-            /* Pure formant synthesis */
-            float formant_output = 0.0f;
-            for (int f = 0; f < engine->formant_bank.num_formants; f++) {
-                formant_output += formant_filter_process(&engine->formant_bank.filters[f], source);
-            }
-            /* Mix sources: formant-filtered voice + aspiration + frication + plosive burst */
-            sample = formant_output + aspiration * 0.3f + frication * 0.4f + plosive_burst * 0.5f;
-
-        } else if (engine->synth_mode == FORMANT_SYNTH_MODE_CELP) {
-            /* Pure CELP synthesis */
-            sample = formant_celp_process_sample(&engine->celp_engine);
-
-        } else {  /* FORMANT_SYNTH_MODE_HYBRID */
-            /* Hybrid: blend formant and CELP */
-            float formant_output = 0.0f;
-            for (int f = 0; f < engine->formant_bank.num_formants; f++) {
-                formant_output += formant_filter_process(&engine->formant_bank.filters[f], source);
-            }
-            formant_output += aspiration * 0.3f + frication * 0.4f + plosive_burst * 0.5f;
+    /* Generate aspiration noise (for breathiness, /h/, voiceless stops) */
+    if (asp_level > 0.01f) {
+        formant_noise_fill(&engine->noise, white, num_samples);
+        formant_generate_aspiration(&engine->noise, white, shaped, num_samples, asp_level);
+        for (int i = 0; i < num_samples; i++) {
+            noise[i] += shaped[i] * 0.3f;
+        }
+    }
+
+    /* Generate frication noise (for fricatives: s, f, sh, etc.) */
+    if (fric_level > 0.01f) {
+        float fric_freq = phoneme->f3;  /* Use F3 for frication color */
+        formant_noise_fill(&engine->noise, white, num_samples);
+        formant_generate_frication(&engine->noise, white, shaped, num_samples, fric_level, fric_freq);
+        for (int i = 0; i < num_samples; i++) {
+            noise[i] += shaped[i] * 0.4f;
+        }
+    }
+}
 
-            float celp_output = formant_celp_process_sample(&engine->celp_engine);
+/**
+ * Render a run of samples with no command changes in between
+ * Works in control-rate sub-blocks: formant update, source, then the filter
+ * bank kernel over the whole sub-block, then the output mix.
+ */
+static void render_segment(formant_engine_t* engine, float* output, int num_samples) {
+    _Alignas(32) float voice[FORMANT_BANK_BLOCK];
+    _Alignas(32) float noise[FORMANT_BANK_BLOCK];
+    _Alignas(32) float formant_out[FORMANT_BANK_BLOCK];
+
+    for (int offset = 0; offset < num_samples; offset += engine->control_rate) {
+        int count = num_samples - offset;
+        if (count > engine->control_rate) {
+            count = engine->control_rate;
+        }
+
+        update_formants(engine, count);
 
-            /* Blend based on hybrid_mix (0.0 = pure CELP, 1.0 = pure formant) */
-            sample = (1.0f - engine->hybrid_mix) * celp_output + engine->hybrid_mix * formant_output;
+        /* Band-limit the glottal source for the current pitch */
+        engine->glottal_table = formant_glottal_table(GLOTTAL_OQ, GLOTTAL_ALPHA,
+                                                      engine->f0_hz, engine->sample_rate);
+        generate_source(engine, voice, noise, count);
+
+        /* Formant-filtered voice + aspiration + frication + plosive burst */
+        if (engine->synth_mode != FORMANT_SYNTH_MODE_CELP) {
+            formant_bank_process(&engine->formant_bank, voice, formant_out, count);
+            for (int i = 0; i < count; i++) {
+                formant_out[i] += noise[i];
+            }
         }
 
-        /* Apply volume */
-        sample *= engine->volume * engine->intensity;
+        float* out = output + offset;
+        for (int i = 0; i < count; i++) {
+            /* Generate output based on synthesis mode */
+            float sample;
 
-        /* Clamp to prevent clipping */
-        output[i] = formant_clamp(sample, -1.0f, 1.0f);
+            if (engine->synth_mode == FORMANT_SYNTH_MODE_FORMANT) {
+                /* Pure formant synthesis */
+                sample = formant_out[i];
 
-        /* Update diagnostics */
-        if (engine->enable_diagnostics) {
-            formant_diagnostics_update_rms(sample);
-            engine->diagnostic_sample_count++;
+            } else if (engine->synth_mode == FORMANT_SYNTH_MODE_CELP) {
+                /* Pure CELP synthesis */
+                sample = formant_celp_process_sample(&engine->celp_engine);
 
-            /* Print stats every 48000 samples (1 second @ 48kHz) */
-            if (engine->diagnostic_sample_count >= 48000) {
-                formant_diagnostics_print_stats();
-                formant_diagnostics_reset_rms();
-                engine->diagnostic_sample_count = 0;
+            } else {  /* FORMANT_SYNTH_MODE_HYBRID */
+                float celp_output = formant_celp_process_sample(&engine->celp_engine);
+
+                /* Blend based on hybrid_mix (0.0 = pure CELP, 1.0 = pure formant) */
+                sample = (1.0f - engine->hybrid_mix) * celp_output + engine->hybrid_mix * formant_out[i];
             }
+
+            /* Apply volume */
+            sample *= engine->volume * engine->intensity;
+
+            /* Clamp to prevent clipping */
+            out[i] = formant_clamp(sample, -1.0f, 1.0f);
         }
 
         /* Update timing */
-        engine->samples_processed++;
+        engine->samples_processed += count;
     }
+}
+
+void formant_engine_process(formant_engine_t* engine, float* output, int num_samples) {
+    if (!engine || !output) return;
+
+    uint64_t start_us = engine->monitor ? formant_get_monotonic_us() : 0;
+
+    /* Split the block at each command's sample offset */
+    int done = 0;
+    do {
+        int segment = formant_process_commands(engine, num_samples - done);
+        render_segment(engine, output + done, segment);
+        done += segment;
+    } while (done < num_samples);
 
     /* Update time */
     engine->time_us = engine->samples_processed * 1000000ULL / (uint64_t)engine->sample_rate;
+
+    /* Publish timeline progress for formant_engine_timeline_done() */
+    atomic_store_explicit(&engine->published_cursor, engine->timeline_cursor, memory_order_relaxed);
+    atomic_store_explicit(&engine->published_samples, engine->samples_processed, memory_order_relaxed);
+    atomic_store_explicit(&engine->published_head,
+                          atomic_load_explicit(&engine->cmd_ring.head, memory_order_relaxed),
+                          memory_order_release);
+
+    if (engine->monitor) {
+        formant_monitor_process(engine->monitor, output, num_samples,
+                                formant_elapsed_us(start_us));
+    }
+}
+
+bool formant_engine_timeline_done(formant_engine_t* engine) {
+    if (!engine) return true;
+
+    unsigned head = atomic_load_explicit(&engine->published_head, memory_order_acquire);
+    unsigned tail = atomic_load_explicit(&engine->cmd_ring.tail, memory_order_acquire);
+    if (head != tail) {
+        return false;
+    }
+
+    return atomic_load_explicit(&engine->published_samples, memory_order_relaxed) >=
+           atomic_load_explicit(&engine->published_cursor, memory_order_relaxed);
 }
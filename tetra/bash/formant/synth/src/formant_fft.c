@@ -0,0 +1,235 @@
+/**
+ * formant_fft.c
+ *
+ * Radix-2 FFT for real signals.
+ * A real transform of size N runs as a complex transform of size N/2 on
+ * the even/odd sample pairs, followed by a split step. Plans own their
+ * twiddle and bit-reversal tables plus scratch, so transforms never allocate.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "formant.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+struct formant_fft {
+    int size;           /* Real transform size N */
+    int half;           /* Complex transform size M = N/2 */
+    float* cos_table;   /* cos(2*pi*k/N), k < N/2 */
+    float* sin_table;   /* sin(2*pi*k/N), k < N/2 */
+    float* stage_cos;   /* Per-stage twiddles: stage with half-length h at [h, 2h) */
+    float* stage_sin;
+    int* bitrev;        /* Bit-reversal permutation for M */
+    float* work_re;     /* Scratch, M entries each */
+    float* work_im;
+};
+
+/* ============================================================================
+ * Complex Transform
+ * ========================================================================= */
+
+/**
+ * In-place complex FFT of size M on split arrays
+ * Each stage reads its twiddles contiguously, so the butterfly loop
+ * vectorizes. inverse selects e^{+i} twiddles; no scaling is applied.
+ */
+static void fft_complex(const formant_fft_t* fft, float* re, float* im, bool inverse) {
+    int m = fft->half;
+
+    for (int i = 0; i < m; i++) {
+        int j = fft->bitrev[i];
+        if (j > i) {
+            float t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+    }
+
+    float sign = inverse ? 1.0f : -1.0f;
+
+    /* First stage: unit twiddles */
+    for (int a = 0; a < m; a += 2) {
+        float tr = re[a + 1];
+        float ti = im[a + 1];
+        re[a + 1] = re[a] - tr;
+        im[a + 1] = im[a] - ti;
+        re[a] += tr;
+        im[a] += ti;
+    }
+
+    for (int len = 4; len <= m; len <<= 1) {
+        int half_len = len >> 1;
+        const float* stage_cos = fft->stage_cos + half_len;
+        const float* stage_sin = fft->stage_sin + half_len;
+
+        for (int start = 0; start < m; start += len) {
+            for (int k = 0; k < half_len; k++) {
+                float wr = stage_cos[k];
+                float wi = sign * stage_sin[k];
+
+                int a = start + k;
+                int b = a + half_len;
+                float tr = re[b] * wr - im[b] * wi;
+                float ti = re[b] * wi + im[b] * wr;
+
+                re[b] = re[a] - tr;
+                im[b] = im[a] - ti;
+                re[a] += tr;
+                im[a] += ti;
+            }
+        }
+    }
+}
+
+/* ============================================================================
+ * Public API
+ * ========================================================================= */
+
+formant_fft_t* formant_fft_create(int size) {
+    if (size < 4 || (size & (size - 1)) != 0) {
+        fprintf(stderr, "ERROR: FFT size must be a power of two >= 4 (got %d)\n", size);
+        return NULL;
+    }
+
+    formant_fft_t* fft = (formant_fft_t*)calloc(1, sizeof(formant_fft_t));
+    if (!fft) {
+        return NULL;
+    }
+
+    fft->size = size;
+    fft->half = size / 2;
+    fft->cos_table = (float*)malloc(fft->half * sizeof(float));
+    fft->sin_table = (float*)malloc(fft->half * sizeof(float));
+    fft->stage_cos = (float*)malloc(fft->half * sizeof(float));
+    fft->stage_sin = (float*)malloc(fft->half * sizeof(float));
+    fft->bitrev = (int*)malloc(fft->half * sizeof(int));
+    fft->work_re = (float*)malloc(fft->half * sizeof(float));
+    fft->work_im = (float*)malloc(fft->half * sizeof(float));
+
+    if (!fft->cos_table || !fft->sin_table || !fft->stage_cos || !fft->stage_sin ||
+        !fft->bitrev || !fft->work_re || !fft->work_im) {
+        formant_fft_destroy(fft);
+        return NULL;
+    }
+
+    for (int k = 0; k < fft->half; k++) {
+        double angle = 2.0 * M_PI * k / size;
+        fft->cos_table[k] = (float)cos(angle);
+        fft->sin_table[k] = (float)sin(angle);
+    }
+
+    /* Stage with half-length h uses e^{-2 pi i k / 2h} = table entry k * N / 2h */
+    for (int h = 1; h < fft->half; h <<= 1) {
+        int stride = size / (2 * h);
+        for (int k = 0; k < h; k++) {
+            fft->stage_cos[h + k] = fft->cos_table[k * stride];
+            fft->stage_sin[h + k] = fft->sin_table[k * stride];
+        }
+    }
+
+    int bits = 0;
+    while ((1 << bits) < fft->half) bits++;
+    for (int i = 0; i < fft->half; i++) {
+        int r = 0;
+        for (int b = 0; b < bits; b++) {
+            r |= ((i >> b) & 1) << (bits - 1 - b);
+        }
+        fft->bitrev[i] = r;
+    }
+
+    return fft;
+}
+
+void formant_fft_destroy(formant_fft_t* fft) {
+    if (!fft) return;
+
+    free(fft->cos_table);
+    free(fft->sin_table);
+    free(fft->stage_cos);
+    free(fft->stage_sin);
+    free(fft->bitrev);
+    free(fft->work_re);
+    free(fft->work_im);
+    free(fft);
+}
+
+int formant_fft_size(const formant_fft_t* fft) {
+    return fft ? fft->size : 0;
+}
+
+void formant_fft_forward(formant_fft_t* fft, const float* input, float* re, float* im) {
+    if (!fft || !input || !re || !im) return;
+
+    int m = fft->half;
+    float* zr = fft->work_re;
+    float* zi = fft->work_im;
+
+    /* Pack even/odd samples as one complex sequence */
+    for (int n = 0; n < m; n++) {
+        zr[n] = input[2 * n];
+        zi[n] = input[2 * n + 1];
+    }
+
+    fft_complex(fft, zr, zi, false);
+
+    /* Split: X[k] = Fe[k] + W^k Fo[k], W = e^{-2 pi i / N} */
+    for (int k = 0; k <= m; k++) {
+        int a = k < m ? k : 0;          /* k mod m, without the divide */
+        int b = k > 0 ? m - k : 0;      /* (m - k) mod m */
+
+        float fe_r = 0.5f * (zr[a] + zr[b]);
+        float fe_i = 0.5f * (zi[a] - zi[b]);
+        float fo_r = 0.5f * (zi[a] + zi[b]);
+        float fo_i = -0.5f * (zr[a] - zr[b]);
+
+        float wr, wi;
+        if (k < m) {
+            wr = fft->cos_table[k];
+            wi = -fft->sin_table[k];
+        } else {
+            wr = -1.0f;
+            wi = 0.0f;
+        }
+
+        re[k] = fe_r + wr * fo_r - wi * fo_i;
+        im[k] = fe_i + wr * fo_i + wi * fo_r;
+    }
+}
+
+void formant_fft_inverse(formant_fft_t* fft, const float* re, const float* im, float* output) {
+    if (!fft || !re || !im || !output) return;
+
+    int m = fft->half;
+    float* zr = fft->work_re;
+    float* zi = fft->work_im;
+
+    /* Merge: Fe = (X[k] + conj(X[M-k])) / 2, Fo = (X[k] - conj(X[M-k])) W^-k / 2 */
+    for (int k = 0; k < m; k++) {
+        int b = m - k;
+
+        float fe_r = 0.5f * (re[k] + re[b]);
+        float fe_i = 0.5f * (im[k] - im[b]);
+        float dr = 0.5f * (re[k] - re[b]);
+        float di = 0.5f * (im[k] + im[b]);
+
+        float wr = fft->cos_table[k];
+        float wi = fft->sin_table[k];
+        float fo_r = dr * wr - di * wi;
+        float fo_i = dr * wi + di * wr;
+
+        /* Z = Fe + i Fo */
+        zr[k] = fe_r - fo_i;
+        zi[k] = fe_i + fo_r;
+    }
+
+    fft_complex(fft, zr, zi, true);
+
+    float scale = 1.0f / (float)m;
+    for (int n = 0; n < m; n++) {
+        output[2 * n] = zr[n] * scale;
+        output[2 * n + 1] = zi[n] * scale;
+    }
+}
@@ -0,0 +1,353 @@
+/**
+ * formant_loudness.c
+ *
+ * EBU R128 loudness metering (ITU-R BS.1770-4, EBU Tech 3341/3342), mono.
+ * Audio is K-weighted and its power summed over 100 ms sub-blocks; all
+ * windows and gates are built from those sums, so the per-sample work is
+ * two biquads and one multiply-add.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "formant.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/* ============================================================================
+ * Constants
+ * ========================================================================= */
+
+#define MOMENTARY_SUBBLOCKS 4           /* 400 ms */
+#define SHORT_TERM_SUBBLOCKS FORMANT_LOUDNESS_SUBBLOCKS
+#define RELATIVE_GATE_LU -10.0          /* Integrated loudness */
+#define LRA_RELATIVE_GATE_LU -20.0      /* Loudness range */
+#define LRA_LOW_PERCENTILE 0.10
+#define LRA_HIGH_PERCENTILE 0.95
+#define BIN_WIDTH_LU ((FORMANT_LOUDNESS_MAX_LUFS - FORMANT_LOUDNESS_MIN_LUFS) / FORMANT_LOUDNESS_BINS)
+
+/* ============================================================================
+ * Helper Functions
+ * ========================================================================= */
+
+/**
+ * Mean-square power to LUFS (BS.1770 channel weight 1.0)
+ */
+static inline double power_to_lufs(double power) {
+    return power > 0.0 ? -0.691 + 10.0 * log10(power) : FORMANT_LOUDNESS_NONE;
+}
+
+/**
+ * Histogram bin for a loudness value, or -1 below the absolute gate
+ */
+static inline int lufs_bin(double lufs) {
+    if (!(lufs > FORMANT_LOUDNESS_MIN_LUFS)) {
+        return -1;
+    }
+    int bin = (int)((lufs - FORMANT_LOUDNESS_MIN_LUFS) / BIN_WIDTH_LU);
+    return bin < FORMANT_LOUDNESS_BINS ? bin : FORMANT_LOUDNESS_BINS - 1;
+}
+
+static inline double bin_lufs(int bin) {
+    return FORMANT_LOUDNESS_MIN_LUFS + bin * BIN_WIDTH_LU;
+}
+
+/**
+ * K-weighting coefficients for any sample rate
+ * BS.1770 specifies them at 48 kHz; these are the analog prototypes the
+ * standard's values come from, re-discretized with the bilinear transform.
+ */
+static void design_k_weighting(formant_loudness_t* loudness, double sample_rate) {
+    /* Stage 1: high shelf, +4 dB above ~1.7 kHz (head diffraction) */
+    double f0 = 1681.974450955533;
+    double gain_db = 3.999843853973347;
+    double q = 0.7071752369554196;
+
+    double k = tan(M_PI * f0 / sample_rate);
+    double vh = pow(10.0, gain_db / 20.0);
+    double vb = pow(vh, 0.4996667741545416);
+    double a0 = 1.0 + k / q + k * k;
+
+    loudness->k_b[0][0] = (vh + vb * k / q + k * k) / a0;
+    loudness->k_b[0][1] = 2.0 * (k * k - vh) / a0;
+    loudness->k_b[0][2] = (vh - vb * k / q + k * k) / a0;
+    loudness->k_a[0][0] = 2.0 * (k * k - 1.0) / a0;
+    loudness->k_a[0][1] = (1.0 - k / q + k * k) / a0;
+
+    /* Stage 2: RLB high-pass at ~38 Hz */
+    f0 = 38.13547087602444;
+    q = 0.5003270373238773;
+    k = tan(M_PI * f0 / sample_rate);
+    a0 = 1.0 + k / q + k * k;
+
+    loudness->k_b[1][0] = 1.0;
+    loudness->k_b[1][1] = -2.0;
+    loudness->k_b[1][2] = 1.0;
+    loudness->k_a[1][0] = 2.0 * (k * k - 1.0) / a0;
+    loudness->k_a[1][1] = (1.0 - k / q + k * k) / a0;
+}
+
+/**
+ * Sum of the newest count completed sub-blocks
+ */
+static double recent_power(const formant_loudness_t* loudness, int count) {
+    double sum = 0.0;
+    int pos = loudness->subblock_pos;
+
+    for (int i = 0; i < count; i++) {
+        pos = (pos == 0) ? FORMANT_LOUDNESS_SUBBLOCKS - 1 : pos - 1;
+        sum += loudness->subblocks[pos];
+    }
+
+    return sum / count;
+}
+
+/**
+ * Close the current sub-block: update the live windows and histograms
+ */
+static void end_subblock(formant_loudness_t* loudness) {
+    loudness->subblocks[loudness->subblock_pos] = loudness->subblock_sum / loudness->subblock_length;
+    loudness->subblock_pos = (loudness->subblock_pos + 1) % FORMANT_LOUDNESS_SUBBLOCKS;
+    if (loudness->subblock_count < FORMANT_LOUDNESS_SUBBLOCKS) {
+        loudness->subblock_count++;
+    }
+    loudness->subblock_sum = 0.0;
+    loudness->subblock_fill = 0;
+
+    /* Momentary window doubles as the 75%-overlapped gating block */
+    if (loudness->subblock_count >= MOMENTARY_SUBBLOCKS) {
+        double power = recent_power(loudness, MOMENTARY_SUBBLOCKS);
+        double lufs = power_to_lufs(power);
+
+        loudness->momentary = (float)lufs;
+        if (loudness->momentary > loudness->max_momentary) {
+            loudness->max_momentary = loudness->momentary;
+        }
+
+        int bin = lufs_bin(lufs);
+        if (bin >= 0) {
+            loudness->block_count[bin]++;
+            loudness->block_energy[bin] += power;
+        }
+    }
+
+    /* Short-term values at 10 Hz feed the loudness range */
+    if (loudness->subblock_count >= SHORT_TERM_SUBBLOCKS) {
+        double power = recent_power(loudness, SHORT_TERM_SUBBLOCKS);
+        double lufs = power_to_lufs(power);
+
+        loudness->short_term = (float)lufs;
+        if (loudness->short_term > loudness->max_short_term) {
+            loudness->max_short_term = loudness->short_term;
+        }
+
+        int bin = lufs_bin(lufs);
+        if (bin >= 0) {
+            loudness->short_term_count[bin]++;
+            loudness->short_term_energy[bin] += power;
+        }
+    }
+}
+
+/**
+ * First bin at or above the relative gate of the absolute-gated mean power
+ */
+static int relative_gate_bin(const uint32_t* count, const double* energy, double gate_lu) {
+    uint64_t n = 0;
+    double sum = 0.0;
+    for (int b = 0; b < FORMANT_LOUDNESS_BINS; b++) {
+        n += count[b];
+        sum += energy[b];
+    }
+    if (n == 0) {
+        return -1;
+    }
+
+    double gate = power_to_lufs(sum / n) + gate_lu;
+    if (gate <= FORMANT_LOUDNESS_MIN_LUFS) {
+        return 0;
+    }
+    int bin = lufs_bin(gate);
+    return bin_lufs(bin) < gate ? bin + 1 : bin;
+}
+
+/* ============================================================================
+ * Public API
+ * ========================================================================= */
+
+formant_loudness_t* formant_loudness_create(float sample_rate) {
+    if (sample_rate < 8000.0f) {
+        fprintf(stderr, "ERROR: Loudness metering needs at least 8 kHz (got %.0f Hz)\n", sample_rate);
+        return NULL;
+    }
+
+    formant_loudness_t* loudness = (formant_loudness_t*)calloc(1, sizeof(formant_loudness_t));
+    if (!loudness) {
+        return NULL;
+    }
+
+    loudness->sample_rate = sample_rate;
+    loudness->subblock_length = (int)lroundf(sample_rate / 10.0f);
+    design_k_weighting(loudness, sample_rate);
+    formant_loudness_reset(loudness);
+
+    return loudness;
+}
+
+void formant_loudness_destroy(formant_loudness_t* loudness) {
+    free(loudness);
+}
+
+void formant_loudness_reset(formant_loudness_t* loudness) {
+    if (!loudness) return;
+
+    memset(loudness->k_z, 0, sizeof(loudness->k_z));
+    loudness->subblock_fill = 0;
+    loudness->subblock_sum = 0.0;
+    memset(loudness->subblocks, 0, sizeof(loudness->subblocks));
+    loudness->subblock_pos = 0;
+    loudness->subblock_count = 0;
+
+    loudness->momentary = FORMANT_LOUDNESS_NONE;
+    loudness->short_term = FORMANT_LOUDNESS_NONE;
+    loudness->max_momentary = FORMANT_LOUDNESS_NONE;
+    loudness->max_short_term = FORMANT_LOUDNESS_NONE;
+
+    memset(loudness->block_count, 0, sizeof(loudness->block_count));
+    memset(loudness->block_energy, 0, sizeof(loudness->block_energy));
+    memset(loudness->short_term_count, 0, sizeof(loudness->short_term_count));
+    memset(loudness->short_term_energy, 0, sizeof(loudness->short_term_energy));
+
+    loudness->samples = 0;
+}
+
+void formant_loudness_process(formant_loudness_t* loudness, const float* samples, int num_samples) {
+    if (!loudness || !samples) return;
+
+    const double b00 = loudness->k_b[0][0], b01 = loudness->k_b[0][1], b02 = loudness->k_b[0][2];
+    const double a01 = loudness->k_a[0][0], a02 = loudness->k_a[0][1];
+    const double b10 = loudness->k_b[1][0], b11 = loudness->k_b[1][1], b12 = loudness->k_b[1][2];
+    const double a11 = loudness->k_a[1][0], a12 = loudness->k_a[1][1];
+
+    double z00 = loudness->k_z[0][0], z01 = loudness->k_z[0][1];
+    double z10 = loudness->k_z[1][0], z11 = loudness->k_z[1][1];
+
+    int offset = 0;
+    while (offset < num_samples) {
+        /* Run straight to the next sub-block boundary */
+        int count = loudness->subblock_length - loudness->subblock_fill;
+        if (count > num_samples - offset) {
+            count = num_samples - offset;
+        }
+
+        double sum = 0.0;
+        for (int i = 0; i < count; i++) {
+            double x = samples[offset + i];
+
+            double y = b00 * x + z00;
+            z00 = b01 * x - a01 * y + z01;
+            z01 = b02 * x - a02 * y;
+
+            double w = b10 * y + z10;
+            z10 = b11 * y - a11 * w + z11;
+            z11 = b12 * y - a12 * w;
+
+            sum += w * w;
+        }
+
+        loudness->subblock_sum += sum;
+        loudness->subblock_fill += count;
+        offset += count;
+
+        if (loudness->subblock_fill == loudness->subblock_length) {
+            end_subblock(loudness);
+        }
+    }
+
+    loudness->k_z[0][0] = z00;
+    loudness->k_z[0][1] = z01;
+    loudness->k_z[1][0] = z10;
+    loudness->k_z[1][1] = z11;
+    loudness->samples += num_samples;
+}
+
+float formant_loudness_momentary(const formant_loudness_t* loudness) {
+    return loudness ? loudness->momentary : FORMANT_LOUDNESS_NONE;
+}
+
+float formant_loudness_short_term(const formant_loudness_t* loudness) {
+    return loudness ? loudness->short_term : FORMANT_LOUDNESS_NONE;
+}
+
+float formant_loudness_integrated(const formant_loudness_t* loudness) {
+    if (!loudness) return FORMANT_LOUDNESS_NONE;
+
+    int first = relative_gate_bin(loudness->block_count, loudness->block_energy, RELATIVE_GATE_LU);
+    if (first < 0) {
+        return FORMANT_LOUDNESS_NONE;
+    }
+
+    uint64_t n = 0;
+    double sum = 0.0;
+    for (int b = first; b < FORMANT_LOUDNESS_BINS; b++) {
+        n += loudness->block_count[b];
+        sum += loudness->block_energy[b];
+    }
+
+    return n > 0 ? (float)power_to_lufs(sum / n) : FORMANT_LOUDNESS_NONE;
+}
+
+float formant_loudness_range(const formant_loudness_t* loudness) {
+    if (!loudness) return 0.0f;
+
+    int first = relative_gate_bin(loudness->short_term_count, loudness->short_term_energy,
+                                  LRA_RELATIVE_GATE_LU);
+    if (first < 0) {
+        return 0.0f;
+    }
+
+    uint64_t n = 0;
+    for (int b = first; b < FORMANT_LOUDNESS_BINS; b++) {
+        n += loudness->short_term_count[b];
+    }
+    if (n == 0) {
+        return 0.0f;
+    }
+
+    /* Percentiles by walking the cumulative counts */
+    uint64_t low_rank = (uint64_t)(LRA_LOW_PERCENTILE * (n - 1));
+    uint64_t high_rank = (uint64_t)(LRA_HIGH_PERCENTILE * (n - 1));
+    double low = 0.0, high = 0.0;
+    uint64_t seen = 0;
+    bool have_low = false;
+
+    for (int b = first; b < FORMANT_LOUDNESS_BINS; b++) {
+        seen += loudness->short_term_count[b];
+        if (!have_low && seen > low_rank) {
+            low = bin_lufs(b);
+            have_low = true;
+        }
+        if (seen > high_rank) {
+            high = bin_lufs(b);
+            break;
+        }
+    }
+
+    return (float)(high - low);
+}
+
+void formant_loudness_report(const formant_loudness_t* loudness, const char* label) {
+    if (!loudness) return;
+
+    fprintf(stderr, "Loudness %s: integrated %.1f LUFS, range %.1f LU, "
+            "max momentary %.1f LUFS, max short-term %.1f LUFS (%.2fs)\n",
+            label ? label : "",
+            formant_loudness_integrated(loudness),
+            formant_loudness_range(loudness),
+            loudness->max_momentary,
+            loudness->max_short_term,
+            loudness->samples / (double)loudness->sample_rate);
+}
@@ -5,16 +5,20 @@
  * Handles command-line arguments, IPC setup, and main loop.
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <signal.h>
 #include <getopt.h>
+#include <time.h>
+#include <pthread.h>
 #include "formant.h"
 
-/* Global engine instance (for signal handler) */
-static formant_engine_t* g_engine = NULL;
+/* Global choir instance (one voice unless --voices is given) */
+static formant_choir_t* g_choir = NULL;
 static volatile bool g_running = true;
 
 /* Signal handler for clean shutdown */
@@ -35,6 +39,21 @@ static void print_usage(const char* program_name) {
     printf("  -i, --input FILE      Input command file or FIFO (default: stdin)\n");
     printf("  -s, --sample-rate HZ  Sample rate: 48000, 44100, 24000, 16000 (default: 48000)\n");
     printf("  -b, --buffer-size N   Buffer size in samples (default: 512)\n");
+    printf("  -r, --render FILE     Render offline to FILE (.wav, .raw/.pcm, or - for stdout)\n");
+    printf("  -k, --kernel NAME     Formant bank kernel: simd, scalar (default: simd)\n");
+    printf("  -c, --control-rate N  Samples per formant update, 1-%d (default: %d)\n",
+           FORMANT_BANK_BLOCK, FORMANT_CONTROL_RATE_DEFAULT);
+    printf("  -S, --seed N          Noise seed; renders with the same seed are identical (default: %d)\n",
+           FORMANT_NOISE_SEED_DEFAULT);
+    printf("  -V, --voices N        Independent voices mixed to one output, 1-%d (default: 1)\n",
+           FORMANT_MAX_VOICES);
+    printf("  -t, --threads N       Render threads for the voices (default: online CPUs)\n");
+    printf("  -B, --bank FILE       Map a compiled sound bank (.fbank, see formant_bankc)\n");
+    printf("  -l, --server PATH     Serve sessions on a Unix socket (with -r, mix bus goes to FILE)\n");
+    printf("  -L, --loudness        Report EBU R128 loudness of rendered output (offline and server WAV)\n");
+    printf("  -d, --diag            Meter the output and print levels and callback load every second\n");
+    printf("  -D, --duplex          One input/output stream: RECORD captures on the playback clock\n");
+    printf("  -T, --latency         Measure loopback latency at startup (implies --duplex)\n");
     printf("  -h, --help            Show this help message\n");
     printf("  -v, --version         Show version information\n");
     printf("\n");
@@ -42,6 +61,9 @@ static void print_usage(const char* program_name) {
     printf("  %s                           # Read from stdin\n", program_name);
     printf("  %s -i /tmp/estovox_fifo      # Read from named pipe\n", program_name);
     printf("  %s -s 24000 -b 256           # Low latency mode\n", program_name);
+    printf("  %s --render out.wav < a.ecl  # Offline render, no audio device\n", program_name);
+    printf("  %s --voices 8 < choir.ecl    # Eight voices; prefix lines with @<n> or @*\n", program_name);
+    printf("  %s --server /tmp/formant.sock  # One session per connection\n", program_name);
     printf("\n");
     printf("Estovox Command Language:\n");
     printf("  PH <ipa> [dur] [pitch] [intensity] [rate]   - Synthesize phoneme\n");
@@ -50,6 +72,7 @@ static void print_usage(const char* program_name) {
     printf("  EM <emotion> [intensity]                    - Set emotion\n");
     printf("  RESET                                       - Reset to neutral\n");
     printf("  STOP                                        - Stop engine\n");
+    printf("  @<n> <command>                              - Send to voice n only (default: all voices)\n");
     printf("\n");
 }
 
@@ -64,37 +87,250 @@ static void print_version(void) {
     printf("\n");
 }
 
-/* Process command line from input */
-static void process_command_line(formant_engine_t* engine, const char* line) {
+/* Sleep without busy waiting while the audio thread catches up */
+static void sleep_ms(int ms) {
+    struct timespec ts = { ms / 1000, (long)(ms % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+}
+
+/* Meter reports from a non-realtime thread (--diag) */
+#define MONITOR_INTERVAL_MS 1000
+#define MONITOR_POLL_MS 100
+
+static atomic_bool g_monitor_running;
+
+static void print_monitor(formant_choir_t* choir, const char* label) {
+    formant_meter_snapshot_t snapshot;
+    if (!formant_monitor_read(choir->monitor, &snapshot)) {
+        return;
+    }
+
+    char line[256];
+    formant_monitor_format(&snapshot, line, sizeof(line));
+    fprintf(stderr, "[%s] %s\n", label, line);
+}
+
+static void* monitor_main(void* arg) {
+    formant_choir_t* choir = (formant_choir_t*)arg;
+    int waited_ms = 0;
+
+    while (atomic_load_explicit(&g_monitor_running, memory_order_relaxed)) {
+        sleep_ms(MONITOR_POLL_MS);
+        waited_ms += MONITOR_POLL_MS;
+        if (waited_ms >= MONITOR_INTERVAL_MS) {
+            print_monitor(choir, "diag");
+            waited_ms = 0;
+        }
+    }
+
+    return NULL;
+}
+
+/* How long the audio thread may render nothing before a full queue is given up on */
+#define QUEUE_STALL_MS 1000
+
+/* Commands dropped across all voices */
+static uint64_t choir_overflow_count(formant_choir_t* choir) {
+    uint64_t total = 0;
+    for (int v = 0; v < choir->num_voices; v++) {
+        total += formant_queue_overflow_count(choir->voices[v]);
+    }
+    return total;
+}
+
+/* Queue a command, waiting for room while the timeline plays out */
+static int queue_command_wait(formant_choir_t* choir, int voice, const formant_command_t* cmd) {
+    /* Scripts are streamed ahead of playback, so a full ring just means
+     * the audio thread has not reached these commands yet. A long phoneme,
+     * rest or SYNC can hold the ring full for seconds; keep waiting as long
+     * as samples are still being rendered and only give up on a stalled stream. */
+    uint64_t rendered = formant_choir_samples_rendered(choir);
+    int stalled_ms = 0;
+
+    while (g_running && stalled_ms < QUEUE_STALL_MS &&
+           formant_choir_queue_space(choir, voice) == 0) {
+        sleep_ms(1);
+        uint64_t now = formant_choir_samples_rendered(choir);
+        stalled_ms = now != rendered ? 0 : stalled_ms + 1;
+        rendered = now;
+    }
+    return formant_choir_queue_command(choir, voice, cmd);
+}
+
+/**
+ * Parse one input line into a command and its target voice
+ * Returns NULL for blank lines, comments and parse errors (reported)
+ */
+static formant_command_t* parse_line(formant_choir_t* choir, const char* line, int* voice) {
     /* Skip empty lines and comments */
     if (line[0] == '\0' || line[0] == '#' || line[0] == '\n') {
-        return;
+        return NULL;
     }
 
-    /* Parse and queue command */
-    formant_command_t* cmd = formant_parse_command(line);
-    if (cmd) {
-        formant_queue_command(engine, cmd);
-        free(cmd);
-    } else {
+    const char* body = line;
+    *voice = formant_choir_parse_target(choir, &body);
+    if (*voice == -2) {
+        fprintf(stderr, "ERROR: Invalid voice prefix (voices: 0-%d): %s",
+                choir->num_voices - 1, line);
+        return NULL;
+    }
+
+    formant_command_t* cmd = formant_parse_command(body);
+    if (!cmd) {
         fprintf(stderr, "ERROR: Failed to parse command: %s", line);
     }
+    return cmd;
+}
+
+/* Process command line from input; returns false on STOP */
+static bool process_command_line(formant_choir_t* choir, const char* line) {
+    int voice;
+    formant_command_t* cmd = parse_line(choir, line, &voice);
+    if (!cmd) {
+        return true;
+    }
+
+    if (cmd->type == FORMANT_CMD_STOP) {
+        free(cmd);
+        return false;
+    }
+
+    if (queue_command_wait(choir, voice, cmd) != 0) {
+        fprintf(stderr, "WARNING: Command queue full, dropped command (%llu total)\n",
+                (unsigned long long)choir_overflow_count(choir));
+    }
+    free(cmd);
+    return true;
+}
+
+/* Block until every queued phoneme has been played */
+static void wait_for_timeline(formant_choir_t* choir) {
+    while (g_running && !formant_choir_timeline_done(choir)) {
+        sleep_ms(10);
+    }
+}
+
+/* Offline render: drive the voices directly, as fast as the CPU allows */
+static int run_offline(formant_choir_t* choir, FILE* input, const char* render_file,
+                       bool measure_loudness) {
+    formant_sink_t* sink = formant_sink_open(render_file, choir->sample_rate);
+    if (!sink) {
+        return 1;
+    }
+    if (measure_loudness && formant_sink_measure_loudness(sink) != 0) {
+        formant_sink_close(sink);
+        return 1;
+    }
+
+    int block_size = choir->audio.buffer_size;
+    float* block = (float*)malloc(block_size * sizeof(float));
+    if (!block) {
+        formant_sink_close(sink);
+        return 1;
+    }
+
+    fprintf(stderr, "Rendering offline to %s\n", render_file);
+
+    int status = 0;
+    uint64_t start_us = formant_get_monotonic_us();
+    char line[1024];
+
+    while (g_running && fgets(line, sizeof(line), input)) {
+        int voice;
+        formant_command_t* cmd = parse_line(choir, line, &voice);
+        if (!cmd) {
+            continue;
+        }
+
+        if (cmd->type == FORMANT_CMD_STOP) {
+            free(cmd);
+            break;
+        }
+
+        /* The engine schedules commands on its own timeline; only render
+         * ahead when the ring is full (this thread is also the consumer) */
+        while (status == 0 && formant_choir_queue_space(choir, voice) == 0) {
+            formant_choir_process(choir, block, block_size);
+            if (formant_sink_write(sink, block, block_size) != 0) {
+                fprintf(stderr, "ERROR: Failed to write render output\n");
+                status = 1;
+            }
+        }
+        if (status == 0) {
+            formant_choir_queue_command(choir, voice, cmd);
+        }
+        free(cmd);
+
+        if (status != 0) {
+            break;
+        }
+    }
+
+    /* Play out everything still queued, up to the end of the last phoneme */
+    if (status == 0 && formant_render_choir_pending(choir, sink, block, block_size) != 0) {
+        fprintf(stderr, "ERROR: Failed to write render output\n");
+        status = 1;
+    }
+
+    uint64_t elapsed_us = formant_elapsed_us(start_us);
+    uint64_t samples = sink->samples_written;
+    if (sink->loudness) {
+        formant_loudness_report(sink->loudness, render_file);
+    }
+
+    free(block);
+    if (formant_sink_close(sink) != 0) {
+        fprintf(stderr, "ERROR: Failed to finalize render output\n");
+        status = 1;
+    }
+
+    double elapsed_s = elapsed_us / 1e6;
+    double audio_s = samples / (double)choir->sample_rate;
+    double rate = elapsed_s > 0.0 ? samples / elapsed_s : 0.0;
+    fprintf(stderr, "Rendered %llu samples (%.2fs audio) in %.3fs: %.0f samples/s (%.1fx realtime)\n",
+            (unsigned long long)samples, audio_s, elapsed_s, rate,
+            elapsed_s > 0.0 ? audio_s / elapsed_s : 0.0);
+
+    return status;
 }
 
 /* Main function */
 int main(int argc, char** argv) {
     const char* input_file = NULL;
+    const char* render_file = NULL;
+    const char* server_path = NULL;
+    const char* bank_file = NULL;
     float sample_rate = FORMANT_SAMPLE_RATE_DEFAULT;
     int buffer_size = FORMANT_BUFFER_SIZE_DEFAULT;
 
     /* Parse command-line arguments */
     bool enable_diagnostics = false;
+    bool measure_loudness = false;
+    bool duplex = false;
+    bool measure_latency = false;
+    formant_bank_kernel_t kernel = FORMANT_BANK_KERNEL_SIMD;
+    int control_rate = FORMANT_CONTROL_RATE_DEFAULT;
+    uint64_t seed = FORMANT_NOISE_SEED_DEFAULT;
+    int num_voices = 1;
+    long online_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int num_threads = online_cpus > 0 ? (int)online_cpus : 1;
 
     static struct option long_options[] = {
         {"input",       required_argument, 0, 'i'},
         {"sample-rate", required_argument, 0, 's'},
         {"buffer-size", required_argument, 0, 'b'},
+        {"render",      required_argument, 0, 'r'},
+        {"kernel",      required_argument, 0, 'k'},
+        {"control-rate", required_argument, 0, 'c'},
+        {"seed",        required_argument, 0, 'S'},
+        {"voices",      required_argument, 0, 'V'},
+        {"threads",     required_argument, 0, 't'},
+        {"bank",        required_argument, 0, 'B'},
+        {"server",      required_argument, 0, 'l'},
+        {"loudness",    no_argument,       0, 'L'},
         {"diag",        no_argument,       0, 'd'},
+        {"duplex",      no_argument,       0, 'D'},
+        {"latency",     no_argument,       0, 'T'},
         {"help",        no_argument,       0, 'h'},
         {"version",     no_argument,       0, 'v'},
         {0, 0, 0, 0}
@@ -103,7 +339,7 @@ int main(int argc, char** argv) {
     int opt;
     int option_index = 0;
 
-    while ((opt = getopt_long(argc, argv, "i:s:b:dhv", long_options, &option_index)) != -1) {
+    while ((opt = getopt_long(argc, argv, "i:s:b:r:k:c:S:V:t:B:l:LdDThv", long_options, &option_index)) != -1) {
         switch (opt) {
             case 'i':
                 input_file = optarg;
@@ -123,9 +359,58 @@ int main(int argc, char** argv) {
                     return 1;
                 }
                 break;
+            case 'r':
+                render_file = optarg;
+                break;
+            case 'k':
+                if (formant_bank_kernel_parse(optarg, &kernel) != 0) {
+                    fprintf(stderr, "ERROR: Unknown kernel '%s'. Use simd or scalar\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'c':
+                control_rate = atoi(optarg);
+                if (control_rate < 1 || control_rate > FORMANT_BANK_BLOCK) {
+                    fprintf(stderr, "ERROR: Control rate must be between 1 and %d\n", FORMANT_BANK_BLOCK);
+                    return 1;
+                }
+                break;
+            case 'S':
+                seed = strtoull(optarg, NULL, 10);
+                break;
+            case 'V':
+                num_voices = atoi(optarg);
+                if (num_voices < 1 || num_voices > FORMANT_MAX_VOICES) {
+                    fprintf(stderr, "ERROR: Voices must be between 1 and %d\n", FORMANT_MAX_VOICES);
+                    return 1;
+                }
+                break;
+            case 't':
+                num_threads = atoi(optarg);
+                if (num_threads < 1 || num_threads > FORMANT_MAX_WORKERS) {
+                    fprintf(stderr, "ERROR: Threads must be between 1 and %d\n", FORMANT_MAX_WORKERS);
+                    return 1;
+                }
+                break;
+            case 'B':
+                bank_file = optarg;
+                break;
+            case 'l':
+                server_path = optarg;
+                break;
+            case 'L':
+                measure_loudness = true;
+                break;
             case 'd':
                 enable_diagnostics = true;
                 break;
+            case 'D':
+                duplex = true;
+                break;
+            case 'T':
+                duplex = true;
+                measure_latency = true;
+                break;
             case 'h':
                 print_usage(argv[0]);
                 return 0;
@@ -142,26 +427,99 @@ int main(int argc, char** argv) {
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
 
-    /* Create and initialize engine */
+    /* Server mode: one engine per client connection instead of stdin/-i */
+    if (server_path) {
+        if (bank_file) {
+            fprintf(stderr, "Warning: --bank applies to local voices, ignored with --server\n");
+        }
+        formant_server_t* server = formant_server_create(server_path, sample_rate, buffer_size);
+        if (!server) {
+            fprintf(stderr, "ERROR: Failed to start formant server\n");
+            return 1;
+        }
+        server->kernel = kernel;
+        server->control_rate = control_rate;
+        server->seed = seed;
+        server->measure_loudness = measure_loudness;
+
+        int status = formant_server_run(server, render_file, &g_running) == 0 ? 0 : 1;
+        formant_server_destroy(server);
+        fprintf(stderr, "Formant server shutdown complete\n");
+        return status;
+    }
+
+    /* Create and initialize voices */
     fprintf(stderr, "Initializing formant engine (%.0f Hz, %d samples)...\n",
             sample_rate, buffer_size);
 
-    g_engine = formant_engine_create(sample_rate);
-    if (!g_engine) {
+    g_choir = formant_choir_create(num_voices, num_threads, sample_rate);
+    if (!g_choir) {
         fprintf(stderr, "ERROR: Failed to create formant engine\n");
         return 1;
     }
+    if (num_voices > 1) {
+        fprintf(stderr, "Choir: %d voices on %d threads\n", num_voices, g_choir->num_threads);
+    }
+
+    g_choir->audio.buffer_size = buffer_size;
+    for (int v = 0; v < num_voices; v++) {
+        formant_engine_t* voice = g_choir->voices[v];
+        voice->audio.buffer_size = buffer_size;
+        formant_bank_set_kernel(&voice->formant_bank, kernel);
+        formant_engine_set_control_rate(voice, control_rate);
+        formant_engine_set_seed(voice, seed + (uint64_t)v);
 
-    g_engine->enable_diagnostics = enable_diagnostics;
+        /* Each voice maps the file; the page cache holds one copy */
+        if (bank_file && formant_engine_load_bank(voice, bank_file) != 0) {
+            formant_choir_destroy(g_choir);
+            return 1;
+        }
+    }
+    if (bank_file) {
+        fprintf(stderr, "Sound bank: %s (%d grains)\n", bank_file,
+                g_choir->voices[0]->sound_bank->num_entries);
+    }
     if (enable_diagnostics) {
-        fprintf(stderr, "Diagnostics enabled - RMS stats will print every second\n");
-        formant_diagnostics_reset_rms();
+        if (formant_choir_enable_monitor(g_choir, "vu") != 0) {
+            formant_choir_destroy(g_choir);
+            return 1;
+        }
+        fprintf(stderr, "Diagnostics enabled - meter readings will print every second\n");
+        fprintf(stderr, "Formant bank kernel: %s\n", formant_bank_kernel_name(kernel));
+    }
+
+    /* Offline render: no PortAudio stream, no wall-clock pacing */
+    if (render_file) {
+        if (duplex) {
+            fprintf(stderr, "Warning: --duplex and --latency need realtime audio, ignored with --render\n");
+        }
+        FILE* input = stdin;
+        if (input_file) {
+            input = fopen(input_file, "r");
+            if (!input) {
+                fprintf(stderr, "ERROR: Failed to open input file: %s\n", input_file);
+                formant_choir_destroy(g_choir);
+                return 1;
+            }
+        }
+
+        int status = run_offline(g_choir, input, render_file, measure_loudness);
+        if (g_choir->monitor) {
+            print_monitor(g_choir, "diag");
+        }
+
+        if (input != stdin) {
+            fclose(input);
+        }
+        formant_choir_destroy(g_choir);
+        return status;
     }
 
     /* Start audio engine */
-    if (formant_engine_start(g_engine) != 0) {
+    formant_choir_set_duplex(g_choir, duplex);
+    if (formant_choir_start(g_choir) != 0) {
         fprintf(stderr, "ERROR: Failed to start audio engine\n");
-        formant_engine_destroy(g_engine);
+        formant_choir_destroy(g_choir);
         return 1;
     }
 
@@ -170,25 +528,43 @@ int main(int argc, char** argv) {
     fprintf(stderr, "Latency: ~%.1f ms\n",
             (buffer_size * 1000.0f) / sample_rate);
 
+    if (measure_latency) {
+        fprintf(stderr, "Measuring loopback latency (output must reach the input)...\n");
+        int round_trip = formant_audio_measure_latency(&g_choir->audio);
+        if (round_trip >= 0) {
+            fprintf(stderr, "Loopback latency: %d samples (%.1f ms)\n",
+                    round_trip, round_trip * 1000.0f / sample_rate);
+        } else {
+            fprintf(stderr, "Loopback latency: no click detected\n");
+        }
+    }
+
     /* Open input stream */
     FILE* input = stdin;
     if (input_file) {
         input = fopen(input_file, "r");
         if (!input) {
             fprintf(stderr, "ERROR: Failed to open input file: %s\n", input_file);
-            formant_engine_stop(g_engine);
-            formant_engine_destroy(g_engine);
+            formant_choir_stop(g_choir);
+            formant_choir_destroy(g_choir);
             return 1;
         }
     }
 
+    pthread_t monitor_thread;
+    bool monitor_started = false;
+    if (g_choir->monitor) {
+        atomic_store(&g_monitor_running, true);
+        monitor_started = pthread_create(&monitor_thread, NULL, monitor_main, g_choir) == 0;
+        if (!monitor_started) {
+            fprintf(stderr, "Warning: Failed to start meter thread\n");
+        }
+    }
+
     /* Main command processing loop */
     char line[1024];
     while (g_running && fgets(line, sizeof(line), input)) {
-        process_command_line(g_engine, line);
-
-        /* Check for STOP command */
-        if (strncmp(line, "STOP", 4) == 0) {
+        if (!process_command_line(g_choir, line)) {
             fprintf(stderr, "STOP command received\n");
             break;
         }
@@ -199,9 +575,24 @@ int main(int argc, char** argv) {
         fclose(input);
     }
 
+    /* Let queued speech finish before tearing the stream down */
+    wait_for_timeline(g_choir);
+
     fprintf(stderr, "Stopping formant engine...\n");
-    formant_engine_stop(g_engine);
-    formant_engine_destroy(g_engine);
+    formant_choir_stop(g_choir);
+
+    if (monitor_started) {
+        atomic_store(&g_monitor_running, false);
+        pthread_join(monitor_thread, NULL);
+        print_monitor(g_choir, "diag");
+    }
+
+    if (enable_diagnostics || choir_overflow_count(g_choir) > 0) {
+        for (int v = 0; v < g_choir->num_voices; v++) {
+            formant_diagnostics_print_queue(g_choir->voices[v]);
+        }
+    }
+    formant_choir_destroy(g_choir);
 
     fprintf(stderr, "Formant engine shutdown complete\n");
     return 0;
@@ -10,6 +10,7 @@
 #include <string.h>
 #include <math.h>
 #include "formant.h"
+#include "formant_simd.h"
 
 /* ============================================================================
  * Constants
@@ -18,6 +19,29 @@
 #define METER_MIN_DB -60.0f
 #define METER_MAX_DB 0.0f
 #define METER_REFERENCE_LEVEL 0.7746f  /* 0dB = -2.2dBFS for VU meter */
+#define METER_BLOCK 256                /* Samples per internal block */
+#define PEAK_HOLD_DECAY 0.99f          /* Per-sample decay once the hold expires */
+#define TRUE_PEAK_DECAY 0.9999f        /* Per-sample true peak decay */
+
+/* ITU-R BS.1770-4 Annex 2 true-peak oversampler: 4 phases x 12 taps */
+#define TP_PHASES 4
+#define TP_TAPS 12
+#define TP_HISTORY 16                  /* >= TP_TAPS - 1, keeps block input aligned */
+
+static const float TP_COEFFS[TP_PHASES][TP_TAPS] = {
+    { 0.0017089843750f,  0.0109863281250f, -0.0196533203125f,  0.0332031250000f,
+     -0.0594482421875f,  0.1373291015625f,  0.9721679687500f, -0.1022949218750f,
+      0.0476074218750f, -0.0266113281250f,  0.0148925781250f, -0.0083007812500f},
+    {-0.0291748046875f,  0.0292968750000f, -0.0517578125000f,  0.0891113281250f,
+     -0.1665039062500f,  0.4650878906250f,  0.7797851562500f, -0.2003173828125f,
+      0.1015625000000f, -0.0582275390625f,  0.0330810546875f, -0.0189208984375f},
+    {-0.0189208984375f,  0.0330810546875f, -0.0582275390625f,  0.1015625000000f,
+     -0.2003173828125f,  0.7797851562500f,  0.4650878906250f, -0.1665039062500f,
+      0.0891113281250f, -0.0517578125000f,  0.0292968750000f, -0.0291748046875f},
+    {-0.0083007812500f,  0.0148925781250f, -0.0266113281250f,  0.0476074218750f,
+     -0.1022949218750f,  0.9721679687500f,  0.1373291015625f, -0.0594482421875f,
+      0.0332031250000f, -0.0196533203125f,  0.0109863281250f,  0.0017089843750f},
+};
 
 /* Standard ballistics presets */
 typedef struct {
@@ -68,6 +92,109 @@ static float calc_ballistics_coeff(float time_ms, float sample_rate) {
     return expf(-1.0f / (sample_rate * time_sec));
 }
 
+/* ============================================================================
+ * FIR Weighting Filter
+ * ========================================================================= */
+
+void formant_fir_filter_release(formant_fir_filter_t* filter) {
+    if (!filter) return;
+
+    formant_fft_destroy(filter->fft);
+    free(filter->coeffs);
+    free(filter->reversed);
+    free(filter->history);
+    free(filter->partition_re);
+    free(filter->partition_im);
+    free(filter->fdl_re);
+    free(filter->fdl_im);
+    free(filter->frame);
+    free(filter->output);
+    free(filter->work);
+    free(filter->acc_re);
+    free(filter->acc_im);
+
+    char name[sizeof(filter->name)];
+    memcpy(name, filter->name, sizeof(name));
+    memset(filter, 0, sizeof(formant_fir_filter_t));
+    memcpy(filter->name, name, sizeof(name));
+}
+
+/**
+ * Set up partitioned convolution for the loaded coefficients
+ * Partition p's spectrum is the FFT of taps [pB, pB + B) zero-padded to 2B.
+ */
+static int fir_prepare_partitions(formant_fir_filter_t* filter) {
+    int block = FORMANT_FIR_PARTITION;
+    int bins = block + 1;
+    int parts = (filter->num_taps + block - 1) / block;
+
+    filter->fft = formant_fft_create(2 * block);
+    filter->num_partitions = parts;
+    filter->bins = bins;
+    filter->partition_re = (float*)calloc((size_t)parts * bins, sizeof(float));
+    filter->partition_im = (float*)calloc((size_t)parts * bins, sizeof(float));
+    filter->fdl_re = (float*)calloc((size_t)parts * bins, sizeof(float));
+    filter->fdl_im = (float*)calloc((size_t)parts * bins, sizeof(float));
+    filter->frame = (float*)calloc(2 * block, sizeof(float));
+    filter->output = (float*)calloc(block, sizeof(float));
+    filter->work = (float*)calloc(2 * block, sizeof(float));
+    filter->acc_re = (float*)calloc(bins, sizeof(float));
+    filter->acc_im = (float*)calloc(bins, sizeof(float));
+
+    if (!filter->fft || !filter->partition_re || !filter->partition_im ||
+        !filter->fdl_re || !filter->fdl_im || !filter->frame || !filter->output ||
+        !filter->work || !filter->acc_re || !filter->acc_im) {
+        return -1;
+    }
+
+    for (int p = 0; p < parts; p++) {
+        int count = filter->num_taps - p * block;
+        if (count > block) count = block;
+
+        memset(filter->work, 0, 2 * block * sizeof(float));
+        memcpy(filter->work, filter->coeffs + (size_t)p * block, count * sizeof(float));
+        formant_fft_forward(filter->fft, filter->work,
+                            filter->partition_re + (size_t)p * bins,
+                            filter->partition_im + (size_t)p * bins);
+    }
+
+    filter->fdl_pos = 0;
+    filter->fill = 0;
+    return 0;
+}
+
+int formant_fir_filter_init(formant_fir_filter_t* filter, const float* coeffs, int num_taps) {
+    if (!filter || !coeffs || num_taps < 1) {
+        return -1;
+    }
+
+    /* Replace any previously loaded filter */
+    formant_fir_filter_release(filter);
+
+    filter->coeffs = (float*)malloc(num_taps * sizeof(float));
+    filter->reversed = (float*)malloc(num_taps * sizeof(float));
+    filter->history = (float*)calloc(2 * (size_t)num_taps, sizeof(float));
+    if (!filter->coeffs || !filter->reversed || !filter->history) {
+        fprintf(stderr, "ERROR: Failed to allocate filter buffers\n");
+        formant_fir_filter_release(filter);
+        return -1;
+    }
+    memcpy(filter->coeffs, coeffs, num_taps * sizeof(float));
+    for (int i = 0; i < num_taps; i++) {
+        filter->reversed[i] = coeffs[num_taps - 1 - i];
+    }
+    filter->num_taps = num_taps;
+    filter->history_pos = 0;
+
+    if (num_taps >= FORMANT_FIR_FFT_MIN_TAPS && fir_prepare_partitions(filter) != 0) {
+        fprintf(stderr, "ERROR: Failed to allocate FFT convolution (%d taps)\n", num_taps);
+        formant_fir_filter_release(filter);
+        return -1;
+    }
+
+    return 0;
+}
+
 /**
  * Load FIR coefficients from file
  * File format: one coefficient per line (float)
@@ -95,13 +222,9 @@ static int load_fir_coefficients(const char* filename, formant_fir_filter_t* fil
         return -1;
     }
 
-    /* Allocate arrays */
-    filter->coeffs = (float*)calloc(num_coeffs, sizeof(float));
-    filter->history = (float*)calloc(num_coeffs, sizeof(float));
-    if (!filter->coeffs || !filter->history) {
+    float* coeffs = (float*)calloc(num_coeffs, sizeof(float));
+    if (!coeffs) {
         fprintf(stderr, "ERROR: Failed to allocate filter buffers\n");
-        free(filter->coeffs);
-        free(filter->history);
         fclose(fp);
         return -1;
     }
@@ -110,7 +233,7 @@ static int load_fir_coefficients(const char* filename, formant_fir_filter_t* fil
     int i = 0;
     while (fgets(line, sizeof(line), fp) && i < num_coeffs) {
         if (line[0] != '#' && line[0] != '\n') {
-            if (sscanf(line, "%f", &filter->coeffs[i]) == 1) {
+            if (sscanf(line, "%f", &coeffs[i]) == 1) {
                 i++;
             }
         }
@@ -118,35 +241,310 @@ static int load_fir_coefficients(const char* filename, formant_fir_filter_t* fil
 
     fclose(fp);
 
-    filter->num_taps = num_coeffs;
-    filter->history_pos = 0;
+    int result = formant_fir_filter_init(filter, coeffs, num_coeffs);
+    free(coeffs);
+    if (result < 0) {
+        return -1;
+    }
 
-    fprintf(stderr, "Loaded %d FIR coefficients from %s\n", num_coeffs, filename);
+    fprintf(stderr, "Loaded %d FIR coefficients from %s (%s)\n", num_coeffs, filename,
+            filter->fft ? "partitioned FFT" : "direct form");
     return num_coeffs;
 }
 
 /**
- * Process single sample through FIR filter
+ * Direct-form FIR over a block
+ * The history is mirrored (each sample stored at pos and pos + taps), so
+ * the taps always read one contiguous run with no wraparound.
+ */
+static void fir_direct_block(formant_fir_filter_t* filter, const float* input, float* output, int n) {
+    int taps = filter->num_taps;
+    const float* c = filter->reversed;
+    float* h = filter->history;
+    int pos = filter->history_pos;
+
+    for (int s = 0; s < n; s++) {
+        h[pos] = input[s];
+        h[pos + taps] = input[s];
+
+        /* h[pos + 1 + j] is the input taps - 1 - j samples ago */
+        const float* x = h + pos + 1;
+        float acc = 0.0f;
+        for (int j = 0; j < taps; j++) {
+            acc += c[j] * x[j];
+        }
+        output[s] = acc;
+
+        if (++pos == taps) pos = 0;
+    }
+
+    filter->history_pos = pos;
+}
+
+/**
+ * Filter one complete partition held in frame[B, 2B)
+ * Overlap-save: the FFT covers the previous and current partitions,
+ * the newest spectrum enters the delay line, every delay-line slot is
+ * multiplied by its partition's spectrum, and the second half of the
+ * inverse transform is the filtered block.
+ */
+static void fir_partition_step(formant_fir_filter_t* filter) {
+    int block = FORMANT_FIR_PARTITION;
+    int bins = filter->bins;
+    int parts = filter->num_partitions;
+
+    filter->fdl_pos = (filter->fdl_pos + parts - 1) % parts;
+    formant_fft_forward(filter->fft, filter->frame,
+                        filter->fdl_re + (size_t)filter->fdl_pos * bins,
+                        filter->fdl_im + (size_t)filter->fdl_pos * bins);
+
+    float* restrict yr = filter->acc_re;
+    float* restrict yi = filter->acc_im;
+    memset(yr, 0, bins * sizeof(float));
+    memset(yi, 0, bins * sizeof(float));
+
+    for (int p = 0; p < parts; p++) {
+        int slot = filter->fdl_pos + p;
+        if (slot >= parts) slot -= parts;
+
+        const float* restrict xr = filter->fdl_re + (size_t)slot * bins;
+        const float* restrict xi = filter->fdl_im + (size_t)slot * bins;
+        const float* restrict hr = filter->partition_re + (size_t)p * bins;
+        const float* restrict hi = filter->partition_im + (size_t)p * bins;
+
+        for (int k = 0; k < bins; k++) {
+            yr[k] += xr[k] * hr[k] - xi[k] * hi[k];
+            yi[k] += xr[k] * hi[k] + xi[k] * hr[k];
+        }
+    }
+
+    formant_fft_inverse(filter->fft, yr, yi, filter->work);
+    memcpy(filter->output, filter->work + block, block * sizeof(float));
+
+    /* The current partition becomes the overlap for the next one */
+    memcpy(filter->frame, filter->frame + block, block * sizeof(float));
+}
+
+/**
+ * Partitioned FIR over a block, delayed by FORMANT_FIR_PARTITION samples
  */
-static float fir_process_sample(formant_fir_filter_t* filter, float input) {
+static void fir_partitioned_block(formant_fir_filter_t* filter, const float* input, float* output, int n) {
+    int block = FORMANT_FIR_PARTITION;
+
+    while (n > 0) {
+        int count = block - filter->fill;
+        if (count > n) count = n;
+
+        memcpy(filter->frame + block + filter->fill, input, count * sizeof(float));
+        memcpy(output, filter->output + filter->fill, count * sizeof(float));
+
+        filter->fill += count;
+        input += count;
+        output += count;
+        n -= count;
+
+        if (filter->fill == block) {
+            fir_partition_step(filter);
+            filter->fill = 0;
+        }
+    }
+}
+
+void formant_fir_filter_process(formant_fir_filter_t* filter, const float* input, float* output, int n) {
+    if (!filter || !input || !output || n <= 0) {
+        return;
+    }
     if (!filter->coeffs || filter->num_taps == 0) {
-        return input;  /* Pass-through if no filter loaded */
+        memcpy(output, input, n * sizeof(float));
+    } else if (filter->fft) {
+        fir_partitioned_block(filter, input, output, n);
+    } else {
+        fir_direct_block(filter, input, output, n);
+    }
+}
+
+/* ============================================================================
+ * Block Kernels
+ * ========================================================================= */
+
+/**
+ * Largest and smallest |x| over an aligned block
+ */
+static void block_abs_range(const float* x, int n, float* peak_out, float* floor_out) {
+    float peak = 0.0f;
+    float floor = INFINITY;
+    int i = 0;
+
+#if FORMANT_SIMD_WIDTH > 0
+    if (n >= FORMANT_SIMD_WIDTH) {
+        fvec_t vmax = fvec_zero();
+        fvec_t vmin = fvec_set1(INFINITY);
+        for (; i + FORMANT_SIMD_WIDTH <= n; i += FORMANT_SIMD_WIDTH) {
+            fvec_t a = fvec_abs(fvec_load(x + i));
+            vmax = fvec_max(vmax, a);
+            vmin = fvec_min(vmin, a);
+        }
+        peak = fvec_hmax(vmax);
+        floor = fvec_hmin(vmin);
+    }
+#endif
+
+    for (; i < n; i++) {
+        float a = fabsf(x[i]);
+        if (a > peak) peak = a;
+        if (a < floor) floor = a;
+    }
+
+    *peak_out = peak;
+    *floor_out = floor;
+}
+
+/**
+ * Largest |y| of the 4x oversampled block
+ * x points at the block inside the true-peak buffer; the TP_TAPS - 1
+ * samples before it are the previous block's tail. Lanes run over output
+ * samples, so every tap is one broadcast multiply-add per phase.
+ */
+static float block_true_peak(const float* x, int n) {
+    float peak = 0.0f;
+    int i = 0;
+
+#if FORMANT_SIMD_WIDTH > 0
+    fvec_t vmax = fvec_zero();
+    for (; i + FORMANT_SIMD_WIDTH <= n; i += FORMANT_SIMD_WIDTH) {
+        fvec_t acc[TP_PHASES];
+        for (int p = 0; p < TP_PHASES; p++) {
+            acc[p] = fvec_zero();
+        }
+        for (int k = 0; k < TP_TAPS; k++) {
+            fvec_t xv = fvec_loadu(x + i - k);
+            for (int p = 0; p < TP_PHASES; p++) {
+                acc[p] = fvec_add(acc[p], fvec_mul(fvec_set1(TP_COEFFS[p][k]), xv));
+            }
+        }
+        for (int p = 0; p < TP_PHASES; p++) {
+            vmax = fvec_max(vmax, fvec_abs(acc[p]));
+        }
+    }
+    peak = fvec_hmax(vmax);
+#endif
+
+    for (; i < n; i++) {
+        for (int p = 0; p < TP_PHASES; p++) {
+            float y = 0.0f;
+            for (int k = 0; k < TP_TAPS; k++) {
+                y += TP_COEFFS[p][k] * x[i - k];
+            }
+            y = fabsf(y);
+            if (y > peak) peak = y;
+        }
+    }
+
+    return peak;
+}
+
+/**
+ * Slide the RMS window over a block
+ * Each sample's square replaces the oldest one and the running sum moves
+ * by the difference. Every time the write position wraps, the sum is
+ * recomputed from the window in double, so rounding cannot accumulate.
+ */
+static void rms_window_update(formant_meter_t* meter, const float* x, int n) {
+    float* ring = meter->rms_buffer;
+    int size = meter->rms_buffer_size;
+    int pos = meter->rms_buffer_pos;
+
+    while (n > 0) {
+        int count = size - pos;
+        if (count > n) count = n;
+
+        float* r = ring + pos;
+        float removed = 0.0f;
+        float added = 0.0f;
+        for (int i = 0; i < count; i++) {
+            removed += r[i];
+            r[i] = x[i] * x[i];
+            added += r[i];
+        }
+        meter->rms_sum += (double)added - (double)removed;
+
+        x += count;
+        n -= count;
+        pos += count;
+
+        if (pos == size) {
+            double sum = 0.0;
+            for (int i = 0; i < size; i++) {
+                sum += ring[i];
+            }
+            meter->rms_sum = sum;
+            pos = 0;
+        }
+    }
+
+    meter->rms_buffer_pos = pos;
+}
+
+/**
+ * Meter one block (<= METER_BLOCK) of weighted samples
+ * true_peak is the oversampled peak of the unweighted input.
+ */
+static void meter_block(formant_meter_t* meter, const float* x, int n, float true_peak) {
+    float peak, floor;
+    block_abs_range(x, n, &peak, &floor);
+
+    /* Statistics */
+    if (floor < meter->min_level) meter->min_level = floor;
+    if (peak > meter->max_level) meter->max_level = peak;
+
+    if (peak >= 1.0f) {
+        for (int i = 0; i < n; i++) {
+            if (fabsf(x[i]) >= 1.0f) meter->clip_count++;
+        }
     }
 
-    /* Add input to circular buffer */
-    filter->history[filter->history_pos] = input;
+    /* Peak ballistics: the attack/release recursion stays per sample */
+    float attack = meter->ballistics.attack_coeff;
+    float release = meter->ballistics.release_coeff;
+    float level = meter->peak_current;
+    for (int i = 0; i < n; i++) {
+        float a = fabsf(x[i]);
+        float coeff = (a > level) ? attack : release;
+        level = coeff * level + (1.0f - coeff) * a;
+    }
+    meter->peak_current = level;
 
-    /* Convolution */
-    float output = 0.0f;
-    for (int i = 0; i < filter->num_taps; i++) {
-        int idx = (filter->history_pos - i + filter->num_taps) % filter->num_taps;
-        output += filter->coeffs[i] * filter->history[idx];
+    /* Peak hold, timed in samples */
+    if (peak > meter->peak_hold) {
+        meter->peak_hold = peak;
+        meter->peak_hold_samples = 0;
+    } else {
+        meter->peak_hold_samples += n;
+        int expired = meter->peak_hold_samples - meter->peak_hold_length;
+        if (expired > 0) {
+            meter->peak_hold *= powf(PEAK_HOLD_DECAY, (float)(expired < n ? expired : n));
+        }
     }
 
-    /* Advance position */
-    filter->history_pos = (filter->history_pos + 1) % filter->num_taps;
+    /* True peak (decaying maximum) */
+    if (true_peak > meter->true_peak) {
+        meter->true_peak = true_peak;
+    } else {
+        meter->true_peak *= powf(TRUE_PEAK_DECAY, (float)n);
+    }
+    if (true_peak > meter->max_true_peak) {
+        meter->max_true_peak = true_peak;
+    }
 
-    return output;
+    /* RMS over the integration window */
+    if (meter->rms_buffer && meter->rms_buffer_size > 0) {
+        rms_window_update(meter, x, n);
+        double mean = meter->rms_sum / meter->rms_buffer_size;
+        meter->rms_current = mean > 0.0 ? sqrtf((float)mean) : 0.0f;
+    } else {
+        /* No integration - instant RMS */
+        meter->rms_current = fabsf(x[n - 1]);
+    }
 }
 
 /* ============================================================================
@@ -175,12 +573,26 @@ formant_meter_t* formant_meter_create(float sample_rate, const char* preset) {
     meter->ballistics.release_coeff = calc_ballistics_coeff(bp->release_ms, sample_rate);
     meter->ballistics.integration_time_ms = bp->integration_ms;
     meter->ballistics.peak_hold_time_ms = bp->peak_hold_ms;
+    meter->peak_hold_length = (int)((bp->peak_hold_ms / 1000.0f) * sample_rate);
+
+    meter->block = (float*)aligned_alloc(FORMANT_CACHE_LINE, METER_BLOCK * sizeof(float));
+    meter->tp_buffer = (float*)aligned_alloc(FORMANT_CACHE_LINE,
+                                             (TP_HISTORY + METER_BLOCK) * sizeof(float));
+    if (!meter->block || !meter->tp_buffer) {
+        free(meter->block);
+        free(meter->tp_buffer);
+        free(meter);
+        return NULL;
+    }
+    memset(meter->tp_buffer, 0, TP_HISTORY * sizeof(float));
 
     /* Allocate RMS integration buffer */
     meter->rms_buffer_size = (int)((bp->integration_ms / 1000.0f) * sample_rate);
     if (meter->rms_buffer_size > 0) {
         meter->rms_buffer = (float*)calloc(meter->rms_buffer_size, sizeof(float));
         if (!meter->rms_buffer) {
+            free(meter->block);
+            free(meter->tp_buffer);
             free(meter);
             return NULL;
         }
@@ -191,6 +603,7 @@ formant_meter_t* formant_meter_create(float sample_rate, const char* preset) {
     meter->peak_current = 0.0f;
     meter->peak_hold = 0.0f;
     meter->true_peak = 0.0f;
+    meter->max_true_peak = 0.0f;
     meter->min_level = 1.0f;
     meter->max_level = 0.0f;
     meter->clip_count = 0;
@@ -212,9 +625,10 @@ void formant_meter_destroy(formant_meter_t* meter) {
         return;
     }
 
-    free(meter->filter.coeffs);
-    free(meter->filter.history);
+    formant_fir_filter_release(&meter->filter);
     free(meter->rms_buffer);
+    free(meter->block);
+    free(meter->tp_buffer);
     free(meter);
 }
 
@@ -231,83 +645,27 @@ void formant_meter_process(formant_meter_t* meter, const float* samples, int num
         return;
     }
 
-    uint64_t now = formant_get_time_us();
+    while (num_samples > 0) {
+        int n = num_samples < METER_BLOCK ? num_samples : METER_BLOCK;
+        float* input = meter->tp_buffer + TP_HISTORY;
 
-    for (int i = 0; i < num_samples; i++) {
-        /* Apply frequency weighting filter */
-        float sample = fir_process_sample(&meter->filter, samples[i]);
-        float abs_sample = fabsf(sample);
-
-        /* Update min/max */
-        if (abs_sample < meter->min_level) {
-            meter->min_level = abs_sample;
-        }
-        if (abs_sample > meter->max_level) {
-            meter->max_level = abs_sample;
-        }
+        memcpy(input, samples, n * sizeof(float));
+        float true_peak = block_true_peak(input, n);
 
-        /* Detect clipping */
-        if (abs_sample >= 1.0f) {
-            meter->clip_count++;
-        }
-
-        /* Peak detection with ballistics */
-        if (abs_sample > meter->peak_current) {
-            /* Attack */
-            if (meter->ballistics.attack_coeff > 0.0f) {
-                meter->peak_current = meter->ballistics.attack_coeff * meter->peak_current +
-                                     (1.0f - meter->ballistics.attack_coeff) * abs_sample;
-            } else {
-                meter->peak_current = abs_sample;  /* Instant attack */
-            }
-        } else {
-            /* Release */
-            if (meter->ballistics.release_coeff > 0.0f) {
-                meter->peak_current = meter->ballistics.release_coeff * meter->peak_current +
-                                     (1.0f - meter->ballistics.release_coeff) * abs_sample;
-            } else {
-                meter->peak_current = abs_sample;  /* Instant release */
-            }
-        }
-
-        /* Peak hold */
-        if (abs_sample > meter->peak_hold) {
-            meter->peak_hold = abs_sample;
-            meter->peak_hold_start_us = now;
-        } else {
-            /* Decay peak hold after hold time */
-            uint64_t hold_duration = now - meter->peak_hold_start_us;
-            float hold_ms = hold_duration / 1000.0f;
-            if (hold_ms > meter->ballistics.peak_hold_time_ms) {
-                meter->peak_hold *= 0.99f;  /* Slow decay */
-            }
-        }
-
-        /* True peak (simple 2x oversampling approximation) */
-        if (abs_sample > meter->true_peak) {
-            meter->true_peak = abs_sample;
-        } else {
-            meter->true_peak *= 0.9999f;  /* Very slow decay */
+        /* Apply frequency weighting filter */
+        const float* weighted = input;
+        if (meter->filter.coeffs && meter->filter.num_taps > 0) {
+            formant_fir_filter_process(&meter->filter, input, meter->block, n);
+            weighted = meter->block;
         }
 
-        /* RMS calculation (moving average) */
-        if (meter->rms_buffer && meter->rms_buffer_size > 0) {
-            float sample_squared = sample * sample;
+        meter_block(meter, weighted, n, true_peak);
 
-            /* Add to circular buffer */
-            meter->rms_buffer[meter->rms_buffer_pos] = sample_squared;
-            meter->rms_buffer_pos = (meter->rms_buffer_pos + 1) % meter->rms_buffer_size;
+        /* Oversampler history for the next block */
+        memmove(input - (TP_TAPS - 1), input + n - (TP_TAPS - 1), (TP_TAPS - 1) * sizeof(float));
 
-            /* Calculate RMS from buffer */
-            float sum = 0.0f;
-            for (int j = 0; j < meter->rms_buffer_size; j++) {
-                sum += meter->rms_buffer[j];
-            }
-            meter->rms_current = sqrtf(sum / meter->rms_buffer_size);
-        } else {
-            /* No integration - instant RMS */
-            meter->rms_current = abs_sample;
-        }
+        samples += n;
+        num_samples -= n;
     }
 }
 
@@ -332,6 +690,13 @@ float formant_meter_get_peak_hold_db(formant_meter_t* meter) {
     return amp_to_db(meter->peak_hold);
 }
 
+float formant_meter_get_true_peak_db(formant_meter_t* meter) {
+    if (!meter) {
+        return METER_MIN_DB;
+    }
+    return amp_to_db(meter->true_peak);
+}
+
 void formant_meter_reset(formant_meter_t* meter) {
     if (!meter) {
         return;
@@ -349,6 +714,10 @@ void formant_meter_reset(formant_meter_t* meter) {
         memset(meter->rms_buffer, 0, meter->rms_buffer_size * sizeof(float));
     }
     meter->rms_buffer_pos = 0;
+    meter->rms_sum = 0.0;
+    meter->peak_hold_samples = 0;
+    meter->max_true_peak = 0.0f;
+    memset(meter->tp_buffer, 0, TP_HISTORY * sizeof(float));
 }
 
 void formant_meter_format_display(formant_meter_t* meter, char* buffer, int buffer_size, int width) {
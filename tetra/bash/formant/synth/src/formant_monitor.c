@@ -0,0 +1,158 @@
+/**
+ * formant_monitor.c
+ *
+ * Output monitoring off the audio thread. The audio thread meters each
+ * block it renders and publishes one snapshot through a seqlock; UI,
+ * console or server threads read the latest snapshot whenever they like.
+ * The writer never waits on a reader and nothing here touches stdio or
+ * the allocator after creation.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include "formant.h"
+
+_Static_assert(sizeof(formant_meter_snapshot_t) % sizeof(uint32_t) == 0,
+               "snapshot must be a whole number of seqlock words");
+
+#define READ_SPIN_LIMIT 100
+
+/* ============================================================================
+ * Seqlock
+ * ========================================================================= */
+
+static void publish(formant_monitor_t* monitor, const formant_meter_snapshot_t* snapshot) {
+    uint32_t words[FORMANT_SNAPSHOT_WORDS];
+    memcpy(words, snapshot, sizeof(words));
+
+    unsigned seq = atomic_load_explicit(&monitor->sequence, memory_order_relaxed);
+    atomic_store_explicit(&monitor->sequence, seq + 1, memory_order_relaxed);
+    /* Readers that see any new word also see the odd sequence */
+    atomic_thread_fence(memory_order_release);
+
+    for (size_t i = 0; i < FORMANT_SNAPSHOT_WORDS; i++) {
+        atomic_store_explicit(&monitor->words[i], words[i], memory_order_relaxed);
+    }
+
+    atomic_store_explicit(&monitor->sequence, seq + 2, memory_order_release);
+}
+
+bool formant_monitor_read(formant_monitor_t* monitor, formant_meter_snapshot_t* snapshot) {
+    if (!monitor || !snapshot) return false;
+
+    uint32_t words[FORMANT_SNAPSHOT_WORDS];
+    int spins = 0;
+
+    for (;;) {
+        unsigned before = atomic_load_explicit(&monitor->sequence, memory_order_acquire);
+        if (before & 1) {
+            /* Mid-publish: the writer is a few stores away unless preempted */
+            if (++spins > READ_SPIN_LIMIT) {
+                sched_yield();
+            }
+            continue;
+        }
+
+        for (size_t i = 0; i < FORMANT_SNAPSHOT_WORDS; i++) {
+            words[i] = atomic_load_explicit(&monitor->words[i], memory_order_relaxed);
+        }
+
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&monitor->sequence, memory_order_relaxed) == before) {
+            break;
+        }
+    }
+
+    memcpy(snapshot, words, sizeof(words));
+    return snapshot->samples > 0;
+}
+
+/* ============================================================================
+ * Public API
+ * ========================================================================= */
+
+formant_monitor_t* formant_monitor_create(float sample_rate, const char* preset) {
+    formant_monitor_t* monitor = (formant_monitor_t*)aligned_alloc(FORMANT_CACHE_LINE,
+                                                                   sizeof(formant_monitor_t));
+    if (!monitor) {
+        return NULL;
+    }
+    memset(monitor, 0, sizeof(formant_monitor_t));
+
+    monitor->sample_rate = sample_rate;
+    monitor->meter = formant_meter_create(sample_rate, preset ? preset : "vu");
+    monitor->loudness = formant_loudness_create(sample_rate);
+    if (!monitor->meter || !monitor->loudness) {
+        fprintf(stderr, "ERROR: Failed to create output monitor\n");
+        formant_monitor_destroy(monitor);
+        return NULL;
+    }
+
+    atomic_init(&monitor->sequence, 0);
+    for (size_t i = 0; i < FORMANT_SNAPSHOT_WORDS; i++) {
+        atomic_init(&monitor->words[i], 0);
+    }
+
+    return monitor;
+}
+
+void formant_monitor_destroy(formant_monitor_t* monitor) {
+    if (!monitor) return;
+
+    formant_meter_destroy(monitor->meter);
+    formant_loudness_destroy(monitor->loudness);
+    free(monitor);
+}
+
+void formant_monitor_process(formant_monitor_t* monitor, const float* samples, int num_samples,
+                             uint64_t render_us) {
+    if (!monitor || !samples || num_samples <= 0) return;
+
+    formant_meter_process(monitor->meter, samples, num_samples);
+    formant_loudness_process(monitor->loudness, samples, num_samples);
+    monitor->samples += (uint64_t)num_samples;
+
+    float block_us = num_samples * 1e6f / monitor->sample_rate;
+    float load = (float)render_us / block_us;
+    if (load > monitor->load_max) {
+        monitor->load_max = load;
+    }
+
+    formant_meter_snapshot_t snapshot = {
+        .rms_db = formant_meter_get_rms_db(monitor->meter),
+        .peak_db = formant_meter_get_peak_db(monitor->meter),
+        .peak_hold_db = formant_meter_get_peak_hold_db(monitor->meter),
+        .true_peak_db = formant_meter_get_true_peak_db(monitor->meter),
+        .momentary_lufs = formant_loudness_momentary(monitor->loudness),
+        .short_term_lufs = formant_loudness_short_term(monitor->loudness),
+        .load = load,
+        .load_max = monitor->load_max,
+        .clip_count = monitor->meter->clip_count,
+        .samples = monitor->samples,
+    };
+    publish(monitor, &snapshot);
+}
+
+void formant_monitor_format(const formant_meter_snapshot_t* snapshot, char* buffer, int buffer_size) {
+    if (!snapshot || !buffer || buffer_size <= 0) return;
+
+    char momentary[16] = "--";
+    char short_term[16] = "--";
+    if (snapshot->momentary_lufs > FORMANT_LOUDNESS_NONE) {
+        snprintf(momentary, sizeof(momentary), "%.1f", snapshot->momentary_lufs);
+    }
+    if (snapshot->short_term_lufs > FORMANT_LOUDNESS_NONE) {
+        snprintf(short_term, sizeof(short_term), "%.1f", snapshot->short_term_lufs);
+    }
+
+    snprintf(buffer, (size_t)buffer_size,
+             "RMS %.1f dB | peak %.1f dB (hold %.1f) | TP %.1f dBTP | M %s S %s LUFS | "
+             "clips %llu | load %.0f%% (max %.0f%%)",
+             snapshot->rms_db, snapshot->peak_db, snapshot->peak_hold_db, snapshot->true_peak_db,
+             momentary, short_term, (unsigned long long)snapshot->clip_count,
+             snapshot->load * 100.0f, snapshot->load_max * 100.0f);
+}
@@ -37,6 +37,7 @@ formant_command_t* formant_parse_command(const char* line) {
         token = strtok(NULL, " \t\n");
         if (!token) { free(cmd); return NULL; }
         strncpy(cmd->params.phoneme.ipa, token, FORMANT_IPA_MAX_LEN - 1);
+        cmd->params.phoneme.id = formant_phoneme_id(token);
 
         cmd->params.phoneme.duration_ms = 100.0f;  /* Default */
         cmd->params.phoneme.pitch_hz = 120.0f;
@@ -172,159 +173,281 @@ formant_command_t* formant_parse_command(const char* line) {
     return cmd;
 }
 
-void formant_queue_command(formant_engine_t* engine, formant_command_t* cmd) {
-    if (!engine || !cmd) return;
+/* ============================================================================
+ * Command Ring (SPSC)
+ * ========================================================================= */
 
-    /* Check if queue is full */
-    if (engine->cmd_queue_size >= FORMANT_MAX_COMMANDS) {
-        fprintf(stderr, "WARNING: Command queue full, dropping command\n");
+#define CMD_RING_MASK (FORMANT_MAX_COMMANDS - 1)
+
+_Static_assert((FORMANT_MAX_COMMANDS & CMD_RING_MASK) == 0,
+               "FORMANT_MAX_COMMANDS must be a power of 2");
+
+int formant_queue_command(formant_engine_t* engine, const formant_command_t* cmd) {
+    if (!engine || !cmd) return -1;
+
+    formant_command_ring_t* ring = &engine->cmd_ring;
+    unsigned tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+    /* Full: count it, the caller decides whether to report or retry */
+    if (tail - head >= FORMANT_MAX_COMMANDS) {
+        atomic_fetch_add_explicit(&ring->overflow_count, 1, memory_order_relaxed);
+        return -1;
+    }
+
+    ring->slots[tail & CMD_RING_MASK] = *cmd;
+
+    /* Publish slot contents before the new tail becomes visible */
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+
+    unsigned depth = tail + 1 - head;
+    if (depth > atomic_load_explicit(&ring->high_water, memory_order_relaxed)) {
+        atomic_store_explicit(&ring->high_water, depth, memory_order_relaxed);
+    }
+
+    return 0;
+}
+
+int formant_queue_space(formant_engine_t* engine) {
+    if (!engine) return 0;
+
+    formant_command_ring_t* ring = &engine->cmd_ring;
+    unsigned tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    return FORMANT_MAX_COMMANDS - (int)(tail - head);
+}
+
+uint64_t formant_queue_overflow_count(formant_engine_t* engine) {
+    if (!engine) return 0;
+    return atomic_load_explicit(&engine->cmd_ring.overflow_count, memory_order_relaxed);
+}
+
+/**
+ * Oldest queued command, or NULL if the ring is empty (consumer side)
+ */
+static const formant_command_t* peek_command(formant_command_ring_t* ring) {
+    unsigned head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+    if (head == tail) {
+        return NULL;
+    }
+    return &ring->slots[head & CMD_RING_MASK];
+}
+
+/**
+ * Release the oldest slot back to the producer (consumer side)
+ */
+static void pop_command(formant_command_ring_t* ring) {
+    unsigned head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+/* ============================================================================
+ * Timeline Scheduling
+ * ========================================================================= */
+
+/**
+ * Samples a command holds the timeline for (PH/FM duration scaled by PR RATE)
+ */
+static uint64_t command_hold_samples(const formant_engine_t* engine, const formant_command_t* cmd) {
+    float duration_ms = 0.0f;
+
+    if (cmd->type == FORMANT_CMD_PHONEME) {
+        duration_ms = cmd->params.phoneme.duration_ms;
+    } else if (cmd->type == FORMANT_CMD_FORMANT) {
+        duration_ms = cmd->params.formant.duration_ms;
+    }
+
+    float rate = engine->rate_multiplier > 0.01f ? engine->rate_multiplier : 0.01f;
+    if (duration_ms <= 0.0f) {
+        return 0;
+    }
+    return (uint64_t)(duration_ms / rate * engine->sample_rate / 1000.0f + 0.5f);
+}
+
+/**
+ * Sample at which a command becomes due
+ * SYNC is never held back: it moves the timeline itself.
+ */
+static uint64_t command_due_sample(const formant_engine_t* engine, const formant_command_t* cmd) {
+    uint64_t now = engine->samples_processed;
+
+    if (cmd->type == FORMANT_CMD_SYNC || engine->timeline_cursor < now) {
+        return now;
+    }
+    return engine->timeline_cursor;
+}
+
+/**
+ * Align the timeline to an external millisecond clock
+ * The first SYNC pins its timestamp to the current timeline position;
+ * later ones move the cursor to the matching sample (never into the past).
+ */
+static void apply_sync(formant_engine_t* engine, uint64_t timestamp_ms) {
+    uint64_t now = engine->samples_processed;
+
+    if (!engine->sync_locked) {
+        engine->sync_locked = true;
+        engine->sync_origin_sample = engine->timeline_cursor > now ? engine->timeline_cursor : now;
+        engine->sync_origin_ms = timestamp_ms;
+        engine->timeline_cursor = engine->sync_origin_sample;
         return;
     }
 
-    /* Add to queue */
-    engine->cmd_queue[engine->cmd_queue_tail] = *cmd;
-    engine->cmd_queue_tail = (engine->cmd_queue_tail + 1) % FORMANT_MAX_COMMANDS;
-    engine->cmd_queue_size++;
+    uint64_t target = engine->sync_origin_sample;
+    if (timestamp_ms > engine->sync_origin_ms) {
+        target += (uint64_t)((double)(timestamp_ms - engine->sync_origin_ms) *
+                             engine->sample_rate / 1000.0);
+    }
+    engine->timeline_cursor = target > now ? target : now;
 }
 
-void formant_process_commands(formant_engine_t* engine) {
-    if (!engine) return;
-
-    /* Process all queued commands */
-    while (engine->cmd_queue_size > 0) {
-        formant_command_t* cmd = &engine->cmd_queue[engine->cmd_queue_head];
-
-        /* Execute command based on type */
-        switch (cmd->type) {
-            case FORMANT_CMD_PHONEME: {
-                /* Get phoneme configuration */
-                const formant_phoneme_config_t* phoneme =
-                    formant_get_phoneme(cmd->params.phoneme.ipa);
-
-                if (phoneme) {
-                    /* Set formant targets */
-                    engine->f1_target = phoneme->f1;
-                    engine->f2_target = phoneme->f2;
-                    engine->f3_target = phoneme->f3;
-                    engine->lerp_rate = cmd->params.phoneme.rate;
-                    engine->f0_hz = cmd->params.phoneme.pitch_hz;
-                    engine->intensity = cmd->params.phoneme.intensity;
-                    engine->current_phoneme = phoneme;
-
-                    /* Select CELP excitation if using CELP or hybrid mode */
-                    if (engine->synth_mode != FORMANT_SYNTH_MODE_FORMANT) {
-                        formant_celp_select_excitation(
-                            &engine->celp_engine,
-                            phoneme,
-                            cmd->params.phoneme.pitch_hz);
-                    }
+/* ============================================================================
+ * Command Execution
+ * ========================================================================= */
+
+static void execute_command(formant_engine_t* engine, const formant_command_t* cmd) {
+    /* Execute command based on type */
+    switch (cmd->type) {
+        case FORMANT_CMD_PHONEME: {
+            /* Interned by the parser: a direct table index */
+            const formant_phoneme_config_t* phoneme =
+                formant_phoneme_by_id(cmd->params.phoneme.id);
+
+            if (phoneme) {
+                /* Set formant targets */
+                engine->f1_target = phoneme->f1;
+                engine->f2_target = phoneme->f2;
+                engine->f3_target = phoneme->f3;
+                engine->f4_target = phoneme->f4;
+                engine->f5_target = phoneme->f5;
+                engine->lerp_rate = cmd->params.phoneme.rate;
+                engine->f0_hz = cmd->params.phoneme.pitch_hz;
+                engine->intensity = cmd->params.phoneme.intensity;
+                engine->current_phoneme = phoneme;
+
+                /* Resonator shape follows the phoneme table */
+                const float bw[FORMANT_MAX_FORMANTS] = {
+                    phoneme->bw1, phoneme->bw2, phoneme->bw3, phoneme->bw4, phoneme->bw5
+                };
+                const float amp[FORMANT_MAX_FORMANTS] = {
+                    phoneme->amp1, phoneme->amp2, phoneme->amp3, phoneme->amp4, phoneme->amp5
+                };
+                for (int f = 0; f < FORMANT_MAX_FORMANTS; f++) {
+                    engine->formant_bw[f] = bw[f];
+                    engine->formant_gain[f] = amp[f];
                 }
-                break;
-            }
-
-            case FORMANT_CMD_FORMANT:
-                /* Direct formant control */
-                engine->f1_target = cmd->params.formant.f1;
-                engine->f2_target = cmd->params.formant.f2;
-                engine->f3_target = cmd->params.formant.f3;
-                break;
-
-            case FORMANT_CMD_PROSODY: {
-                /* Set prosody parameter */
-                const char* param = cmd->params.prosody.param;
-                float value = cmd->params.prosody.value;
-
-                if (strcmp(param, "PITCH") == 0) {
-                    engine->pitch_base = value;
-                    engine->f0_hz = value;
-                } else if (strcmp(param, "RATE") == 0) {
-                    engine->rate_multiplier = value;
-                } else if (strcmp(param, "VOLUME") == 0) {
-                    engine->volume = value;
+                engine->phoneme_start_us = engine->samples_processed * 1000000ULL /
+                                           (uint64_t)engine->sample_rate;
+                engine->phoneme_duration_us = command_hold_samples(engine, cmd) * 1000000ULL /
+                                              (uint64_t)engine->sample_rate;
+
+                /* Select CELP excitation if using CELP or hybrid mode */
+                if (engine->synth_mode != FORMANT_SYNTH_MODE_FORMANT) {
+                    formant_celp_select_excitation(
+                        &engine->celp_engine,
+                        cmd->params.phoneme.id,
+                        cmd->params.phoneme.pitch_hz);
                 }
-                break;
             }
+            break;
+        }
 
-            case FORMANT_CMD_MODE: {
-                /* Set synthesis mode */
-                const char* mode = cmd->params.mode.mode;
-
-                if (strcmp(mode, "FORMANT") == 0 || strcmp(mode, "formant") == 0) {
-                    formant_engine_set_mode(engine, FORMANT_SYNTH_MODE_FORMANT);
-                } else if (strcmp(mode, "CELP") == 0 || strcmp(mode, "celp") == 0) {
-                    formant_engine_set_mode(engine, FORMANT_SYNTH_MODE_CELP);
-                } else if (strcmp(mode, "HYBRID") == 0 || strcmp(mode, "hybrid") == 0) {
-                    formant_engine_set_mode(engine, FORMANT_SYNTH_MODE_HYBRID);
-                    formant_engine_set_hybrid_mix(engine, cmd->params.mode.mix);
-                }
-                break;
+        case FORMANT_CMD_FORMANT:
+            /* Direct formant control */
+            engine->f1_target = cmd->params.formant.f1;
+            engine->f2_target = cmd->params.formant.f2;
+            engine->f3_target = cmd->params.formant.f3;
+            engine->formant_bw[0] = cmd->params.formant.bw1;
+            engine->formant_bw[1] = cmd->params.formant.bw2;
+            engine->formant_bw[2] = cmd->params.formant.bw3;
+            break;
+
+        case FORMANT_CMD_PROSODY: {
+            /* Set prosody parameter */
+            const char* param = cmd->params.prosody.param;
+            float value = cmd->params.prosody.value;
+
+            if (strcmp(param, "PITCH") == 0) {
+                engine->pitch_base = value;
+                engine->f0_hz = value;
+            } else if (strcmp(param, "RATE") == 0) {
+                engine->rate_multiplier = value;
+            } else if (strcmp(param, "VOLUME") == 0) {
+                engine->volume = value;
             }
+            break;
+        }
 
-            case FORMANT_CMD_RESET:
-                formant_engine_reset(engine);
-                break;
-
-            case FORMANT_CMD_PAUSE:
-                engine->paused = true;
-                break;
-
-            case FORMANT_CMD_RESUME:
-                engine->paused = false;
-                break;
-
-            case FORMANT_CMD_RECORD: {
-                /* Start fixed-duration recording */
-                if (engine->recorder) {
-                    if (formant_recorder_is_recording(engine->recorder)) {
-                        fprintf(stderr, "WARNING: Already recording, stopping previous recording\n");
-                        formant_recorder_stop(engine->recorder);
-                    }
-
-                    int result = formant_recorder_start(
-                        engine->recorder,
-                        cmd->params.record.filename,
-                        cmd->params.record.duration_ms
-                    );
-
-                    if (result != 0) {
-                        fprintf(stderr, "ERROR: Failed to start recording\n");
-                    }
-                } else {
-                    fprintf(stderr, "ERROR: Recorder not initialized\n");
-                }
-                break;
+        case FORMANT_CMD_MODE: {
+            /* Set synthesis mode */
+            const char* mode = cmd->params.mode.mode;
+
+            if (strcmp(mode, "FORMANT") == 0 || strcmp(mode, "formant") == 0) {
+                formant_engine_set_mode(engine, FORMANT_SYNTH_MODE_FORMANT);
+            } else if (strcmp(mode, "CELP") == 0 || strcmp(mode, "celp") == 0) {
+                formant_engine_set_mode(engine, FORMANT_SYNTH_MODE_CELP);
+            } else if (strcmp(mode, "HYBRID") == 0 || strcmp(mode, "hybrid") == 0) {
+                formant_engine_set_mode(engine, FORMANT_SYNTH_MODE_HYBRID);
+                formant_engine_set_hybrid_mix(engine, cmd->params.mode.mix);
             }
+            break;
+        }
 
-            case FORMANT_CMD_RECORD_VAD: {
-                /* Start VAD-triggered recording */
-                if (engine->recorder) {
-                    if (formant_recorder_is_recording(engine->recorder)) {
-                        fprintf(stderr, "WARNING: Already recording, stopping previous recording\n");
-                        formant_recorder_stop(engine->recorder);
-                    }
-
-                    int result = formant_recorder_start_vad(
-                        engine->recorder,
-                        cmd->params.record.filename,
-                        cmd->params.record.duration_ms,
-                        cmd->params.record.vad_mode
-                    );
-
-                    if (result != 0) {
-                        fprintf(stderr, "ERROR: Failed to start VAD recording\n");
-                    }
-                } else {
-                    fprintf(stderr, "ERROR: Recorder not initialized\n");
-                }
-                break;
-            }
+        case FORMANT_CMD_RESET:
+            formant_engine_reset(engine);
+            break;
+
+        case FORMANT_CMD_SYNC:
+            apply_sync(engine, cmd->params.sync.timestamp_ms);
+            break;
+
+        case FORMANT_CMD_PAUSE:
+            engine->paused = true;
+            break;
+
+        case FORMANT_CMD_RESUME:
+            engine->paused = false;
+            break;
+
+        case FORMANT_CMD_RECORD:
+        case FORMANT_CMD_RECORD_VAD:
+            /* Opening the file and stream blocks and reports on stderr, so
+             * the recorder's control thread does it; here it is only handed over */
+            formant_recorder_request(engine->recorder, cmd->params.record.filename,
+                                     cmd->params.record.duration_ms,
+                                     cmd->params.record.use_vad, cmd->params.record.vad_mode);
+            break;
+
+        default:
+            break;
+    }
+
+    /* Advance the timeline past whatever this command holds */
+    if (cmd->type != FORMANT_CMD_SYNC) {
+        engine->timeline_cursor = engine->samples_processed + command_hold_samples(engine, cmd);
+    }
+}
 
-            default:
-                break;
+int formant_process_commands(formant_engine_t* engine, int max_samples) {
+    if (!engine) return max_samples;
+
+    /* Execute commands that are due now; stop at the first one still held back */
+    const formant_command_t* next;
+    while ((next = peek_command(&engine->cmd_ring)) != NULL) {
+        uint64_t now = engine->samples_processed;
+        uint64_t due = command_due_sample(engine, next);
+
+        if (due > now) {
+            uint64_t wait = due - now;
+            return wait < (uint64_t)max_samples ? (int)wait : max_samples;
         }
 
-        /* Remove from queue */
-        engine->cmd_queue_head = (engine->cmd_queue_head + 1) % FORMANT_MAX_COMMANDS;
-        engine->cmd_queue_size--;
+        formant_command_t cmd = *next;
+        pop_command(&engine->cmd_ring);
+        execute_command(engine, &cmd);
     }
+
+    return max_samples;
 }
@@ -6,6 +6,7 @@
  */
 
 #include <string.h>
+#include <pthread.h>
 #include "formant.h"
 
 /* Formant frequency table for IPA phonemes */
@@ -56,16 +57,89 @@ static const formant_phoneme_config_t PHONEME_TABLE[] = {
 
 static const int PHONEME_TABLE_SIZE = sizeof(PHONEME_TABLE) / sizeof(PHONEME_TABLE[0]);
 
-const formant_phoneme_config_t* formant_get_phoneme(const char* ipa) {
-    if (!ipa) return NULL;
+_Static_assert(sizeof(PHONEME_TABLE) / sizeof(PHONEME_TABLE[0]) <= FORMANT_MAX_PHONEMES,
+               "PHONEME_TABLE exceeds FORMANT_MAX_PHONEMES");
+
+/* ============================================================================
+ * Phoneme Interning
+ * ========================================================================= */
+
+/*
+ * Symbols are at most FORMANT_IPA_MAX_LEN bytes ("ə" is two, "rest" four),
+ * so each one packs into a 32-bit key. Keys live in an open-addressed hash
+ * of twice the table size; a lookup is one multiply and a probe or two.
+ */
+#define PHONEME_HASH_BITS 7
+#define PHONEME_HASH_SIZE (1 << PHONEME_HASH_BITS)
+
+_Static_assert(PHONEME_HASH_SIZE >= 2 * FORMANT_MAX_PHONEMES, "Phoneme hash too small");
+
+static uint32_t g_phoneme_keys[PHONEME_HASH_SIZE];
+static int8_t g_phoneme_slots[PHONEME_HASH_SIZE];   /* Phoneme ID, -1 if empty */
+static pthread_once_t g_phoneme_once = PTHREAD_ONCE_INIT;
+
+/* Pack a symbol of up to 4 bytes; 0 if it is empty or too long to be one */
+static uint32_t pack_symbol(const char* symbol, size_t max_len) {
+    size_t len = 0;
+    while (len < max_len && symbol[len] != '\0') len++;
+    if (len == 0 || (len == max_len && max_len > FORMANT_IPA_MAX_LEN)) {
+        return 0;
+    }
+
+    uint32_t key = 0;
+    for (size_t i = 0; i < len; i++) {
+        key |= (uint32_t)(uint8_t)symbol[i] << (8 * i);
+    }
+    return key;
+}
+
+static inline unsigned hash_key(uint32_t key) {
+    return (key * 2654435761u) >> (32 - PHONEME_HASH_BITS);
+}
+
+static void build_phoneme_hash(void) {
+    memset(g_phoneme_slots, -1, sizeof(g_phoneme_slots));
 
-    for (int i = 0; i < PHONEME_TABLE_SIZE; i++) {
-        if (strcmp(PHONEME_TABLE[i].ipa, ipa) == 0) {
-            return &PHONEME_TABLE[i];
+    for (int id = 0; id < PHONEME_TABLE_SIZE; id++) {
+        /* Table symbols may fill all FORMANT_IPA_MAX_LEN bytes without a NUL */
+        uint32_t key = pack_symbol(PHONEME_TABLE[id].ipa, FORMANT_IPA_MAX_LEN);
+        unsigned slot = hash_key(key);
+        while (g_phoneme_slots[slot] >= 0) {
+            slot = (slot + 1) & (PHONEME_HASH_SIZE - 1);
+        }
+        g_phoneme_keys[slot] = key;
+        g_phoneme_slots[slot] = (int8_t)id;
+    }
+}
+
+int formant_phoneme_id(const char* ipa) {
+    if (!ipa) return -1;
+
+    pthread_once(&g_phoneme_once, build_phoneme_hash);
+
+    uint32_t key = pack_symbol(ipa, FORMANT_IPA_MAX_LEN + 1);
+    if (key == 0) return -1;
+
+    for (unsigned slot = hash_key(key); g_phoneme_slots[slot] >= 0;
+         slot = (slot + 1) & (PHONEME_HASH_SIZE - 1)) {
+        if (g_phoneme_keys[slot] == key) {
+            return g_phoneme_slots[slot];
         }
     }
 
-    return NULL;  /* Not found */
+    return -1;
+}
+
+const formant_phoneme_config_t* formant_phoneme_by_id(int id) {
+    return (id >= 0 && id < PHONEME_TABLE_SIZE) ? &PHONEME_TABLE[id] : NULL;
+}
+
+int formant_phoneme_count(void) {
+    return PHONEME_TABLE_SIZE;
+}
+
+const formant_phoneme_config_t* formant_get_phoneme(const char* ipa) {
+    return formant_phoneme_by_id(formant_phoneme_id(ipa));
 }
 
 const formant_phoneme_config_t* formant_get_all_phonemes(int* count) {
@@ -3,14 +3,29 @@
  *
  * Audio input recording module using PortAudio.
  * Records audio to WAV files for voice cloning training.
+ * The input callback only copies samples into a lock-free ring; a writer
+ * thread owns the file, so a slow disk never stalls the audio thread.
+ * RECORD commands reach a per-recorder control thread, which opens files
+ * and streams off the audio thread.
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
 #include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sched.h>
 #include "formant.h"
 
+#define WRITER_POLL_MS 10
+#define CONTROL_POLL_MS 10
+
 /* ============================================================================
  * WAV File Header
  * ========================================================================= */
@@ -36,10 +51,30 @@ typedef struct {
     uint32_t data_bytes;      /* num_samples * num_channels * bytes_per_sample */
 } wav_header_t;
 
+/**
+ * Write all of buffer at offset, retrying short writes
+ */
+static int pwrite_all(int fd, const void* buffer, size_t bytes, off_t offset) {
+    const char* p = (const char*)buffer;
+
+    while (bytes > 0) {
+        ssize_t n = pwrite(fd, p, bytes, offset);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += n;
+        bytes -= (size_t)n;
+        offset += n;
+    }
+
+    return 0;
+}
+
 /**
  * Write WAV file header
  */
-static int write_wav_header(FILE* file, int sample_rate, int num_samples) {
+static int write_wav_header(int fd, int sample_rate, int num_samples) {
     wav_header_t header;
 
     /* RIFF header */
@@ -61,226 +96,422 @@ static int write_wav_header(FILE* file, int sample_rate, int num_samples) {
     memcpy(header.data_header, "data", 4);
     header.data_bytes = num_samples * 2;  /* 2 bytes per sample */
 
-    /* Write header */
-    size_t written = fwrite(&header, sizeof(wav_header_t), 1, file);
-    if (written != 1) {
+    return pwrite_all(fd, &header, sizeof(wav_header_t), 0);
+}
+
+/**
+ * Update WAV file header with actual sample count
+ */
+static int update_wav_header(int fd, int num_samples) {
+    uint32_t wav_size = 36 + num_samples * 2;
+    uint32_t data_bytes = num_samples * 2;
+
+    if (pwrite_all(fd, &wav_size, sizeof(uint32_t), offsetof(wav_header_t, wav_size)) != 0 ||
+        pwrite_all(fd, &data_bytes, sizeof(uint32_t), offsetof(wav_header_t, data_bytes)) != 0) {
         return -1;
     }
 
     return 0;
 }
 
+/* ============================================================================
+ * Capture State
+ * ========================================================================= */
+
+/*
+ * The control thread arms a capture (IDLE -> WAITING_FOR_SPEECH or
+ * RECORDING) and ends it (-> STOPPING -> IDLE). The audio thread only
+ * moves it forward by compare-and-swap (WAITING_FOR_SPEECH -> RECORDING
+ * -> STOPPING), so a stop from the control thread is never overwritten.
+ * The writer thread only reads it, and returns a finished capture to IDLE.
+ */
+static inline formant_recorder_state_t get_state(formant_recorder_t* recorder) {
+    return atomic_load_explicit(&recorder->state, memory_order_acquire);
+}
+
+static inline void set_state(formant_recorder_t* recorder, formant_recorder_state_t state) {
+    atomic_store_explicit(&recorder->state, state, memory_order_release);
+}
+
+static inline bool advance_state(formant_recorder_t* recorder, formant_recorder_state_t from,
+                                 formant_recorder_state_t to) {
+    return atomic_compare_exchange_strong_explicit(&recorder->state, &from, to,
+                                                   memory_order_acq_rel, memory_order_acquire);
+}
+
+/* ============================================================================
+ * Capture Ring
+ * ========================================================================= */
+
 /**
- * Update WAV file header with actual sample count
+ * Copy samples into the ring (input callback only)
+ * Whatever does not fit is dropped and counted; the callback never waits.
  */
-static int update_wav_header(FILE* file, int num_samples) {
-    /* Seek to wav_size field (offset 4) */
-    fseek(file, 4, SEEK_SET);
-    uint32_t wav_size = 36 + num_samples * 2;
-    fwrite(&wav_size, sizeof(uint32_t), 1, file);
+static void ring_push(formant_recorder_t* recorder, const float* samples, int count) {
+    unsigned tail = atomic_load_explicit(&recorder->ring_tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&recorder->ring_head, memory_order_acquire);
+    unsigned space = recorder->ring_mask + 1 - (tail - head);
+
+    if ((unsigned)count > space) {
+        atomic_fetch_add_explicit(&recorder->overruns, (unsigned)count - space, memory_order_relaxed);
+        count = (int)space;
+    }
 
-    /* Seek to data_bytes field (offset 40) */
-    fseek(file, 40, SEEK_SET);
-    uint32_t data_bytes = num_samples * 2;
-    fwrite(&data_bytes, sizeof(uint32_t), 1, file);
+    unsigned pos = tail & recorder->ring_mask;
+    unsigned first = recorder->ring_mask + 1 - pos;
+    if (first > (unsigned)count) {
+        first = (unsigned)count;
+    }
+    memcpy(recorder->ring + pos, samples, first * sizeof(float));
+    memcpy(recorder->ring, samples + first, (count - first) * sizeof(float));
 
-    return 0;
+    atomic_store_explicit(&recorder->ring_tail, tail + (unsigned)count, memory_order_release);
 }
 
 /* ============================================================================
- * PortAudio Callback
+ * Writer Thread
  * ========================================================================= */
 
 /**
- * Helper function to write samples to WAV file
+ * Convert up to count queued samples to PCM and write them at offset
+ * Returns the number of samples consumed
  */
-static void write_samples_to_file(formant_recorder_t* recorder, const float* samples, int count) {
+static int write_chunk(formant_recorder_t* recorder, int count, off_t offset, bool* failed) {
+    unsigned head = atomic_load_explicit(&recorder->ring_head, memory_order_relaxed);
+
     for (int i = 0; i < count; i++) {
-        float sample = samples[i];
+        float sample = recorder->ring[(head + (unsigned)i) & recorder->ring_mask];
 
         /* Clamp to [-1.0, 1.0] */
         if (sample > 1.0f) sample = 1.0f;
         if (sample < -1.0f) sample = -1.0f;
 
         /* Convert to 16-bit PCM */
-        int16_t sample_16 = (int16_t)(sample * 32767.0f);
+        recorder->chunk[i] = (int16_t)(sample * 32767.0f);
+    }
 
-        /* Write to file */
-        fwrite(&sample_16, sizeof(int16_t), 1, recorder->wav_file);
+    /* The slots are free again once converted */
+    atomic_store_explicit(&recorder->ring_head, head + (unsigned)count, memory_order_release);
+
+    if (!*failed && pwrite_all(recorder->fd, recorder->chunk, count * sizeof(int16_t), offset) != 0) {
+        fprintf(stderr, "ERROR: Failed to write recording %s: %s\n", recorder->filename, strerror(errno));
+        *failed = true;
     }
-    recorder->samples_recorded += count;
+
+    return *failed ? 0 : count;
 }
 
-static int recorder_callback(const void* input_buffer,
-                             void* output_buffer,
-                             unsigned long frames_per_buffer,
-                             const PaStreamCallbackTimeInfo* time_info,
-                             PaStreamCallbackFlags status_flags,
-                             void* user_data)
-{
-    (void)output_buffer;  /* Unused */
-    (void)time_info;
-    (void)status_flags;
+/**
+ * Drain the ring until the capture ends, then finalize the file
+ * Writes are sized so every one after the first ends on a
+ * FORMANT_RECORDER_CHUNK_BYTES boundary of the file.
+ */
+static void* writer_main(void* arg) {
+    formant_recorder_t* recorder = (formant_recorder_t*)arg;
+    off_t offset = sizeof(wav_header_t);
+    int written = 0;
+    bool failed = false;
+
+    for (;;) {
+        /* Read the stop request before the tail: everything pushed before
+         * the request is then visible and gets written */
+        bool finishing = atomic_load_explicit(&recorder->writer_stop, memory_order_acquire) ||
+                         get_state(recorder) == FORMANT_RECORDER_STOPPING;
+        unsigned available = atomic_load_explicit(&recorder->ring_tail, memory_order_acquire) -
+                             atomic_load_explicit(&recorder->ring_head, memory_order_relaxed);
+        int to_boundary = (int)((FORMANT_RECORDER_CHUNK_BYTES - offset % FORMANT_RECORDER_CHUNK_BYTES) /
+                                (off_t)sizeof(int16_t));
+
+        if (available >= (unsigned)to_boundary || (finishing && available > 0)) {
+            int count = available < (unsigned)to_boundary ? (int)available : to_boundary;
+            int n = write_chunk(recorder, count, offset, &failed);
+            offset += (off_t)n * (off_t)sizeof(int16_t);
+            written += n;
+            atomic_store_explicit(&recorder->samples_recorded, written, memory_order_relaxed);
+            continue;
+        }
 
-    formant_recorder_t* recorder = (formant_recorder_t*)user_data;
-    const float* input = (const float*)input_buffer;
+        if (finishing) {
+            break;
+        }
+
+        struct timespec ts = { 0, WRITER_POLL_MS * 1000000L };
+        nanosleep(&ts, NULL);
+    }
+
+    /* Header with the real length; drop any preallocated tail */
+    if (update_wav_header(recorder->fd, written) != 0 ||
+        ftruncate(recorder->fd, offset) != 0) {
+        fprintf(stderr, "ERROR: Failed to finalize recording %s\n", recorder->filename);
+    }
+    close(recorder->fd);
+    recorder->fd = -1;
+
+    uint64_t overruns = atomic_load_explicit(&recorder->overruns, memory_order_relaxed);
+    fprintf(stderr, "✓ Recording complete: %s (%d samples, %.2fs",
+            recorder->filename, written, written / recorder->sample_rate);
+    if (overruns > 0) {
+        fprintf(stderr, ", %llu samples dropped", (unsigned long long)overruns);
+    }
+    fprintf(stderr, ")\n");
+
+    advance_state(recorder, FORMANT_RECORDER_STOPPING, FORMANT_RECORDER_IDLE);
+    return NULL;
+}
+
+/* ============================================================================
+ * Capture
+ * ========================================================================= */
+
+/**
+ * Run one VAD frame through the detector and record it while speech lasts
+ * Returns false once the capture has ended
+ */
+static bool capture_vad_frame(formant_recorder_t* recorder, const float* frame, int frame_size) {
+    formant_vad_result_t vad_result = formant_vad_process_frame(recorder->vad, frame, frame_size);
+
+    switch (get_state(recorder)) {
+        case FORMANT_RECORDER_WAITING_FOR_SPEECH:
+            if (vad_result == FORMANT_VAD_RESULT_SPEECH) {
+                /* Speech detected! Transition to recording, unless just stopped */
+                if (!advance_state(recorder, FORMANT_RECORDER_WAITING_FOR_SPEECH,
+                                   FORMANT_RECORDER_RECORDING)) {
+                    return false;
+                }
+
+                /* The pre-trigger buffer already ends with this frame */
+                int pretrigger_samples = formant_vad_get_pretrigger(
+                    recorder->vad, recorder->pretrigger, recorder->vad->pretrigger_size);
+                ring_push(recorder, recorder->pretrigger, pretrigger_samples);
+            }
+            /* Otherwise, keep waiting */
+            return true;
+
+        case FORMANT_RECORDER_RECORDING:
+            if (vad_result == FORMANT_VAD_RESULT_SPEECH) {
+                /* Continue recording */
+                ring_push(recorder, frame, frame_size);
+                return true;
+            }
+            /* Silence detected - stop recording */
+            advance_state(recorder, FORMANT_RECORDER_RECORDING, FORMANT_RECORDER_STOPPING);
+            return false;
+
+        default:
+            return false;
+    }
+}
 
+/**
+ * Record one block of input (audio thread)
+ * Returns false once the capture has ended
+ */
+static bool capture_block(formant_recorder_t* recorder, const float* input, int num_samples) {
     /* Check timeout */
     if (recorder->max_duration_us > 0) {
         uint64_t elapsed = formant_get_time_us() - recorder->start_time_us;
         if (elapsed >= recorder->max_duration_us) {
-            recorder->state = FORMANT_RECORDER_STOPPING;
-            return paComplete;
+            formant_recorder_state_t state = get_state(recorder);
+            if (state == FORMANT_RECORDER_WAITING_FOR_SPEECH || state == FORMANT_RECORDER_RECORDING) {
+                advance_state(recorder, state, FORMANT_RECORDER_STOPPING);
+            }
+            return false;
         }
     }
 
-    /* VAD mode */
+    /* VAD mode: the detector only takes whole frames */
     if (recorder->use_vad && recorder->vad) {
-        formant_vad_result_t vad_result = formant_vad_process_frame(
-            recorder->vad, input, frames_per_buffer);
-
-        switch (recorder->state) {
-            case FORMANT_RECORDER_WAITING_FOR_SPEECH:
-                if (vad_result == FORMANT_VAD_RESULT_SPEECH) {
-                    /* Speech detected! Transition to recording */
-                    recorder->state = FORMANT_RECORDER_RECORDING;
-
-                    /* Write pre-trigger buffer first */
-                    float pretrigger[8000];  /* Max 500ms @ 16kHz */
-                    int pretrigger_samples = formant_vad_get_pretrigger(
-                        recorder->vad, pretrigger, 8000);
-
-                    if (pretrigger_samples > 0) {
-                        write_samples_to_file(recorder, pretrigger, pretrigger_samples);
-                    }
-
-                    /* Write current frame */
-                    write_samples_to_file(recorder, input, frames_per_buffer);
-                }
-                /* Otherwise, keep waiting */
-                break;
-
-            case FORMANT_RECORDER_RECORDING:
-                if (vad_result == FORMANT_VAD_RESULT_SPEECH) {
-                    /* Continue recording */
-                    write_samples_to_file(recorder, input, frames_per_buffer);
-                } else {
-                    /* Silence detected - stop recording */
-                    recorder->state = FORMANT_RECORDER_STOPPING;
-                    return paComplete;
+        int frame_size = recorder->vad->frame_size;
+
+        while (num_samples > 0) {
+            int take = frame_size - recorder->vad_fill;
+            if (take > num_samples) {
+                take = num_samples;
+            }
+            memcpy(recorder->vad_frame + recorder->vad_fill, input, take * sizeof(float));
+            recorder->vad_fill += take;
+            input += take;
+            num_samples -= take;
+
+            if (recorder->vad_fill == frame_size) {
+                recorder->vad_fill = 0;
+                if (!capture_vad_frame(recorder, recorder->vad_frame, frame_size)) {
+                    return false;
                 }
-                break;
-
-            default:
-                return paComplete;
+            }
         }
 
-        return paContinue;
+        return true;
     }
 
     /* Fixed duration mode (original behavior) */
-    if (recorder->state != FORMANT_RECORDER_RECORDING) {
-        return paComplete;
+    if (get_state(recorder) != FORMANT_RECORDER_RECORDING) {
+        return false;
     }
 
     /* Calculate how many samples to record */
-    int samples_to_record = frames_per_buffer;
-    int samples_remaining = recorder->samples_target - recorder->samples_recorded;
+    int samples_to_record = num_samples;
+    int samples_remaining = recorder->samples_target - recorder->samples_captured;
 
     if (samples_to_record > samples_remaining) {
         samples_to_record = samples_remaining;
     }
 
-    /* Write samples */
-    write_samples_to_file(recorder, input, samples_to_record);
+    ring_push(recorder, input, samples_to_record);
+    recorder->samples_captured += samples_to_record;
 
     /* Check if we're done */
-    if (recorder->samples_recorded >= recorder->samples_target) {
-        recorder->state = FORMANT_RECORDER_STOPPING;
-        return paComplete;
+    if (recorder->samples_captured >= recorder->samples_target) {
+        advance_state(recorder, FORMANT_RECORDER_RECORDING, FORMANT_RECORDER_STOPPING);
+        return false;
     }
 
-    return paContinue;
+    return true;
+}
+
+static int recorder_callback(const void* input_buffer,
+                             void* output_buffer,
+                             unsigned long frames_per_buffer,
+                             const PaStreamCallbackTimeInfo* time_info,
+                             PaStreamCallbackFlags status_flags,
+                             void* user_data)
+{
+    (void)output_buffer;  /* Unused */
+    (void)time_info;
+    (void)status_flags;
+
+    formant_recorder_t* recorder = (formant_recorder_t*)user_data;
+    const float* input = (const float*)input_buffer;
+
+    return capture_block(recorder, input, (int)frames_per_buffer) ? paContinue : paComplete;
 }
 
 /* ============================================================================
- * Public API
+ * Capture Setup
  * ========================================================================= */
 
-formant_recorder_t* formant_recorder_create(float sample_rate) {
-    formant_recorder_t* recorder = calloc(1, sizeof(formant_recorder_t));
-    if (!recorder) {
-        return NULL;
+/**
+ * Stop the stream, let the writer finish the file and free per-capture state
+ * Safe on partially started captures.
+ */
+static void release_capture(formant_recorder_t* recorder) {
+    if (recorder->shared_input) {
+        /* No stream to stop: end the capture, then wait out a duplex
+         * callback that may already be inside formant_recorder_capture().
+         * Sequentially consistent, against the in_capture store there */
+        atomic_store(&recorder->state, FORMANT_RECORDER_STOPPING);
+        while (atomic_load(&recorder->in_capture)) {
+            sched_yield();
+        }
     }
 
-    recorder->sample_rate = sample_rate;
-    recorder->state = FORMANT_RECORDER_IDLE;
-    recorder->stream = NULL;
-    recorder->wav_file = NULL;
-    recorder->buffer_size = 512;  /* Same as output buffer */
-    recorder->vad = NULL;
-    recorder->use_vad = false;
-    recorder->max_duration_us = 0;
-
-    return recorder;
-}
-
-void formant_recorder_destroy(formant_recorder_t* recorder) {
-    if (!recorder) {
-        return;
+    if (recorder->stream) {
+        Pa_StopStream(recorder->stream);
+        Pa_CloseStream(recorder->stream);
+        recorder->stream = NULL;
     }
 
-    /* Stop recording if active */
-    if (recorder->state == FORMANT_RECORDER_RECORDING ||
-        recorder->state == FORMANT_RECORDER_WAITING_FOR_SPEECH) {
-        formant_recorder_stop(recorder);
+    if (recorder->writer_started) {
+        /* The stream is stopped, so the ring tail no longer moves */
+        atomic_store_explicit(&recorder->writer_stop, true, memory_order_release);
+        pthread_join(recorder->writer, NULL);
+        recorder->writer_started = false;
+    } else if (recorder->fd >= 0) {
+        close(recorder->fd);
+        recorder->fd = -1;
     }
 
-    /* Destroy VAD if exists */
     if (recorder->vad) {
         formant_vad_destroy(recorder->vad);
+        recorder->vad = NULL;
     }
+    free(recorder->pretrigger);
+    free(recorder->vad_frame);
+    recorder->pretrigger = NULL;
+    recorder->vad_frame = NULL;
+    recorder->vad_fill = 0;
 
-    /* Close stream if open */
-    if (recorder->stream) {
-        Pa_CloseStream(recorder->stream);
-    }
-
-    free(recorder);
+    recorder->use_vad = false;
+    set_state(recorder, FORMANT_RECORDER_IDLE);
 }
 
-int formant_recorder_start(formant_recorder_t* recorder, const char* filename, float duration_ms) {
-    if (!recorder || recorder->state != FORMANT_RECORDER_IDLE) {
-        return -1;
+/**
+ * Open the WAV file, reset the ring and start the writer thread
+ */
+static int open_capture(formant_recorder_t* recorder, const char* filename, int max_samples) {
+    /* A capture that ended by itself still has its thread and stream */
+    release_capture(recorder);
+
+    if (!recorder->ring) {
+        unsigned size = 1;
+        while (size < (unsigned)(recorder->sample_rate * FORMANT_RECORDER_RING_MS / 1000.0f)) {
+            size <<= 1;
+        }
+        recorder->ring = (float*)malloc(size * sizeof(float));
+        recorder->chunk = (int16_t*)aligned_alloc(FORMANT_RECORDER_CHUNK_BYTES, FORMANT_RECORDER_CHUNK_BYTES);
+        if (!recorder->ring || !recorder->chunk) {
+            fprintf(stderr, "ERROR: Failed to allocate recording buffers\n");
+            free(recorder->ring);
+            free(recorder->chunk);
+            recorder->ring = NULL;
+            recorder->chunk = NULL;
+            return -1;
+        }
+        recorder->ring_mask = size - 1;
     }
 
-    /* Calculate target samples */
-    recorder->samples_target = (int)(duration_ms * recorder->sample_rate / 1000.0f);
-    recorder->samples_recorded = 0;
+    recorder->samples_target = max_samples;
+    recorder->samples_captured = 0;
+    atomic_store(&recorder->samples_recorded, 0);
+    atomic_store(&recorder->ring_head, 0);
+    atomic_store(&recorder->ring_tail, 0);
+    atomic_store(&recorder->overruns, 0);
+    atomic_store(&recorder->writer_stop, false);
     strncpy(recorder->filename, filename, sizeof(recorder->filename) - 1);
 
     /* Open WAV file for writing */
-    recorder->wav_file = fopen(filename, "wb");
-    if (!recorder->wav_file) {
+    recorder->fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (recorder->fd < 0) {
         fprintf(stderr, "ERROR: Failed to open file for recording: %s\n", filename);
         return -1;
     }
 
     /* Write placeholder WAV header (will update later with actual sample count) */
-    if (write_wav_header(recorder->wav_file, (int)recorder->sample_rate, recorder->samples_target) != 0) {
+    if (write_wav_header(recorder->fd, (int)recorder->sample_rate, max_samples) != 0) {
         fprintf(stderr, "ERROR: Failed to write WAV header\n");
-        fclose(recorder->wav_file);
-        recorder->wav_file = NULL;
+        release_capture(recorder);
+        return -1;
+    }
+
+    /* Reserve the longest capture up front so extending the file does not
+     * allocate mid-recording; unsupported filesystems just skip this */
+    posix_fallocate(recorder->fd, 0, (off_t)sizeof(wav_header_t) + (off_t)max_samples * 2);
+
+    if (pthread_create(&recorder->writer, NULL, writer_main, recorder) != 0) {
+        fprintf(stderr, "ERROR: Failed to start recording writer thread\n");
+        release_capture(recorder);
         return -1;
     }
+    recorder->writer_started = true;
+
+    return 0;
+}
+
+/**
+ * Open and start the input stream in the given state
+ */
+static int open_stream(formant_recorder_t* recorder, int frames_per_buffer, formant_recorder_state_t state) {
+    if (recorder->shared_input) {
+        /* The duplex callback feeds formant_recorder_capture() */
+        recorder->start_time_us = formant_get_time_us();
+        set_state(recorder, state);
+        return 0;
+    }
 
-    /* Setup PortAudio input stream */
     PaStreamParameters input_params;
     input_params.device = Pa_GetDefaultInputDevice();
     if (input_params.device == paNoDevice) {
         fprintf(stderr, "ERROR: No default input device found\n");
-        fclose(recorder->wav_file);
-        recorder->wav_file = NULL;
         return -1;
     }
 
@@ -295,7 +526,7 @@ int formant_recorder_start(formant_recorder_t* recorder, const char* filename, f
         &input_params,
         NULL,  /* No output */
         recorder->sample_rate,
-        recorder->buffer_size,
+        frames_per_buffer,
         paClipOff,
         recorder_callback,
         recorder
@@ -303,25 +534,167 @@ int formant_recorder_start(formant_recorder_t* recorder, const char* filename, f
 
     if (err != paNoError) {
         fprintf(stderr, "ERROR: Failed to open input stream: %s\n", Pa_GetErrorText(err));
-        fclose(recorder->wav_file);
-        recorder->wav_file = NULL;
+        recorder->stream = NULL;
         return -1;
     }
 
-    /* Start stream */
+    /* The callback checks the state from its first buffer */
+    recorder->start_time_us = formant_get_time_us();
+    set_state(recorder, state);
+
     err = Pa_StartStream(recorder->stream);
     if (err != paNoError) {
         fprintf(stderr, "ERROR: Failed to start input stream: %s\n", Pa_GetErrorText(err));
-        Pa_CloseStream(recorder->stream);
-        recorder->stream = NULL;
-        fclose(recorder->wav_file);
-        recorder->wav_file = NULL;
         return -1;
     }
 
+    return 0;
+}
+
+/* ============================================================================
+ * Control Thread
+ * ========================================================================= */
+
+/**
+ * Service capture requests handed over by formant_recorder_request()
+ * The audio thread cannot signal a condition variable, so requests are
+ * polled like the writer polls its ring; a few milliseconds of start
+ * latency are below the stream latency anyway. Only destroy signals.
+ */
+static void* control_main(void* arg) {
+    formant_recorder_t* recorder = (formant_recorder_t*)arg;
+
+    pthread_mutex_lock(&recorder->control_lock);
+    while (!recorder->control_stop) {
+        if (!atomic_load_explicit(&recorder->request_pending, memory_order_acquire)) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += CONTROL_POLL_MS * 1000000L;
+            if (deadline.tv_nsec >= 1000000000L) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&recorder->control_cond, &recorder->control_lock, &deadline);
+            continue;
+        }
+        pthread_mutex_unlock(&recorder->control_lock);
+
+        /* Take the request, then free the slot for the next one */
+        char filename[sizeof(recorder->request.filename)];
+        memcpy(filename, recorder->request.filename, sizeof(filename));
+        float duration_ms = recorder->request.duration_ms;
+        bool use_vad = recorder->request.use_vad;
+        int vad_mode = recorder->request.vad_mode;
+        atomic_store_explicit(&recorder->request_pending, false, memory_order_release);
+
+        unsigned dropped = atomic_exchange_explicit(&recorder->requests_dropped, 0, memory_order_relaxed);
+        if (dropped > 0) {
+            fprintf(stderr, "WARNING: %u recording request(s) dropped while another was starting\n", dropped);
+        }
+
+        formant_recorder_state_t state = get_state(recorder);
+        if (state != FORMANT_RECORDER_IDLE || recorder->writer_started) {
+            if (state == FORMANT_RECORDER_RECORDING || state == FORMANT_RECORDER_WAITING_FOR_SPEECH) {
+                fprintf(stderr, "WARNING: Already recording, stopping previous recording\n");
+            }
+            formant_recorder_stop(recorder);
+        }
+
+        int result = use_vad ? formant_recorder_start_vad(recorder, filename, duration_ms, vad_mode)
+                             : formant_recorder_start(recorder, filename, duration_ms);
+        if (result != 0) {
+            fprintf(stderr, "ERROR: Failed to start %srecording\n", use_vad ? "VAD " : "");
+        }
+
+        pthread_mutex_lock(&recorder->control_lock);
+    }
+    pthread_mutex_unlock(&recorder->control_lock);
+
+    return NULL;
+}
+
+/* ============================================================================
+ * Public API
+ * ========================================================================= */
+
+formant_recorder_t* formant_recorder_create(float sample_rate) {
+    formant_recorder_t* recorder = (formant_recorder_t*)aligned_alloc(FORMANT_CACHE_LINE,
+                                                                       sizeof(formant_recorder_t));
+    if (!recorder) {
+        return NULL;
+    }
+    memset(recorder, 0, sizeof(formant_recorder_t));
+
+    recorder->sample_rate = sample_rate;
+    atomic_init(&recorder->state, FORMANT_RECORDER_IDLE);
+    recorder->stream = NULL;
+    recorder->fd = -1;
+    recorder->buffer_size = 512;  /* Same as output buffer */
+    recorder->vad = NULL;
     recorder->use_vad = false;
-    recorder->state = FORMANT_RECORDER_RECORDING;
-    recorder->start_time_us = formant_get_time_us();
+    recorder->max_duration_us = 0;
+    atomic_init(&recorder->ring_head, 0);
+    atomic_init(&recorder->ring_tail, 0);
+    atomic_init(&recorder->overruns, 0);
+    atomic_init(&recorder->writer_stop, false);
+    atomic_init(&recorder->samples_recorded, 0);
+    atomic_init(&recorder->in_capture, false);
+    atomic_init(&recorder->request_pending, false);
+    atomic_init(&recorder->requests_dropped, 0);
+    pthread_mutex_init(&recorder->control_lock, NULL);
+    pthread_cond_init(&recorder->control_cond, NULL);
+
+    if (pthread_create(&recorder->control, NULL, control_main, recorder) != 0) {
+        fprintf(stderr, "ERROR: Failed to start recorder control thread\n");
+        pthread_cond_destroy(&recorder->control_cond);
+        pthread_mutex_destroy(&recorder->control_lock);
+        free(recorder);
+        return NULL;
+    }
+    recorder->control_started = true;
+
+    return recorder;
+}
+
+void formant_recorder_destroy(formant_recorder_t* recorder) {
+    if (!recorder) {
+        return;
+    }
+
+    /* No more requests once the control thread is gone */
+    if (recorder->control_started) {
+        pthread_mutex_lock(&recorder->control_lock);
+        recorder->control_stop = true;
+        pthread_cond_signal(&recorder->control_cond);
+        pthread_mutex_unlock(&recorder->control_lock);
+        pthread_join(recorder->control, NULL);
+        pthread_cond_destroy(&recorder->control_cond);
+        pthread_mutex_destroy(&recorder->control_lock);
+    }
+
+    /* Stop recording if active and finish the file */
+    release_capture(recorder);
+
+    free(recorder->ring);
+    free(recorder->chunk);
+    free(recorder);
+}
+
+int formant_recorder_start(formant_recorder_t* recorder, const char* filename, float duration_ms) {
+    if (!recorder || get_state(recorder) != FORMANT_RECORDER_IDLE) {
+        return -1;
+    }
+
+    if (open_capture(recorder, filename, (int)(duration_ms * recorder->sample_rate / 1000.0f)) != 0) {
+        return -1;
+    }
+
+    recorder->max_duration_us = 0;
+    if (open_stream(recorder, recorder->buffer_size, FORMANT_RECORDER_RECORDING) != 0) {
+        release_capture(recorder);
+        return -1;
+    }
+
     fprintf(stderr, "🔴 Recording to: %s (%.1fs, %.0fHz)\n",
             filename, duration_ms / 1000.0f, recorder->sample_rate);
 
@@ -330,7 +703,7 @@ int formant_recorder_start(formant_recorder_t* recorder, const char* filename, f
 
 int formant_recorder_start_vad(formant_recorder_t* recorder, const char* filename,
                                 float max_duration_ms, int vad_mode) {
-    if (!recorder || recorder->state != FORMANT_RECORDER_IDLE) {
+    if (!recorder || get_state(recorder) != FORMANT_RECORDER_IDLE) {
         return -1;
     }
 
@@ -339,10 +712,22 @@ int formant_recorder_start_vad(formant_recorder_t* recorder, const char* filenam
         return -1;
     }
 
+    if (open_capture(recorder, filename, (int)(max_duration_ms * recorder->sample_rate / 1000.0f)) != 0) {
+        return -1;
+    }
+
     /* Create VAD */
     recorder->vad = formant_vad_create(recorder->sample_rate, vad_mode);
     if (!recorder->vad) {
         fprintf(stderr, "ERROR: Failed to create VAD\n");
+        release_capture(recorder);
+        return -1;
+    }
+
+    recorder->pretrigger = (float*)malloc(recorder->vad->pretrigger_size * sizeof(float));
+    recorder->vad_frame = (float*)malloc(recorder->vad->frame_size * sizeof(float));
+    if (!recorder->pretrigger || !recorder->vad_frame) {
+        release_capture(recorder);
         return -1;
     }
 
@@ -353,131 +738,78 @@ int formant_recorder_start_vad(formant_recorder_t* recorder, const char* filenam
     /* For now, use default calibration */
     recorder->vad->calibrated = true;  /* Will adapt during recording */
 
-    /* Setup recording */
-    recorder->samples_target = (int)(max_duration_ms * recorder->sample_rate / 1000.0f);
-    recorder->samples_recorded = 0;
+    /* One VAD frame per callback on our own stream (duplex input is regrouped) */
+    recorder->use_vad = true;
     recorder->max_duration_us = (uint64_t)(max_duration_ms * 1000.0f);
-    strncpy(recorder->filename, filename, sizeof(recorder->filename) - 1);
-
-    /* Open WAV file for writing */
-    recorder->wav_file = fopen(filename, "wb");
-    if (!recorder->wav_file) {
-        fprintf(stderr, "ERROR: Failed to open file for recording: %s\n", filename);
-        formant_vad_destroy(recorder->vad);
-        recorder->vad = NULL;
+    if (open_stream(recorder, recorder->vad->frame_size, FORMANT_RECORDER_WAITING_FOR_SPEECH) != 0) {
+        release_capture(recorder);
         return -1;
     }
 
-    /* Write placeholder WAV header (will update later with actual sample count) */
-    if (write_wav_header(recorder->wav_file, (int)recorder->sample_rate, recorder->samples_target) != 0) {
-        fprintf(stderr, "ERROR: Failed to write WAV header\n");
-        fclose(recorder->wav_file);
-        recorder->wav_file = NULL;
-        formant_vad_destroy(recorder->vad);
-        recorder->vad = NULL;
-        return -1;
-    }
+    fprintf(stderr, "🎤 Waiting for speech... (max %.1fs, mode %d, %.0fHz)\n",
+            max_duration_ms / 1000.0f, vad_mode, recorder->sample_rate);
 
-    /* Setup PortAudio input stream */
-    PaStreamParameters input_params;
-    input_params.device = Pa_GetDefaultInputDevice();
-    if (input_params.device == paNoDevice) {
-        fprintf(stderr, "ERROR: No default input device found\n");
-        fclose(recorder->wav_file);
-        recorder->wav_file = NULL;
-        formant_vad_destroy(recorder->vad);
-        recorder->vad = NULL;
+    return 0;
+}
+
+int formant_recorder_stop(formant_recorder_t* recorder) {
+    if (!recorder || !recorder->writer_started) {
         return -1;
     }
 
-    input_params.channelCount = 1;  /* Mono */
-    input_params.sampleFormat = paFloat32;
-    input_params.suggestedLatency = Pa_GetDeviceInfo(input_params.device)->defaultLowInputLatency;
-    input_params.hostApiSpecificStreamInfo = NULL;
-
-    /* Open stream */
-    PaError err = Pa_OpenStream(
-        &recorder->stream,
-        &input_params,
-        NULL,  /* No output */
-        recorder->sample_rate,
-        recorder->buffer_size,
-        paClipOff,
-        recorder_callback,
-        recorder
-    );
+    release_capture(recorder);
+    return 0;
+}
 
-    if (err != paNoError) {
-        fprintf(stderr, "ERROR: Failed to open input stream: %s\n", Pa_GetErrorText(err));
-        fclose(recorder->wav_file);
-        recorder->wav_file = NULL;
-        formant_vad_destroy(recorder->vad);
-        recorder->vad = NULL;
+int formant_recorder_request(formant_recorder_t* recorder, const char* filename,
+                             float duration_ms, bool use_vad, int vad_mode) {
+    if (!recorder || !filename) {
         return -1;
     }
 
-    /* Start stream */
-    err = Pa_StartStream(recorder->stream);
-    if (err != paNoError) {
-        fprintf(stderr, "ERROR: Failed to start input stream: %s\n", Pa_GetErrorText(err));
-        Pa_CloseStream(recorder->stream);
-        recorder->stream = NULL;
-        fclose(recorder->wav_file);
-        recorder->wav_file = NULL;
-        formant_vad_destroy(recorder->vad);
-        recorder->vad = NULL;
+    /* The control thread releases the slot only after copying it out */
+    if (atomic_load_explicit(&recorder->request_pending, memory_order_acquire)) {
+        atomic_fetch_add_explicit(&recorder->requests_dropped, 1, memory_order_relaxed);
         return -1;
     }
 
-    recorder->use_vad = true;
-    recorder->state = FORMANT_RECORDER_WAITING_FOR_SPEECH;
-    recorder->start_time_us = formant_get_time_us();
-
-    fprintf(stderr, "🎤 Waiting for speech... (max %.1fs, mode %d, %.0fHz)\n",
-            max_duration_ms / 1000.0f, vad_mode, recorder->sample_rate);
+    strncpy(recorder->request.filename, filename, sizeof(recorder->request.filename) - 1);
+    recorder->request.filename[sizeof(recorder->request.filename) - 1] = '\0';
+    recorder->request.duration_ms = duration_ms;
+    recorder->request.use_vad = use_vad;
+    recorder->request.vad_mode = vad_mode;
+    atomic_store_explicit(&recorder->request_pending, true, memory_order_release);
 
     return 0;
 }
 
-int formant_recorder_stop(formant_recorder_t* recorder) {
-    if (!recorder || recorder->state == FORMANT_RECORDER_IDLE) {
-        return -1;
-    }
-
-    /* Stop stream */
-    if (recorder->stream) {
-        Pa_StopStream(recorder->stream);
-        Pa_CloseStream(recorder->stream);
-        recorder->stream = NULL;
-    }
-
-    /* Update WAV header with actual sample count */
-    if (recorder->wav_file) {
-        update_wav_header(recorder->wav_file, recorder->samples_recorded);
-        fclose(recorder->wav_file);
-        recorder->wav_file = NULL;
+bool formant_recorder_capture(formant_recorder_t* recorder, const float* input, int num_samples) {
+    if (!recorder || !recorder->shared_input || !input) {
+        return false;
     }
 
-    recorder->state = FORMANT_RECORDER_IDLE;
+    /* Pairs with release_capture(): either it sees in_capture set, or
+     * this sees its STOPPING state and leaves the VAD alone */
+    atomic_store(&recorder->in_capture, true);
+    formant_recorder_state_t state = atomic_load(&recorder->state);
+    bool active = (state == FORMANT_RECORDER_WAITING_FOR_SPEECH || state == FORMANT_RECORDER_RECORDING) &&
+                  capture_block(recorder, input, num_samples);
+    atomic_store_explicit(&recorder->in_capture, false, memory_order_release);
 
-    fprintf(stderr, "✓ Recording complete: %s (%d samples, %.2fs)\n",
-            recorder->filename,
-            recorder->samples_recorded,
-            recorder->samples_recorded / recorder->sample_rate);
-
-    return 0;
+    return active;
 }
 
 bool formant_recorder_is_recording(formant_recorder_t* recorder) {
     if (!recorder) {
         return false;
     }
-    return recorder->state == FORMANT_RECORDER_RECORDING;
+    return get_state(recorder) == FORMANT_RECORDER_RECORDING;
 }
 
 float formant_recorder_get_progress(formant_recorder_t* recorder) {
     if (!recorder || recorder->samples_target == 0) {
         return 0.0f;
     }
-    return (float)recorder->samples_recorded / (float)recorder->samples_target;
+    return (float)atomic_load_explicit(&recorder->samples_recorded, memory_order_relaxed) /
+           (float)recorder->samples_target;
 }
@@ -0,0 +1,235 @@
+/**
+ * formant_render.c
+ *
+ * Output sinks for offline (faster than realtime) rendering.
+ * Writes engine output to WAV or raw 16-bit PCM without touching PortAudio.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "formant.h"
+
+/* ============================================================================
+ * WAV Header
+ * ========================================================================= */
+
+#define WAV_HEADER_SIZE 44
+
+/**
+ * Write 16-bit mono PCM WAV header
+ * Written field by field (little endian) so the layout does not depend on struct packing
+ */
+static int write_wav_header(FILE* file, int sample_rate, uint32_t num_samples) {
+    uint8_t header[WAV_HEADER_SIZE];
+    uint32_t data_bytes = num_samples * 2;
+    uint32_t byte_rate = (uint32_t)sample_rate * 2;
+
+    #define PUT16(off, v) do { header[(off)] = (uint8_t)(v); header[(off) + 1] = (uint8_t)((v) >> 8); } while (0)
+    #define PUT32(off, v) do { PUT16((off), (v) & 0xFFFF); PUT16((off) + 2, ((v) >> 16) & 0xFFFF); } while (0)
+
+    memcpy(&header[0], "RIFF", 4);
+    PUT32(4, 36 + data_bytes);
+    memcpy(&header[8], "WAVE", 4);
+    memcpy(&header[12], "fmt ", 4);
+    PUT32(16, 16);                  /* fmt chunk size */
+    PUT16(20, 1);                   /* PCM */
+    PUT16(22, 1);                   /* Mono */
+    PUT32(24, (uint32_t)sample_rate);
+    PUT32(28, byte_rate);
+    PUT16(32, 2);                   /* Block align */
+    PUT16(34, 16);                  /* Bits per sample */
+    memcpy(&header[36], "data", 4);
+    PUT32(40, data_bytes);
+
+    #undef PUT32
+    #undef PUT16
+
+    return fwrite(header, 1, WAV_HEADER_SIZE, file) == WAV_HEADER_SIZE ? 0 : -1;
+}
+
+static bool has_extension(const char* path, const char* ext) {
+    size_t path_len = strlen(path);
+    size_t ext_len = strlen(ext);
+    return path_len >= ext_len && strcmp(path + path_len - ext_len, ext) == 0;
+}
+
+/* ============================================================================
+ * Public API
+ * ========================================================================= */
+
+formant_sink_t* formant_sink_open(const char* path, float sample_rate) {
+    if (!path) {
+        return NULL;
+    }
+
+    formant_sink_t* sink = (formant_sink_t*)calloc(1, sizeof(formant_sink_t));
+    if (!sink) {
+        return NULL;
+    }
+
+    sink->sample_rate = (int)sample_rate;
+
+    if (strcmp(path, "-") == 0) {
+        sink->file = stdout;
+        sink->format = FORMANT_SINK_RAW;
+        sink->owns_file = false;
+    } else {
+        sink->format = (has_extension(path, ".raw") || has_extension(path, ".pcm"))
+                       ? FORMANT_SINK_RAW : FORMANT_SINK_WAV;
+        sink->file = fopen(path, "wb");
+        sink->owns_file = true;
+        if (!sink->file) {
+            fprintf(stderr, "ERROR: Failed to open render output: %s\n", path);
+            free(sink);
+            return NULL;
+        }
+    }
+
+    /* Placeholder header, patched with the real length on close */
+    if (sink->format == FORMANT_SINK_WAV && write_wav_header(sink->file, sink->sample_rate, 0) != 0) {
+        fprintf(stderr, "ERROR: Failed to write WAV header\n");
+        fclose(sink->file);
+        free(sink);
+        return NULL;
+    }
+
+    return sink;
+}
+
+int formant_sink_write(formant_sink_t* sink, const float* samples, int num_samples) {
+    if (!sink || !samples) {
+        return -1;
+    }
+
+    if (sink->loudness) {
+        formant_loudness_process(sink->loudness, samples, num_samples);
+    }
+
+    /* Convert in chunks so large renders never need a second full-size buffer */
+    int offset = 0;
+    while (offset < num_samples) {
+        int count = num_samples - offset;
+        if (count > FORMANT_SINK_CHUNK) {
+            count = FORMANT_SINK_CHUNK;
+        }
+
+        for (int i = 0; i < count; i++) {
+            float sample = formant_clamp(samples[offset + i], -1.0f, 1.0f);
+            sink->pcm[i] = (int16_t)(sample * 32767.0f);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            /* WAV and raw output are little endian, like the header */
+            sink->pcm[i] = (int16_t)__builtin_bswap16((uint16_t)sink->pcm[i]);
+#endif
+        }
+
+        if (fwrite(sink->pcm, sizeof(int16_t), count, sink->file) != (size_t)count) {
+            return -1;
+        }
+
+        offset += count;
+    }
+
+    sink->samples_written += num_samples;
+    return 0;
+}
+
+int formant_sink_close(formant_sink_t* sink) {
+    if (!sink) {
+        return -1;
+    }
+
+    int result = 0;
+
+    if (sink->format == FORMANT_SINK_WAV) {
+        /* Rewrite header with the final sample count */
+        if (fseek(sink->file, 0, SEEK_SET) != 0 ||
+            write_wav_header(sink->file, sink->sample_rate, (uint32_t)sink->samples_written) != 0) {
+            result = -1;
+        }
+    }
+
+    if (sink->owns_file) {
+        if (fclose(sink->file) != 0) {
+            result = -1;
+        }
+    } else {
+        fflush(sink->file);
+    }
+
+    formant_loudness_destroy(sink->loudness);
+    free(sink);
+    return result;
+}
+
+int formant_sink_measure_loudness(formant_sink_t* sink) {
+    if (!sink) {
+        return -1;
+    }
+    if (!sink->loudness) {
+        sink->loudness = formant_loudness_create((float)sink->sample_rate);
+    }
+    return sink->loudness ? 0 : -1;
+}
+
+int formant_render_pending(formant_engine_t* engine, formant_sink_t* sink,
+                           float* block, int block_size) {
+    if (!engine || !sink || !block || block_size <= 0) {
+        return -1;
+    }
+
+    while (!formant_engine_timeline_done(engine)) {
+        int count = block_size;
+
+        /* Once the ring is drained, stop exactly where the last phoneme ends */
+        if (formant_queue_space(engine) == FORMANT_MAX_COMMANDS &&
+            engine->timeline_cursor > engine->samples_processed &&
+            engine->timeline_cursor - engine->samples_processed < (uint64_t)block_size) {
+            count = (int)(engine->timeline_cursor - engine->samples_processed);
+        }
+
+        formant_engine_process(engine, block, count);
+        if (formant_sink_write(sink, block, count) != 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int formant_render_choir_pending(formant_choir_t* choir, formant_sink_t* sink,
+                                 float* block, int block_size) {
+    if (!choir || !sink || !block || block_size <= 0) {
+        return -1;
+    }
+
+    while (!formant_choir_timeline_done(choir)) {
+        int count = block_size;
+
+        /* Voices run in lockstep; stop where the longest timeline ends */
+        uint64_t remaining = 0;
+        bool drained = true;
+        for (int v = 0; v < choir->num_voices; v++) {
+            formant_engine_t* voice = choir->voices[v];
+            if (formant_queue_space(voice) != FORMANT_MAX_COMMANDS) {
+                drained = false;
+                break;
+            }
+            if (voice->timeline_cursor > voice->samples_processed &&
+                voice->timeline_cursor - voice->samples_processed > remaining) {
+                remaining = voice->timeline_cursor - voice->samples_processed;
+            }
+        }
+        if (drained && remaining > 0 && remaining < (uint64_t)block_size) {
+            count = (int)remaining;
+        }
+
+        formant_choir_process(choir, block, count);
+        if (formant_sink_write(sink, block, count) != 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,663 @@
+/**
+ * formant_server.c
+ *
+ * Multi-session synthesis daemon on a Unix socket.
+ * Every client connection is a session with its own engine and ECL stream.
+ * One render thread (the PortAudio callback, or a clock thread when the mix
+ * bus goes to a file) renders all sessions block by block; sessions land
+ * on the shared mix bus, in their own WAV file, or back on their socket as
+ * raw PCM. Socket and file I/O stay on the server thread.
+ *
+ * Session directives (before the first command):
+ *   OUTPUT MIX           Shared mix bus (default)
+ *   OUTPUT WAV <path>    Per-session WAV file
+ *   OUTPUT RAW           16-bit PCM written back on the connection
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "formant.h"
+
+#define SERVER_POLL_MS 5
+#define SESSION_RING_MASK (FORMANT_SESSION_RING - 1)
+
+static int session_state(const formant_session_t* session) {
+    return atomic_load_explicit(&session->state, memory_order_acquire);
+}
+
+static void set_session_state(formant_session_t* session, formant_session_state_t state) {
+    atomic_store_explicit(&session->state, (int)state, memory_order_release);
+}
+
+/* ============================================================================
+ * Render Thread
+ * ========================================================================= */
+
+/**
+ * Push a rendered block into the session's output ring
+ * Samples that do not fit are dropped and counted: a slow reader must not
+ * stall every other session.
+ */
+static void session_ring_push(formant_session_t* session, const float* samples, int count) {
+    unsigned write = atomic_load_explicit(&session->ring_write, memory_order_relaxed);
+    unsigned read = atomic_load_explicit(&session->ring_read, memory_order_acquire);
+    unsigned space = FORMANT_SESSION_RING - (write - read);
+
+    if ((unsigned)count > space) {
+        atomic_fetch_add_explicit(&session->ring_dropped, (unsigned)count - space, memory_order_relaxed);
+        count = (int)space;
+    }
+
+    for (int i = 0; i < count; i++) {
+        session->ring[(write + i) & SESSION_RING_MASK] = samples[i];
+    }
+    atomic_store_explicit(&session->ring_write, write + count, memory_order_release);
+}
+
+/**
+ * Render every live session into out (mix bus) or its ring
+ * Runs on the PortAudio callback or the clock thread.
+ */
+static void render_sessions(formant_server_t* server, float* out, int num_samples) {
+    memset(out, 0, num_samples * sizeof(float));
+
+    for (int s = 0; s < FORMANT_MAX_SESSIONS; s++) {
+        formant_session_t* session = &server->sessions[s];
+        int state = session_state(session);
+        if (state != FORMANT_SESSION_ACTIVE && state != FORMANT_SESSION_CLOSING) {
+            continue;
+        }
+
+        formant_engine_process(session->engine, server->scratch, num_samples);
+
+        if (session->output == FORMANT_SESSION_OUTPUT_MIX) {
+            for (int i = 0; i < num_samples; i++) {
+                out[i] += server->scratch[i];
+            }
+        } else {
+            session_ring_push(session, server->scratch, num_samples);
+        }
+
+        if (state == FORMANT_SESSION_CLOSING && formant_engine_timeline_done(session->engine)) {
+            set_session_state(session, FORMANT_SESSION_DRAINED);
+        }
+    }
+
+    for (int i = 0; i < num_samples; i++) {
+        out[i] = formant_clamp(out[i], -1.0f, 1.0f);
+    }
+}
+
+static int server_audio_callback(
+    const void* input_buffer,
+    void* output_buffer,
+    unsigned long frames_per_buffer,
+    const PaStreamCallbackTimeInfo* time_info,
+    PaStreamCallbackFlags status_flags,
+    void* user_data)
+{
+    formant_server_t* server = (formant_server_t*)user_data;
+    float* output = (float*)output_buffer;
+
+    (void)input_buffer;
+    (void)time_info;
+    (void)status_flags;
+
+    /* Scratch holds one buffer_size block; split anything larger */
+    unsigned long done = 0;
+    while (done < frames_per_buffer) {
+        int count = (int)(frames_per_buffer - done);
+        if (count > server->buffer_size) {
+            count = server->buffer_size;
+        }
+        render_sessions(server, output + done, count);
+        done += count;
+    }
+
+    return paContinue;
+}
+
+/**
+ * Clock thread for a file mix bus: renders one block per block period
+ * against an absolute deadline so the timeline tracks wall-clock time
+ */
+static void* clock_thread_main(void* arg) {
+    formant_server_t* server = (formant_server_t*)arg;
+    float* block = (float*)malloc(server->buffer_size * sizeof(float));
+    if (!block) {
+        fprintf(stderr, "ERROR: Failed to allocate mix block\n");
+        return NULL;
+    }
+
+    long period_ns = (long)(server->buffer_size * 1e9 / server->sample_rate);
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+    while (!atomic_load_explicit(&server->clock_stop, memory_order_relaxed)) {
+        render_sessions(server, block, server->buffer_size);
+        if (formant_sink_write(server->mix_sink, block, server->buffer_size) != 0) {
+            fprintf(stderr, "ERROR: Failed to write mix output\n");
+            break;
+        }
+
+        deadline.tv_nsec += period_ns;
+        while (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_nsec -= 1000000000L;
+            deadline.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL);
+    }
+
+    free(block);
+    return NULL;
+}
+
+/* ============================================================================
+ * Sessions (server thread)
+ * ========================================================================= */
+
+static formant_session_t* open_session(formant_server_t* server, int fd) {
+    for (int s = 0; s < FORMANT_MAX_SESSIONS; s++) {
+        formant_session_t* session = &server->sessions[s];
+        if (session_state(session) != FORMANT_SESSION_FREE) {
+            continue;
+        }
+
+        session->engine = formant_engine_create(server->sample_rate);
+        if (!session->engine) {
+            return NULL;
+        }
+        formant_bank_set_kernel(&session->engine->formant_bank, server->kernel);
+        formant_engine_set_control_rate(session->engine, server->control_rate);
+        formant_engine_set_seed(session->engine, server->seed);
+
+        session->id = server->next_id++;
+        session->fd = fd;
+        session->input_closed = false;
+        session->output = FORMANT_SESSION_OUTPUT_MIX;
+        session->sink = NULL;
+        session->line_len = 0;
+        session->pcm_len = 0;
+        session->pcm_sent = 0;
+        atomic_store_explicit(&session->ring_write, 0, memory_order_relaxed);
+        atomic_store_explicit(&session->ring_read, 0, memory_order_relaxed);
+        atomic_store_explicit(&session->ring_dropped, 0, memory_order_relaxed);
+        set_session_state(session, FORMANT_SESSION_SETUP);
+        return session;
+    }
+
+    return NULL;
+}
+
+/**
+ * Move buffered output to the session's sink or socket
+ * Returns false once a RAW client has gone away
+ */
+static bool flush_session_output(formant_session_t* session) {
+    unsigned write = atomic_load_explicit(&session->ring_write, memory_order_acquire);
+    unsigned read = atomic_load_explicit(&session->ring_read, memory_order_relaxed);
+
+    if (session->output == FORMANT_SESSION_OUTPUT_WAV) {
+        float chunk[FORMANT_SINK_CHUNK];
+        while (read != write) {
+            int count = 0;
+            while (read != write && count < FORMANT_SINK_CHUNK) {
+                chunk[count++] = session->ring[read++ & SESSION_RING_MASK];
+            }
+            if (session->sink && formant_sink_write(session->sink, chunk, count) != 0) {
+                fprintf(stderr, "ERROR: Session %d: failed to write WAV output\n", session->id);
+                formant_sink_close(session->sink);
+                session->sink = NULL;
+            }
+        }
+        atomic_store_explicit(&session->ring_read, read, memory_order_release);
+        return true;
+    }
+
+    if (session->output != FORMANT_SESSION_OUTPUT_RAW || session->fd < 0) {
+        atomic_store_explicit(&session->ring_read, write, memory_order_release);
+        return true;
+    }
+
+    for (;;) {
+        if (session->pcm_sent == session->pcm_len) {
+            int count = 0;
+            while (read != write && count < FORMANT_SINK_CHUNK) {
+                float sample = formant_clamp(session->ring[read++ & SESSION_RING_MASK], -1.0f, 1.0f);
+                session->pcm[count++] = (int16_t)(sample * 32767.0f);
+            }
+            atomic_store_explicit(&session->ring_read, read, memory_order_release);
+            if (count == 0) {
+                return true;
+            }
+            session->pcm_len = count * (int)sizeof(int16_t);
+            session->pcm_sent = 0;
+        }
+
+        ssize_t sent = send(session->fd, (const char*)session->pcm + session->pcm_sent,
+                            session->pcm_len - session->pcm_sent, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (sent < 0) {
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        }
+        session->pcm_sent += (int)sent;
+        if (session->pcm_sent < session->pcm_len) {
+            return true;   /* Socket buffer full; resume on POLLOUT */
+        }
+    }
+}
+
+static void close_session(formant_session_t* session) {
+    flush_session_output(session);
+
+    uint64_t dropped = atomic_load_explicit(&session->ring_dropped, memory_order_relaxed);
+    if (dropped > 0) {
+        fprintf(stderr, "WARNING: Session %d: dropped %llu output samples\n",
+                session->id, (unsigned long long)dropped);
+    }
+
+    if (session->sink && session->sink->loudness) {
+        char label[32];
+        snprintf(label, sizeof(label), "session %d", session->id);
+        formant_loudness_report(session->sink->loudness, label);
+    }
+    if (session->sink && formant_sink_close(session->sink) != 0) {
+        fprintf(stderr, "ERROR: Session %d: failed to finalize WAV output\n", session->id);
+    }
+    session->sink = NULL;
+
+    if (session->fd >= 0) {
+        close(session->fd);
+        session->fd = -1;
+    }
+
+    formant_engine_destroy(session->engine);
+    session->engine = NULL;
+
+    fprintf(stderr, "Session %d closed\n", session->id);
+    set_session_state(session, FORMANT_SESSION_FREE);
+}
+
+/**
+ * Stop taking input; the render thread plays out what is queued
+ */
+static void end_session_input(formant_session_t* session) {
+    session->input_closed = true;
+
+    if (session_state(session) == FORMANT_SESSION_SETUP) {
+        /* Nothing was ever queued */
+        set_session_state(session, FORMANT_SESSION_DRAINED);
+    } else {
+        set_session_state(session, FORMANT_SESSION_CLOSING);
+    }
+}
+
+/**
+ * Handle an OUTPUT directive; returns false if the line is not one
+ */
+static bool session_directive(formant_server_t* server, formant_session_t* session, const char* line) {
+    if (strncmp(line, "OUTPUT", 6) != 0 || (line[6] != ' ' && line[6] != '\t')) {
+        return false;
+    }
+
+    if (session_state(session) != FORMANT_SESSION_SETUP) {
+        fprintf(stderr, "ERROR: Session %d: OUTPUT must precede the first command\n", session->id);
+        return true;
+    }
+
+    char mode[8] = {0};
+    char path[256] = {0};
+    if (sscanf(line + 7, "%7s %255s", mode, path) < 1) {
+        fprintf(stderr, "ERROR: Session %d: OUTPUT needs MIX, WAV <path> or RAW\n", session->id);
+        return true;
+    }
+
+    if (session->sink) {
+        formant_sink_close(session->sink);
+        session->sink = NULL;
+    }
+
+    if (strcmp(mode, "MIX") == 0) {
+        session->output = FORMANT_SESSION_OUTPUT_MIX;
+    } else if (strcmp(mode, "RAW") == 0) {
+        session->output = FORMANT_SESSION_OUTPUT_RAW;
+    } else if (strcmp(mode, "WAV") == 0 && path[0] != '\0') {
+        session->sink = formant_sink_open(path, server->sample_rate);
+        if (session->sink && server->measure_loudness) {
+            formant_sink_measure_loudness(session->sink);
+        }
+        session->output = session->sink ? FORMANT_SESSION_OUTPUT_WAV : FORMANT_SESSION_OUTPUT_MIX;
+    } else {
+        fprintf(stderr, "ERROR: Session %d: OUTPUT needs MIX, WAV <path> or RAW\n", session->id);
+    }
+
+    return true;
+}
+
+/**
+ * Parse complete lines from the input buffer while the engine has room
+ * A full command ring leaves the rest buffered; the socket is not read
+ * again until the render thread frees a slot.
+ */
+static void process_session_lines(formant_server_t* server, formant_session_t* session) {
+    int start = 0;
+
+    while (!session->input_closed && formant_queue_space(session->engine) > 0) {
+        char* newline = memchr(session->line + start, '\n', session->line_len - start);
+        if (!newline) {
+            break;
+        }
+        *newline = '\0';
+        char* line = session->line + start;
+        start = (int)(newline - session->line) + 1;
+
+        if (line[0] == '\0' || line[0] == '#') {
+            continue;
+        }
+        if (session_directive(server, session, line)) {
+            continue;
+        }
+
+        formant_command_t* cmd = formant_parse_command(line);
+        if (!cmd) {
+            fprintf(stderr, "ERROR: Session %d: failed to parse command: %s\n", session->id, line);
+            continue;
+        }
+
+        if (cmd->type == FORMANT_CMD_STOP) {
+            free(cmd);
+            end_session_input(session);
+            break;
+        }
+
+        formant_queue_command(session->engine, cmd);
+        free(cmd);
+
+        /* Start rendering with the first command so WAV/RAW output does
+         * not begin with however long the client took to connect */
+        if (session_state(session) == FORMANT_SESSION_SETUP) {
+            set_session_state(session, FORMANT_SESSION_ACTIVE);
+        }
+    }
+
+    memmove(session->line, session->line + start, session->line_len - start);
+    session->line_len -= start;
+
+    if (session->line_len == FORMANT_SESSION_LINE && !memchr(session->line, '\n', session->line_len)) {
+        fprintf(stderr, "ERROR: Session %d: line too long, discarded\n", session->id);
+        session->line_len = 0;
+    }
+}
+
+static void read_session(formant_server_t* server, formant_session_t* session) {
+    ssize_t n = read(session->fd, session->line + session->line_len,
+                     FORMANT_SESSION_LINE - session->line_len);
+    if (n < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+            return;
+        }
+        n = 0;
+    }
+
+    if (n == 0) {
+        /* Final line without a newline still counts */
+        if (session->line_len > 0 && session->line_len < FORMANT_SESSION_LINE) {
+            session->line[session->line_len++] = '\n';
+            process_session_lines(server, session);
+        }
+        if (!session->input_closed) {
+            end_session_input(session);
+        }
+        return;
+    }
+
+    session->line_len += (int)n;
+    process_session_lines(server, session);
+}
+
+static void accept_clients(formant_server_t* server) {
+    for (;;) {
+        int fd = accept(server->listen_fd, NULL, NULL);
+        if (fd < 0) {
+            return;
+        }
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+        formant_session_t* session = open_session(server, fd);
+        if (!session) {
+            fprintf(stderr, "WARNING: Session limit (%d) reached, rejecting client\n", FORMANT_MAX_SESSIONS);
+            close(fd);
+            continue;
+        }
+        fprintf(stderr, "Session %d connected\n", session->id);
+    }
+}
+
+/* ============================================================================
+ * Public API
+ * ========================================================================= */
+
+formant_server_t* formant_server_create(const char* socket_path, float sample_rate, int buffer_size) {
+    struct sockaddr_un addr;
+
+    if (!socket_path || strlen(socket_path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "ERROR: Invalid socket path\n");
+        return NULL;
+    }
+
+    formant_server_t* server = (formant_server_t*)calloc(1, sizeof(formant_server_t));
+    if (!server) {
+        return NULL;
+    }
+
+    server->sample_rate = sample_rate;
+    server->buffer_size = buffer_size;
+    server->kernel = FORMANT_BANK_KERNEL_SIMD;
+    server->control_rate = FORMANT_CONTROL_RATE_DEFAULT;
+    server->seed = FORMANT_NOISE_SEED_DEFAULT;
+    server->audio.sample_rate = sample_rate;
+    server->audio.buffer_size = buffer_size;
+    server->listen_fd = -1;
+    atomic_init(&server->clock_stop, false);
+
+    for (int s = 0; s < FORMANT_MAX_SESSIONS; s++) {
+        formant_session_t* session = &server->sessions[s];
+        atomic_init(&session->state, FORMANT_SESSION_FREE);
+        atomic_init(&session->ring_write, 0);
+        atomic_init(&session->ring_read, 0);
+        atomic_init(&session->ring_dropped, 0);
+        session->fd = -1;
+        session->ring = (float*)malloc(FORMANT_SESSION_RING * sizeof(float));
+        if (!session->ring) {
+            formant_server_destroy(server);
+            return NULL;
+        }
+    }
+
+    server->scratch = (float*)malloc(buffer_size * sizeof(float));
+    if (!server->scratch) {
+        formant_server_destroy(server);
+        return NULL;
+    }
+
+    server->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server->listen_fd < 0) {
+        fprintf(stderr, "ERROR: Failed to create socket: %s\n", strerror(errno));
+        formant_server_destroy(server);
+        return NULL;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socket_path);
+    unlink(socket_path);
+
+    if (bind(server->listen_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+        listen(server->listen_fd, 16) != 0) {
+        fprintf(stderr, "ERROR: Failed to listen on %s: %s\n", socket_path, strerror(errno));
+        formant_server_destroy(server);
+        return NULL;
+    }
+    strcpy(server->socket_path, socket_path);
+    fcntl(server->listen_fd, F_SETFL, fcntl(server->listen_fd, F_GETFL) | O_NONBLOCK);
+
+    return server;
+}
+
+void formant_server_destroy(formant_server_t* server) {
+    if (!server) return;
+
+    /* Stop the render thread before touching sessions */
+    if (server->clock_running) {
+        atomic_store_explicit(&server->clock_stop, true, memory_order_relaxed);
+        pthread_join(server->clock_thread, NULL);
+        server->clock_running = false;
+    }
+    formant_audio_stop(&server->audio);
+
+    for (int s = 0; s < FORMANT_MAX_SESSIONS; s++) {
+        formant_session_t* session = &server->sessions[s];
+        if (session_state(session) != FORMANT_SESSION_FREE) {
+            close_session(session);
+        }
+        free(session->ring);
+    }
+
+    if (server->mix_sink) {
+        formant_sink_close(server->mix_sink);
+    }
+
+    if (server->listen_fd >= 0) {
+        close(server->listen_fd);
+        if (server->socket_path[0] != '\0') {
+            unlink(server->socket_path);
+        }
+    }
+
+    if (server->audio.pa_initialized) {
+        Pa_Terminate();
+    }
+
+    free(server->scratch);
+    free(server);
+}
+
+int formant_server_run(formant_server_t* server, const char* mix_path, volatile bool* running) {
+    if (!server || !running) return -1;
+
+    /* A client vanishing mid-send must not kill the daemon */
+    signal(SIGPIPE, SIG_IGN);
+
+    if (mix_path) {
+        server->mix_sink = formant_sink_open(mix_path, server->sample_rate);
+        if (!server->mix_sink) {
+            return -1;
+        }
+        if (server->measure_loudness) {
+            formant_sink_measure_loudness(server->mix_sink);
+        }
+        if (pthread_create(&server->clock_thread, NULL, clock_thread_main, server) != 0) {
+            fprintf(stderr, "ERROR: Failed to start mix clock thread\n");
+            return -1;
+        }
+        server->clock_running = true;
+    } else if (formant_audio_start(&server->audio, server->sample_rate,
+                                   server_audio_callback, server) != 0) {
+        return -1;
+    }
+
+    fprintf(stderr, "Formant server listening on %s (mix: %s)\n",
+            server->socket_path, mix_path ? mix_path : "audio device");
+
+    struct pollfd fds[FORMANT_MAX_SESSIONS + 1];
+    int owners[FORMANT_MAX_SESSIONS + 1];
+
+    while (*running) {
+        int nfds = 0;
+
+        fds[nfds].fd = server->listen_fd;
+        fds[nfds].events = POLLIN;
+        owners[nfds++] = -1;
+
+        for (int s = 0; s < FORMANT_MAX_SESSIONS; s++) {
+            formant_session_t* session = &server->sessions[s];
+            if (session_state(session) == FORMANT_SESSION_FREE || session->fd < 0) {
+                continue;
+            }
+
+            short events = 0;
+            if (!session->input_closed && session->line_len < FORMANT_SESSION_LINE &&
+                formant_queue_space(session->engine) > 0) {
+                events |= POLLIN;
+            }
+            if (session->output == FORMANT_SESSION_OUTPUT_RAW && session->pcm_sent < session->pcm_len) {
+                events |= POLLOUT;
+            }
+
+            fds[nfds].fd = session->fd;
+            fds[nfds].events = events;
+            owners[nfds++] = s;
+        }
+
+        /* Short timeout: output rings and stalled inputs are serviced on a tick */
+        if (poll(fds, nfds, SERVER_POLL_MS) < 0 && errno != EINTR) {
+            fprintf(stderr, "ERROR: poll failed: %s\n", strerror(errno));
+            return -1;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            accept_clients(server);
+        }
+
+        for (int i = 1; i < nfds; i++) {
+            formant_session_t* session = &server->sessions[owners[i]];
+            if (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+                if (!session->input_closed) {
+                    read_session(server, session);
+                } else if (fds[i].revents & (POLLHUP | POLLERR)) {
+                    close(session->fd);   /* RAW client gone */
+                    session->fd = -1;
+                }
+            }
+        }
+
+        for (int s = 0; s < FORMANT_MAX_SESSIONS; s++) {
+            formant_session_t* session = &server->sessions[s];
+            int state = session_state(session);
+            if (state == FORMANT_SESSION_FREE) {
+                continue;
+            }
+
+            /* Input left waiting on a full command ring */
+            if (!session->input_closed && session->line_len > 0) {
+                process_session_lines(server, session);
+            }
+
+            if (!flush_session_output(session) && session->fd >= 0) {
+                close(session->fd);
+                session->fd = -1;
+            }
+
+            /* RAW clients get every sample before the connection closes */
+            bool raw_pending = session->output == FORMANT_SESSION_OUTPUT_RAW && session->fd >= 0 &&
+                               (session->pcm_sent < session->pcm_len ||
+                                atomic_load_explicit(&session->ring_write, memory_order_acquire) !=
+                                atomic_load_explicit(&session->ring_read, memory_order_relaxed));
+            if (state == FORMANT_SESSION_DRAINED && !raw_pending) {
+                close_session(session);
+            }
+        }
+    }
+
+    return 0;
+}
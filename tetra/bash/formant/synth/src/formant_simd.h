@@ -0,0 +1,151 @@
+/**
+ * formant_simd.h
+ *
+ * Minimal float vector layer for the block kernels (internal header).
+ * Maps a handful of operations onto AVX, SSE or NEON, chosen at compile
+ * time from the target flags. FORMANT_SIMD_WIDTH is 0 when no vector unit
+ * is available; callers then use their scalar path.
+ */
+
+#ifndef FORMANT_SIMD_H
+#define FORMANT_SIMD_H
+
+#if defined(__AVX__)
+
+#include <immintrin.h>
+
+#define FORMANT_SIMD_WIDTH 8
+#define FORMANT_SIMD_ISA "avx"
+
+typedef __m256 fvec_t;
+
+#define fvec_load(p)      _mm256_load_ps(p)
+#define fvec_loadu(p)     _mm256_loadu_ps(p)
+#define fvec_store(p, v)  _mm256_store_ps((p), (v))
+#define fvec_set1(x)      _mm256_set1_ps(x)
+#define fvec_zero()       _mm256_setzero_ps()
+#define fvec_add(a, b)    _mm256_add_ps((a), (b))
+#define fvec_sub(a, b)    _mm256_sub_ps((a), (b))
+#define fvec_mul(a, b)    _mm256_mul_ps((a), (b))
+#define fvec_max(a, b)    _mm256_max_ps((a), (b))
+#define fvec_min(a, b)    _mm256_min_ps((a), (b))
+#define fvec_abs(v)       _mm256_andnot_ps(_mm256_set1_ps(-0.0f), (v))
+
+static inline float fvec_hsum(fvec_t v) {
+    __m128 lo = _mm256_castps256_ps128(v);
+    __m128 hi = _mm256_extractf128_ps(v, 1);
+    __m128 s = _mm_add_ps(lo, hi);
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 0x55));
+    return _mm_cvtss_f32(s);
+}
+
+static inline float fvec_hmax(fvec_t v) {
+    __m128 s = _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s = _mm_max_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_max_ss(s, _mm_shuffle_ps(s, s, 0x55));
+    return _mm_cvtss_f32(s);
+}
+
+static inline float fvec_hmin(fvec_t v) {
+    __m128 s = _mm_min_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s = _mm_min_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_min_ss(s, _mm_shuffle_ps(s, s, 0x55));
+    return _mm_cvtss_f32(s);
+}
+
+#elif defined(__SSE__) || defined(__x86_64__) || defined(_M_X64)
+
+#include <xmmintrin.h>
+
+#define FORMANT_SIMD_WIDTH 4
+#define FORMANT_SIMD_ISA "sse"
+
+typedef __m128 fvec_t;
+
+#define fvec_load(p)      _mm_load_ps(p)
+#define fvec_loadu(p)     _mm_loadu_ps(p)
+#define fvec_store(p, v)  _mm_store_ps((p), (v))
+#define fvec_set1(x)      _mm_set1_ps(x)
+#define fvec_zero()       _mm_setzero_ps()
+#define fvec_add(a, b)    _mm_add_ps((a), (b))
+#define fvec_sub(a, b)    _mm_sub_ps((a), (b))
+#define fvec_mul(a, b)    _mm_mul_ps((a), (b))
+#define fvec_max(a, b)    _mm_max_ps((a), (b))
+#define fvec_min(a, b)    _mm_min_ps((a), (b))
+#define fvec_abs(v)       _mm_andnot_ps(_mm_set1_ps(-0.0f), (v))
+
+static inline float fvec_hsum(fvec_t v) {
+    __m128 s = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 0x55));
+    return _mm_cvtss_f32(s);
+}
+
+static inline float fvec_hmax(fvec_t v) {
+    __m128 s = _mm_max_ps(v, _mm_movehl_ps(v, v));
+    s = _mm_max_ss(s, _mm_shuffle_ps(s, s, 0x55));
+    return _mm_cvtss_f32(s);
+}
+
+static inline float fvec_hmin(fvec_t v) {
+    __m128 s = _mm_min_ps(v, _mm_movehl_ps(v, v));
+    s = _mm_min_ss(s, _mm_shuffle_ps(s, s, 0x55));
+    return _mm_cvtss_f32(s);
+}
+
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+
+#include <arm_neon.h>
+
+#define FORMANT_SIMD_WIDTH 4
+#define FORMANT_SIMD_ISA "neon"
+
+typedef float32x4_t fvec_t;
+
+#define fvec_load(p)      vld1q_f32(p)
+#define fvec_loadu(p)     vld1q_f32(p)
+#define fvec_store(p, v)  vst1q_f32((p), (v))
+#define fvec_set1(x)      vdupq_n_f32(x)
+#define fvec_zero()       vdupq_n_f32(0.0f)
+#define fvec_add(a, b)    vaddq_f32((a), (b))
+#define fvec_sub(a, b)    vsubq_f32((a), (b))
+#define fvec_mul(a, b)    vmulq_f32((a), (b))
+#define fvec_max(a, b)    vmaxq_f32((a), (b))
+#define fvec_min(a, b)    vminq_f32((a), (b))
+#define fvec_abs(v)       vabsq_f32(v)
+
+static inline float fvec_hsum(fvec_t v) {
+#if defined(__aarch64__)
+    return vaddvq_f32(v);
+#else
+    float32x2_t s = vadd_f32(vget_low_f32(v), vget_high_f32(v));
+    return vget_lane_f32(vpadd_f32(s, s), 0);
+#endif
+}
+
+static inline float fvec_hmax(fvec_t v) {
+#if defined(__aarch64__)
+    return vmaxvq_f32(v);
+#else
+    float32x2_t s = vmax_f32(vget_low_f32(v), vget_high_f32(v));
+    return vget_lane_f32(vpmax_f32(s, s), 0);
+#endif
+}
+
+static inline float fvec_hmin(fvec_t v) {
+#if defined(__aarch64__)
+    return vminvq_f32(v);
+#else
+    float32x2_t s = vmin_f32(vget_low_f32(v), vget_high_f32(v));
+    return vget_lane_f32(vpmin_f32(s, s), 0);
+#endif
+}
+
+#else
+
+#define FORMANT_SIMD_WIDTH 0
+#define FORMANT_SIMD_ISA "none"
+
+#endif
+
+#endif /* FORMANT_SIMD_H */
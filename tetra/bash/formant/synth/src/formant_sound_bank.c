@@ -5,17 +5,28 @@
  * Organizes pre-recorded formant samples by phonetic feature hierarchy
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
 #include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
 #include "formant.h"
 
 /* ============================================================================
  * Phonetic Feature Encoding
  * ========================================================================= */
 
+/* Table symbols may fill all FORMANT_IPA_MAX_LEN bytes without a NUL ("rest") */
+static inline bool ipa_has(const formant_phoneme_config_t* phoneme, char c) {
+    return memchr(phoneme->ipa, c, strnlen(phoneme->ipa, FORMANT_IPA_MAX_LEN)) != NULL;
+}
+
 /**
  * Calculate feature vector for BST ordering
  *
@@ -68,11 +79,11 @@ uint8_t sound_bank_calc_feature_vector(const formant_phoneme_config_t* phoneme)
             /* Stop manner */
             features |= 0x00;
             /* Place encoded in bits [4-3] based on phoneme */
-            if (strstr(phoneme->ipa, "p") || strstr(phoneme->ipa, "b")) {
+            if (ipa_has(phoneme, 'p') || ipa_has(phoneme, 'b')) {
                 features |= 0x00;  /* Labial */
-            } else if (strstr(phoneme->ipa, "t") || strstr(phoneme->ipa, "d")) {
+            } else if (ipa_has(phoneme, 't') || ipa_has(phoneme, 'd')) {
                 features |= 0x08;  /* Alveolar */
-            } else if (strstr(phoneme->ipa, "k") || strstr(phoneme->ipa, "g")) {
+            } else if (ipa_has(phoneme, 'k') || ipa_has(phoneme, 'g')) {
                 features |= 0x10;  /* Velar */
             }
             break;
@@ -83,11 +94,11 @@ uint8_t sound_bank_calc_feature_vector(const formant_phoneme_config_t* phoneme)
             features |= 0x20;  /* Obstruent */
             features |= 0x02;  /* Fricative manner */
             /* Place based on IPA */
-            if (strstr(phoneme->ipa, "f") || strstr(phoneme->ipa, "v")) {
+            if (ipa_has(phoneme, 'f') || ipa_has(phoneme, 'v')) {
                 features |= 0x00;  /* Labial */
-            } else if (strstr(phoneme->ipa, "s") || strstr(phoneme->ipa, "z")) {
+            } else if (ipa_has(phoneme, 's') || ipa_has(phoneme, 'z')) {
                 features |= 0x08;  /* Alveolar */
-            } else if (strstr(phoneme->ipa, "h")) {
+            } else if (ipa_has(phoneme, 'h')) {
                 features |= 0x18;  /* Glottal */
             }
             break;
@@ -98,9 +109,9 @@ uint8_t sound_bank_calc_feature_vector(const formant_phoneme_config_t* phoneme)
             features |= 0x00;  /* Sonorant */
             features |= 0x04;  /* Nasal manner */
             /* Place */
-            if (strstr(phoneme->ipa, "m")) {
+            if (ipa_has(phoneme, 'm')) {
                 features |= 0x00;  /* Labial */
-            } else if (strstr(phoneme->ipa, "n")) {
+            } else if (ipa_has(phoneme, 'n')) {
                 features |= 0x08;  /* Alveolar */
             }
             break;
@@ -159,24 +170,32 @@ static void bst_insert_node(phoneme_bst_node_t** root, phoneme_bst_node_t* new_n
     }
 }
 
+/**
+ * Follow the feature-vector key down the tree; nodes with the key of the
+ * phoneme sought are the only ones compared by IPA (equal keys go right)
+ */
 static phoneme_bst_node_t* bst_find_node(phoneme_bst_node_t* root, const char* phoneme) {
     if (!root || !phoneme) {
         return NULL;
     }
 
-    /* Check if this node matches */
-    if (root->phoneme && strcmp(root->phoneme->ipa, phoneme) == 0) {
-        return root;
+    const formant_phoneme_config_t* config = formant_get_phoneme(phoneme);
+    if (!config) {
+        return NULL;
     }
+    uint8_t key = sound_bank_calc_feature_vector(config);
 
-    /* Search left subtree */
-    phoneme_bst_node_t* found = bst_find_node(root->left, phoneme);
-    if (found) {
-        return found;
+    for (phoneme_bst_node_t* node = root; node; ) {
+        if (key < node->feature_vector) {
+            node = node->left;
+            continue;
+        }
+        if (key == node->feature_vector && node->phoneme && strncmp(node->phoneme->ipa, phoneme, FORMANT_IPA_MAX_LEN) == 0) {
+            return node;
+        }
+        node = node->right;
     }
-
-    /* Search right subtree */
-    return bst_find_node(root->right, phoneme);
+    return NULL;
 }
 
 static void bst_destroy_tree(phoneme_bst_node_t* node) {
@@ -193,53 +212,210 @@ static void bst_destroy_tree(phoneme_bst_node_t* node) {
  * Grain Analysis
  * ========================================================================= */
 
+#define LOOP_MIN_LENGTH 1024
+#define LOOP_MIN_PITCH_HZ 80
+#define LOOP_MAX_PITCH_HZ 500
+#define LOOP_REFINE_RADIUS 2        /* Lags either side of the ACF peak checked by NCC */
+#define LOOP_OCTAVE_RATIO 0.9f      /* A sub-multiple this close in NCC is the real period */
+#define LOOP_BLOCK_RATIO 4          /* ACF transform size over the longest lag */
+
 /**
- * Find best loop points using autocorrelation
- * Simple implementation - finds pitch period and suggests loop points
+ * Make the plan fit a size-point transform; scratch only ever grows
+ */
+static int analyzer_reserve(sound_grain_analyzer_t* analyzer, int size) {
+    if (analyzer->fft_size == size) {
+        return 0;
+    }
+
+    formant_fft_destroy(analyzer->fft);
+    analyzer->fft = formant_fft_create(size);
+    analyzer->fft_size = 0;
+    if (!analyzer->fft) {
+        return -1;
+    }
+
+    if (size > analyzer->capacity) {
+        float** buffers[] = {
+            &analyzer->frame, &analyzer->block_re, &analyzer->block_im, &analyzer->lagged_re,
+            &analyzer->lagged_im, &analyzer->acf_re, &analyzer->acf_im
+        };
+        analyzer->capacity = 0;
+        for (size_t i = 0; i < sizeof(buffers) / sizeof(buffers[0]); i++) {
+            free(*buffers[i]);
+            *buffers[i] = (float*)malloc(size * sizeof(float));
+            if (!*buffers[i]) {
+                fprintf(stderr, "ERROR: Failed to allocate analysis buffers\n");
+                return -1;
+            }
+        }
+        analyzer->capacity = size;
+    }
+
+    analyzer->fft_size = size;
+    return 0;
+}
+
+/**
+ * Autocorrelation r[lag] = sum x[i] x[i + lag], lags below lag_limit, into
+ * analyzer->frame
+ *
+ * Wiener-Khinchin, partitioned: x is cut into blocks of size - lag_limit
+ * samples. Each block is correlated with itself plus the lag_limit samples
+ * that follow it, and the cross-spectra are summed, so one inverse
+ * transform gives the whole ACF. The zero padding keeps circular wrap off
+ * every lag we read, and small blocks keep the transforms in cache.
+ */
+static void partitioned_acf(sound_grain_analyzer_t* analyzer, const float* x, int len, int lag_limit) {
+    int size = analyzer->fft_size;
+    int bins = size / 2 + 1;
+    int block = size - lag_limit;
+    float* frame = analyzer->frame;
+
+    memset(analyzer->acf_re, 0, bins * sizeof(float));
+    memset(analyzer->acf_im, 0, bins * sizeof(float));
+
+    for (int offset = 0; offset < len; offset += block) {
+        int count = len - offset < block ? len - offset : block;
+        int lagged = len - offset < size ? len - offset : size;
+
+        memcpy(frame, x + offset, count * sizeof(float));
+        memset(frame + count, 0, (size - count) * sizeof(float));
+        formant_fft_forward(analyzer->fft, frame, analyzer->block_re, analyzer->block_im);
+
+        memcpy(frame, x + offset, lagged * sizeof(float));
+        memset(frame + lagged, 0, (size - lagged) * sizeof(float));
+        formant_fft_forward(analyzer->fft, frame, analyzer->lagged_re, analyzer->lagged_im);
+
+        /* acf += conj(B) L */
+        const float* br = analyzer->block_re;
+        const float* bi = analyzer->block_im;
+        const float* lr = analyzer->lagged_re;
+        const float* li = analyzer->lagged_im;
+        float* ar = analyzer->acf_re;
+        float* ai = analyzer->acf_im;
+        for (int k = 0; k < bins; k++) {
+            ar[k] += br[k] * lr[k] + bi[k] * li[k];
+            ai[k] += br[k] * li[k] - bi[k] * lr[k];
+        }
+    }
+
+    formant_fft_inverse(analyzer->fft, analyzer->acf_re, analyzer->acf_im, frame);
+}
+
+/**
+ * Normalized cross-correlation of x[0, len - lag) with x[lag, len)
+ */
+static float normalized_correlation(const float* x, int len, int lag) {
+    float cross = 0.0f, energy_a = 0.0f, energy_b = 0.0f;
+    for (int i = 0; i < len - lag; i++) {
+        cross += x[i] * x[i + lag];
+        energy_a += x[i] * x[i];
+        energy_b += x[i + lag] * x[i + lag];
+    }
+    float norm = sqrtf(energy_a * energy_b);
+    return norm > 0.0f ? cross / norm : 0.0f;
+}
+
+/**
+ * Best NCC lag within LOOP_REFINE_RADIUS of center, inside [min_lag, max_lag)
+ */
+static int refine_lag(const float* x, int len, int center, int min_lag, int max_lag, float* ncc_out) {
+    int best = center;
+    float best_ncc = -1.0f;
+    for (int lag = center - LOOP_REFINE_RADIUS; lag <= center + LOOP_REFINE_RADIUS; lag++) {
+        if (lag < min_lag || lag >= max_lag) continue;
+        float ncc = normalized_correlation(x, len, lag);
+        if (ncc > best_ncc) {
+            best_ncc = ncc;
+            best = lag;
+        }
+    }
+    *ncc_out = best_ncc;
+    return best;
+}
+
+/**
+ * Pitch period by autocorrelation of the middle third
+ *
+ * r[lag] / (len - lag) from partitioned_acf() matches the direct sum, so
+ * the peak is the one the direct search finds. Refinement then moves to
+ * the NCC peak nearby and to a sub-multiple period that correlates nearly
+ * as well, which catches octave errors.
  */
-static int find_loop_points(const float* audio, int length, int sample_rate,
-                            uint32_t* loop_start, uint32_t* loop_end) {
-    if (!audio || length < 1024) {
+static int estimate_period(sound_grain_analyzer_t* analyzer, const float* audio, int length,
+                           int sample_rate) {
+    const float* x = audio + length / 3;
+    int len = length / 3;
+    int min_period = sample_rate / LOOP_MAX_PITCH_HZ;
+    int max_period = sample_rate / LOOP_MIN_PITCH_HZ;
+    int lag_limit = max_period < len / 2 ? max_period : len / 2;
+
+    if (lag_limit <= min_period) {
+        return min_period;
+    }
+
+    /* Blocks of at least 3 * lag_limit samples; one block if x is shorter */
+    int size = 4;
+    while (size < LOOP_BLOCK_RATIO * lag_limit && size < len + lag_limit) {
+        size <<= 1;
+    }
+    if (analyzer_reserve(analyzer, size) != 0) {
         return -1;
     }
 
-    /* Estimate pitch period using autocorrelation on middle section */
-    int search_start = length / 3;
-    int search_len = length / 3;
-    int min_period = sample_rate / 500;  /* Min 500Hz */
-    int max_period = sample_rate / 80;   /* Max 80Hz */
+    partitioned_acf(analyzer, x, len, lag_limit);
+    const float* frame = analyzer->frame;
 
     float max_corr = 0.0f;
     int best_lag = min_period;
+    for (int lag = min_period; lag < lag_limit; lag++) {
+        float corr = frame[lag] / (len - lag);
+        if (corr > max_corr) {
+            max_corr = corr;
+            best_lag = lag;
+        }
+    }
 
-    for (int lag = min_period; lag < max_period && lag < search_len / 2; lag++) {
-        float corr = 0.0f;
-        int count = 0;
+    if (!analyzer->refine) {
+        return best_lag;
+    }
 
-        for (int i = search_start; i < search_start + search_len - lag; i++) {
-            corr += audio[i] * audio[i + lag];
-            count++;
-        }
+    float best_ncc;
+    best_lag = refine_lag(x, len, best_lag, min_period, lag_limit, &best_ncc);
+    for (int divisor = 3; divisor >= 2; divisor--) {
+        int candidate = (best_lag + divisor / 2) / divisor;
+        if (candidate - LOOP_REFINE_RADIUS < min_period) continue;
 
-        if (count > 0) {
-            corr /= count;
-            if (corr > max_corr) {
-                max_corr = corr;
-                best_lag = lag;
-            }
+        float ncc;
+        int lag = refine_lag(x, len, candidate, min_period, lag_limit, &ncc);
+        if (ncc >= LOOP_OCTAVE_RATIO * best_ncc) {
+            return lag;
         }
     }
+    return best_lag;
+}
 
-    /* Set loop points based on pitch period */
-    int midpoint = length / 2;
-    *loop_start = midpoint - best_lag;
-    *loop_end = midpoint + best_lag;
+/**
+ * Find best loop points using autocorrelation
+ * Loops one pitch period either side of the midpoint
+ */
+static int find_loop_points(sound_grain_analyzer_t* analyzer, const float* audio, int length,
+                            int sample_rate, uint32_t* loop_start, uint32_t* loop_end) {
+    if (!analyzer || !audio || length < LOOP_MIN_LENGTH) {
+        return -1;
+    }
 
-    /* Ensure within bounds */
-    if (*loop_start < 0) *loop_start = 0;
-    if (*loop_end >= (uint32_t)length) *loop_end = length - 1;
+    int period = estimate_period(analyzer, audio, length, sample_rate);
+    if (period < 0) {
+        return -1;
+    }
 
-    return 0;
+    /* The period is under length / 6, so both ends stay inside the grain */
+    int midpoint = length / 2;
+    *loop_start = (uint32_t)(midpoint - period);
+    *loop_end = (uint32_t)(midpoint + period);
+
+    return period;
 }
 
 /**
@@ -283,63 +459,37 @@ static int calculate_gain_map(const float* audio, int length, int num_chunks,
 }
 
 /**
- * Simple WAV file reader (mono, 16-bit PCM)
+ * Read a whole WAV file as mono float (any format formant_wav_open takes)
  */
 static int load_wav_file(const char* filename, float** audio_out, int* length_out, float* sample_rate_out) {
-    FILE* fp = fopen(filename, "rb");
-    if (!fp) {
-        fprintf(stderr, "ERROR: Failed to open WAV file: %s\n", filename);
+    formant_wav_reader_t* reader = formant_wav_open(filename);
+    if (!reader) {
         return -1;
     }
 
-    /* Read WAV header (simplified - assumes standard format) */
-    uint8_t header[44];
-    if (fread(header, 1, 44, fp) != 44) {
-        fprintf(stderr, "ERROR: Invalid WAV header\n");
-        fclose(fp);
+    if (reader->num_frames == 0 || reader->num_frames > INT32_MAX) {
+        fprintf(stderr, "ERROR: %s: no usable audio data\n", filename);
+        formant_wav_close(reader);
         return -1;
     }
 
-    /* Extract sample rate (bytes 24-27) */
-    uint32_t sample_rate = *(uint32_t*)&header[24];
-    *sample_rate_out = (float)sample_rate;
-
-    /* Extract data size (bytes 40-43) */
-    uint32_t data_size = *(uint32_t*)&header[40];
-    int num_samples = data_size / 2;  /* 16-bit = 2 bytes per sample */
-
-    /* Allocate audio buffer */
-    float* audio = (float*)malloc(num_samples * sizeof(float));
+    float* audio = (float*)malloc(reader->num_frames * sizeof(float));
     if (!audio) {
         fprintf(stderr, "ERROR: Failed to allocate audio buffer\n");
-        fclose(fp);
+        formant_wav_close(reader);
         return -1;
     }
 
-    /* Read and convert 16-bit PCM to float */
-    int16_t* pcm_buffer = (int16_t*)malloc(num_samples * sizeof(int16_t));
-    if (!pcm_buffer) {
-        free(audio);
-        fclose(fp);
-        return -1;
-    }
+    int num_samples = formant_wav_read(reader, audio, (int)reader->num_frames);
+    *sample_rate_out = (float)reader->sample_rate;
+    formant_wav_close(reader);
 
-    if (fread(pcm_buffer, sizeof(int16_t), num_samples, fp) != (size_t)num_samples) {
-        fprintf(stderr, "ERROR: Failed to read audio data\n");
+    if (num_samples <= 0) {
+        fprintf(stderr, "ERROR: Failed to read audio data: %s\n", filename);
         free(audio);
-        free(pcm_buffer);
-        fclose(fp);
         return -1;
     }
 
-    /* Convert to float (-1.0 to 1.0) */
-    for (int i = 0; i < num_samples; i++) {
-        audio[i] = pcm_buffer[i] / 32768.0f;
-    }
-
-    free(pcm_buffer);
-    fclose(fp);
-
     *audio_out = audio;
     *length_out = num_samples;
 
@@ -386,6 +536,11 @@ void sound_bank_destroy(sound_bank_t* bank) {
         free(bank->grains);
     }
 
+    /* Compiled bank: grains are views into the mapping */
+    if (bank->map) {
+        munmap((void*)bank->map, bank->map_size);
+    }
+
     free(bank);
 }
 
@@ -409,8 +564,61 @@ sound_grain_t* sound_bank_find_grain(sound_bank_t* bank, const char* phoneme) {
     return node ? node->grain : NULL;
 }
 
+sound_grain_analyzer_t* sound_grain_analyzer_create(void) {
+    sound_grain_analyzer_t* analyzer = (sound_grain_analyzer_t*)calloc(1, sizeof(sound_grain_analyzer_t));
+    if (!analyzer) {
+        return NULL;
+    }
+    analyzer->refine = true;
+    return analyzer;
+}
+
+void sound_grain_analyzer_destroy(sound_grain_analyzer_t* analyzer) {
+    if (!analyzer) return;
+
+    formant_fft_destroy(analyzer->fft);
+    free(analyzer->frame);
+    free(analyzer->block_re);
+    free(analyzer->block_im);
+    free(analyzer->lagged_re);
+    free(analyzer->lagged_im);
+    free(analyzer->acf_re);
+    free(analyzer->acf_im);
+    free(analyzer);
+}
+
+int sound_grain_find_loop_points(sound_grain_analyzer_t* analyzer, const float* audio, int length,
+                                 int sample_rate, uint32_t* loop_start, uint32_t* loop_end) {
+    if (!loop_start || !loop_end) {
+        return -1;
+    }
+    return find_loop_points(analyzer, audio, length, sample_rate, loop_start, loop_end);
+}
+
 int sound_bank_analyze_grain(const char* wav_file, sound_grain_t* grain) {
-    if (!wav_file || !grain) {
+    sound_grain_analyzer_t* analyzer = sound_grain_analyzer_create();
+    if (!analyzer) {
+        return -1;
+    }
+
+    int result = sound_grain_analyze(analyzer, wav_file, grain);
+    sound_grain_analyzer_destroy(analyzer);
+    if (result != 0) {
+        return result;
+    }
+
+    fprintf(stderr, "Analyzed grain: %s\n", wav_file);
+    fprintf(stderr, "  Length: %u samples (%.2fs)\n", grain->audio_length,
+            grain->audio_length / grain->sample_rate);
+    fprintf(stderr, "  Loop: %u - %u (%u samples)\n", grain->loop_start, grain->loop_end, grain->duration_samples);
+    fprintf(stderr, "  Peak: %.2f (gain: %.1fdB)\n", powf(10.0f, -grain->selection_gain / 20.0f),
+            grain->selection_gain);
+    fprintf(stderr, "  Gain map: %d chunks\n", grain->gain_map_chunks);
+    return 0;
+}
+
+int sound_grain_analyze(sound_grain_analyzer_t* analyzer, const char* wav_file, sound_grain_t* grain) {
+    if (!analyzer || !wav_file || !grain) {
         return -1;
     }
 
@@ -431,8 +639,8 @@ int sound_bank_analyze_grain(const char* wav_file, sound_grain_t* grain) {
     grain->midpoint_sample = length / 2;
 
     /* Find loop points */
-    find_loop_points(audio, length, (int)sample_rate,
-                    &grain->loop_start, &grain->loop_end);
+    find_loop_points(analyzer, audio, length, (int)sample_rate,
+                     &grain->loop_start, &grain->loop_end);
 
     /* Calculate grain duration (loop region) */
     grain->duration_samples = grain->loop_end - grain->loop_start;
@@ -463,15 +671,198 @@ int sound_bank_analyze_grain(const char* wav_file, sound_grain_t* grain) {
         grain->selection_gain = 0.0f;
     }
 
-    fprintf(stderr, "Analyzed grain: %s\n", wav_file);
-    fprintf(stderr, "  Length: %d samples (%.2fs)\n", length, length / sample_rate);
-    fprintf(stderr, "  Loop: %u - %u (%u samples)\n", grain->loop_start, grain->loop_end, grain->duration_samples);
-    fprintf(stderr, "  Peak: %.2f (gain: %.1fdB)\n", peak, grain->selection_gain);
-    fprintf(stderr, "  Gain map: %d chunks\n", grain->gain_map_chunks);
-
     return 0;
 }
 
+void sound_grain_calc_features(const sound_grain_t* grain, const char* ipa,
+                               float features[SOUND_GRAIN_FEATURES]) {
+    if (!grain || !features) {
+        return;
+    }
+
+    const float* audio = grain->audio_data;
+    int length = audio ? (int)grain->audio_length : 0;
+
+    double energy = 0.0;
+    int crossings = 0;
+    for (int i = 0; i < length; i++) {
+        energy += (double)audio[i] * audio[i];
+        if (i > 0) crossings += (audio[i] < 0.0f) != (audio[i - 1] < 0.0f);
+    }
+
+    /* The loop region spans two periods */
+    float rms = length > 0 ? (float)sqrt(energy / length) : 0.0f;
+    uint32_t period = grain->duration_samples / 2;
+
+    features[SOUND_GRAIN_FEATURE_PHONETIC] = sound_bank_calc_feature_vector(formant_get_phoneme(ipa));
+    features[SOUND_GRAIN_FEATURE_F0] = period > 0 ? grain->sample_rate / period : 0.0f;
+    features[SOUND_GRAIN_FEATURE_LEVEL] = rms > 1e-10f ? 20.0f * log10f(rms) : -200.0f;
+    features[SOUND_GRAIN_FEATURE_ZCR] = length > 1 ? (float)crossings / (length - 1) : 0.0f;
+}
+
+/* ============================================================================
+ * Parallel Ingestion
+ * ========================================================================= */
+
+typedef struct {
+    const char* const* wav_files;
+    sound_grain_t* grains;
+    int count;
+    atomic_int next;                     /* Next unclaimed file */
+    atomic_int analyzed;
+} analyze_job_t;
+
+/**
+ * Claim files until none are left. Each thread owns its analyzer, and
+ * each slot is written by exactly one thread, so nothing is shared but
+ * the counters
+ */
+static void* analyze_worker(void* arg) {
+    analyze_job_t* job = (analyze_job_t*)arg;
+
+    sound_grain_analyzer_t* analyzer = sound_grain_analyzer_create();
+    if (!analyzer) {
+        return NULL;
+    }
+
+    for (;;) {
+        int i = atomic_fetch_add_explicit(&job->next, 1, memory_order_relaxed);
+        if (i >= job->count) break;
+
+        sound_grain_t* grain = &job->grains[i];
+        if (sound_grain_analyze(analyzer, job->wav_files[i], grain) == 0) {
+            atomic_fetch_add_explicit(&job->analyzed, 1, memory_order_relaxed);
+        } else {
+            memset(grain, 0, sizeof(*grain));
+        }
+    }
+
+    sound_grain_analyzer_destroy(analyzer);
+    return NULL;
+}
+
+int sound_grain_analyze_batch(const char* const* wav_files, int count, sound_grain_t* grains,
+                              int num_threads) {
+    if (!wav_files || !grains || count < 0) {
+        return -1;
+    }
+    if (count == 0) {
+        return 0;
+    }
+
+    if (num_threads <= 0) {
+        long online_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        num_threads = online_cpus > 0 ? (int)online_cpus : 1;
+    }
+    if (num_threads > FORMANT_MAX_WORKERS) num_threads = FORMANT_MAX_WORKERS;
+    if (num_threads > count) num_threads = count;
+
+    analyze_job_t job = {
+        .wav_files = wav_files,
+        .grains = grains,
+        .count = count,
+    };
+    atomic_init(&job.next, 0);
+    atomic_init(&job.analyzed, 0);
+
+    /* Unclaimed slots must read as empty if the workers give up early */
+    memset(grains, 0, count * sizeof(sound_grain_t));
+
+    /* The caller is worker 0 */
+    pthread_t threads[FORMANT_MAX_WORKERS];
+    int started = 1;
+    for (; started < num_threads; started++) {
+        if (pthread_create(&threads[started], NULL, analyze_worker, &job) != 0) {
+            break;
+        }
+    }
+    analyze_worker(&job);
+    for (int t = 1; t < started; t++) {
+        pthread_join(threads[t], NULL);
+    }
+
+    /* Every worker failed to get an analyzer before claiming the lot;
+     * only claimed slots can hold buffers */
+    int claimed = atomic_load(&job.next);
+    if (claimed < count) {
+        fprintf(stderr, "ERROR: Out of memory analyzing grains\n");
+        for (int i = 0; i < claimed; i++) {
+            free(grains[i].gain_map);
+            free(grains[i].audio_data);
+        }
+        memset(grains, 0, count * sizeof(sound_grain_t));
+        return -1;
+    }
+
+    return atomic_load(&job.analyzed);
+}
+
+/**
+ * Point BST nodes at the grains array after it moved
+ */
+static void bst_rebase(phoneme_bst_node_t* node, uintptr_t old_base, sound_grain_t* new_base) {
+    for (; node; node = node->right) {
+        if (node->grain) {
+            node->grain = new_base + ((uintptr_t)node->grain - old_base) / sizeof(sound_grain_t);
+        }
+        bst_rebase(node->left, old_base, new_base);
+    }
+}
+
+int sound_bank_load_grains(sound_bank_t* bank, const char* const* phonemes,
+                           const char* const* wav_files, int count, int num_threads) {
+    if (!bank || !phonemes || !wav_files || count < 0 || bank->map) {
+        return -1;
+    }
+
+    /* Reserve every slot first: workers write straight into the array */
+    if (bank->num_grains + count > bank->capacity) {
+        int capacity = bank->num_grains + count;
+        uintptr_t old_base = (uintptr_t)bank->grains;
+        sound_grain_t* grains = (sound_grain_t*)realloc(bank->grains, capacity * sizeof(sound_grain_t));
+        if (!grains) {
+            fprintf(stderr, "ERROR: Failed to allocate %d grain slots\n", capacity);
+            return -1;
+        }
+        bst_rebase(bank->root, old_base, grains);
+        bank->grains = grains;
+        bank->capacity = capacity;
+    }
+
+    sound_grain_t* slots = bank->grains + bank->num_grains;
+    if (sound_grain_analyze_batch(wav_files, count, slots, num_threads) < 0) {
+        return -1;
+    }
+
+    /* Files that failed leave empty slots; close the gaps, keeping order */
+    int added = 0;
+    for (int i = 0; i < count; i++) {
+        if (!slots[i].audio_data) {
+            continue;
+        }
+
+        sound_grain_t* grain = &slots[added++];
+        if (grain != &slots[i]) {
+            *grain = slots[i];
+        }
+        memset(grain->phoneme, 0, sizeof(grain->phoneme));
+        strncpy(grain->phoneme, phonemes[i], sizeof(grain->phoneme) - 1);
+
+        const formant_phoneme_config_t* phoneme = formant_get_phoneme(grain->phoneme);
+        if (phoneme) {
+            sound_bank_bst_insert(bank, phoneme, grain);
+        } else {
+            fprintf(stderr, "Warning: Unknown phoneme '%s' for %s, not indexed\n",
+                    phonemes[i], wav_files[i]);
+        }
+    }
+
+    memset(slots + added, 0, (count - added) * sizeof(sound_grain_t));
+
+    bank->num_grains += added;
+    return added;
+}
+
 int sound_bank_export_grain_metadata(const sound_grain_t* grain, const char* filename) {
     if (!grain || !filename) {
         return -1;
@@ -523,7 +914,7 @@ void sound_bank_print_tree(phoneme_bst_node_t* node, int depth) {
     for (int i = 0; i < depth; i++) {
         fprintf(stderr, "    ");
     }
-    fprintf(stderr, "[%02X] %s\n", node->feature_vector,
+    fprintf(stderr, "[%02X] %.*s\n", node->feature_vector, FORMANT_IPA_MAX_LEN,
            node->phoneme ? node->phoneme->ipa : "?");
 
     /* Print left subtree (lower features) */
@@ -0,0 +1,408 @@
+/**
+ * formant_sound_bank_file.c
+ *
+ * Compiled sound banks. sound_bank_compile() analyzes every grain once, in
+ * parallel, and packs samples, loop points, gain maps and feature vectors into a single
+ * .fbank file; sound_bank_map() maps it read-only, so startup cost does not
+ * grow with the bank and every process using the bank shares its pages
+ * through the page cache.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "formant.h"
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "compiled sound banks are little endian; add byte swapping for this target"
+#endif
+
+_Static_assert(sizeof(sound_bank_header_t) == 64, "bank header must stay 64 bytes");
+_Static_assert(sizeof(sound_bank_entry_t) % 8 == 0, "bank entries must keep 8-byte alignment");
+_Static_assert(sizeof(((sound_grain_t*)0)->phoneme) <= SOUND_BANK_IPA_LEN, "IPA field too small");
+
+#define MANIFEST_LINE_MAX 1024
+#define COMPILE_BATCH 256           /* Grains decoded at once; bounds compiler memory */
+
+typedef struct {
+    char ipa[SOUND_BANK_IPA_LEN];
+    char path[MANIFEST_LINE_MAX];
+} manifest_item_t;
+
+/* ============================================================================
+ * Manifest
+ * ========================================================================= */
+
+/**
+ * Read "<ipa> <file.wav>" lines; relative paths resolve against the
+ * manifest's directory. Returns item count, or -1 on error
+ */
+static int read_manifest(const char* manifest_path, manifest_item_t** items_out) {
+    FILE* fp = fopen(manifest_path, "r");
+    if (!fp) {
+        fprintf(stderr, "ERROR: Failed to open manifest: %s\n", manifest_path);
+        return -1;
+    }
+
+    char dir[MANIFEST_LINE_MAX] = "";
+    const char* slash = strrchr(manifest_path, '/');
+    if (slash && (size_t)(slash - manifest_path) + 1 < sizeof(dir)) {
+        memcpy(dir, manifest_path, (size_t)(slash - manifest_path) + 1);
+        dir[slash - manifest_path + 1] = '\0';
+    }
+
+    manifest_item_t* items = NULL;
+    int count = 0, capacity = 0;
+    char line[MANIFEST_LINE_MAX];
+    int line_number = 0;
+
+    while (fgets(line, sizeof(line), fp)) {
+        line_number++;
+        char* hash = strchr(line, '#');
+        if (hash) *hash = '\0';
+
+        char ipa[MANIFEST_LINE_MAX], file[MANIFEST_LINE_MAX];
+        int fields = sscanf(line, "%1023s %1023s", ipa, file);
+        if (fields <= 0) {
+            continue;
+        }
+        if (fields != 2 || strlen(ipa) >= FORMANT_IPA_MAX_LEN) {
+            fprintf(stderr, "ERROR: %s:%d: expected \"<ipa> <file.wav>\"\n", manifest_path, line_number);
+            free(items);
+            fclose(fp);
+            return -1;
+        }
+
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            manifest_item_t* grown = (manifest_item_t*)realloc(items, capacity * sizeof(manifest_item_t));
+            if (!grown) {
+                fprintf(stderr, "ERROR: Out of memory\n");
+                free(items);
+                fclose(fp);
+                return -1;
+            }
+            items = grown;
+        }
+
+        manifest_item_t* item = &items[count++];
+        memset(item->ipa, 0, sizeof(item->ipa));
+        strcpy(item->ipa, ipa);
+        snprintf(item->path, sizeof(item->path), "%s%s", file[0] == '/' ? "" : dir, file);
+    }
+
+    fclose(fp);
+    *items_out = items;
+    return count;
+}
+
+/* ============================================================================
+ * Compiler
+ * ========================================================================= */
+
+static int compare_entries(const void* a, const void* b) {
+    const sound_bank_entry_t* x = (const sound_bank_entry_t*)a;
+    const sound_bank_entry_t* y = (const sound_bank_entry_t*)b;
+
+    int order = strncmp(x->phoneme, y->phoneme, SOUND_BANK_IPA_LEN);
+    if (order != 0) return order;
+
+    float fx = x->features[SOUND_GRAIN_FEATURE_F0];
+    float fy = y->features[SOUND_GRAIN_FEATURE_F0];
+    return (fx > fy) - (fx < fy);
+}
+
+/**
+ * Append one grain's samples at the next aligned offset
+ * *offset tracks the file position; *start receives where the run begins
+ */
+static int write_samples(FILE* fp, const sound_grain_t* grain, sound_bank_format_t format,
+                         uint64_t* offset, uint64_t* start) {
+    static const uint8_t zeros[SOUND_BANK_ALIGN] = {0};
+    uint64_t pad = (SOUND_BANK_ALIGN - (*offset % SOUND_BANK_ALIGN)) % SOUND_BANK_ALIGN;
+    if (pad && fwrite(zeros, 1, (size_t)pad, fp) != pad) {
+        return -1;
+    }
+    *offset += pad;
+
+    *start = *offset;
+    if (format == SOUND_BANK_FLOAT32) {
+        if (fwrite(grain->audio_data, sizeof(float), grain->audio_length, fp) != grain->audio_length) {
+            return -1;
+        }
+        *offset += (uint64_t)grain->audio_length * sizeof(float);
+    } else {
+        int16_t pcm[1024];
+        for (uint32_t done = 0; done < grain->audio_length; ) {
+            uint32_t count = grain->audio_length - done;
+            if (count > 1024) count = 1024;
+            for (uint32_t i = 0; i < count; i++) {
+                float x = grain->audio_data[done + i] * 32768.0f;
+                if (x > 32767.0f) x = 32767.0f;
+                if (x < -32768.0f) x = -32768.0f;
+                pcm[i] = (int16_t)lrintf(x);
+            }
+            if (fwrite(pcm, sizeof(int16_t), count, fp) != count) {
+                return -1;
+            }
+            done += count;
+        }
+        *offset += (uint64_t)grain->audio_length * sizeof(int16_t);
+    }
+
+    return 0;
+}
+
+int sound_bank_compile(const char* manifest_path, const char* output_path, sound_bank_format_t format,
+                       int num_threads) {
+    if (!manifest_path || !output_path ||
+        (format != SOUND_BANK_FLOAT32 && format != SOUND_BANK_INT16)) {
+        return -1;
+    }
+
+    manifest_item_t* items = NULL;
+    int count = read_manifest(manifest_path, &items);
+    if (count < 0) {
+        return -1;
+    }
+    if (count == 0) {
+        fprintf(stderr, "ERROR: %s: no grains listed\n", manifest_path);
+        free(items);
+        return -1;
+    }
+
+    sound_bank_entry_t* entries = (sound_bank_entry_t*)calloc(count, sizeof(sound_bank_entry_t));
+    sound_grain_t* grains = (sound_grain_t*)calloc(COMPILE_BATCH, sizeof(sound_grain_t));
+    const char* paths[COMPILE_BATCH];
+
+    /* Write beside the target and rename, so a failed compile never
+     * replaces a working bank and readers never map a half-written file */
+    char tmp_path[1024];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", output_path);
+    FILE* fp = entries && grains ? fopen(tmp_path, "wb") : NULL;
+    if (!fp) {
+        fprintf(stderr, "ERROR: Failed to create sound bank: %s\n", tmp_path);
+        free(grains);
+        free(entries);
+        free(items);
+        return -1;
+    }
+
+    /* Header and index are rewritten once the grains are in */
+    sound_bank_header_t header;
+    memset(&header, 0, sizeof(header));
+    uint64_t offset = sizeof(header) + (uint64_t)count * sizeof(sound_bank_entry_t);
+    int result = fseek(fp, (long)offset, SEEK_SET) == 0 ? 0 : -1;
+
+    /* Grains are analyzed a batch at a time in parallel, then written in
+     * manifest order by this thread */
+    for (int base = 0; base < count && result == 0; base += COMPILE_BATCH) {
+        int batch = count - base < COMPILE_BATCH ? count - base : COMPILE_BATCH;
+        for (int i = 0; i < batch; i++) {
+            paths[i] = items[base + i].path;
+        }
+        if (sound_grain_analyze_batch(paths, batch, grains, num_threads) != batch) {
+            result = -1;
+        }
+
+        for (int i = 0; i < batch; i++) {
+            sound_grain_t* grain = &grains[i];
+            sound_bank_entry_t* entry = &entries[base + i];
+
+            if (result == 0) {
+                memcpy(entry->phoneme, items[base + i].ipa, SOUND_BANK_IPA_LEN);
+                entry->audio_length = grain->audio_length;
+                entry->sample_rate = grain->sample_rate;
+                entry->midpoint_sample = grain->midpoint_sample;
+                entry->loop_start = grain->loop_start;
+                entry->loop_end = grain->loop_end;
+                entry->duration_samples = grain->duration_samples;
+                entry->selection_gain = grain->selection_gain;
+                entry->gain_map_chunks = grain->gain_map_chunks > SOUND_BANK_GAIN_CHUNKS ?
+                                         SOUND_BANK_GAIN_CHUNKS : grain->gain_map_chunks;
+                if (grain->gain_map) {
+                    memcpy(entry->gain_map, grain->gain_map, entry->gain_map_chunks * sizeof(float));
+                }
+                sound_grain_calc_features(grain, items[base + i].ipa, entry->features);
+                entry->feature_vector = (uint8_t)entry->features[SOUND_GRAIN_FEATURE_PHONETIC];
+
+                if (write_samples(fp, grain, format, &offset, &entry->sample_offset) != 0) {
+                    fprintf(stderr, "ERROR: Failed to write samples to %s\n", tmp_path);
+                    result = -1;
+                }
+            }
+
+            free(grain->gain_map);
+            free(grain->audio_data);
+            grain->gain_map = NULL;
+            grain->audio_data = NULL;
+        }
+    }
+
+    if (result == 0) {
+        qsort(entries, count, sizeof(sound_bank_entry_t), compare_entries);
+
+        memcpy(header.magic, SOUND_BANK_MAGIC, sizeof(header.magic));
+        header.version = SOUND_BANK_VERSION;
+        header.sample_format = (uint32_t)format;
+        header.num_grains = (uint32_t)count;
+        header.entry_size = sizeof(sound_bank_entry_t);
+        header.index_offset = sizeof(header);
+        header.file_size = offset;
+
+        if (fseek(fp, 0, SEEK_SET) != 0 ||
+            fwrite(&header, sizeof(header), 1, fp) != 1 ||
+            fwrite(entries, sizeof(sound_bank_entry_t), count, fp) != (size_t)count) {
+            fprintf(stderr, "ERROR: Failed to write index to %s\n", tmp_path);
+            result = -1;
+        }
+    }
+
+    if (fclose(fp) != 0) {
+        result = -1;
+    }
+    if (result == 0 && rename(tmp_path, output_path) != 0) {
+        fprintf(stderr, "ERROR: Failed to rename %s to %s\n", tmp_path, output_path);
+        result = -1;
+    }
+    if (result != 0) {
+        remove(tmp_path);
+    }
+
+    free(grains);
+    free(entries);
+    free(items);
+    return result == 0 ? count : -1;
+}
+
+/* ============================================================================
+ * Mapping
+ * ========================================================================= */
+
+sound_bank_t* sound_bank_map(const char* path) {
+    if (!path) return NULL;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "ERROR: Failed to open sound bank: %s\n", path);
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (uint64_t)st.st_size < sizeof(sound_bank_header_t)) {
+        fprintf(stderr, "ERROR: %s: not a sound bank\n", path);
+        close(fd);
+        return NULL;
+    }
+
+    size_t size = (size_t)st.st_size;
+    void* map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);   /* The mapping keeps the file referenced */
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "ERROR: Failed to map sound bank: %s\n", path);
+        return NULL;
+    }
+
+    const sound_bank_header_t* header = (const sound_bank_header_t*)map;
+    const char* problem = NULL;
+    if (memcmp(header->magic, SOUND_BANK_MAGIC, sizeof(header->magic)) != 0) {
+        problem = "not a sound bank";
+    } else if (header->version != SOUND_BANK_VERSION) {
+        problem = "unsupported version";
+    } else if (header->entry_size != sizeof(sound_bank_entry_t) ||
+               (header->sample_format != SOUND_BANK_FLOAT32 &&
+                header->sample_format != SOUND_BANK_INT16)) {
+        problem = "incompatible layout";
+    } else if (header->file_size != size) {
+        problem = "truncated";
+    } else if (header->index_offset % 8 != 0 || header->index_offset < sizeof(*header) ||
+               header->num_grains > (size - header->index_offset) / sizeof(sound_bank_entry_t) ||
+               header->num_grains > INT32_MAX) {
+        problem = "index out of bounds";
+    }
+
+    sound_bank_t* bank = problem ? NULL : (sound_bank_t*)calloc(1, sizeof(sound_bank_t));
+    if (!bank) {
+        fprintf(stderr, "ERROR: %s: %s\n", path, problem ? problem : "out of memory");
+        munmap(map, size);
+        return NULL;
+    }
+
+    strncpy(bank->bank_path, path, sizeof(bank->bank_path) - 1);
+    bank->map = (const uint8_t*)map;
+    bank->map_size = size;
+    bank->sample_format = (sound_bank_format_t)header->sample_format;
+    bank->entries = (const sound_bank_entry_t*)(bank->map + header->index_offset);
+    bank->num_entries = (int)header->num_grains;
+
+    return bank;
+}
+
+int sound_bank_find_entry(const sound_bank_t* bank, const char* phoneme) {
+    if (!bank || !bank->entries || !phoneme) return -1;
+
+    /* Lower bound, so the first of a phoneme's grains comes back */
+    int lo = 0, hi = bank->num_entries;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (strncmp(bank->entries[mid].phoneme, phoneme, SOUND_BANK_IPA_LEN) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    if (lo < bank->num_entries &&
+        strncmp(bank->entries[lo].phoneme, phoneme, SOUND_BANK_IPA_LEN) == 0) {
+        return lo;
+    }
+    return -1;
+}
+
+int sound_bank_mapped_grain(const sound_bank_t* bank, int index, sound_grain_t* grain) {
+    if (!bank || !bank->entries || !grain || index < 0 || index >= bank->num_entries) {
+        return -1;
+    }
+
+    /* The index is trusted only as far as these checks go */
+    const sound_bank_entry_t* entry = &bank->entries[index];
+    size_t sample_size = bank->sample_format == SOUND_BANK_INT16 ? sizeof(int16_t) : sizeof(float);
+    uint64_t bytes = (uint64_t)entry->audio_length * sample_size;
+    if (entry->sample_offset % SOUND_BANK_ALIGN != 0 ||
+        entry->sample_offset > bank->map_size || bytes > bank->map_size - entry->sample_offset ||
+        entry->gain_map_chunks > SOUND_BANK_GAIN_CHUNKS ||
+        entry->loop_end > entry->audio_length || entry->loop_start > entry->loop_end) {
+        fprintf(stderr, "ERROR: %s: corrupt entry %d\n", bank->bank_path, index);
+        return -1;
+    }
+
+    memset(grain, 0, sizeof(*grain));
+    memcpy(grain->phoneme, entry->phoneme, sizeof(grain->phoneme) - 1);
+    memcpy(grain->sample_file, bank->bank_path, sizeof(grain->sample_file) - 1);
+    grain->midpoint_sample = entry->midpoint_sample;
+    grain->loop_start = entry->loop_start;
+    grain->loop_end = entry->loop_end;
+    grain->duration_samples = entry->duration_samples;
+    grain->gain_map = entry->gain_map_chunks ? (float*)entry->gain_map : NULL;
+    grain->gain_map_chunks = entry->gain_map_chunks;
+    grain->selection_gain = entry->selection_gain;
+    grain->audio_length = entry->audio_length;
+    grain->sample_rate = entry->sample_rate;
+
+    const void* samples = bank->map + entry->sample_offset;
+    if (bank->sample_format == SOUND_BANK_INT16) {
+        grain->audio_pcm16 = (const int16_t*)samples;
+    } else {
+        grain->audio_data = (float*)samples;
+    }
+
+    return 0;
+}
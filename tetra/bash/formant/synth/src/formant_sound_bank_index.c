@@ -0,0 +1,467 @@
+/**
+ * formant_sound_bank_index.c
+ *
+ * Nearest-grain lookup. Each grain becomes a point in a small feature
+ * space (phoneme formants and voicing, pitch, level, brightness) stored
+ * column-wise. Small banks are scanned whole with vector loops: no
+ * branches per level and no pointer chasing. Past SOUND_GRAIN_INDEX_FLAT_MAX
+ * grains that cost would grow with the bank, so rows are kept grouped by
+ * phoneme and sorted by pitch (level for unvoiced phonemes, which queries
+ * never pitch), and a query only walks the rows near its target in the
+ * groups that can still beat what it has found.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include "formant.h"
+#include "formant_simd.h"
+
+#define INDEX_ROW_ALIGN (FORMANT_CACHE_LINE / (int)sizeof(float))
+#define INDEX_PAD_VALUE 1e6f        /* Padding rows sit far from any target */
+#define EXACT_DISTANCE 1e-6f        /* At or below: an exact match takes the whole mix */
+
+/* Default weights, per squared unit. One Bark of F1 or F2 costs as much
+ * as 6 semitones of pitch, and voicing class outweighs both, so the right
+ * phoneme wins unless its pitch is far off */
+#define WEIGHT_FORMANT 36.0f
+#define WEIGHT_VOICING 100.0f
+#define WEIGHT_PITCH 1.0f
+#define WEIGHT_LEVEL 0.1f
+#define WEIGHT_BRIGHTNESS 0.05f
+
+/* ============================================================================
+ * Feature Coordinates
+ * ========================================================================= */
+
+static float hz_to_bark(float hz) {
+    return 26.81f * hz / (1960.0f + hz) - 0.53f;
+}
+
+static float voicing_class(const formant_phoneme_config_t* phoneme) {
+    if (phoneme->type == FORMANT_PHONEME_VOWEL) return 0.0f;
+    return phoneme->voiced ? 1.0f : 2.0f;
+}
+
+static float hz_to_semitones(float hz) {
+    return hz > 0.0f ? 12.0f * log2f(hz / 100.0f) : 0.0f;
+}
+
+/**
+ * How each emotion shifts the grain wanted, at intensity 1.
+ * Follows the EM descriptions: happy and surprised brighter and higher,
+ * sad darker and quieter, angry louder and tense, fear breathy (noisier)
+ */
+static const struct {
+    float semitones;
+    float level_db;
+    float brightness;               /* Ratio */
+} EMOTION_SHIFT[] = {
+    [FORMANT_EMOTION_NEUTRAL]   = { 0.0f,  0.0f, 1.00f},
+    [FORMANT_EMOTION_HAPPY]     = { 2.0f,  2.0f, 1.15f},
+    [FORMANT_EMOTION_SAD]       = {-2.0f, -4.0f, 0.80f},
+    [FORMANT_EMOTION_ANGRY]     = { 1.0f,  6.0f, 1.30f},
+    [FORMANT_EMOTION_FEAR]      = { 3.0f, -2.0f, 1.40f},
+    [FORMANT_EMOTION_DISGUST]   = {-1.0f,  0.0f, 0.90f},
+    [FORMANT_EMOTION_SURPRISED] = { 4.0f,  3.0f, 1.10f},
+};
+
+/* ============================================================================
+ * Index
+ * ========================================================================= */
+
+/* One grain's coordinates while the index is built */
+typedef struct {
+    int phoneme;                    /* Phoneme ID: the group */
+    float pitch, level, brightness;
+    float key;                      /* Sort order within the group */
+    int grain;
+} index_row_t;
+
+/* The dimension a group is sorted on: the one its queries weigh most */
+static sound_grain_dim_t group_key(const formant_phoneme_config_t* phoneme) {
+    return voicing_class(phoneme) < 2.0f ? SOUND_GRAIN_DIM_PITCH : SOUND_GRAIN_DIM_LEVEL;
+}
+
+/* Group by phoneme, then ascending key; bank order breaks ties */
+static int compare_rows(const void* a, const void* b) {
+    const index_row_t* x = (const index_row_t*)a;
+    const index_row_t* y = (const index_row_t*)b;
+
+    if (x->phoneme != y->phoneme) return x->phoneme < y->phoneme ? -1 : 1;
+    if (x->key != y->key) return x->key < y->key ? -1 : 1;
+    return (x->grain > y->grain) - (x->grain < y->grain);
+}
+
+sound_grain_index_t* sound_grain_index_create(const sound_bank_t* bank) {
+    if (!bank) return NULL;
+
+    int total = bank->map ? bank->num_entries : bank->num_grains;
+    sound_grain_index_t* index = (sound_grain_index_t*)calloc(1, sizeof(sound_grain_index_t));
+    index_row_t* rows = (index_row_t*)malloc((size_t)(total > 0 ? total : 1) * sizeof(index_row_t));
+    if (!index || !rows) {
+        fprintf(stderr, "ERROR: Failed to allocate grain index\n");
+        free(index);
+        free(rows);
+        return NULL;
+    }
+
+    /* Whole cache lines per column keep every column vector-aligned */
+    index->stride = (total + INDEX_ROW_ALIGN - 1) / INDEX_ROW_ALIGN * INDEX_ROW_ALIGN;
+    if (index->stride == 0) index->stride = INDEX_ROW_ALIGN;
+
+    size_t column_bytes = (size_t)index->stride * sizeof(float);
+    float* columns = (float*)aligned_alloc(FORMANT_CACHE_LINE, column_bytes * SOUND_GRAIN_DIMS);
+    index->grain = (int32_t*)malloc((size_t)index->stride * sizeof(int32_t));
+    if (!columns || !index->grain) {
+        fprintf(stderr, "ERROR: Failed to allocate grain index\n");
+        free(columns);
+        free(index->grain);
+        free(index);
+        free(rows);
+        return NULL;
+    }
+    for (int d = 0; d < SOUND_GRAIN_DIMS; d++) {
+        index->dims[d] = columns + (size_t)d * index->stride;
+    }
+
+    int skipped = 0;
+    double level_sum = 0.0, brightness_sum = 0.0;
+    for (int i = 0; i < total; i++) {
+        char ipa[SOUND_BANK_IPA_LEN + 1];
+        float features[SOUND_GRAIN_FEATURES];
+
+        if (bank->map) {
+            const sound_bank_entry_t* entry = &bank->entries[i];
+            memcpy(ipa, entry->phoneme, SOUND_BANK_IPA_LEN);
+            ipa[SOUND_BANK_IPA_LEN] = '\0';
+            memcpy(features, entry->features, sizeof(features));
+        } else {
+            const sound_grain_t* grain = &bank->grains[i];
+            memcpy(ipa, grain->phoneme, sizeof(grain->phoneme));
+            ipa[sizeof(grain->phoneme)] = '\0';
+            sound_grain_calc_features(grain, ipa, features);
+        }
+
+        int id = formant_phoneme_id(ipa);
+        if (id < 0) {
+            skipped++;
+            continue;
+        }
+
+        index_row_t* row = &rows[index->count++];
+        row->phoneme = id;
+        row->pitch = hz_to_semitones(features[SOUND_GRAIN_FEATURE_F0]);
+        row->level = features[SOUND_GRAIN_FEATURE_LEVEL];
+        row->brightness = features[SOUND_GRAIN_FEATURE_ZCR] * 100.0f;
+        row->key = group_key(formant_phoneme_by_id(id)) == SOUND_GRAIN_DIM_PITCH ? row->pitch : row->level;
+        row->grain = i;
+
+        level_sum += row->level;
+        brightness_sum += row->brightness;
+    }
+
+    qsort(rows, index->count, sizeof(index_row_t), compare_rows);
+
+    for (int r = 0; r < index->count; r++) {
+        const formant_phoneme_config_t* phoneme = formant_phoneme_by_id(rows[r].phoneme);
+        float f1 = hz_to_bark(phoneme->f1);
+        float f2 = hz_to_bark(phoneme->f2);
+        float voicing = voicing_class(phoneme);
+
+        if (r == 0 || rows[r].phoneme != rows[r - 1].phoneme) {
+            sound_grain_group_t* group = &index->groups[index->num_groups++];
+            group->start = r;
+            group->f1 = f1;
+            group->f2 = f2;
+            group->voicing = voicing;
+            group->key = group_key(phoneme);
+        }
+        index->groups[index->num_groups - 1].end = r + 1;
+
+        index->dims[SOUND_GRAIN_DIM_F1][r] = f1;
+        index->dims[SOUND_GRAIN_DIM_F2][r] = f2;
+        index->dims[SOUND_GRAIN_DIM_VOICING][r] = voicing;
+        index->dims[SOUND_GRAIN_DIM_PITCH][r] = rows[r].pitch;
+        index->dims[SOUND_GRAIN_DIM_LEVEL][r] = rows[r].level;
+        index->dims[SOUND_GRAIN_DIM_BRIGHTNESS][r] = rows[r].brightness;
+        index->grain[r] = rows[r].grain;
+    }
+    free(rows);
+
+    for (int row = index->count; row < index->stride; row++) {
+        for (int d = 0; d < SOUND_GRAIN_DIMS; d++) {
+            index->dims[d][row] = INDEX_PAD_VALUE;
+        }
+        index->grain[row] = -1;
+    }
+
+    if (index->count > 0) {
+        index->neutral_level = (float)(level_sum / index->count);
+        index->neutral_brightness = (float)(brightness_sum / index->count);
+    }
+    if (skipped > 0) {
+        fprintf(stderr, "Warning: %d grains with unknown phonemes left out of the index\n", skipped);
+    }
+
+    return index;
+}
+
+void sound_grain_index_destroy(sound_grain_index_t* index) {
+    if (!index) return;
+
+    free(index->dims[0]);       /* One block holds every column */
+    free(index->grain);
+    free(index);
+}
+
+/* ============================================================================
+ * Queries
+ * ========================================================================= */
+
+int sound_grain_query_init(sound_grain_query_t* query, const sound_grain_index_t* index,
+                           const char* phoneme, float f0_hz) {
+    if (!query || !phoneme) return -1;
+
+    const formant_phoneme_config_t* config = formant_get_phoneme(phoneme);
+    if (!config) {
+        return -1;
+    }
+
+    float voicing = voicing_class(config);
+    bool pitched = f0_hz > 0.0f && voicing < 2.0f;
+
+    query->target[SOUND_GRAIN_DIM_F1] = hz_to_bark(config->f1);
+    query->target[SOUND_GRAIN_DIM_F2] = hz_to_bark(config->f2);
+    query->target[SOUND_GRAIN_DIM_VOICING] = voicing;
+    query->target[SOUND_GRAIN_DIM_PITCH] = pitched ? hz_to_semitones(f0_hz) : 0.0f;
+    query->target[SOUND_GRAIN_DIM_LEVEL] = index ? index->neutral_level : 0.0f;
+    query->target[SOUND_GRAIN_DIM_BRIGHTNESS] = index ? index->neutral_brightness : 0.0f;
+
+    query->weight[SOUND_GRAIN_DIM_F1] = WEIGHT_FORMANT;
+    query->weight[SOUND_GRAIN_DIM_F2] = WEIGHT_FORMANT;
+    query->weight[SOUND_GRAIN_DIM_VOICING] = WEIGHT_VOICING;
+    query->weight[SOUND_GRAIN_DIM_PITCH] = pitched ? WEIGHT_PITCH : 0.0f;
+
+    /* Level and brightness vary by phoneme and take; they only count once
+     * an emotion asks for something other than the usual */
+    query->weight[SOUND_GRAIN_DIM_LEVEL] = 0.0f;
+    query->weight[SOUND_GRAIN_DIM_BRIGHTNESS] = 0.0f;
+
+    return 0;
+}
+
+void sound_grain_query_emotion(sound_grain_query_t* query, formant_emotion_t emotion, float intensity) {
+    if (!query || (unsigned)emotion >= sizeof(EMOTION_SHIFT) / sizeof(EMOTION_SHIFT[0])) {
+        return;
+    }
+    if (intensity < 0.0f) intensity = 0.0f;
+    if (intensity > 1.0f) intensity = 1.0f;
+    if (emotion == FORMANT_EMOTION_NEUTRAL || intensity == 0.0f) {
+        return;
+    }
+
+    query->target[SOUND_GRAIN_DIM_PITCH] += EMOTION_SHIFT[emotion].semitones * intensity;
+    query->target[SOUND_GRAIN_DIM_LEVEL] += EMOTION_SHIFT[emotion].level_db * intensity;
+    query->target[SOUND_GRAIN_DIM_BRIGHTNESS] *= 1.0f + (EMOTION_SHIFT[emotion].brightness - 1.0f) * intensity;
+    query->weight[SOUND_GRAIN_DIM_LEVEL] = WEIGHT_LEVEL;
+    query->weight[SOUND_GRAIN_DIM_BRIGHTNESS] = WEIGHT_BRIGHTNESS;
+}
+
+/**
+ * Insert row into the sorted best-k list if it beats the worst kept
+ */
+static void keep_best(sound_grain_match_t* best, int* found, int k, int grain, float distance) {
+    int pos;
+    if (*found == k) {
+        if (distance >= best[k - 1].distance) return;
+        pos = k - 1;
+    } else {
+        pos = (*found)++;
+    }
+    while (pos > 0 && best[pos - 1].distance > distance) {
+        best[pos] = best[pos - 1];
+        pos--;
+    }
+    best[pos].grain = grain;
+    best[pos].distance = distance;
+}
+
+/**
+ * Score every row with vector loops (banks up to SOUND_GRAIN_INDEX_FLAT_MAX)
+ */
+static int scan_rows(const sound_grain_index_t* index, const sound_grain_query_t* query,
+                     sound_grain_match_t* matches, int k) {
+    int found = 0;
+    float worst = FLT_MAX;          /* Distance a row must beat to be kept */
+
+#if FORMANT_SIMD_WIDTH > 0
+    fvec_t target[SOUND_GRAIN_DIMS], weight[SOUND_GRAIN_DIMS];
+    for (int d = 0; d < SOUND_GRAIN_DIMS; d++) {
+        target[d] = fvec_set1(query->target[d]);
+        weight[d] = fvec_set1(query->weight[d]);
+    }
+
+    _Alignas(FORMANT_CACHE_LINE) float lanes[FORMANT_SIMD_WIDTH];
+    for (int row = 0; row < index->count; row += FORMANT_SIMD_WIDTH) {
+        fvec_t distance = fvec_zero();
+        for (int d = 0; d < SOUND_GRAIN_DIMS; d++) {
+            fvec_t diff = fvec_sub(fvec_load(index->dims[d] + row), target[d]);
+            distance = fvec_add(distance, fvec_mul(weight[d], fvec_mul(diff, diff)));
+        }
+
+        /* Most blocks hold nothing better than what is already kept */
+        if (fvec_hmin(distance) >= worst) {
+            continue;
+        }
+        fvec_store(lanes, distance);
+        for (int j = 0; j < FORMANT_SIMD_WIDTH && row + j < index->count; j++) {
+            if (lanes[j] < worst) {
+                keep_best(matches, &found, k, index->grain[row + j], lanes[j]);
+                if (found == k) worst = matches[k - 1].distance;
+            }
+        }
+    }
+#else
+    for (int row = 0; row < index->count; row++) {
+        float distance = 0.0f;
+        for (int d = 0; d < SOUND_GRAIN_DIMS; d++) {
+            float diff = index->dims[d][row] - query->target[d];
+            distance += query->weight[d] * diff * diff;
+        }
+        if (distance < worst) {
+            keep_best(matches, &found, k, index->grain[row], distance);
+            if (found == k) worst = matches[k - 1].distance;
+        }
+    }
+#endif
+
+    return found;
+}
+
+/**
+ * Walk phoneme groups closest first, and rows outward from the target on
+ * each group's key (pitch or level) within it (banks past
+ * SOUND_GRAIN_INDEX_FLAT_MAX)
+ * A group's F1/F2/voicing distance bounds all of its rows, and a row's key
+ * distance bounds every row further out on the same side, so the walk
+ * stops as soon as neither can beat the k-th best. Exact unless it runs
+ * out of its SOUND_GRAIN_INDEX_VISIT_MAX rows first: an emotion query
+ * without a pitch on a voiced phoneme, or hundreds of takes of one
+ * phoneme within a few semitones.
+ */
+static int search_groups(const sound_grain_index_t* index, const sound_grain_query_t* query,
+                         sound_grain_match_t* matches, int k) {
+    const float* target = query->target;
+    const float* weight = query->weight;
+    float bound[FORMANT_MAX_PHONEMES];
+    int order[FORMANT_MAX_PHONEMES];
+
+    /* Groups by ascending bound; there are at most a few dozen */
+    for (int g = 0; g < index->num_groups; g++) {
+        const sound_grain_group_t* group = &index->groups[g];
+        float d1 = group->f1 - target[SOUND_GRAIN_DIM_F1];
+        float d2 = group->f2 - target[SOUND_GRAIN_DIM_F2];
+        float dv = group->voicing - target[SOUND_GRAIN_DIM_VOICING];
+        float b = weight[SOUND_GRAIN_DIM_F1] * d1 * d1 + weight[SOUND_GRAIN_DIM_F2] * d2 * d2 +
+                  weight[SOUND_GRAIN_DIM_VOICING] * dv * dv;
+
+        int pos = g;
+        while (pos > 0 && bound[pos - 1] > b) {
+            bound[pos] = bound[pos - 1];
+            order[pos] = order[pos - 1];
+            pos--;
+        }
+        bound[pos] = b;
+        order[pos] = g;
+    }
+
+    int found = 0;
+    float worst = FLT_MAX;
+    int budget = SOUND_GRAIN_INDEX_VISIT_MAX;
+
+    for (int i = 0; i < index->num_groups && budget > 0 && bound[i] < worst; i++) {
+        const sound_grain_group_t* group = &index->groups[order[i]];
+        const float* key = index->dims[group->key];
+        float tk = target[group->key], wk = weight[group->key];
+
+        /* The row dimensions other than the key */
+        const float* rest[2];
+        float tr[2], wr[2];
+        for (int d = SOUND_GRAIN_DIM_PITCH, n = 0; d < SOUND_GRAIN_DIMS; d++) {
+            if (d == (int)group->key) continue;
+            rest[n] = index->dims[d];
+            tr[n] = target[d];
+            wr[n++] = weight[d];
+        }
+
+        /* First row at or above the target key */
+        int lo = group->start, hi = group->end;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (key[mid] < tk) lo = mid + 1;
+            else hi = mid;
+        }
+
+        int left = lo - 1, right = lo;
+        while (budget > 0) {
+            float dl = left >= group->start ? tk - key[left] : FLT_MAX;
+            float dr = right < group->end ? key[right] - tk : FLT_MAX;
+            int row;
+            float dk;
+            if (dl <= dr) {
+                if (left < group->start) break;     /* Both sides done */
+                row = left--;
+                dk = dl;
+            } else {
+                row = right++;
+                dk = dr;
+            }
+
+            float distance = bound[i] + wk * dk * dk;
+            if (distance >= worst) break;           /* Nothing further out is closer */
+            budget--;
+
+            float d0 = rest[0][row] - tr[0], d1 = rest[1][row] - tr[1];
+            distance += wr[0] * d0 * d0 + wr[1] * d1 * d1;
+            if (distance < worst) {
+                keep_best(matches, &found, k, index->grain[row], distance);
+                if (found == k) worst = matches[k - 1].distance;
+            }
+        }
+    }
+
+    return found;
+}
+
+int sound_grain_index_nearest(const sound_grain_index_t* index, const sound_grain_query_t* query,
+                              sound_grain_match_t* matches, int k) {
+    if (!index || !query || !matches || k <= 0) return 0;
+    if (k > SOUND_GRAIN_MATCHES_MAX) k = SOUND_GRAIN_MATCHES_MAX;
+
+    int found = index->count <= SOUND_GRAIN_INDEX_FLAT_MAX ? scan_rows(index, query, matches, k)
+                                                           : search_groups(index, query, matches, k);
+    if (found == 0) {
+        return 0;
+    }
+
+    /* Inverse-distance mix, so a caller can crossfade neighbours */
+    if (matches[0].distance <= EXACT_DISTANCE) {
+        for (int i = 0; i < found; i++) {
+            matches[i].mix = i == 0 ? 1.0f : 0.0f;
+        }
+    } else {
+        float total = 0.0f;
+        for (int i = 0; i < found; i++) {
+            matches[i].mix = 1.0f / matches[i].distance;
+            total += matches[i].mix;
+        }
+        for (int i = 0; i < found; i++) {
+            matches[i].mix /= total;
+        }
+    }
+
+    return found;
+}
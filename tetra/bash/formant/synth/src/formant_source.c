@@ -2,20 +2,20 @@
  * formant_source.c
  *
  * Source signal generators for vocal synthesis.
- * Implements glottal pulse (LF model) and noise sources.
+ * Implements glottal pulse (LF model), its band-limited wavetables and
+ * noise sources.
  */
 
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
 #include "formant.h"
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 
-/* Random number generator state */
-static unsigned long rng_state = 1;
-
 float formant_generate_glottal(float phase, float oq, float alpha) {
     /* Simplified Liljencrants-Fant (LF) glottal pulse model
      *
@@ -52,47 +52,208 @@ float formant_generate_glottal(float phase, float oq, float alpha) {
     }
 }
 
-float formant_generate_white_noise(void) {
-    /* Simple LCG (Linear Congruential Generator) */
-    rng_state = rng_state * 1103515245 + 12345;
-    return ((float)(rng_state & 0x7FFFFFFF) / (float)0x7FFFFFFF) * 2.0f - 1.0f;
+/* ============================================================================
+ * Glottal Wavetables
+ * ========================================================================= */
+
+#define GLOTTAL_OQ_MIN 0.30f
+#define GLOTTAL_OQ_STEP 0.05f
+#define GLOTTAL_OQ_COUNT 9          /* 0.30 - 0.70 */
+#define GLOTTAL_ALPHA_MIN 0.5f
+#define GLOTTAL_ALPHA_STEP 0.1f
+#define GLOTTAL_ALPHA_COUNT 6       /* 0.5 - 1.0 */
+
+#define GLOTTAL_BINS (FORMANT_GLOTTAL_TABLE_SIZE / 2 + 1)
+
+static float g_glottal_tables[GLOTTAL_OQ_COUNT][GLOTTAL_ALPHA_COUNT]
+                             [FORMANT_GLOTTAL_MIPS][FORMANT_GLOTTAL_TABLE_SIZE + 1];
+static pthread_once_t g_glottal_once = PTHREAD_ONCE_INIT;
+static int g_glottal_status = -1;
+
+static void build_glottal_tables(void) {
+    formant_fft_t* fft = formant_fft_create(FORMANT_GLOTTAL_TABLE_SIZE);
+    if (!fft) {
+        return;
+    }
+
+    float spectrum_re[GLOTTAL_BINS], spectrum_im[GLOTTAL_BINS];
+    float band_re[GLOTTAL_BINS], band_im[GLOTTAL_BINS];
+
+    for (int o = 0; o < GLOTTAL_OQ_COUNT; o++) {
+        for (int a = 0; a < GLOTTAL_ALPHA_COUNT; a++) {
+            float oq = GLOTTAL_OQ_MIN + o * GLOTTAL_OQ_STEP;
+            float alpha = GLOTTAL_ALPHA_MIN + a * GLOTTAL_ALPHA_STEP;
+            float (*levels)[FORMANT_GLOTTAL_TABLE_SIZE + 1] = g_glottal_tables[o][a];
+
+            /* Level 0: the analytic model sampled directly */
+            for (int n = 0; n < FORMANT_GLOTTAL_TABLE_SIZE; n++) {
+                levels[0][n] = formant_generate_glottal((float)n / FORMANT_GLOTTAL_TABLE_SIZE, oq, alpha);
+            }
+            levels[0][FORMANT_GLOTTAL_TABLE_SIZE] = levels[0][0];
+
+            formant_fft_forward(fft, levels[0], spectrum_re, spectrum_im);
+
+            /* Higher levels: truncate the harmonic series */
+            for (int level = 1; level < FORMANT_GLOTTAL_MIPS; level++) {
+                int harmonics = (FORMANT_GLOTTAL_TABLE_SIZE / 2) >> level;
+                for (int k = 0; k < GLOTTAL_BINS; k++) {
+                    band_re[k] = k <= harmonics ? spectrum_re[k] : 0.0f;
+                    band_im[k] = k <= harmonics ? spectrum_im[k] : 0.0f;
+                }
+                formant_fft_inverse(fft, band_re, band_im, levels[level]);
+                levels[level][FORMANT_GLOTTAL_TABLE_SIZE] = levels[level][0];
+            }
+        }
+    }
+
+    formant_fft_destroy(fft);
+    g_glottal_status = 0;
+}
+
+int formant_glottal_tables_init(void) {
+    pthread_once(&g_glottal_once, build_glottal_tables);
+    return g_glottal_status;
 }
 
-float formant_generate_aspiration(float intensity) {
-    /* Aspiration is low-pass filtered white noise */
-    static float prev = 0.0f;
-    float noise = formant_generate_white_noise();
+static int grid_index(float value, float min, float step, int count) {
+    int i = (int)lroundf((value - min) / step);
+    if (i < 0) return 0;
+    if (i >= count) return count - 1;
+    return i;
+}
+
+const float* formant_glottal_table(float oq, float alpha, float f0_hz, float sample_rate) {
+    int o = grid_index(oq, GLOTTAL_OQ_MIN, GLOTTAL_OQ_STEP, GLOTTAL_OQ_COUNT);
+    int a = grid_index(alpha, GLOTTAL_ALPHA_MIN, GLOTTAL_ALPHA_STEP, GLOTTAL_ALPHA_COUNT);
+
+    /* Least band-limited level whose top harmonic fits below Nyquist */
+    int level = 0;
+    if (f0_hz > 1.0f) {
+        float max_harmonic = 0.5f * sample_rate / f0_hz;
+        while (level < FORMANT_GLOTTAL_MIPS - 1 &&
+               (float)((FORMANT_GLOTTAL_TABLE_SIZE / 2) >> level) > max_harmonic) {
+            level++;
+        }
+    }
+
+    return g_glottal_tables[o][a][level];
+}
+
+/* ============================================================================
+ * Noise Sources
+ * ========================================================================= */
+
+/* Per-lane seed expansion (splitmix64), so nearby seeds give unrelated lanes */
+static uint64_t splitmix64(uint64_t* x) {
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+void formant_noise_init(formant_noise_t* noise, uint64_t seed) {
+    if (!noise) return;
 
+    memset(noise, 0, sizeof(formant_noise_t));
+
+    uint64_t x = seed;
+    for (int lane = 0; lane < FORMANT_NOISE_LANES; lane++) {
+        uint32_t state = (uint32_t)splitmix64(&x);
+        noise->state[lane] = state ? state : 0x9E3779B9u;   /* xorshift must not be 0 */
+    }
+
+    /* Empty buffer: first draw refills */
+    noise->pos = FORMANT_NOISE_BLOCK;
+}
+
+void formant_noise_fill(formant_noise_t* noise, float* output, int num_samples) {
+    if (!noise || !output) return;
+
+    /* Independent xorshift32 lanes, interleaved; the inner loop has no
+     * cross-lane dependency so the compiler vectorizes it */
+    uint32_t state[FORMANT_NOISE_LANES];
+    memcpy(state, noise->state, sizeof(state));
+
+    const float scale = 1.0f / 2147483648.0f;
+    int i = 0;
+
+    for (; i + FORMANT_NOISE_LANES <= num_samples; i += FORMANT_NOISE_LANES) {
+        for (int lane = 0; lane < FORMANT_NOISE_LANES; lane++) {
+            uint32_t x = state[lane];
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            state[lane] = x;
+            output[i + lane] = (float)(int32_t)x * scale;
+        }
+    }
+
+    /* Partial last group */
+    int remaining = num_samples - i;
+    for (int lane = 0; lane < remaining && lane < FORMANT_NOISE_LANES; lane++) {
+        uint32_t x = state[lane];
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        state[lane] = x;
+        output[i + lane] = (float)(int32_t)x * scale;
+    }
+
+    memcpy(noise->state, state, sizeof(state));
+}
+
+float formant_generate_white_noise(formant_noise_t* noise) {
+    /* Draw from a block filled FORMANT_NOISE_BLOCK samples at a time */
+    if (noise->pos >= FORMANT_NOISE_BLOCK) {
+        formant_noise_fill(noise, noise->block, FORMANT_NOISE_BLOCK);
+        noise->pos = 0;
+    }
+    return noise->block[noise->pos++];
+}
+
+void formant_generate_aspiration(formant_noise_t* noise, const float* white, float* output,
+                                 int num_samples, float intensity) {
+    /* Aspiration is low-pass filtered white noise */
     /* Simple one-pole low-pass filter (cutoff ~8 kHz @ 48kHz) */
     float alpha_lpf = 0.7f;
-    prev = prev * (1.0f - alpha_lpf) + noise * alpha_lpf;
+    float lp = noise->aspiration_lp;
+
+    for (int i = 0; i < num_samples; i++) {
+        lp = lp * (1.0f - alpha_lpf) + white[i] * alpha_lpf;
+        output[i] = lp * intensity;
+    }
 
-    return prev * intensity;
+    noise->aspiration_lp = lp;
 }
 
-float formant_generate_frication(float intensity, float cutoff_freq) {
+void formant_generate_frication(formant_noise_t* noise, const float* white, float* output,
+                                int num_samples, float intensity, float cutoff_freq) {
     /* Frication is band-pass filtered noise (2-10 kHz) */
-    static float prev1 = 0.0f, prev2 = 0.0f;
-    float noise = formant_generate_white_noise();
-
     /* Simple band-pass approximation (high-pass then low-pass) */
-    /* High-pass: cutoff ~2 kHz */
-    float hp_alpha = 0.85f;
-    float hp_out = noise - prev1 * hp_alpha;
-    prev1 = noise;
-
-    /* Low-pass: cutoff ~10 kHz */
-    float lp_alpha = 0.5f;
-    prev2 = prev2 * (1.0f - lp_alpha) + hp_out * lp_alpha;
+    float hp_alpha = 0.85f;   /* High-pass: cutoff ~2 kHz */
+    float lp_alpha = 0.5f;    /* Low-pass: cutoff ~10 kHz */
 
     /* Adjust based on cutoff frequency (for different fricatives) */
-    float freq_factor = cutoff_freq / 6000.0f;  /* Normalized around 6 kHz */
+    float gain = intensity * (cutoff_freq / 6000.0f);  /* Normalized around 6 kHz */
+
+    float hp = noise->frication_hp;
+    float lp = noise->frication_lp;
 
-    return prev2 * intensity * freq_factor;
+    for (int i = 0; i < num_samples; i++) {
+        float hp_out = white[i] - hp * hp_alpha;
+        hp = white[i];
+        lp = lp * (1.0f - lp_alpha) + hp_out * lp_alpha;
+        output[i] = lp * gain;
+    }
+
+    noise->frication_hp = hp;
+    noise->frication_lp = lp;
 }
 
-float formant_generate_plosive_burst(float time_in_burst, float intensity, float freq) {
+float formant_generate_plosive_burst(formant_noise_t* noise, float white, float time_in_burst,
+                                     float intensity, float freq) {
     /* Generate plosive burst (p, t, k, b, d, g)
+     * white: next white noise sample
      * time_in_burst: 0.0 to 1.0 within burst duration
      * intensity: burst strength
      * freq: center frequency for burst coloring
@@ -103,14 +264,10 @@ float formant_generate_plosive_burst(float time_in_burst, float intensity, float
     /* Envelope: sharp attack, exponential decay */
     float envelope = expf(-8.0f * time_in_burst);
 
-    /* Noise burst (broadband for voiceless, more tonal for voiced) */
-    float noise = formant_generate_white_noise();
-
     /* High-pass filter for burst coloration */
-    static float prev = 0.0f;
     float hp_alpha = 0.5f + (freq / 8000.0f) * 0.4f;
-    float filtered = noise - prev * hp_alpha;
-    prev = noise;
+    float filtered = white - noise->burst_hp * hp_alpha;
+    noise->burst_hp = white;
 
     return filtered * envelope * intensity;
 }
@@ -2,57 +2,103 @@
  * formant_synth.c
  *
  * Formant filter bank implementation using biquad filters.
+ * The bank runs all resonators in parallel lanes (see formant_simd.h).
+ * Coefficients come from a sin/cos table and are ramped across each block,
+ * so control-rate updates never touch filter history.
  */
 
 #include <math.h>
 #include <string.h>
+#include <pthread.h>
 #include "formant.h"
+#include "formant_simd.h"
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 
-void formant_filter_init(formant_filter_t* filter, float freq, float bw, float sample_rate) {
-    if (!filter) return;
+/* ============================================================================
+ * Coefficient Table
+ * ========================================================================= */
 
-    memset(filter, 0, sizeof(formant_filter_t));
+/* sin/cos over [0, pi], linearly interpolated (max error ~1.2e-6) */
+#define TRIG_TABLE_SIZE 1024
 
-    filter->freq = freq;
-    filter->bw = bw;
-    filter->gain = 1.0f;
+static float g_sin_table[TRIG_TABLE_SIZE + 1];
+static float g_cos_table[TRIG_TABLE_SIZE + 1];
+static pthread_once_t g_trig_once = PTHREAD_ONCE_INIT;
 
-    /* Calculate biquad coefficients for bandpass resonator */
-    float Q = freq / bw;
-    float omega = 2.0f * M_PI * freq / sample_rate;
-    float alpha = sinf(omega) / (2.0f * Q);
-    float cos_omega = cosf(omega);
+static void build_trig_table(void) {
+    for (int i = 0; i <= TRIG_TABLE_SIZE; i++) {
+        double omega = M_PI * i / TRIG_TABLE_SIZE;
+        g_sin_table[i] = (float)sin(omega);
+        g_cos_table[i] = (float)cos(omega);
+    }
+}
 
-    /* Bandpass filter (constant skirt gain, peak gain = Q) */
-    filter->b0 = alpha;
-    filter->b1 = 0.0f;
-    filter->b2 = -alpha;
+static inline void table_sincos(float omega, float* s, float* c) {
+    float pos = omega * (float)(TRIG_TABLE_SIZE / M_PI);
+    if (pos < 0.0f) pos = 0.0f;
+    if (pos > TRIG_TABLE_SIZE - 0.001f) pos = TRIG_TABLE_SIZE - 0.001f;
+
+    int i = (int)pos;
+    float frac = pos - (float)i;
+    *s = g_sin_table[i] + frac * (g_sin_table[i + 1] - g_sin_table[i]);
+    *c = g_cos_table[i] + frac * (g_cos_table[i + 1] - g_cos_table[i]);
+}
 
+/**
+ * Bandpass resonator coefficients (constant skirt gain, peak gain = Q),
+ * normalized by a0, with b1 = 0 and b2 = -b0
+ * Cheap enough to call at control rate from the audio thread.
+ */
+static void resonator_coeffs(float freq, float bw, float sample_rate, float* b0, float* a1, float* a2) {
+    float nyquist = sample_rate * 0.49f;
+    if (freq > nyquist) freq = nyquist;
+    if (freq < 1.0f) freq = 1.0f;
+    if (bw < 1.0f) bw = 1.0f;
+
+    float sin_omega, cos_omega;
+    table_sincos(2.0f * (float)M_PI * freq / sample_rate, &sin_omega, &cos_omega);
+
+    float alpha = sin_omega * bw / (2.0f * freq);   /* sin(omega) / (2Q), Q = freq / bw */
     float a0 = 1.0f + alpha;
-    filter->a1 = -2.0f * cos_omega / a0;
-    filter->a2 = (1.0f - alpha) / a0;
 
-    /* Normalize numerator coefficients */
-    filter->b0 /= a0;
-    filter->b1 /= a0;
-    filter->b2 /= a0;
+    *b0 = alpha / a0;
+    *a1 = -2.0f * cos_omega / a0;
+    *a2 = (1.0f - alpha) / a0;
+}
+
+/* ============================================================================
+ * Single Filter
+ * ========================================================================= */
+
+void formant_filter_init(formant_filter_t* filter, float freq, float bw, float sample_rate) {
+    if (!filter) return;
+
+    pthread_once(&g_trig_once, build_trig_table);
+
+    memset(filter, 0, sizeof(formant_filter_t));
+
+    filter->bw = bw;
+    filter->gain = 1.0f;
 
-    /* Initialize state */
-    filter->x1 = filter->x2 = 0.0f;
-    filter->y1 = filter->y2 = 0.0f;
+    formant_filter_set_freq(filter, freq, sample_rate);
 }
 
 void formant_filter_set_freq(formant_filter_t* filter, float freq, float sample_rate) {
     if (!filter) return;
 
-    /* Recalculate coefficients if frequency changed significantly */
-    if (fabsf(freq - filter->freq) > 1.0f) {
-        formant_filter_init(filter, freq, filter->bw, sample_rate);
-    }
+    /* Coefficients only: history is kept so glides do not click */
+    float b0, a1, a2;
+    resonator_coeffs(freq, filter->bw, sample_rate, &b0, &a1, &a2);
+
+    filter->freq = freq;
+    filter->b0 = b0;
+    filter->b1 = 0.0f;
+    filter->b2 = -b0;
+    filter->a1 = a1;
+    filter->a2 = a2;
 }
 
 float formant_filter_process(formant_filter_t* filter, float input) {
@@ -74,22 +120,246 @@ float formant_filter_process(formant_filter_t* filter, float input) {
     return output * filter->gain;
 }
 
-void formant_bank_process(formant_bank_t* bank, const float* input, float* output, int num_samples) {
-    if (!bank || !input || !output) return;
+/* ============================================================================
+ * Formant Bank (structure-of-arrays)
+ * ========================================================================= */
+
+void formant_bank_init(formant_bank_t* bank, int num_formants, float sample_rate) {
+    if (!bank) return;
 
-    /* Clear output buffer */
-    memset(output, 0, num_samples * sizeof(float));
+    pthread_once(&g_trig_once, build_trig_table);
 
-    /* Process each formant and sum */
-    for (int f = 0; f < bank->num_formants; f++) {
-        for (int i = 0; i < num_samples; i++) {
-            output[i] += formant_filter_process(&bank->filters[f], input[i]);
+    memset(bank, 0, sizeof(formant_bank_t));
+
+    if (num_formants < 1) num_formants = 1;
+    if (num_formants > FORMANT_MAX_FORMANTS) num_formants = FORMANT_MAX_FORMANTS;
+
+    bank->num_formants = num_formants;
+    bank->sample_rate = sample_rate;
+    bank->kernel = FORMANT_BANK_KERNEL_SIMD;
+}
+
+void formant_bank_set_formant(formant_bank_t* bank, int index, float freq, float bw, float gain) {
+    if (!bank || index < 0 || index >= bank->num_formants) return;
+
+    if (freq == bank->freq[index] && bw == bank->bw[index] && gain == bank->gain_target[index]) {
+        return;
+    }
+
+    float b0, a1, a2;
+    resonator_coeffs(freq, bw, bank->sample_rate, &b0, &a1, &a2);
+    bank->b0_target[index] = b0;
+    bank->a1_target[index] = a1;
+    bank->a2_target[index] = a2;
+    bank->gain_target[index] = gain;
+
+    /* First setting of a lane takes effect at once; later ones ramp */
+    if (bank->freq[index] == 0.0f) {
+        bank->b0[index] = b0;
+        bank->a1[index] = a1;
+        bank->a2[index] = a2;
+        bank->gain[index] = gain;
+    } else {
+        bank->ramp_pending = true;
+    }
+
+    bank->freq[index] = freq;
+    bank->bw[index] = bw;
+}
+
+void formant_bank_reset(formant_bank_t* bank) {
+    if (!bank) return;
+
+    memset(bank->y1, 0, sizeof(bank->y1));
+    memset(bank->y2, 0, sizeof(bank->y2));
+    bank->x1 = bank->x2 = 0.0f;
+}
+
+/* Per-sample coefficient increments for a ramped block */
+typedef struct {
+    _Alignas(32) float b0[FORMANT_BANK_LANES];
+    _Alignas(32) float a1[FORMANT_BANK_LANES];
+    _Alignas(32) float a2[FORMANT_BANK_LANES];
+    _Alignas(32) float gain[FORMANT_BANK_LANES];
+} bank_ramp_t;
+
+/**
+ * Scalar kernel: one resonator after another for each sample
+ * ramp is NULL when the coefficients are constant over the block.
+ */
+static void bank_process_scalar(formant_bank_t* bank, const bank_ramp_t* ramp,
+                                const float* input, float* output, int num_samples) {
+    float x1 = bank->x1, x2 = bank->x2;
+    int n = bank->num_formants;
+
+    for (int i = 0; i < num_samples; i++) {
+        float dx = input[i] - x2;
+        float acc = 0.0f;
+
+        for (int f = 0; f < n; f++) {
+            if (ramp) {
+                bank->b0[f] += ramp->b0[f];
+                bank->a1[f] += ramp->a1[f];
+                bank->a2[f] += ramp->a2[f];
+                bank->gain[f] += ramp->gain[f];
+            }
+
+            float y = bank->b0[f] * dx - bank->a1[f] * bank->y1[f] - bank->a2[f] * bank->y2[f];
+            bank->y2[f] = bank->y1[f];
+            bank->y1[f] = y;
+            acc += bank->gain[f] * y;
         }
+
+        x2 = x1;
+        x1 = input[i];
+        output[i] = acc;
     }
 
-    /* Normalize by number of formants to prevent clipping */
-    float scale = 1.0f / sqrtf((float)bank->num_formants);
+    bank->x1 = x1;
+    bank->x2 = x2;
+}
+
+#if FORMANT_SIMD_WIDTH > 0
+
+#define BANK_VECS (FORMANT_BANK_LANES / FORMANT_SIMD_WIDTH)
+
+/**
+ * SIMD kernel: all resonators advance together, one lane each
+ * The recursion stays serial in time; the parallelism is across formants.
+ * Inlined twice so the constant-coefficient path carries no ramp adds.
+ */
+static inline __attribute__((always_inline))
+void bank_run_simd(formant_bank_t* bank, const bank_ramp_t* ramp,
+                   const float* input, float* output, int num_samples) {
+    fvec_t b0[BANK_VECS], a1[BANK_VECS], a2[BANK_VECS], g[BANK_VECS];
+    fvec_t db0[BANK_VECS], da1[BANK_VECS], da2[BANK_VECS], dg[BANK_VECS];
+    fvec_t y1[BANK_VECS], y2[BANK_VECS];
+
+    for (int v = 0; v < BANK_VECS; v++) {
+        int o = v * FORMANT_SIMD_WIDTH;
+        b0[v] = fvec_load(&bank->b0[o]);
+        a1[v] = fvec_load(&bank->a1[o]);
+        a2[v] = fvec_load(&bank->a2[o]);
+        g[v] = fvec_load(&bank->gain[o]);
+        y1[v] = fvec_load(&bank->y1[o]);
+        y2[v] = fvec_load(&bank->y2[o]);
+        if (ramp) {
+            db0[v] = fvec_load(&ramp->b0[o]);
+            da1[v] = fvec_load(&ramp->a1[o]);
+            da2[v] = fvec_load(&ramp->a2[o]);
+            dg[v] = fvec_load(&ramp->gain[o]);
+        }
+    }
+
+    float x1 = bank->x1, x2 = bank->x2;
+
     for (int i = 0; i < num_samples; i++) {
-        output[i] *= scale;
+        fvec_t dx = fvec_set1(input[i] - x2);
+        fvec_t acc = fvec_zero();
+
+        for (int v = 0; v < BANK_VECS; v++) {
+            if (ramp) {
+                b0[v] = fvec_add(b0[v], db0[v]);
+                a1[v] = fvec_add(a1[v], da1[v]);
+                a2[v] = fvec_add(a2[v], da2[v]);
+                g[v] = fvec_add(g[v], dg[v]);
+            }
+
+            fvec_t y = fvec_sub(fvec_sub(fvec_mul(b0[v], dx), fvec_mul(a1[v], y1[v])),
+                                fvec_mul(a2[v], y2[v]));
+            y2[v] = y1[v];
+            y1[v] = y;
+            acc = fvec_add(acc, fvec_mul(g[v], y));
+        }
+
+        x2 = x1;
+        x1 = input[i];
+        output[i] = fvec_hsum(acc);
+    }
+
+    for (int v = 0; v < BANK_VECS; v++) {
+        int o = v * FORMANT_SIMD_WIDTH;
+        fvec_store(&bank->y1[o], y1[v]);
+        fvec_store(&bank->y2[o], y2[v]);
+    }
+    bank->x1 = x1;
+    bank->x2 = x2;
+}
+
+static void bank_process_simd(formant_bank_t* bank, const float* input, float* output, int num_samples) {
+    bank_run_simd(bank, NULL, input, output, num_samples);
+}
+
+static void bank_process_simd_ramp(formant_bank_t* bank, const bank_ramp_t* ramp,
+                                   const float* input, float* output, int num_samples) {
+    bank_run_simd(bank, ramp, input, output, num_samples);
+}
+
+#endif /* FORMANT_SIMD_WIDTH > 0 */
+
+void formant_bank_process(formant_bank_t* bank, const float* input, float* output, int num_samples) {
+    if (!bank || !input || !output || num_samples <= 0) return;
+
+    /* Ramp coefficients linearly from their current values to the targets
+     * set since the last block, landing on the targets at the last sample */
+    bank_ramp_t ramp;
+    const bank_ramp_t* active_ramp = NULL;
+
+    if (bank->ramp_pending) {
+        float step = 1.0f / (float)num_samples;
+        for (int f = 0; f < FORMANT_BANK_LANES; f++) {
+            ramp.b0[f] = (bank->b0_target[f] - bank->b0[f]) * step;
+            ramp.a1[f] = (bank->a1_target[f] - bank->a1[f]) * step;
+            ramp.a2[f] = (bank->a2_target[f] - bank->a2[f]) * step;
+            ramp.gain[f] = (bank->gain_target[f] - bank->gain[f]) * step;
+        }
+        active_ramp = &ramp;
+    }
+
+#if FORMANT_SIMD_WIDTH > 0
+    if (bank->kernel == FORMANT_BANK_KERNEL_SIMD) {
+        if (active_ramp) {
+            bank_process_simd_ramp(bank, active_ramp, input, output, num_samples);
+        } else {
+            bank_process_simd(bank, input, output, num_samples);
+        }
+    } else
+#endif
+    {
+        bank_process_scalar(bank, active_ramp, input, output, num_samples);
+    }
+
+    /* Snap to the exact targets so rounding in the ramp never accumulates */
+    if (active_ramp) {
+        memcpy(bank->b0, bank->b0_target, sizeof(bank->b0));
+        memcpy(bank->a1, bank->a1_target, sizeof(bank->a1));
+        memcpy(bank->a2, bank->a2_target, sizeof(bank->a2));
+        memcpy(bank->gain, bank->gain_target, sizeof(bank->gain));
+        bank->ramp_pending = false;
+    }
+}
+
+void formant_bank_set_kernel(formant_bank_t* bank, formant_bank_kernel_t kernel) {
+    if (!bank) return;
+    bank->kernel = kernel;
+}
+
+int formant_bank_kernel_parse(const char* name, formant_bank_kernel_t* kernel) {
+    if (!name || !kernel) return -1;
+
+    if (strcmp(name, "scalar") == 0) {
+        *kernel = FORMANT_BANK_KERNEL_SCALAR;
+    } else if (strcmp(name, "simd") == 0) {
+        *kernel = FORMANT_BANK_KERNEL_SIMD;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+const char* formant_bank_kernel_name(formant_bank_kernel_t kernel) {
+    if (kernel == FORMANT_BANK_KERNEL_SIMD) {
+        return FORMANT_SIMD_WIDTH > 0 ? "simd (" FORMANT_SIMD_ISA ")" : "simd (unavailable, scalar)";
     }
+    return "scalar";
 }
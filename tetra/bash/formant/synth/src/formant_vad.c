@@ -10,6 +10,11 @@
 #include <string.h>
 #include <math.h>
 #include "formant.h"
+#include "formant_simd.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
 
 /* ============================================================================
  * Constants
@@ -18,23 +23,27 @@
 #define VAD_FRAME_SIZE_MS 10        /* 10ms frames */
 #define VAD_HISTORY_LENGTH 5        /* Smooth over 5 frames (50ms) */
 #define VAD_PRETRIGGER_MS 100       /* 100ms pre-trigger buffer */
+#define VAD_LOW_BAND_HZ 300.0f      /* Hum, fans, handling noise below */
+#define VAD_HIGH_BAND_HZ 4000.0f    /* Hiss and clicks above */
+#define VAD_POWER_FLOOR 1e-12f      /* Added to bin power before log() */
 
 /* Mode-dependent parameters */
 static const struct {
     float energy_multiplier;        /* Multiply noise floor by this */
     float zcr_threshold;            /* Max ZCR for speech */
-    float sf_threshold;             /* Max spectral flatness for speech */
+    float sf_threshold;             /* Max voice-band spectral flatness for speech */
+    float band_threshold;           /* Min share of power in the voice band */
     int hangover_frames;            /* Frames to continue after speech */
     int min_speech_frames;          /* Min consecutive frames to confirm speech */
 } vad_modes[] = {
     /* Mode 0: Quality - conservative, less likely to clip speech */
-    {2.5f, 0.35f, 0.5f, 30, 2},     /* 300ms hangover, 20ms min speech */
+    {2.5f, 0.35f, 0.45f, 0.40f, 30, 2},    /* 300ms hangover, 20ms min speech */
 
     /* Mode 1: Balanced - good for most use cases */
-    {3.0f, 0.30f, 0.45f, 20, 3},    /* 200ms hangover, 30ms min speech */
+    {3.0f, 0.30f, 0.40f, 0.50f, 20, 3},    /* 200ms hangover, 30ms min speech */
 
     /* Mode 2: Aggressive - clips silence quickly */
-    {4.0f, 0.25f, 0.40f, 10, 4}     /* 100ms hangover, 40ms min speech */
+    {4.0f, 0.25f, 0.35f, 0.60f, 10, 4}     /* 100ms hangover, 40ms min speech */
 };
 
 /* ============================================================================
@@ -42,64 +51,155 @@ static const struct {
  * ========================================================================= */
 
 /**
- * Calculate RMS energy of audio frame
+ * Window the frame into the FFT input and return its RMS
  */
-static float calculate_energy(const float* samples, int count) {
+static float window_frame(formant_vad_t* vad, const float* samples) {
+    const float* window = vad->window;
+    float* out = vad->fft_input;
+    int n = vad->frame_size;
     float sum = 0.0f;
-    for (int i = 0; i < count; i++) {
+    int i = 0;
+
+#if FORMANT_SIMD_WIDTH > 0
+    fvec_t acc = fvec_zero();
+    for (; i + FORMANT_SIMD_WIDTH <= n; i += FORMANT_SIMD_WIDTH) {
+        fvec_t x = fvec_loadu(samples + i);
+        acc = fvec_add(acc, fvec_mul(x, x));
+        fvec_store(out + i, fvec_mul(x, fvec_load(window + i)));
+    }
+    sum = fvec_hsum(acc);
+#endif
+
+    for (; i < n; i++) {
         sum += samples[i] * samples[i];
+        out[i] = samples[i] * window[i];
     }
-    return sqrtf(sum / count);
+
+    return sqrtf(sum / n);
 }
 
 /**
  * Calculate zero-crossing rate
- * Returns normalized rate (0.0 to 1.0)
+ * Returns normalized rate (0.0 to 1.0). Branch-free so the compiler
+ * vectorizes the count.
  */
 static float calculate_zcr(const float* samples, int count) {
     int crossings = 0;
     for (int i = 1; i < count; i++) {
-        if ((samples[i] >= 0.0f && samples[i-1] < 0.0f) ||
-            (samples[i] < 0.0f && samples[i-1] >= 0.0f)) {
-            crossings++;
-        }
+        crossings += (samples[i] < 0.0f) != (samples[i - 1] < 0.0f);
     }
     return (float)crossings / (float)(count - 1);
 }
 
 /**
- * Calculate spectral flatness (simplified, no FFT)
- * We use a time-domain approximation: variance / mean_absolute
- * Low values indicate harmonic content (speech)
- * High values indicate noise-like content
+ * Power spectrum from the FFT output
  */
-static float calculate_spectral_flatness_approx(const float* samples, int count) {
-    /* Calculate mean absolute value */
-    float mean_abs = 0.0f;
-    for (int i = 0; i < count; i++) {
-        mean_abs += fabsf(samples[i]);
+static void power_spectrum(formant_vad_t* vad) {
+    const float* re = vad->spectrum_re;
+    const float* im = vad->spectrum_im;
+    float* power = vad->power;
+    int k = 0;
+
+#if FORMANT_SIMD_WIDTH > 0
+    for (; k + FORMANT_SIMD_WIDTH <= vad->bins; k += FORMANT_SIMD_WIDTH) {
+        fvec_t r = fvec_load(re + k);
+        fvec_t m = fvec_load(im + k);
+        fvec_store(power + k, fvec_add(fvec_mul(r, r), fvec_mul(m, m)));
     }
-    mean_abs /= count;
+#endif
 
-    if (mean_abs < 1e-6f) {
-        return 1.0f;  /* Silence - treat as noise */
+    for (; k < vad->bins; k++) {
+        power[k] = re[k] * re[k] + im[k] * im[k];
     }
+}
+
+/**
+ * Sum x[start, end)
+ */
+static float sum_range(const float* x, int start, int end) {
+    float sum = 0.0f;
+    int k = start;
 
-    /* Calculate variance */
-    float variance = 0.0f;
-    for (int i = 0; i < count; i++) {
-        float diff = fabsf(samples[i]) - mean_abs;
-        variance += diff * diff;
+#if FORMANT_SIMD_WIDTH > 0
+    fvec_t acc = fvec_zero();
+    for (; k + FORMANT_SIMD_WIDTH <= end; k += FORMANT_SIMD_WIDTH) {
+        acc = fvec_add(acc, fvec_loadu(x + k));
     }
-    variance /= count;
+    sum = fvec_hsum(acc);
+#endif
 
-    /* Normalized flatness approximation */
-    float flatness = sqrtf(variance) / mean_abs;
+    for (; k < end; k++) {
+        sum += x[k];
+    }
+    return sum;
+}
 
-    /* Clamp to 0-1 range */
-    if (flatness > 1.0f) flatness = 1.0f;
+/**
+ * Mean of max(cur - prev, 0) over all bins
+ */
+static float positive_flux(const float* cur, const float* prev, int bins) {
+    float sum = 0.0f;
+    int k = 0;
+
+#if FORMANT_SIMD_WIDTH > 0
+    fvec_t acc = fvec_zero();
+    fvec_t zero = fvec_zero();
+    for (; k + FORMANT_SIMD_WIDTH <= bins; k += FORMANT_SIMD_WIDTH) {
+        fvec_t rise = fvec_sub(fvec_load(cur + k), fvec_load(prev + k));
+        acc = fvec_add(acc, fvec_max(rise, zero));
+    }
+    sum = fvec_hsum(acc);
+#endif
 
-    return flatness;
+    for (; k < bins; k++) {
+        float rise = cur[k] - prev[k];
+        if (rise > 0.0f) sum += rise;
+    }
+    return sum / bins;
+}
+
+void formant_vad_compute_features(formant_vad_t* vad, const float* frame, formant_vad_features_t* features) {
+    if (!vad || !frame || !features) {
+        return;
+    }
+
+    features->energy = window_frame(vad, frame);
+    features->zcr = calculate_zcr(frame, vad->frame_size);
+
+    formant_fft_forward(vad->fft, vad->fft_input, vad->spectrum_re, vad->spectrum_im);
+    power_spectrum(vad);
+
+    /* Floor keeps log() finite in digital silence; plain loop so the
+     * compiler can use its vector log */
+    const float* power = vad->power;
+    float* log_power = vad->log_power;
+    for (int k = 0; k < vad->bins; k++) {
+        log_power[k] = logf(power[k] + VAD_POWER_FLOOR);
+    }
+
+    float total = 0.0f;
+    float band[FORMANT_VAD_BANDS];
+    for (int b = 0; b < FORMANT_VAD_BANDS; b++) {
+        band[b] = sum_range(power, vad->band_start[b], vad->band_start[b + 1]);
+        total += band[b];
+    }
+    for (int b = 0; b < FORMANT_VAD_BANDS; b++) {
+        features->band_share[b] = total > 0.0f ? band[b] / total : 0.0f;
+    }
+
+    /* Flatness: geometric over arithmetic mean power of the voice band */
+    int start = vad->band_start[FORMANT_VAD_VOICE_BAND];
+    int count = vad->band_start[FORMANT_VAD_VOICE_BAND + 1] - start;
+    float mean_log = sum_range(log_power, start, start + count) / count;
+    float mean = band[FORMANT_VAD_VOICE_BAND] / count + VAD_POWER_FLOOR;
+    features->flatness = expf(mean_log) / mean;
+    if (features->flatness > 1.0f) features->flatness = 1.0f;
+
+    features->flux = positive_flux(log_power, vad->prev_log_power, vad->bins);
+
+    /* This frame's spectrum is the next frame's reference */
+    vad->log_power = vad->prev_log_power;
+    vad->prev_log_power = log_power;
 }
 
 /**
@@ -140,6 +240,50 @@ formant_vad_t* formant_vad_create(float sample_rate, int mode) {
         return NULL;
     }
 
+    /* Spectral front end */
+    vad->fft_size = 4;
+    while (vad->fft_size < vad->frame_size) {
+        vad->fft_size <<= 1;
+    }
+    vad->bins = vad->fft_size / 2 + 1;
+    vad->fft = formant_fft_create(vad->fft_size);
+
+    /* Rounded up so vector loops may touch whole vectors */
+    size_t bins_bytes = ((size_t)vad->bins * sizeof(float) + FORMANT_CACHE_LINE - 1) &
+                        ~(size_t)(FORMANT_CACHE_LINE - 1);
+    size_t frame_bytes = ((size_t)vad->fft_size * sizeof(float) + FORMANT_CACHE_LINE - 1) &
+                         ~(size_t)(FORMANT_CACHE_LINE - 1);
+    vad->window = (float*)aligned_alloc(FORMANT_CACHE_LINE, frame_bytes);
+    vad->fft_input = (float*)aligned_alloc(FORMANT_CACHE_LINE, frame_bytes);
+    vad->spectrum_re = (float*)aligned_alloc(FORMANT_CACHE_LINE, bins_bytes);
+    vad->spectrum_im = (float*)aligned_alloc(FORMANT_CACHE_LINE, bins_bytes);
+    vad->power = (float*)aligned_alloc(FORMANT_CACHE_LINE, bins_bytes);
+    vad->log_power = (float*)aligned_alloc(FORMANT_CACHE_LINE, bins_bytes);
+    vad->prev_log_power = (float*)aligned_alloc(FORMANT_CACHE_LINE, bins_bytes);
+
+    if (!vad->fft || !vad->window || !vad->fft_input || !vad->spectrum_re || !vad->spectrum_im ||
+        !vad->power || !vad->log_power || !vad->prev_log_power) {
+        formant_vad_destroy(vad);
+        return NULL;
+    }
+
+    memset(vad->fft_input, 0, frame_bytes);
+    for (int i = 0; i < vad->frame_size; i++) {
+        vad->window[i] = 0.5f - 0.5f * cosf(2.0f * (float)M_PI * (i + 0.5f) / vad->frame_size);
+    }
+    for (int k = 0; k < vad->bins; k++) {
+        vad->prev_log_power[k] = logf(VAD_POWER_FLOOR);
+    }
+
+    float bin_hz = sample_rate / vad->fft_size;
+    vad->band_start[0] = 1;   /* Skip DC */
+    vad->band_start[1] = (int)ceilf(VAD_LOW_BAND_HZ / bin_hz);
+    vad->band_start[2] = (int)ceilf(VAD_HIGH_BAND_HZ / bin_hz);
+    vad->band_start[3] = vad->bins;
+    if (vad->band_start[2] > vad->bins) {
+        vad->band_start[2] = vad->bins;
+    }
+
     /* Allocate pre-trigger buffer */
     vad->pretrigger_size = (int)(sample_rate * VAD_PRETRIGGER_MS / 1000.0f);
     vad->pretrigger_buffer = calloc(vad->pretrigger_size, sizeof(float));
@@ -153,6 +297,7 @@ formant_vad_t* formant_vad_create(float sample_rate, int mode) {
     vad->energy_threshold = 0.01f;  /* Default low threshold */
     vad->zcr_threshold = vad_modes[mode].zcr_threshold;
     vad->sf_threshold = vad_modes[mode].sf_threshold;
+    vad->band_threshold = vad_modes[mode].band_threshold;
     vad->noise_floor = 0.001f;      /* Very low default */
     vad->calibrated = false;
 
@@ -183,6 +328,14 @@ void formant_vad_destroy(formant_vad_t* vad) {
     free(vad->energy_history);
     free(vad->zcr_history);
     free(vad->pretrigger_buffer);
+    formant_fft_destroy(vad->fft);
+    free(vad->window);
+    free(vad->fft_input);
+    free(vad->spectrum_re);
+    free(vad->spectrum_im);
+    free(vad->power);
+    free(vad->log_power);
+    free(vad->prev_log_power);
     free(vad);
 }
 
@@ -204,6 +357,11 @@ void formant_vad_reset(formant_vad_t* vad) {
     /* Clear history */
     memset(vad->energy_history, 0, vad->history_length * sizeof(float));
     memset(vad->zcr_history, 0, vad->history_length * sizeof(float));
+
+    /* First frame after a reset has no flux */
+    for (int k = 0; k < vad->bins; k++) {
+        vad->prev_log_power[k] = logf(VAD_POWER_FLOOR);
+    }
 }
 
 void formant_vad_calibrate(formant_vad_t* vad, const float* samples, int num_samples) {
@@ -217,8 +375,8 @@ void formant_vad_calibrate(formant_vad_t* vad, const float* samples, int num_sam
 
     for (int f = 0; f < num_frames; f++) {
         const float* frame = &samples[f * vad->frame_size];
-        float energy = calculate_energy(frame, vad->frame_size);
-        total_energy += energy;
+        formant_vad_compute_features(vad, frame, &vad->features);
+        total_energy += vad->features.energy;
     }
 
     /* Set noise floor to average energy */
@@ -228,9 +386,6 @@ void formant_vad_calibrate(formant_vad_t* vad, const float* samples, int num_sam
     vad->energy_threshold = vad->noise_floor * vad_modes[vad->mode].energy_multiplier;
 
     vad->calibrated = true;
-
-    fprintf(stderr, "VAD calibrated: noise_floor=%.6f, energy_threshold=%.6f\n",
-            vad->noise_floor, vad->energy_threshold);
 }
 
 formant_vad_result_t formant_vad_process_frame(formant_vad_t* vad, const float* samples, int frame_size) {
@@ -238,20 +393,27 @@ formant_vad_result_t formant_vad_process_frame(formant_vad_t* vad, const float*
         return FORMANT_VAD_RESULT_SILENCE;
     }
 
-    /* Add to pre-trigger buffer (circular) */
-    for (int i = 0; i < frame_size; i++) {
-        vad->pretrigger_buffer[vad->pretrigger_pos] = samples[i];
-        vad->pretrigger_pos = (vad->pretrigger_pos + 1) % vad->pretrigger_size;
-
-        if (vad->pretrigger_available < vad->pretrigger_size) {
-            vad->pretrigger_available++;
-        }
+    /* Add to pre-trigger buffer (circular); at most two copies per frame */
+    int remaining = frame_size;
+    const float* src = samples;
+    while (remaining > 0) {
+        int chunk = vad->pretrigger_size - vad->pretrigger_pos;
+        if (chunk > remaining) chunk = remaining;
+        memcpy(vad->pretrigger_buffer + vad->pretrigger_pos, src, chunk * sizeof(float));
+        vad->pretrigger_pos = (vad->pretrigger_pos + chunk) % vad->pretrigger_size;
+        src += chunk;
+        remaining -= chunk;
+    }
+    vad->pretrigger_available += frame_size;
+    if (vad->pretrigger_available > vad->pretrigger_size) {
+        vad->pretrigger_available = vad->pretrigger_size;
     }
 
     /* Calculate features */
-    float energy = calculate_energy(samples, frame_size);
-    float zcr = calculate_zcr(samples, frame_size);
-    float sf = calculate_spectral_flatness_approx(samples, frame_size);
+    formant_vad_features_t* features = &vad->features;
+    formant_vad_compute_features(vad, samples, features);
+    float energy = features->energy;
+    float zcr = features->zcr;
 
     /* Store in history */
     vad->energy_history[vad->history_pos] = energy;
@@ -263,10 +425,12 @@ formant_vad_result_t formant_vad_process_frame(formant_vad_t* vad, const float*
         update_noise_floor(vad, energy);
     }
 
-    /* Speech decision: All three features must agree */
+    /* Speech decision: all features must agree. Fans and hum fail the
+     * voice-band share, hiss and clicks fail flatness */
     bool is_speech = (energy > vad->energy_threshold) &&
                      (zcr < vad->zcr_threshold) &&
-                     (sf < vad->sf_threshold);
+                     (features->flatness < vad->sf_threshold) &&
+                     (features->band_share[FORMANT_VAD_VOICE_BAND] > vad->band_threshold);
 
     /* State machine */
     vad->frames_processed++;
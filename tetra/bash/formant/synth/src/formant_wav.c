@@ -0,0 +1,253 @@
+/**
+ * formant_wav.c
+ *
+ * Streaming WAV reader for offline tools. Walks the RIFF chunk list rather
+ * than assuming the 44-byte canonical header, so files from editors and
+ * field recorders (LIST, bext, fact, JUNK chunks) read the same as our own.
+ * Decodes 16/24/32-bit PCM and 32/64-bit float. Output is mono float;
+ * multichannel files are averaged.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "formant.h"
+
+#define WAV_FORMAT_PCM 1
+#define WAV_FORMAT_FLOAT 3
+#define WAV_FORMAT_EXTENSIBLE 0xFFFE
+#define WAV_MAX_CHANNELS 32
+
+/* ============================================================================
+ * RIFF Parsing
+ * ========================================================================= */
+
+static uint32_t get16(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8);
+}
+
+static uint32_t get32(const uint8_t* p) {
+    return get16(p) | (get16(p + 2) << 16);
+}
+
+static uint64_t get64(const uint8_t* p) {
+    return (uint64_t)get32(p) | ((uint64_t)get32(p + 4) << 32);
+}
+
+/**
+ * One sample at full scale 1.0. Called with a loop-invariant format, so
+ * the compiler unswitches the frame loop per format
+ */
+static inline float decode_sample(const uint8_t* p, int bits, bool is_float) {
+    if (is_float) {
+        if (bits == 32) {
+            uint32_t u = get32(p);
+            float f;
+            memcpy(&f, &u, sizeof(f));
+            return f;
+        }
+        uint64_t u = get64(p);
+        double d;
+        memcpy(&d, &u, sizeof(d));
+        return (float)d;
+    }
+
+    switch (bits) {
+        case 16:
+            return (float)(int16_t)get16(p) * (1.0f / 32768.0f);
+        case 24:
+            /* Left-justify into 32 bits so the sign lands in bit 31 */
+            return (float)(int32_t)(get16(p) << 8 | (uint32_t)p[2] << 24) * (1.0f / 2147483648.0f);
+        default:
+            return (float)(int32_t)get32(p) * (1.0f / 2147483648.0f);
+    }
+}
+
+/**
+ * Parse the fmt chunk body
+ * Returns 0 if the format is one we can read, -1 otherwise
+ */
+static int parse_format(formant_wav_reader_t* reader, const uint8_t* fmt, uint32_t size,
+                        const char* path) {
+    if (size < 16) {
+        fprintf(stderr, "ERROR: %s: fmt chunk too short\n", path);
+        return -1;
+    }
+
+    uint32_t format = get16(fmt);
+    reader->channels = (int)get16(fmt + 2);
+    reader->sample_rate = (int)get32(fmt + 4);
+    reader->block_align = (int)get16(fmt + 12);
+    reader->bits_per_sample = (int)get16(fmt + 14);
+
+    /* Extensible: the real format code leads the sub-format GUID */
+    if (format == WAV_FORMAT_EXTENSIBLE && size >= 40) {
+        format = get16(fmt + 24);
+    }
+
+    int bits = reader->bits_per_sample;
+    if (format == WAV_FORMAT_FLOAT && (bits == 32 || bits == 64)) {
+        reader->is_float = true;
+    } else if (format != WAV_FORMAT_PCM || (bits != 16 && bits != 24 && bits != 32)) {
+        fprintf(stderr, "ERROR: %s: unsupported format %u, %d bits "
+                "(need 16/24/32-bit PCM or 32/64-bit float)\n", path, format, bits);
+        return -1;
+    }
+    if (reader->channels < 1 || reader->channels > WAV_MAX_CHANNELS ||
+        reader->block_align != reader->channels * (bits / 8) || reader->sample_rate <= 0) {
+        fprintf(stderr, "ERROR: %s: inconsistent fmt chunk\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Walk chunks up to "data", leaving the file positioned on the first sample
+ */
+static int parse_chunks(formant_wav_reader_t* reader, const char* path) {
+    uint8_t header[12];
+    if (fread(header, 1, 12, reader->file) != 12 ||
+        memcmp(header, "RIFF", 4) != 0 || memcmp(header + 8, "WAVE", 4) != 0) {
+        fprintf(stderr, "ERROR: %s: not a RIFF/WAVE file\n", path);
+        return -1;
+    }
+
+    bool have_format = false;
+    for (;;) {
+        uint8_t chunk[8];
+        if (fread(chunk, 1, 8, reader->file) != 8) {
+            fprintf(stderr, "ERROR: %s: no data chunk\n", path);
+            return -1;
+        }
+        uint32_t size = get32(chunk + 4);
+        uint32_t pad = size & 1;   /* Chunks are word aligned */
+
+        if (memcmp(chunk, "fmt ", 4) == 0) {
+            uint8_t fmt[40];
+            uint32_t keep = size < sizeof(fmt) ? size : (uint32_t)sizeof(fmt);
+            if (fread(fmt, 1, keep, reader->file) != keep ||
+                parse_format(reader, fmt, keep, path) != 0) {
+                return -1;
+            }
+            size -= keep;
+            have_format = true;
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            if (!have_format) {
+                fprintf(stderr, "ERROR: %s: data chunk before fmt chunk\n", path);
+                return -1;
+            }
+
+            /* Writers that never patched the size leave 0 or 0xFFFFFFFF:
+             * trust the file length instead */
+            long data_start = ftell(reader->file);
+            fseek(reader->file, 0, SEEK_END);
+            long available = ftell(reader->file) - data_start;
+            fseek(reader->file, data_start, SEEK_SET);
+
+            uint64_t bytes = size;
+            if (bytes == 0 || bytes == 0xFFFFFFFFu || (available >= 0 && bytes > (uint64_t)available)) {
+                bytes = available > 0 ? (uint64_t)available : 0;
+            }
+            reader->num_frames = bytes / (uint64_t)reader->block_align;
+            return 0;
+        }
+
+        if (fseek(reader->file, (long)size + pad, SEEK_CUR) != 0) {
+            fprintf(stderr, "ERROR: %s: truncated chunk\n", path);
+            return -1;
+        }
+    }
+}
+
+/* ============================================================================
+ * Public API
+ * ========================================================================= */
+
+formant_wav_reader_t* formant_wav_open(const char* path) {
+    if (!path) return NULL;
+
+    formant_wav_reader_t* reader = (formant_wav_reader_t*)calloc(1, sizeof(formant_wav_reader_t));
+    if (!reader) {
+        return NULL;
+    }
+
+    reader->file = fopen(path, "rb");
+    if (!reader->file) {
+        fprintf(stderr, "ERROR: Failed to open WAV file: %s\n", path);
+        free(reader);
+        return NULL;
+    }
+
+    if (parse_chunks(reader, path) != 0) {
+        formant_wav_close(reader);
+        return NULL;
+    }
+
+    reader->raw = (uint8_t*)malloc((size_t)FORMANT_WAV_CHUNK * reader->block_align);
+    if (!reader->raw) {
+        formant_wav_close(reader);
+        return NULL;
+    }
+
+    return reader;
+}
+
+int formant_wav_read(formant_wav_reader_t* reader, float* output, int max_frames) {
+    if (!reader || !output || max_frames < 0) return -1;
+
+    uint64_t remaining = reader->num_frames - reader->frames_read;
+    int total = (uint64_t)max_frames < remaining ? max_frames : (int)remaining;
+    const int bits = reader->bits_per_sample;
+    const int bytes = bits / 8;
+    const bool is_float = reader->is_float;
+    const float scale = 1.0f / reader->channels;
+    int done = 0;
+
+    while (done < total) {
+        int count = total - done;
+        if (count > FORMANT_WAV_CHUNK) count = FORMANT_WAV_CHUNK;
+
+        size_t got = fread(reader->raw, (size_t)reader->block_align, (size_t)count, reader->file);
+        const uint8_t* p = reader->raw;
+        float* out = output + done;
+
+        if (reader->channels == 1) {
+            for (size_t i = 0; i < got; i++, p += bytes) {
+                out[i] = decode_sample(p, bits, is_float);
+            }
+        } else {
+            for (size_t i = 0; i < got; i++) {
+                float sum = 0.0f;
+                for (int c = 0; c < reader->channels; c++, p += bytes) {
+                    sum += decode_sample(p, bits, is_float);
+                }
+                out[i] = sum * scale;
+            }
+        }
+
+        done += (int)got;
+        reader->frames_read += got;
+        if ((int)got < count) {
+            /* Short file: the size said more than was there */
+            if (ferror(reader->file)) {
+                fprintf(stderr, "ERROR: Failed to read audio data\n");
+                return -1;
+            }
+            reader->num_frames = reader->frames_read;
+            break;
+        }
+    }
+
+    return done;
+}
+
+void formant_wav_close(formant_wav_reader_t* reader) {
+    if (!reader) return;
+
+    if (reader->file) {
+        fclose(reader->file);
+    }
+    free(reader->raw);
+    free(reader);
+}
@@ -0,0 +1,149 @@
+/**
+ * formant_bankc.c
+ *
+ * Sound bank compiler. Reads a manifest of "<ipa> <file.wav>" lines,
+ * analyzes every grain once and writes a single .fbank file the engine
+ * maps at startup (formant -B). With -l, lists a compiled bank instead.
+ *
+ * Usage: formant_bankc [options] MANIFEST
+ *        formant_bankc -l BANK.fbank
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <time.h>
+#include "formant.h"
+
+static void print_usage(const char* program_name) {
+    printf("Usage: %s [options] MANIFEST\n", program_name);
+    printf("       %s -l BANK.fbank\n\n", program_name);
+    printf("Compile the grains listed in MANIFEST (\"<ipa> <file.wav>\" per line) into one bank.\n\n");
+    printf("Options:\n");
+    printf("  -o, --output FILE     Bank to write (default: MANIFEST with .fbank extension)\n");
+    printf("  -f, --format FMT      Sample format: float or int16 (default: float)\n");
+    printf("  -t, --threads N       Analysis threads (default: online CPUs)\n");
+    printf("  -l, --list            List the entries of a compiled bank\n");
+    printf("  -h, --help            Show this help message\n");
+}
+
+static double wall_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int list_bank(const char* path) {
+    sound_bank_t* bank = sound_bank_map(path);
+    if (!bank) return 1;
+
+    printf("%s: %d grains, %s, %zu bytes\n", path, bank->num_entries,
+           bank->sample_format == SOUND_BANK_INT16 ? "int16" : "float", bank->map_size);
+    printf("%-4s %-6s %8s %7s %7s %8s %6s %6s\n",
+           "#", "ipa", "samples", "rate", "f0", "loop", "dBFS", "zcr");
+    for (int i = 0; i < bank->num_entries; i++) {
+        const sound_bank_entry_t* entry = &bank->entries[i];
+        printf("%-4d %-6.8s %8u %7.0f %7.1f %8u %6.1f %6.3f\n", i, entry->phoneme,
+               entry->audio_length, entry->sample_rate,
+               entry->features[SOUND_GRAIN_FEATURE_F0], entry->duration_samples,
+               entry->features[SOUND_GRAIN_FEATURE_LEVEL],
+               entry->features[SOUND_GRAIN_FEATURE_ZCR]);
+    }
+
+    sound_bank_destroy(bank);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    const char* output_path = NULL;
+    sound_bank_format_t format = SOUND_BANK_FLOAT32;
+    int list = 0;
+    long online_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int num_threads = online_cpus > 0 ? (int)online_cpus : 1;
+
+    static struct option long_options[] = {
+        {"output",  required_argument, 0, 'o'},
+        {"format",  required_argument, 0, 'f'},
+        {"threads", required_argument, 0, 't'},
+        {"list",    no_argument,       0, 'l'},
+        {"help",    no_argument,       0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "o:f:t:lh", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'o':
+                output_path = optarg;
+                break;
+            case 'f':
+                if (strcmp(optarg, "float") == 0) {
+                    format = SOUND_BANK_FLOAT32;
+                } else if (strcmp(optarg, "int16") == 0) {
+                    format = SOUND_BANK_INT16;
+                } else {
+                    fprintf(stderr, "ERROR: Unknown sample format '%s' (float or int16)\n", optarg);
+                    return 1;
+                }
+                break;
+            case 't':
+                num_threads = atoi(optarg);
+                if (num_threads < 1 || num_threads > FORMANT_MAX_WORKERS) {
+                    fprintf(stderr, "ERROR: Threads must be between 1 and %d\n", FORMANT_MAX_WORKERS);
+                    return 1;
+                }
+                break;
+            case 'l':
+                list = 1;
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (argc - optind != 1) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    const char* input_path = argv[optind];
+
+    if (list) {
+        return list_bank(input_path);
+    }
+
+    char default_output[1024];
+    if (!output_path) {
+        const char* dot = strrchr(input_path, '.');
+        const char* slash = strrchr(input_path, '/');
+        int stem = dot && (!slash || dot > slash) ? (int)(dot - input_path) : (int)strlen(input_path);
+        snprintf(default_output, sizeof(default_output), "%.*s.fbank", stem, input_path);
+        output_path = default_output;
+    }
+
+    double start = wall_seconds();
+    int count = sound_bank_compile(input_path, output_path, format, num_threads);
+    if (count < 0) {
+        fprintf(stderr, "ERROR: Failed to compile %s\n", input_path);
+        return 1;
+    }
+    double compiled = wall_seconds() - start;
+
+    /* Map what was written, as the engine will */
+    start = wall_seconds();
+    sound_bank_t* bank = sound_bank_map(output_path);
+    double mapped = wall_seconds() - start;
+    if (!bank) return 1;
+
+    fprintf(stderr, "Compiled %d grains into %s (%zu bytes) in %.2fs on %d threads; maps in %.1fus\n",
+            count, output_path, bank->map_size, compiled, num_threads, mapped * 1e6);
+    sound_bank_destroy(bank);
+    return 0;
+}
@@ -0,0 +1,1157 @@
+/**
+ * formant_bench.c
+ *
+ * Micro benchmarks for the synthesis hot paths.
+ * Reports cycles per sample (TSC on x86, nanoseconds elsewhere).
+ *
+ * Usage: formant_bench [seconds_of_audio]
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "formant.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_UNIT "cycles"
+static inline uint64_t bench_ticks(void) {
+    return __rdtsc();
+}
+#else
+#define BENCH_UNIT "ns"
+static inline uint64_t bench_ticks(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+#endif
+
+#define BENCH_SAMPLE_RATE 48000.0f
+#define BENCH_BLOCK FORMANT_CONTROL_RATE_DEFAULT
+
+static const float BENCH_FREQS[FORMANT_MAX_FORMANTS] = {800.0f, 1200.0f, 2500.0f, 3500.0f, 4500.0f};
+static const float BENCH_BWS[FORMANT_MAX_FORMANTS] = {60.0f, 120.0f, 180.0f, 180.0f, 220.0f};
+static const float BENCH_GAINS[FORMANT_MAX_FORMANTS] = {1.0f, 0.9f, 0.7f, 0.5f, 0.3f};
+
+/* Keeps results observable so the compiler cannot drop the work */
+static volatile float g_sink;
+
+static void print_result(const char* name, uint64_t ticks, long samples) {
+    printf("  %-28s %8.2f %s/sample\n", name, (double)ticks / samples, BENCH_UNIT);
+}
+
+/* ============================================================================
+ * Formant Filter Bank
+ * ========================================================================= */
+
+/* Per-formant formant_filter_t path (the engine's original inner loop) */
+static uint64_t bench_filters(const float* input, float* output, long num_samples, int num_formants) {
+    formant_filter_t filters[FORMANT_MAX_FORMANTS];
+    for (int f = 0; f < num_formants; f++) {
+        formant_filter_init(&filters[f], BENCH_FREQS[f], BENCH_BWS[f], BENCH_SAMPLE_RATE);
+        filters[f].gain = BENCH_GAINS[f];
+    }
+
+    uint64_t start = bench_ticks();
+    for (long offset = 0; offset < num_samples; offset += BENCH_BLOCK) {
+        for (int i = 0; i < BENCH_BLOCK; i++) {
+            float acc = 0.0f;
+            for (int f = 0; f < num_formants; f++) {
+                acc += formant_filter_process(&filters[f], input[offset + i]);
+            }
+            output[offset + i] = acc;
+        }
+    }
+    return bench_ticks() - start;
+}
+
+static uint64_t bench_bank(const float* input, float* output, long num_samples,
+                           int num_formants, formant_bank_kernel_t kernel) {
+    formant_bank_t bank;
+    formant_bank_init(&bank, num_formants, BENCH_SAMPLE_RATE);
+    formant_bank_set_kernel(&bank, kernel);
+    for (int f = 0; f < num_formants; f++) {
+        formant_bank_set_formant(&bank, f, BENCH_FREQS[f], BENCH_BWS[f], BENCH_GAINS[f]);
+    }
+
+    uint64_t start = bench_ticks();
+    for (long offset = 0; offset < num_samples; offset += BENCH_BLOCK) {
+        formant_bank_process(&bank, input + offset, output + offset, BENCH_BLOCK);
+    }
+    return bench_ticks() - start;
+}
+
+static float max_abs_diff(const float* a, const float* b, long n) {
+    float diff = 0.0f;
+    for (long i = 0; i < n; i++) {
+        float d = fabsf(a[i] - b[i]);
+        if (d > diff) diff = d;
+    }
+    return diff;
+}
+
+/* ============================================================================
+ * Formant Glides
+ * ========================================================================= */
+
+/* Glide curve: formants move +-30% around their centers at 4 Hz */
+static float* make_glide(long num_samples) {
+    float* glide = (float*)malloc(num_samples * sizeof(float));
+    if (!glide) {
+        fprintf(stderr, "ERROR: Out of memory\n");
+        exit(1);
+    }
+    for (long i = 0; i < num_samples; i++) {
+        glide[i] = 1.0f + 0.3f * sinf(2.0f * (float)M_PI * 4.0f * i / BENCH_SAMPLE_RATE);
+    }
+    return glide;
+}
+
+/* Previous glide path: trig plus history reset whenever a formant moves > 1 Hz */
+static void legacy_retune(formant_filter_t* filter, float freq) {
+    if (fabsf(freq - filter->freq) <= 1.0f) {
+        return;
+    }
+
+    float omega = 2.0f * (float)M_PI * freq / BENCH_SAMPLE_RATE;
+    float alpha = sinf(omega) * filter->bw / (2.0f * freq);
+    float a0 = 1.0f + alpha;
+    filter->freq = freq;
+    filter->b0 = alpha / a0;
+    filter->b2 = -filter->b0;
+    filter->a1 = -2.0f * cosf(omega) / a0;
+    filter->a2 = (1.0f - alpha) / a0;
+    filter->x1 = filter->x2 = filter->y1 = filter->y2 = 0.0f;
+}
+
+static void bench_glides(const float* input, float* output, long num_samples) {
+    printf("Formant glides, %d formants:\n", FORMANT_MAX_FORMANTS);
+    float* glide = make_glide(num_samples);
+
+    /* Per-sample retune */
+    formant_filter_t filters[FORMANT_MAX_FORMANTS];
+    for (int f = 0; f < FORMANT_MAX_FORMANTS; f++) {
+        formant_filter_init(&filters[f], BENCH_FREQS[f], BENCH_BWS[f], BENCH_SAMPLE_RATE);
+        filters[f].gain = BENCH_GAINS[f];
+    }
+
+    uint64_t start = bench_ticks();
+    for (long i = 0; i < num_samples; i++) {
+        float acc = 0.0f;
+        for (int f = 0; f < FORMANT_MAX_FORMANTS; f++) {
+            legacy_retune(&filters[f], BENCH_FREQS[f] * glide[i]);
+            acc += formant_filter_process(&filters[f], input[i]);
+        }
+        output[i] = acc;
+    }
+    print_result("per-sample retune + reset", bench_ticks() - start, num_samples);
+
+    /* Control-rate updates with coefficient ramps */
+    const int rates[] = {8, 32, 128};
+    for (size_t r = 0; r < sizeof(rates) / sizeof(rates[0]); r++) {
+        formant_bank_t bank;
+        formant_bank_init(&bank, FORMANT_MAX_FORMANTS, BENCH_SAMPLE_RATE);
+
+        start = bench_ticks();
+        for (long offset = 0; offset < num_samples; offset += rates[r]) {
+            for (int f = 0; f < FORMANT_MAX_FORMANTS; f++) {
+                formant_bank_set_formant(&bank, f, BENCH_FREQS[f] * glide[offset], BENCH_BWS[f], BENCH_GAINS[f]);
+            }
+            formant_bank_process(&bank, input + offset, output + offset, rates[r]);
+        }
+
+        char name[64];
+        snprintf(name, sizeof(name), "bank simd, control rate %d", rates[r]);
+        print_result(name, bench_ticks() - start, num_samples);
+    }
+
+    free(glide);
+}
+
+static void bench_filter_bank(long num_samples) {
+    float* input = (float*)malloc(num_samples * sizeof(float));
+    float* reference = (float*)malloc(num_samples * sizeof(float));
+    float* output = (float*)malloc(num_samples * sizeof(float));
+    if (!input || !reference || !output) {
+        fprintf(stderr, "ERROR: Out of memory\n");
+        exit(1);
+    }
+
+    /* Glottal pulse train at 120 Hz */
+    float phase = 0.0f;
+    for (long i = 0; i < num_samples; i++) {
+        input[i] = formant_generate_glottal(phase, 0.6f, 0.8f);
+        phase += 120.0f / BENCH_SAMPLE_RATE;
+        if (phase >= 1.0f) phase -= 1.0f;
+    }
+
+    const int counts[] = {3, FORMANT_MAX_FORMANTS};
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        int n = counts[c];
+        printf("Formant bank, %d formants:\n", n);
+
+        print_result("formant_filter_t (per filter)", bench_filters(input, reference, num_samples, n), num_samples);
+        print_result("bank scalar", bench_bank(input, output, num_samples, n, FORMANT_BANK_KERNEL_SCALAR), num_samples);
+        printf("    max |diff| vs per filter: %.2e\n", max_abs_diff(reference, output, num_samples));
+        print_result(formant_bank_kernel_name(FORMANT_BANK_KERNEL_SIMD),
+                     bench_bank(input, output, num_samples, n, FORMANT_BANK_KERNEL_SIMD), num_samples);
+        printf("    max |diff| vs per filter: %.2e\n", max_abs_diff(reference, output, num_samples));
+    }
+
+    bench_glides(input, output, num_samples);
+
+    g_sink = output[num_samples - 1];
+    free(input);
+    free(reference);
+    free(output);
+}
+
+/* ============================================================================
+ * Glottal Source
+ * ========================================================================= */
+
+/* Table error against the analytic model over a 16x oversampled cycle */
+static void glottal_error(const float* table, float oq, float alpha,
+                          float* max_error, float* rms_error) {
+    const int steps = FORMANT_GLOTTAL_TABLE_SIZE * 16;
+    float closure = oq * FORMANT_GLOTTAL_TABLE_SIZE;
+    double sum_sq = 0.0;
+    float worst = 0.0f;
+
+    for (int n = 0; n < steps; n++) {
+        float phase = (float)n / steps;
+        float err = fabsf(formant_glottal_read(table, phase) - formant_generate_glottal(phase, oq, alpha));
+        sum_sq += (double)err * err;
+
+        /* The model jumps at closure; skip the cell(s) that straddle it */
+        int cell = (int)(phase * FORMANT_GLOTTAL_TABLE_SIZE);
+        bool straddles = cell <= closure && closure <= cell + 1;
+        if (!straddles && err > worst) {
+            worst = err;
+        }
+    }
+
+    *max_error = worst;
+    *rms_error = (float)sqrt(sum_sq / steps);
+}
+
+static void bench_glottal(long num_samples) {
+    float* output = (float*)malloc(num_samples * sizeof(float));
+    if (!output || formant_glottal_tables_init() != 0) {
+        fprintf(stderr, "ERROR: Glottal setup failed\n");
+        exit(1);
+    }
+
+    printf("Glottal source (120 Hz, oq 0.6, alpha 0.8):\n");
+
+    float increment = 120.0f / BENCH_SAMPLE_RATE;
+    float phase = 0.0f;
+    uint64_t start = bench_ticks();
+    for (long i = 0; i < num_samples; i++) {
+        output[i] = formant_generate_glottal(phase, 0.6f, 0.8f);
+        phase += increment;
+        if (phase >= 1.0f) phase -= 1.0f;
+    }
+    print_result("analytic (cosf/expf/powf)", bench_ticks() - start, num_samples);
+
+    const float* table = formant_glottal_table(0.6f, 0.8f, 120.0f, BENCH_SAMPLE_RATE);
+    phase = 0.0f;
+    start = bench_ticks();
+    for (long i = 0; i < num_samples; i++) {
+        output[i] = formant_glottal_read(table, phase);
+        phase += increment;
+        if (phase >= 1.0f) phase -= 1.0f;
+    }
+    print_result("wavetable", bench_ticks() - start, num_samples);
+    g_sink = output[num_samples - 1];
+
+    /* Accuracy of every grid shape, level 0 (f0 low enough for full band) */
+    float worst_max = 0.0f, worst_rms = 0.0f;
+    for (int o = 0; o <= 8; o++) {
+        for (int a = 0; a <= 5; a++) {
+            float oq = 0.30f + o * 0.05f;
+            float alpha = 0.5f + a * 0.1f;
+            float max_error, rms_error;
+            glottal_error(formant_glottal_table(oq, alpha, 0.0f, BENCH_SAMPLE_RATE),
+                          oq, alpha, &max_error, &rms_error);
+            if (max_error > worst_max) worst_max = max_error;
+            if (rms_error > worst_rms) worst_rms = rms_error;
+        }
+    }
+    printf("    level 0 vs analytic, all shapes: max %.2e (excl. closure), rms %.2e\n",
+           worst_max, worst_rms);
+
+    float max_error, rms_error;
+    glottal_error(table, 0.6f, 0.8f, &max_error, &rms_error);
+    printf("    band-limited for 120 Hz vs analytic: max %.2e (excl. closure), rms %.2e\n",
+           max_error, rms_error);
+
+    /* FFT round trip used to build the band-limited levels */
+    formant_fft_t* fft = formant_fft_create(FORMANT_GLOTTAL_TABLE_SIZE);
+    float re[FORMANT_GLOTTAL_TABLE_SIZE / 2 + 1], im[FORMANT_GLOTTAL_TABLE_SIZE / 2 + 1];
+    float roundtrip[FORMANT_GLOTTAL_TABLE_SIZE];
+    const float* level0 = formant_glottal_table(0.6f, 0.8f, 0.0f, BENCH_SAMPLE_RATE);
+    formant_fft_forward(fft, level0, re, im);
+    formant_fft_inverse(fft, re, im, roundtrip);
+    printf("    FFT round trip max error: %.2e\n",
+           max_abs_diff(level0, roundtrip, FORMANT_GLOTTAL_TABLE_SIZE));
+    formant_fft_destroy(fft);
+
+    free(output);
+}
+
+/* ============================================================================
+ * Noise
+ * ========================================================================= */
+
+static void bench_noise(long num_samples) {
+    float* output = (float*)malloc(num_samples * sizeof(float));
+    if (!output) {
+        fprintf(stderr, "ERROR: Out of memory\n");
+        exit(1);
+    }
+
+    printf("White noise:\n");
+
+    /* Previous generator: one LCG step per sample */
+    unsigned long lcg = 1;
+    uint64_t start = bench_ticks();
+    for (long i = 0; i < num_samples; i++) {
+        lcg = lcg * 1103515245 + 12345;
+        output[i] = ((float)(lcg & 0x7FFFFFFF) / (float)0x7FFFFFFF) * 2.0f - 1.0f;
+    }
+    print_result("LCG per sample", bench_ticks() - start, num_samples);
+
+    formant_noise_t noise;
+    formant_noise_init(&noise, FORMANT_NOISE_SEED_DEFAULT);
+    start = bench_ticks();
+    for (long offset = 0; offset < num_samples; offset += FORMANT_NOISE_BLOCK) {
+        formant_noise_fill(&noise, output + offset, FORMANT_NOISE_BLOCK);
+    }
+    print_result("xorshift lanes, block fill", bench_ticks() - start, num_samples);
+
+    start = bench_ticks();
+    for (long i = 0; i < num_samples; i++) {
+        output[i] = formant_generate_white_noise(&noise);
+    }
+    print_result("xorshift, per-sample draw", bench_ticks() - start, num_samples);
+
+    g_sink = output[num_samples - 1];
+    free(output);
+}
+
+/* ============================================================================
+ * Metering
+ * ========================================================================= */
+
+static void bench_meter(long num_samples) {
+    float* input = (float*)malloc(num_samples * sizeof(float));
+    formant_meter_t* meter = formant_meter_create(BENCH_SAMPLE_RATE, "vu");
+    if (!input || !meter) {
+        fprintf(stderr, "ERROR: Out of memory\n");
+        exit(1);
+    }
+
+    formant_noise_t noise;
+    formant_noise_init(&noise, FORMANT_NOISE_SEED_DEFAULT);
+    for (long i = 0; i < num_samples; i++) {
+        input[i] = 0.5f * sinf(2.0f * (float)M_PI * 220.0f * i / BENCH_SAMPLE_RATE) +
+                   0.05f * formant_generate_white_noise(&noise);
+    }
+
+    printf("Meter (vu, %d-sample window):\n", meter->rms_buffer_size);
+
+    /* Previous RMS: re-sum the whole window every sample (1 s is plenty) */
+    long legacy_samples = num_samples < (long)BENCH_SAMPLE_RATE ? num_samples : (long)BENCH_SAMPLE_RATE;
+    int window = meter->rms_buffer_size;
+    float* ring = (float*)calloc(window, sizeof(float));
+    float legacy_rms = 0.0f;
+    int pos = 0;
+    uint64_t start = bench_ticks();
+    for (long i = 0; i < legacy_samples; i++) {
+        ring[pos] = input[i] * input[i];
+        pos = (pos + 1) % window;
+        float sum = 0.0f;
+        for (int j = 0; j < window; j++) {
+            sum += ring[j];
+        }
+        legacy_rms = sqrtf(sum / window);
+    }
+    print_result("window re-sum per sample", bench_ticks() - start, legacy_samples);
+    free(ring);
+
+    formant_meter_process(meter, input, (int)legacy_samples);
+    printf("    RMS after %ld samples: %.6f (re-sum %.6f)\n",
+           legacy_samples, meter->rms_current, legacy_rms);
+
+    formant_meter_reset(meter);
+    start = bench_ticks();
+    for (long offset = 0; offset < num_samples; offset += FORMANT_BUFFER_SIZE_DEFAULT) {
+        formant_meter_process(meter, input + offset, FORMANT_BUFFER_SIZE_DEFAULT);
+    }
+    print_result("meter incl. 4x true peak", bench_ticks() - start, num_samples);
+
+    formant_loudness_t* loudness = formant_loudness_create(BENCH_SAMPLE_RATE);
+    if (!loudness) {
+        exit(1);
+    }
+    start = bench_ticks();
+    for (long offset = 0; offset < num_samples; offset += FORMANT_BUFFER_SIZE_DEFAULT) {
+        formant_loudness_process(loudness, input + offset, FORMANT_BUFFER_SIZE_DEFAULT);
+    }
+    print_result("EBU R128 loudness", bench_ticks() - start, num_samples);
+    printf("    integrated %.2f LUFS, range %.2f LU\n",
+           formant_loudness_integrated(loudness), formant_loudness_range(loudness));
+    formant_loudness_destroy(loudness);
+
+    g_sink = meter->rms_current;
+    formant_meter_destroy(meter);
+    free(input);
+}
+
+/* Decaying noise burst: an arbitrary, long weighting response */
+static void make_fir(float* coeffs, int taps) {
+    formant_noise_t noise;
+    formant_noise_init(&noise, FORMANT_NOISE_SEED_DEFAULT + (uint64_t)taps);
+    for (int i = 0; i < taps; i++) {
+        coeffs[i] = formant_generate_white_noise(&noise) * expf(-4.0f * i / taps) / sqrtf((float)taps);
+    }
+}
+
+static void bench_fir(long num_samples) {
+    static const int TAPS[] = {16, 64, 255, 256, 1024, 4096};
+    float* input = (float*)malloc(num_samples * sizeof(float));
+    float* output = (float*)malloc(num_samples * sizeof(float));
+    float* reference = (float*)malloc(num_samples * sizeof(float));
+    float* coeffs = (float*)malloc(4096 * sizeof(float));
+    if (!input || !output || !reference || !coeffs) {
+        fprintf(stderr, "ERROR: Out of memory\n");
+        exit(1);
+    }
+
+    formant_noise_t noise;
+    formant_noise_init(&noise, FORMANT_NOISE_SEED_DEFAULT);
+    formant_noise_fill(&noise, input, (int)num_samples);
+    memset(output, 0, num_samples * sizeof(float));    /* Fault pages in before timing */
+
+    printf("Meter FIR weighting (512-sample blocks):\n");
+
+    for (size_t t = 0; t < sizeof(TAPS) / sizeof(TAPS[0]); t++) {
+        int taps = TAPS[t];
+        make_fir(coeffs, taps);
+
+        formant_fir_filter_t filter;
+        memset(&filter, 0, sizeof(filter));
+        if (formant_fir_filter_init(&filter, coeffs, taps) != 0) {
+            exit(1);
+        }
+
+        uint64_t start = bench_ticks();
+        for (long offset = 0; offset < num_samples; offset += FORMANT_BUFFER_SIZE_DEFAULT) {
+            formant_fir_filter_process(&filter, input + offset, output + offset, FORMANT_BUFFER_SIZE_DEFAULT);
+        }
+        uint64_t ticks = bench_ticks() - start;
+
+        /* Textbook convolution over the first second to check the result */
+        int latency = filter.fft ? FORMANT_FIR_PARTITION : 0;
+        long check = num_samples - latency < (long)BENCH_SAMPLE_RATE ? num_samples - latency : (long)BENCH_SAMPLE_RATE;
+        for (long i = 0; i < check; i++) {
+            float acc = 0.0f;
+            for (int k = 0; k < taps && k <= i; k++) {
+                acc += coeffs[k] * input[i - k];
+            }
+            reference[i] = acc;
+        }
+
+        char name[64];
+        snprintf(name, sizeof(name), "%4d taps, %s", taps, filter.fft ? "partitioned FFT" : "direct form");
+        print_result(name, ticks, num_samples);
+        printf("    max error vs direct convolution: %.2e\n",
+               max_abs_diff(output + latency, reference, check));
+
+        formant_fir_filter_release(&filter);
+    }
+
+    g_sink = output[num_samples - 1];
+    free(input);
+    free(output);
+    free(reference);
+    free(coeffs);
+}
+
+/* BS.1770-4 Annex 2 phase 0 and 1; phases 2 and 3 are their mirror images */
+static const float TP_REF_COEFFS[2][12] = {
+    { 0.0017089843750f,  0.0109863281250f, -0.0196533203125f,  0.0332031250000f,
+     -0.0594482421875f,  0.1373291015625f,  0.9721679687500f, -0.1022949218750f,
+      0.0476074218750f, -0.0266113281250f,  0.0148925781250f, -0.0083007812500f},
+    {-0.0291748046875f,  0.0292968750000f, -0.0517578125000f,  0.0891113281250f,
+     -0.1665039062500f,  0.4650878906250f,  0.7797851562500f, -0.2003173828125f,
+      0.1015625000000f, -0.0582275390625f,  0.0330810546875f, -0.0189208984375f},
+};
+
+static void bench_true_peak(long num_samples) {
+    float* input = (float*)malloc(num_samples * sizeof(float));
+    formant_meter_t* meter = formant_meter_create(BENCH_SAMPLE_RATE, "peak");
+    if (!input || !meter) {
+        fprintf(stderr, "ERROR: Out of memory\n");
+        exit(1);
+    }
+
+    /* fs/4 sine at 45 degrees: every sample is +-0.707, the waveform reaches 1.0 */
+    for (long i = 0; i < num_samples; i++) {
+        input[i] = sinf(0.5f * (float)M_PI * i + 0.25f * (float)M_PI);
+    }
+
+    printf("True peak (4x polyphase, 48 taps):\n");
+
+    /* Scalar reference: one dot product per phase per sample */
+    uint64_t start = bench_ticks();
+    float reference = 0.0f;
+    for (long i = 11; i < num_samples; i++) {
+        for (int p = 0; p < 4; p++) {
+            const float* c = TP_REF_COEFFS[p < 2 ? p : 3 - p];
+            float y = 0.0f;
+            for (int k = 0; k < 12; k++) {
+                y += c[p < 2 ? k : 11 - k] * input[i - k];
+            }
+            if (fabsf(y) > reference) reference = fabsf(y);
+        }
+    }
+    print_result("scalar reference", bench_ticks() - start, num_samples);
+
+    start = bench_ticks();
+    for (long offset = 0; offset < num_samples; offset += FORMANT_BUFFER_SIZE_DEFAULT) {
+        formant_meter_process(meter, input + offset, FORMANT_BUFFER_SIZE_DEFAULT);
+    }
+    print_result("meter (peak preset)", bench_ticks() - start, num_samples);
+
+    printf("    sample peak %.2f dBFS, true peak %.2f dBTP (reference %.2f)\n",
+           20.0f * log10f(meter->max_level), 20.0f * log10f(meter->max_true_peak),
+           20.0f * log10f(reference));
+
+    formant_meter_destroy(meter);
+    free(input);
+}
+
+/* ============================================================================
+ * Full Engine
+ * ========================================================================= */
+
+typedef struct {
+    formant_monitor_t* monitor;
+    atomic_bool running;
+    long reads;
+    long torn;
+} monitor_reader_t;
+
+/* Reads as fast as possible; a torn copy breaks the block invariants */
+static void* monitor_reader_main(void* arg) {
+    monitor_reader_t* reader = (monitor_reader_t*)arg;
+    uint64_t last = 0;
+
+    while (atomic_load_explicit(&reader->running, memory_order_relaxed)) {
+        formant_meter_snapshot_t snapshot;
+        if (!formant_monitor_read(reader->monitor, &snapshot)) {
+            continue;
+        }
+        reader->reads++;
+        if (snapshot.samples % FORMANT_BUFFER_SIZE_DEFAULT != 0 || snapshot.samples < last ||
+            snapshot.load > snapshot.load_max) {
+            reader->torn++;
+        }
+        last = snapshot.samples;
+    }
+
+    return NULL;
+}
+
+/**
+ * Engine render with the output monitor publishing every block while
+ * another thread polls the seqlock
+ */
+static void bench_monitor(long num_samples) {
+    float block[FORMANT_BUFFER_SIZE_DEFAULT];
+
+    formant_engine_t* engine = formant_engine_create(BENCH_SAMPLE_RATE);
+    if (!engine || formant_engine_enable_monitor(engine, "vu") != 0) {
+        fprintf(stderr, "ERROR: Failed to create monitored engine\n");
+        exit(1);
+    }
+
+    formant_command_t* cmd = formant_parse_command("PH a 0 120 0.8 0.3");
+    if (cmd) {
+        formant_queue_command(engine, cmd);
+        free(cmd);
+    }
+
+    uint64_t start = bench_ticks();
+    for (long done = 0; done < num_samples; done += FORMANT_BUFFER_SIZE_DEFAULT) {
+        formant_engine_process(engine, block, FORMANT_BUFFER_SIZE_DEFAULT);
+    }
+    print_result("simd + monitor", bench_ticks() - start, num_samples);
+
+    /* Untimed: on few cores the reader competes with the render */
+    monitor_reader_t reader = { .monitor = engine->monitor };
+    atomic_init(&reader.running, true);
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, monitor_reader_main, &reader) == 0) {
+        for (long done = 0; done < num_samples; done += FORMANT_BUFFER_SIZE_DEFAULT) {
+            formant_engine_process(engine, block, FORMANT_BUFFER_SIZE_DEFAULT);
+        }
+        atomic_store_explicit(&reader.running, false, memory_order_relaxed);
+        pthread_join(thread, NULL);
+        printf("    concurrent reads: %ld, torn: %ld\n", reader.reads, reader.torn);
+    }
+
+    g_sink = block[0];
+    formant_engine_destroy(engine);
+}
+
+static void bench_engine(long num_samples) {
+    const formant_bank_kernel_t kernels[] = {FORMANT_BANK_KERNEL_SCALAR, FORMANT_BANK_KERNEL_SIMD};
+    float block[FORMANT_BUFFER_SIZE_DEFAULT];
+
+    printf("Engine render (PH a, %d-sample blocks):\n", FORMANT_BUFFER_SIZE_DEFAULT);
+
+    for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+        formant_engine_t* engine = formant_engine_create(BENCH_SAMPLE_RATE);
+        if (!engine) {
+            fprintf(stderr, "ERROR: Failed to create engine\n");
+            exit(1);
+        }
+        formant_bank_set_kernel(&engine->formant_bank, kernels[k]);
+
+        formant_command_t* cmd = formant_parse_command("PH a 0 120 0.8 0.3");
+        if (cmd) {
+            formant_queue_command(engine, cmd);
+            free(cmd);
+        }
+
+        uint64_t start = bench_ticks();
+        for (long done = 0; done < num_samples; done += FORMANT_BUFFER_SIZE_DEFAULT) {
+            formant_engine_process(engine, block, FORMANT_BUFFER_SIZE_DEFAULT);
+        }
+        print_result(formant_bank_kernel_name(kernels[k]), bench_ticks() - start, num_samples);
+
+        g_sink = block[0];
+        formant_engine_destroy(engine);
+    }
+
+    /* Noise path: frication filtered from block-filled white noise */
+    formant_engine_t* engine = formant_engine_create(BENCH_SAMPLE_RATE);
+    if (!engine) {
+        fprintf(stderr, "ERROR: Failed to create engine\n");
+        exit(1);
+    }
+
+    formant_command_t* cmd = formant_parse_command("PH s 0 120 0.8 0.3");
+    if (cmd) {
+        formant_queue_command(engine, cmd);
+        free(cmd);
+    }
+
+    uint64_t start = bench_ticks();
+    for (long done = 0; done < num_samples; done += FORMANT_BUFFER_SIZE_DEFAULT) {
+        formant_engine_process(engine, block, FORMANT_BUFFER_SIZE_DEFAULT);
+    }
+    print_result("simd, PH s (frication)", bench_ticks() - start, num_samples);
+
+    g_sink = block[0];
+    formant_engine_destroy(engine);
+
+    bench_monitor(num_samples);
+}
+
+/* ============================================================================
+ * Voice Activity Detection
+ * ========================================================================= */
+
+typedef enum {
+    VAD_SIGNAL_VOWEL,
+    VAD_SIGNAL_WHITE,
+    VAD_SIGNAL_FAN,
+    VAD_SIGNAL_CLICKS,
+    VAD_SIGNAL_SILENCE,
+    VAD_SIGNAL_COUNT
+} vad_signal_t;
+
+static const char* const VAD_SIGNAL_NAMES[VAD_SIGNAL_COUNT] = {
+    "vowel a", "white noise", "fan (brown noise)", "clicks, 10/s", "silence"
+};
+
+static void make_vad_signal(vad_signal_t signal, float* out, long n) {
+    formant_noise_t noise;
+    formant_noise_init(&noise, FORMANT_NOISE_SEED_DEFAULT);
+    memset(out, 0, n * sizeof(float));
+
+    switch (signal) {
+    case VAD_SIGNAL_VOWEL: {
+        formant_engine_t* engine = formant_engine_create(BENCH_SAMPLE_RATE);
+        if (!engine) {
+            fprintf(stderr, "ERROR: Failed to create engine\n");
+            exit(1);
+        }
+        formant_command_t* cmd = formant_parse_command("PH a 0 120 0.8 0.3");
+        if (cmd) {
+            formant_queue_command(engine, cmd);
+            free(cmd);
+        }
+        for (long done = 0; done + FORMANT_BUFFER_SIZE_DEFAULT <= n; done += FORMANT_BUFFER_SIZE_DEFAULT) {
+            formant_engine_process(engine, out + done, FORMANT_BUFFER_SIZE_DEFAULT);
+        }
+        formant_engine_destroy(engine);
+        break;
+    }
+    case VAD_SIGNAL_WHITE:
+        formant_noise_fill(&noise, out, (int)n);
+        for (long i = 0; i < n; i++) out[i] *= 0.2f;
+        break;
+    case VAD_SIGNAL_FAN: {
+        float state = 0.0f;
+        for (long i = 0; i < n; i++) {
+            state = 0.995f * state + 0.02f * formant_generate_white_noise(&noise);
+            out[i] = state;
+        }
+        break;
+    }
+    case VAD_SIGNAL_CLICKS: {
+        long period = (long)(BENCH_SAMPLE_RATE / 10.0f);
+        for (long i = 0; i < n; i += period) {
+            for (int k = 0; k < 48 && i + k < n; k++) {
+                out[i + k] = 0.5f * expf(-k / 8.0f) * (k & 1 ? -1.0f : 1.0f);
+            }
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+/**
+ * Per-frame feature cost at 48 kHz, and what each feature sees on speech
+ * against the usual false triggers
+ */
+static void bench_vad(long num_samples) {
+    float* signal = (float*)malloc(num_samples * sizeof(float));
+    if (!signal) {
+        fprintf(stderr, "ERROR: Out of memory\n");
+        exit(1);
+    }
+
+    formant_vad_t* vad = formant_vad_create(BENCH_SAMPLE_RATE, 1);
+    if (!vad) {
+        fprintf(stderr, "ERROR: Failed to create VAD\n");
+        exit(1);
+    }
+    int frame = vad->frame_size;
+    long frames = num_samples / frame;
+
+    printf("VAD (%d-sample frames, %d-point FFT):\n", frame, vad->fft_size);
+
+    make_vad_signal(VAD_SIGNAL_WHITE, signal, num_samples);
+    formant_vad_features_t features;
+    uint64_t start = bench_ticks();
+    for (long f = 0; f < frames; f++) {
+        formant_vad_compute_features(vad, signal + f * frame, &features);
+    }
+    uint64_t ticks = bench_ticks() - start;
+    printf("  %-28s %8.0f %s/frame %6.2f %s/sample\n", "features", (double)ticks / frames,
+           BENCH_UNIT, (double)ticks / (frames * frame), BENCH_UNIT);
+
+    start = bench_ticks();
+    for (long f = 0; f < frames; f++) {
+        formant_vad_process_frame(vad, signal + f * frame, frame);
+    }
+    ticks = bench_ticks() - start;
+    printf("  %-28s %8.0f %s/frame %6.2f %s/sample\n", "process_frame", (double)ticks / frames,
+           BENCH_UNIT, (double)ticks / (frames * frame), BENCH_UNIT);
+
+    printf("  %-20s %7s %6s %6s %6s %6s %6s %6s %7s\n", "signal", "rms", "zcr", "flat",
+           "flux", "low", "voice", "high", "speech");
+    for (int s = 0; s < VAD_SIGNAL_COUNT; s++) {
+        make_vad_signal((vad_signal_t)s, signal, num_samples);
+        formant_vad_reset(vad);
+
+        formant_vad_features_t mean = {0};
+        long speech = 0;
+        for (long f = 0; f < frames; f++) {
+            if (formant_vad_process_frame(vad, signal + f * frame, frame) == FORMANT_VAD_RESULT_SPEECH) {
+                speech++;
+            }
+            mean.energy += vad->features.energy / frames;
+            mean.zcr += vad->features.zcr / frames;
+            mean.flatness += vad->features.flatness / frames;
+            mean.flux += vad->features.flux / frames;
+            for (int b = 0; b < FORMANT_VAD_BANDS; b++) {
+                mean.band_share[b] += vad->features.band_share[b] / frames;
+            }
+        }
+        printf("  %-20s %7.4f %6.3f %6.3f %6.2f %6.2f %6.2f %6.2f %6.1f%%\n", VAD_SIGNAL_NAMES[s],
+               mean.energy, mean.zcr, mean.flatness, mean.flux, mean.band_share[0],
+               mean.band_share[1], mean.band_share[2], 100.0 * speech / frames);
+    }
+
+    g_sink = features.flatness;
+    formant_vad_destroy(vad);
+    free(signal);
+}
+
+/* ============================================================================
+ * Sound Bank Loop Points
+ * ========================================================================= */
+
+#define LOOP_GRAIN_SAMPLES 48000    /* One-second grains */
+
+/* Previous period search: direct autocorrelation at every lag */
+static int legacy_period(const float* audio, int length, int sample_rate) {
+    int search_start = length / 3;
+    int search_len = length / 3;
+    int min_period = sample_rate / 500;
+    int max_period = sample_rate / 80;
+
+    float max_corr = 0.0f;
+    int best_lag = min_period;
+    for (int lag = min_period; lag < max_period && lag < search_len / 2; lag++) {
+        float corr = 0.0f;
+        int count = 0;
+        for (int i = search_start; i < search_start + search_len - lag; i++) {
+            corr += audio[i] * audio[i + lag];
+            count++;
+        }
+        if (count > 0) {
+            corr /= count;
+            if (corr > max_corr) {
+                max_corr = corr;
+                best_lag = lag;
+            }
+        }
+    }
+    return best_lag;
+}
+
+static void render_vowel(float* out, int n, const char* vowel, int pitch) {
+    formant_engine_t* engine = formant_engine_create(BENCH_SAMPLE_RATE);
+    if (!engine) {
+        fprintf(stderr, "ERROR: Failed to create engine\n");
+        exit(1);
+    }
+
+    char line[64];
+    snprintf(line, sizeof(line), "PH %s 0 %d 0.8 0.3", vowel, pitch);
+    formant_command_t* cmd = formant_parse_command(line);
+    if (cmd) {
+        formant_queue_command(engine, cmd);
+        free(cmd);
+    }
+
+    memset(out, 0, n * sizeof(float));
+    for (int done = 0; done + FORMANT_BUFFER_SIZE_DEFAULT <= n; done += FORMANT_BUFFER_SIZE_DEFAULT) {
+        formant_engine_process(engine, out + done, FORMANT_BUFFER_SIZE_DEFAULT);
+    }
+    formant_engine_destroy(engine);
+}
+
+/**
+ * Period found per grain by the direct search, by FFT autocorrelation and
+ * by FFT plus NCC refinement, against the pitch the grain was rendered at
+ */
+static void bench_loop_points(void) {
+    static const struct { const char* vowel; int pitch; } grains[] = {
+        {"a", 85}, {"a", 120}, {"i", 140}, {"o", 110}, {"u", 200}, {"e", 260}, {"a", 330}, {"i", 440},
+    };
+    const int num_grains = (int)(sizeof(grains) / sizeof(grains[0]));
+    const int sample_rate = (int)BENCH_SAMPLE_RATE;
+
+    float* audio = (float*)malloc((size_t)num_grains * LOOP_GRAIN_SAMPLES * sizeof(float));
+    sound_grain_analyzer_t* analyzer = sound_grain_analyzer_create();
+    if (!audio || !analyzer) {
+        fprintf(stderr, "ERROR: Loop point setup failed\n");
+        exit(1);
+    }
+    for (int g = 0; g < num_grains; g++) {
+        render_vowel(audio + (size_t)g * LOOP_GRAIN_SAMPLES, LOOP_GRAIN_SAMPLES, grains[g].vowel, grains[g].pitch);
+    }
+
+    printf("Loop points (%d grains of %d samples):\n", num_grains, LOOP_GRAIN_SAMPLES);
+
+    int periods[3][8];
+    uint64_t ticks[3];
+    uint32_t loop_start, loop_end;
+
+    uint64_t start = bench_ticks();
+    for (int g = 0; g < num_grains; g++) {
+        periods[0][g] = legacy_period(audio + (size_t)g * LOOP_GRAIN_SAMPLES, LOOP_GRAIN_SAMPLES, sample_rate);
+    }
+    ticks[0] = bench_ticks() - start;
+
+    for (int pass = 1; pass <= 2; pass++) {
+        analyzer->refine = pass == 2;
+        start = bench_ticks();
+        for (int g = 0; g < num_grains; g++) {
+            periods[pass][g] = sound_grain_find_loop_points(analyzer, audio + (size_t)g * LOOP_GRAIN_SAMPLES,
+                                                            LOOP_GRAIN_SAMPLES, sample_rate,
+                                                            &loop_start, &loop_end);
+        }
+        ticks[pass] = bench_ticks() - start;
+    }
+
+    static const char* const names[3] = {"direct autocorrelation", "FFT autocorrelation", "FFT + NCC refinement"};
+    for (int pass = 0; pass < 3; pass++) {
+        printf("  %-28s %10.0f %s/grain\n", names[pass], (double)ticks[pass] / num_grains, BENCH_UNIT);
+    }
+    printf("  %-10s %8s %8s %8s %8s\n", "grain", "true", "direct", "fft", "refined");
+    for (int g = 0; g < num_grains; g++) {
+        printf("  %-3s %3d Hz %8.1f %8d %8d %8d\n", grains[g].vowel, grains[g].pitch,
+               (float)sample_rate / grains[g].pitch, periods[0][g], periods[1][g], periods[2][g]);
+    }
+
+    g_sink = (float)loop_end;
+    sound_grain_analyzer_destroy(analyzer);
+    free(audio);
+}
+
+/* ============================================================================
+ * Grain Lookup
+ * ========================================================================= */
+
+#define LOOKUP_QUERIES 256
+
+/* Previous lookup: walk the whole BST comparing IPA strings */
+static phoneme_bst_node_t* legacy_find(phoneme_bst_node_t* node, const char* phoneme) {
+    if (!node) return NULL;
+    if (node->phoneme && strncmp(node->phoneme->ipa, phoneme, FORMANT_IPA_MAX_LEN) == 0) return node;
+    phoneme_bst_node_t* found = legacy_find(node->left, phoneme);
+    return found ? found : legacy_find(node->right, phoneme);
+}
+
+/**
+ * Bank of num_grains short grains, phonemes dealt round the table with
+ * random pitches; only the features matter here
+ */
+static sound_bank_t* lookup_bank(int num_grains, uint32_t* seed) {
+    int num_phonemes;
+    const formant_phoneme_config_t* table = formant_get_all_phonemes(&num_phonemes);
+
+    sound_bank_t* bank = sound_bank_create(NULL);
+    bank->grains = (sound_grain_t*)calloc(num_grains, sizeof(sound_grain_t));
+    if (!bank->grains) {
+        fprintf(stderr, "ERROR: Out of memory\n");
+        exit(1);
+    }
+    bank->capacity = num_grains;
+
+    for (int i = 0; i < num_grains; i++) {
+        const formant_phoneme_config_t* phoneme = &table[i % num_phonemes];
+        sound_grain_t* grain = &bank->grains[i];
+        *seed = *seed * 1664525u + 1013904223u;
+        float f0 = 80.0f + (float)(*seed >> 8) / (1u << 24) * 320.0f;
+
+        memcpy(grain->phoneme, phoneme->ipa, sizeof(grain->phoneme));
+        grain->sample_rate = BENCH_SAMPLE_RATE;
+        grain->duration_samples = 2 * (uint32_t)(BENCH_SAMPLE_RATE / f0);
+        grain->audio_length = 64;
+        grain->audio_data = (float*)malloc(64 * sizeof(float));
+        for (int n = 0; n < 64; n++) {
+            grain->audio_data[n] = 0.1f * sinf(2.0f * (float)M_PI * f0 * n / BENCH_SAMPLE_RATE);
+        }
+        bank->num_grains++;
+        sound_bank_bst_insert(bank, phoneme, grain);
+    }
+    return bank;
+}
+
+static void bench_grain_lookup(void) {
+    static const int bank_sizes[] = {64, 1000, 10000};
+    int num_phonemes;
+    const formant_phoneme_config_t* table = formant_get_all_phonemes(&num_phonemes);
+    uint32_t seed = 12345;
+
+    printf("Grain lookup (%d-phoneme table, per query):\n", num_phonemes);
+
+    for (size_t b = 0; b < sizeof(bank_sizes) / sizeof(bank_sizes[0]); b++) {
+        int num_grains = bank_sizes[b];
+        sound_bank_t* bank = lookup_bank(num_grains, &seed);
+        sound_grain_index_t* index = sound_grain_index_create(bank);
+        if (!index) {
+            fprintf(stderr, "ERROR: Failed to index grains\n");
+            exit(1);
+        }
+
+        char names[LOOKUP_QUERIES][FORMANT_IPA_MAX_LEN + 1] = {{0}};
+        sound_grain_query_t queries[LOOKUP_QUERIES];
+        for (int q = 0; q < LOOKUP_QUERIES; q++) {
+            seed = seed * 1664525u + 1013904223u;
+            memcpy(names[q], table[(seed >> 8) % num_phonemes].ipa, FORMANT_IPA_MAX_LEN);
+            sound_grain_query_init(&queries[q], index, names[q], 80.0f + (float)(seed % 320));
+            if (q % 4 == 0) {
+                sound_grain_query_emotion(&queries[q], (formant_emotion_t)(1 + q / 4 % 6), 0.7f);
+            }
+        }
+
+        /* Same number of lookups per bank size; the per-query cost is what grows */
+        const int rounds = 40;
+        sound_grain_match_t matches[SOUND_GRAIN_MATCHES_MAX];
+        uintptr_t check = 0;
+        uint64_t ticks[4];
+
+        uint64_t start = bench_ticks();
+        for (int r = 0; r < rounds; r++) {
+            for (int q = 0; q < LOOKUP_QUERIES; q++) {
+                check += (uintptr_t)legacy_find(bank->root, names[q]);
+            }
+        }
+        ticks[0] = bench_ticks() - start;
+
+        start = bench_ticks();
+        for (int r = 0; r < rounds; r++) {
+            for (int q = 0; q < LOOKUP_QUERIES; q++) {
+                check += (uintptr_t)sound_bank_find_grain(bank, names[q]);
+            }
+        }
+        ticks[1] = bench_ticks() - start;
+
+        for (int pass = 0; pass < 2; pass++) {
+            int k = pass == 0 ? 1 : SOUND_GRAIN_MATCHES_MAX;
+            start = bench_ticks();
+            for (int r = 0; r < rounds; r++) {
+                for (int q = 0; q < LOOKUP_QUERIES; q++) {
+                    check += (uintptr_t)sound_grain_index_nearest(index, &queries[q], matches, k);
+                    check += (uintptr_t)matches[0].grain;
+                }
+            }
+            ticks[2 + pass] = bench_ticks() - start;
+        }
+
+        static const char* const labels[4] = {
+            "BST walk, exact IPA", "keyed BST, exact IPA", "index nearest, k=1", "index nearest, k=4"
+        };
+        double lookups = (double)rounds * LOOKUP_QUERIES;
+        for (int i = 0; i < 4; i++) {
+            char name[64];
+            snprintf(name, sizeof(name), "%5d grains, %s", num_grains, labels[i]);
+            printf("  %-40s %10.0f %s\n", name, (double)ticks[i] / lookups, BENCH_UNIT);
+        }
+
+        g_sink = (float)(check & 0xff);
+        sound_grain_index_destroy(index);
+        sound_bank_destroy(bank);
+    }
+}
+
+/* ============================================================================
+ * Choir Scaling
+ * ========================================================================= */
+
+static double wall_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Voices x threads grid; per voice-sample cost shows barrier overhead at
+ * low voice counts and how far the pool scales across cores at high ones
+ */
+static void bench_choir(long num_samples) {
+    static const int voice_counts[] = {1, 4, 16, 64};
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int max_threads = cpus > 1 ? (int)cpus : 2;   /* Always show 1 vs 2 threads */
+    if (max_threads > FORMANT_MAX_WORKERS) max_threads = FORMANT_MAX_WORKERS;
+    float block[FORMANT_BUFFER_SIZE_DEFAULT];
+
+    printf("Choir render (%ld online CPUs, %d-sample blocks):\n", cpus, FORMANT_BUFFER_SIZE_DEFAULT);
+
+    for (size_t i = 0; i < sizeof(voice_counts) / sizeof(voice_counts[0]); i++) {
+        int voices = voice_counts[i];
+
+        for (int threads = 1; threads <= max_threads && threads <= voices; threads *= 2) {
+            formant_choir_t* choir = formant_choir_create(voices, threads, BENCH_SAMPLE_RATE);
+            if (!choir) {
+                fprintf(stderr, "ERROR: Failed to create choir\n");
+                exit(1);
+            }
+
+            /* Spread pitches so voices do not share branch patterns */
+            for (int v = 0; v < voices; v++) {
+                char line[64];
+                snprintf(line, sizeof(line), "PH a 0 %d 0.8 0.3", 100 + 7 * v);
+                formant_command_t* cmd = formant_parse_command(line);
+                if (cmd) {
+                    formant_choir_queue_command(choir, v, cmd);
+                    free(cmd);
+                }
+            }
+
+            double wall_start = wall_seconds();
+            uint64_t start = bench_ticks();
+            for (long done = 0; done < num_samples; done += FORMANT_BUFFER_SIZE_DEFAULT) {
+                formant_choir_process(choir, block, FORMANT_BUFFER_SIZE_DEFAULT);
+            }
+            uint64_t ticks = bench_ticks() - start;
+            double wall = wall_seconds() - wall_start;
+
+            char name[64];
+            snprintf(name, sizeof(name), "%2d voices, %2d threads", voices, threads);
+            printf("  %-28s %8.2f %s/voice-sample  %7.1fx realtime\n", name,
+                   (double)ticks / ((double)num_samples * voices), BENCH_UNIT,
+                   wall > 0.0 ? num_samples / BENCH_SAMPLE_RATE / wall : 0.0);
+
+            g_sink = block[0];
+            formant_choir_destroy(choir);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    float seconds = argc > 1 ? atof(argv[1]) : 10.0f;
+    if (seconds <= 0.0f) {
+        fprintf(stderr, "Usage: %s [seconds_of_audio]\n", argv[0]);
+        return 1;
+    }
+
+    /* Whole blocks only */
+    long num_samples = (long)(seconds * BENCH_SAMPLE_RATE);
+    num_samples -= num_samples % FORMANT_BUFFER_SIZE_DEFAULT;
+    if (num_samples < FORMANT_BUFFER_SIZE_DEFAULT) {
+        num_samples = FORMANT_BUFFER_SIZE_DEFAULT;
+    }
+
+    printf("formant_bench: %ld samples (%.1fs @ %.0f Hz)\n\n",
+           num_samples, num_samples / BENCH_SAMPLE_RATE, BENCH_SAMPLE_RATE);
+
+    bench_filter_bank(num_samples);
+    printf("\n");
+    bench_glottal(num_samples);
+    printf("\n");
+    bench_noise(num_samples);
+    printf("\n");
+    bench_meter(num_samples);
+    printf("\n");
+    bench_true_peak(num_samples);
+    printf("\n");
+    bench_fir(num_samples);
+    printf("\n");
+    bench_engine(num_samples);
+    printf("\n");
+    bench_vad(num_samples);
+    printf("\n");
+    bench_loop_points();
+    printf("\n");
+    bench_grain_lookup();
+    printf("\n");
+    bench_choir(num_samples / 4);
+
+    return 0;
+}
@@ -0,0 +1,462 @@
+/**
+ * formant_vad.c
+ *
+ * Offline voice activity segmentation for audio corpora. Runs the same VAD
+ * state machine RECORD_VAD uses (noise floor, pre-trigger, hangover, modes
+ * 0-2) over every input WAV and writes segment boundaries and per-segment
+ * features as JSON or CSV. Files are spread over a pool of threads, one
+ * VAD instance per file.
+ *
+ * Usage: formant_vad [options] FILE.wav...
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "formant.h"
+
+#define FRAMES_PER_READ 64          /* VAD frames decoded per read */
+#define CALIBRATE_MS_DEFAULT 200    /* Lead-in taken as background noise */
+
+typedef enum {
+    OUTPUT_JSON,
+    OUTPUT_CSV
+} output_format_t;
+
+typedef struct {
+    uint64_t start;                 /* First sample, pre-trigger included */
+    uint64_t end;                   /* One past the last sample, hangover included */
+    float rms;                      /* Over the frames the VAD marked speech */
+    float peak;
+    float zcr;
+    float flatness;
+    float flux;
+    float voice_share;
+} segment_t;
+
+typedef struct {
+    const char* path;
+    bool ok;
+    int sample_rate;
+    uint64_t num_samples;
+    float noise_floor;
+    segment_t* segments;
+    int num_segments;
+    int capacity;
+} file_result_t;
+
+typedef struct {
+    file_result_t* files;
+    int num_files;
+    atomic_int next;                /* Next unclaimed file */
+    int mode;
+    int calibrate_ms;
+} job_t;
+
+/* ============================================================================
+ * Segmentation
+ * ========================================================================= */
+
+/* Running sums for the segment being built */
+typedef struct {
+    bool active;
+    uint64_t start;
+    int frames;
+    double energy;                  /* Sum of squares */
+    float peak;
+    double zcr, flatness, flux, voice_share;
+} segment_acc_t;
+
+static int push_segment(file_result_t* result, const segment_acc_t* acc, uint64_t end, int frame_size) {
+    if (result->num_segments == result->capacity) {
+        int capacity = result->capacity ? result->capacity * 2 : 16;
+        segment_t* grown = (segment_t*)realloc(result->segments, capacity * sizeof(segment_t));
+        if (!grown) {
+            fprintf(stderr, "ERROR: Out of memory\n");
+            return -1;
+        }
+        result->segments = grown;
+        result->capacity = capacity;
+    }
+
+    int n = acc->frames > 0 ? acc->frames : 1;
+    segment_t* seg = &result->segments[result->num_segments++];
+    seg->start = acc->start;
+    seg->end = end;
+    seg->rms = (float)sqrt(acc->energy / ((double)n * frame_size));
+    seg->peak = acc->peak;
+    seg->zcr = (float)(acc->zcr / n);
+    seg->flatness = (float)(acc->flatness / n);
+    seg->flux = (float)(acc->flux / n);
+    seg->voice_share = (float)(acc->voice_share / n);
+    return 0;
+}
+
+/**
+ * Feed one frame through the VAD and open/extend/close the current segment
+ */
+static int segment_frame(formant_vad_t* vad, file_result_t* result, segment_acc_t* acc,
+                         const float* frame, uint64_t frame_index) {
+    int size = vad->frame_size;
+    uint64_t position = frame_index * (uint64_t)size;
+    bool speech = formant_vad_process_frame(vad, frame, size) == FORMANT_VAD_RESULT_SPEECH;
+
+    if (speech && !acc->active) {
+        /* Onset is the first of the confirming frames, less the pre-trigger */
+        uint64_t lead = (uint64_t)(vad->min_speech_frames - 1) * size + (uint64_t)vad->pretrigger_size;
+        uint64_t previous_end = result->num_segments > 0 ? result->segments[result->num_segments - 1].end : 0;
+        uint64_t start = position > lead ? position - lead : 0;
+
+        memset(acc, 0, sizeof(*acc));
+        acc->active = true;
+        acc->start = start > previous_end ? start : previous_end;
+    } else if (!speech && acc->active) {
+        acc->active = false;
+        return push_segment(result, acc, position, size);
+    }
+
+    if (speech) {
+        const formant_vad_features_t* features = &vad->features;
+        acc->frames++;
+        acc->energy += (double)features->energy * features->energy * size;
+        acc->zcr += features->zcr;
+        acc->flatness += features->flatness;
+        acc->flux += features->flux;
+        acc->voice_share += features->band_share[FORMANT_VAD_VOICE_BAND];
+        for (int i = 0; i < size; i++) {
+            float level = fabsf(frame[i]);
+            if (level > acc->peak) acc->peak = level;
+        }
+    }
+    return 0;
+}
+
+static void process_file(const job_t* job, file_result_t* result) {
+    formant_wav_reader_t* reader = formant_wav_open(result->path);
+    if (!reader) {
+        return;
+    }
+
+    formant_vad_t* vad = formant_vad_create((float)reader->sample_rate, job->mode);
+    float* buffer = NULL;
+    if (!vad) {
+        goto done;
+    }
+
+    int frame = vad->frame_size;
+    int calibrate_frames = (int)((int64_t)reader->sample_rate * job->calibrate_ms / 1000 / frame);
+    int capacity = calibrate_frames > FRAMES_PER_READ ? calibrate_frames : FRAMES_PER_READ;
+    buffer = (float*)malloc((size_t)capacity * frame * sizeof(float));
+    if (!buffer) {
+        fprintf(stderr, "ERROR: Out of memory\n");
+        goto done;
+    }
+
+    result->sample_rate = reader->sample_rate;
+    segment_acc_t acc = {0};
+    uint64_t frame_index = 0;
+    int want = calibrate_frames > 0 ? calibrate_frames : FRAMES_PER_READ;
+
+    for (;;) {
+        int got = formant_wav_read(reader, buffer, want * frame);
+        if (got < 0) {
+            goto done;
+        }
+        int frames = got / frame;   /* A trailing partial frame is dropped */
+
+        if (frame_index == 0 && calibrate_frames > 0 && frames > 0) {
+            formant_vad_calibrate(vad, buffer, frames * frame);
+            formant_vad_reset(vad);
+            result->noise_floor = vad->noise_floor;
+        }
+
+        for (int f = 0; f < frames; f++, frame_index++) {
+            if (segment_frame(vad, result, &acc, buffer + (size_t)f * frame, frame_index) != 0) {
+                goto done;
+            }
+        }
+
+        if (got < want * frame) {
+            break;
+        }
+        want = FRAMES_PER_READ;
+    }
+
+    result->num_samples = reader->frames_read;
+    if (acc.active && push_segment(result, &acc, frame_index * (uint64_t)frame, frame) != 0) {
+        goto done;
+    }
+    result->ok = true;
+
+done:
+    free(buffer);
+    formant_vad_destroy(vad);
+    formant_wav_close(reader);
+}
+
+static void* worker_main(void* arg) {
+    job_t* job = (job_t*)arg;
+
+    for (;;) {
+        int index = atomic_fetch_add_explicit(&job->next, 1, memory_order_relaxed);
+        if (index >= job->num_files) {
+            break;
+        }
+        process_file(job, &job->files[index]);
+    }
+    return NULL;
+}
+
+/* ============================================================================
+ * Output
+ * ========================================================================= */
+
+static void write_json_string(FILE* out, const char* s) {
+    fputc('"', out);
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') {
+            fprintf(out, "\\%c", c);
+        } else if (c < 0x20) {
+            fprintf(out, "\\u%04x", c);
+        } else {
+            fputc(c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+static void write_json(FILE* out, const file_result_t* files, int num_files) {
+    fprintf(out, "[\n");
+    for (int i = 0; i < num_files; i++) {
+        const file_result_t* r = &files[i];
+        fprintf(out, "  {\"file\": ");
+        write_json_string(out, r->path);
+        if (!r->ok) {
+            fprintf(out, ", \"error\": true}%s\n", i + 1 < num_files ? "," : "");
+            continue;
+        }
+
+        fprintf(out, ", \"sample_rate\": %d, \"duration\": %.3f, \"noise_floor\": %.6f, \"segments\": [",
+                r->sample_rate, (double)r->num_samples / r->sample_rate, r->noise_floor);
+        for (int s = 0; s < r->num_segments; s++) {
+            const segment_t* seg = &r->segments[s];
+            fprintf(out, "%s\n    {\"start\": %.3f, \"end\": %.3f, \"start_sample\": %llu, "
+                    "\"end_sample\": %llu, \"rms\": %.5f, \"peak\": %.5f, \"zcr\": %.4f, "
+                    "\"flatness\": %.4f, \"flux\": %.4f, \"voice_share\": %.4f}",
+                    s > 0 ? "," : "",
+                    (double)seg->start / r->sample_rate, (double)seg->end / r->sample_rate,
+                    (unsigned long long)seg->start, (unsigned long long)seg->end,
+                    seg->rms, seg->peak, seg->zcr, seg->flatness, seg->flux, seg->voice_share);
+        }
+        fprintf(out, "%s]}%s\n", r->num_segments > 0 ? "\n  " : "", i + 1 < num_files ? "," : "");
+    }
+    fprintf(out, "]\n");
+}
+
+static void write_csv_field(FILE* out, const char* s) {
+    if (!strpbrk(s, ",\"\n")) {
+        fputs(s, out);
+        return;
+    }
+    fputc('"', out);
+    for (; *s; s++) {
+        if (*s == '"') fputc('"', out);
+        fputc(*s, out);
+    }
+    fputc('"', out);
+}
+
+static void write_csv(FILE* out, const file_result_t* files, int num_files) {
+    fprintf(out, "file,segment,start,end,start_sample,end_sample,rms,peak,zcr,flatness,flux,voice_share\n");
+    for (int i = 0; i < num_files; i++) {
+        const file_result_t* r = &files[i];
+        for (int s = 0; r->ok && s < r->num_segments; s++) {
+            const segment_t* seg = &r->segments[s];
+            write_csv_field(out, r->path);
+            fprintf(out, ",%d,%.3f,%.3f,%llu,%llu,%.5f,%.5f,%.4f,%.4f,%.4f,%.4f\n", s,
+                    (double)seg->start / r->sample_rate, (double)seg->end / r->sample_rate,
+                    (unsigned long long)seg->start, (unsigned long long)seg->end,
+                    seg->rms, seg->peak, seg->zcr, seg->flatness, seg->flux, seg->voice_share);
+        }
+    }
+}
+
+/* ============================================================================
+ * Main
+ * ========================================================================= */
+
+static void print_usage(const char* program_name) {
+    printf("Usage: %s [options] FILE.wav...\n\n", program_name);
+    printf("Find speech segments in WAV files (16/24/32-bit PCM or float).\n\n");
+    printf("Options:\n");
+    printf("  -m, --mode N          VAD mode: 0=quality, 1=balanced, 2=aggressive (default: 1)\n");
+    printf("  -t, --threads N       Worker threads (default: online CPUs)\n");
+    printf("  -c, --calibrate MS    Lead-in taken as background noise, 0 = fixed threshold (default: %d)\n",
+           CALIBRATE_MS_DEFAULT);
+    printf("  -f, --format FMT      json or csv (default: from --output extension, else json)\n");
+    printf("  -o, --output FILE     Write results to FILE (default: stdout)\n");
+    printf("  -h, --help            Show this help message\n");
+}
+
+static double wall_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char** argv) {
+    int mode = 1;
+    int calibrate_ms = CALIBRATE_MS_DEFAULT;
+    long online_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int num_threads = online_cpus > 0 ? (int)online_cpus : 1;
+    const char* output_path = NULL;
+    const char* format_name = NULL;
+
+    static struct option long_options[] = {
+        {"mode",      required_argument, 0, 'm'},
+        {"threads",   required_argument, 0, 't'},
+        {"calibrate", required_argument, 0, 'c'},
+        {"format",    required_argument, 0, 'f'},
+        {"output",    required_argument, 0, 'o'},
+        {"help",      no_argument,       0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "m:t:c:f:o:h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'm':
+                mode = atoi(optarg);
+                if (mode < 0 || mode > 2) {
+                    fprintf(stderr, "ERROR: Invalid VAD mode. Use 0, 1 or 2\n");
+                    return 1;
+                }
+                break;
+            case 't':
+                num_threads = atoi(optarg);
+                if (num_threads < 1) {
+                    fprintf(stderr, "ERROR: Thread count must be at least 1\n");
+                    return 1;
+                }
+                break;
+            case 'c':
+                calibrate_ms = atoi(optarg);
+                if (calibrate_ms < 0) {
+                    fprintf(stderr, "ERROR: Calibration time must not be negative\n");
+                    return 1;
+                }
+                break;
+            case 'f':
+                format_name = optarg;
+                break;
+            case 'o':
+                output_path = optarg;
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+
+    int num_files = argc - optind;
+    if (num_files < 1) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    output_format_t format = OUTPUT_JSON;
+    if (!format_name && output_path) {
+        const char* dot = strrchr(output_path, '.');
+        format_name = dot && strcmp(dot, ".csv") == 0 ? "csv" : "json";
+    }
+    if (format_name && strcmp(format_name, "csv") == 0) {
+        format = OUTPUT_CSV;
+    } else if (format_name && strcmp(format_name, "json") != 0) {
+        fprintf(stderr, "ERROR: Unknown format '%s' (json or csv)\n", format_name);
+        return 1;
+    }
+
+    job_t job = {
+        .files = (file_result_t*)calloc(num_files, sizeof(file_result_t)),
+        .num_files = num_files,
+        .mode = mode,
+        .calibrate_ms = calibrate_ms,
+    };
+    if (!job.files) {
+        fprintf(stderr, "ERROR: Out of memory\n");
+        return 1;
+    }
+    atomic_init(&job.next, 0);
+    for (int i = 0; i < num_files; i++) {
+        job.files[i].path = argv[optind + i];
+    }
+
+    if (num_threads > num_files) num_threads = num_files;
+    pthread_t* threads = (pthread_t*)calloc(num_threads, sizeof(pthread_t));
+    if (!threads) {
+        fprintf(stderr, "ERROR: Out of memory\n");
+        return 1;
+    }
+
+    /* The main thread is worker 0 */
+    double start = wall_seconds();
+    int started = 1;
+    for (; started < num_threads; started++) {
+        if (pthread_create(&threads[started], NULL, worker_main, &job) != 0) {
+            fprintf(stderr, "WARNING: Started only %d of %d threads\n", started, num_threads);
+            break;
+        }
+    }
+    worker_main(&job);
+    for (int t = 1; t < started; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    double elapsed = wall_seconds() - start;
+
+    FILE* out = stdout;
+    if (output_path && !(out = fopen(output_path, "w"))) {
+        fprintf(stderr, "ERROR: Failed to open %s for writing\n", output_path);
+        return 1;
+    }
+    if (format == OUTPUT_CSV) {
+        write_csv(out, job.files, num_files);
+    } else {
+        write_json(out, job.files, num_files);
+    }
+
+    double audio_seconds = 0.0;
+    int failed = 0;
+    long segments = 0;
+    for (int i = 0; i < num_files; i++) {
+        if (!job.files[i].ok) {
+            failed++;
+            continue;
+        }
+        audio_seconds += (double)job.files[i].num_samples / job.files[i].sample_rate;
+        segments += job.files[i].num_segments;
+    }
+    fprintf(stderr, "%d files, %ld segments, %.1fs of audio in %.2fs (%.0fx realtime, %d threads)%s\n",
+            num_files - failed, segments, audio_seconds, elapsed,
+            elapsed > 0.0 ? audio_seconds / elapsed : 0.0, started,
+            failed ? ", some files failed" : "");
+
+    int status = (out != stdout && fclose(out) != 0) ? 1 : 0;
+    for (int i = 0; i < num_files; i++) {
+        free(job.files[i].segments);
+    }
+    free(job.files);
+    free(threads);
+    return failed || status ? 1 : 0;
+}